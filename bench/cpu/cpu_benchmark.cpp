@@ -0,0 +1,168 @@
+/**
+ * Compare the interpreters of the CPU on a program exercising loads, ALU and
+ * CB-prefixed instructions, calls and the stack, running until HALT.
+ * @file cpu_benchmark.cpp
+ */
+#include <catch2/catch.hpp>
+
+#include <algorithm>
+#include <vector>
+
+#include <knocknock/cpu/cpu.h>
+#include <knocknock/memory/flat_rom.h>
+#include <knocknock/memory/internal_ram.h>
+#include <knocknock/memory/mmu.h>
+#include <knocknock/memory/regions.h>
+
+namespace cpu {
+
+namespace {
+
+// clang-format off
+const std::vector<memory::MemoryValue> PROGRAM = {
+    0x21, 0x00, 0xc0,  // 0100: LD HL, $c000
+    0x01, 0x00, 0x20,  // 0103: LD BC, $2000
+    0xaf,              // 0106: XOR A
+    0x86,              // 0107: ADD A, (HL)
+    0x07,              // 0108: RLCA
+    0x77,              // 0109: LD (HL), A
+    0x23,              // 010a: INC HL
+    0xcd, 0x20, 0x01,  // 010b: CALL $0120
+    0x0b,              // 010e: DEC BC
+    0x57,              // 010f: LD D, A
+    0x78,              // 0110: LD A, B
+    0xb1,              // 0111: OR C
+    0x7a,              // 0112: LD A, D
+    0x20, 0xf2,        // 0113: JR NZ, $0107
+    0x76,              // 0115: HALT
+};
+
+const std::vector<memory::MemoryValue> SUBROUTINE = {
+    0xcb, 0x37,        // 0120: SWAP A
+    0xcb, 0x40,        // 0122: BIT 0, B
+    0xc5,              // 0124: PUSH BC
+    0xc1,              // 0125: POP BC
+    0xc9,              // 0126: RET
+};
+// clang-format on
+
+// Number of instructions executed by the program, including the final HALT:
+// three to set up, then 16 for each of the 0x2000 iterations.
+constexpr size_t INSTRUCTION_COUNT = 3 + 0x2000 * 16 + 1;
+
+// M-cycles per CPU::run() call: one scanline.
+constexpr uint32_t BATCH_CYCLES = 114;
+
+/**
+ * ROM and RAM the program runs from.
+ */
+class Machine {
+public:
+    Machine() : rom_(make_rom(), memory::RAM_EXTERNAL_SIZE), ram_(), mmu_() {
+        mmu_.register_region(&rom_, memory::ROM_0_BEGIN,
+                             memory::ROM_SWITCHABLE_END);
+        mmu_.register_region(&ram_, memory::RAM_INTERNAL_BEGIN,
+                             memory::RAM_INTERNAL_END);
+        mmu_.register_region(&ram_, memory::HRAM_BEGIN, memory::HRAM_END);
+    }
+
+    memory::Memory *mmu() { return &mmu_; }
+
+private:
+    static std::vector<memory::MemoryValue> make_rom() {
+        std::vector<memory::MemoryValue> rom(
+            memory::ROM_0_SIZE + memory::ROM_SWITCHABLE_SIZE, 0x00);
+        std::copy(PROGRAM.begin(), PROGRAM.end(), rom.begin() + 0x0100);
+        std::copy(SUBROUTINE.begin(), SUBROUTINE.end(), rom.begin() + 0x0120);
+        return rom;
+    }
+
+    memory::FlatROM rom_;
+    memory::InternalRAM ram_;
+    memory::MMU mmu_;
+};
+
+/**
+ * Run the program to completion.
+ * @param hits, misses if not nullptr, receive the counters of the decoded
+ * cache.
+ * @return the number of ticks taken.
+ */
+size_t run_program(Machine *machine,
+                   CPU::Interpreter interpreter,
+                   uint64_t *hits = nullptr,
+                   uint64_t *misses = nullptr) {
+    CPU cpu(machine->mmu(), interpreter);
+
+    size_t ticks = 0;
+    while (!cpu.halted()) {
+        cpu.tick();
+        ticks++;
+    }
+
+    if (hits != nullptr && misses != nullptr) {
+        *hits = cpu.decoded_cache().hits();
+        *misses = cpu.decoded_cache().misses();
+    }
+
+    return ticks;
+}
+
+/**
+ * Run the program to completion through CPU::run().
+ * @return the number of elapsed M-cycles.
+ */
+size_t run_program_batched(Machine *machine, CPU::Interpreter interpreter) {
+    CPU cpu(machine->mmu(), interpreter);
+
+    size_t cycles = 0;
+    while (!cpu.halted()) {
+        cycles += cpu.run(BATCH_CYCLES);
+    }
+
+    return cycles;
+}
+
+}  // namespace
+
+TEST_CASE("CPU interpreters", "[benchmark][cpu]") {
+    Machine machine;
+
+    // Both interpreters run the same instructions, but the decoder spends one
+    // tick per byte while the threaded interpreter spends one per M-cycle.
+    REQUIRE(run_program(&machine, CPU::Interpreter::DECODER) > 0);
+    REQUIRE(run_program(&machine, CPU::Interpreter::THREADED) > 0);
+
+    // The micro-op interpreter also spends one tick per M-cycle, plus the
+    // fetch of the first opcode.
+    REQUIRE(run_program(&machine, CPU::Interpreter::MICRO_OP) ==
+            run_program(&machine, CPU::Interpreter::THREADED) + 1);
+
+    uint64_t hits = 0, misses = 0;
+    REQUIRE(run_program(&machine, CPU::Interpreter::CACHED_DECODER, &hits,
+                        &misses) ==
+            run_program(&machine, CPU::Interpreter::DECODER));
+
+    WARN("Instructions per run: " << INSTRUCTION_COUNT);
+    WARN("Decoded cache hits: " << hits << ", misses: " << misses);
+    BENCHMARK("Decoder") {
+        return run_program(&machine, CPU::Interpreter::DECODER);
+    };
+    BENCHMARK("Cached decoder") {
+        return run_program(&machine, CPU::Interpreter::CACHED_DECODER);
+    };
+    BENCHMARK("Threaded") {
+        return run_program(&machine, CPU::Interpreter::THREADED);
+    };
+    BENCHMARK("Micro-op") {
+        return run_program(&machine, CPU::Interpreter::MICRO_OP);
+    };
+    BENCHMARK("Threaded, batched") {
+        return run_program_batched(&machine, CPU::Interpreter::THREADED);
+    };
+    BENCHMARK("Micro-op, batched") {
+        return run_program_batched(&machine, CPU::Interpreter::MICRO_OP);
+    };
+}
+
+}  // namespace cpu
@@ -0,0 +1,18 @@
+#define CATCH_CONFIG_RUNNER
+
+#include <glog/logging.h>
+#include <catch2/catch.hpp>
+
+int main(int argc, char *argv[]) {
+    google::InitGoogleLogging(argv[0]);
+    google::InstallFailureSignalHandler();
+
+    // Write log to stderr
+    FLAGS_logtostderr = true;
+
+    // Only log errors, so logging does not skew the measurements.
+    FLAGS_minloglevel = google::GLOG_ERROR;
+
+    // Then run the benchmarks.
+    return Catch::Session().run(argc, argv);
+}
@@ -0,0 +1,390 @@
+/**
+ * Compare the page table MMU against a linear scan over all registered
+ * regions, and against reading through the published host pointers, on the
+ * set of regions a running Game Boy registers. Also compare copying the
+ * address space one byte at a time and block by block, as a memory viewer or
+ * a save state would, MBC1 ROM reads with and without cached bank bases, and
+ * MBC5 ROM reads on small and large ROMs.
+ * @file mmu_benchmark.cpp
+ */
+#include <catch2/catch.hpp>
+
+#include <random>
+#include <vector>
+
+#include <knocknock/interrupt.h>
+#include <knocknock/memory/direct_memory.h>
+#include <knocknock/memory/flat_rom.h>
+#include <knocknock/memory/internal_ram.h>
+#include <knocknock/memory/mbc1.h>
+#include <knocknock/memory/mbc5.h>
+#include <knocknock/memory/mmu.h>
+#include <knocknock/memory/regions.h>
+#include <knocknock/peripherals/joypad.h>
+#include <knocknock/peripherals/serial.h>
+#include <knocknock/ppu/dma.h>
+
+namespace memory {
+
+namespace {
+
+/**
+ * The MMU as it was before the page table: every access scans all regions.
+ */
+class LinearMMU : public Memory {
+public:
+    void register_region(Memory *region, MemoryAddr start, MemoryAddr end) {
+        regions_.push_back({region, start, end});
+    }
+
+    MemoryValue read(MemoryAddr addr) const override {
+        for (const auto &region : regions_) {
+            if (BETWEEN(region.start, addr, region.end)) {
+                return region.region->read(addr);
+            }
+        }
+
+        return 0xff;
+    }
+
+    void write(MemoryAddr addr, MemoryValue value) override {
+        for (const auto &region : regions_) {
+            if (BETWEEN(region.start, addr, region.end)) {
+                region.region->write(addr, value);
+                return;
+            }
+        }
+    }
+
+private:
+    struct Region {
+        Memory *region;
+        MemoryAddr start;
+        MemoryAddr end;
+    };
+
+    std::vector<Region> regions_;
+};
+
+/**
+ * The ROM reads of MBC1 as they were before the bank bases were cached:
+ * every read decodes the bank registers and wraps around the ROM.
+ */
+class TranslatingMBC1 : public Memory {
+public:
+    explicit TranslatingMBC1(std::vector<MemoryValue> rom)
+        : rom_(std::move(rom)), bank1_(1), bank2_(0), mode_1_(false) {}
+
+    MemoryValue read(MemoryAddr addr) const override {
+        uint32_t bank = 0;
+        uint32_t addr_in_bank = 0;
+        if (BETWEEN(ROM_0_BEGIN, addr, ROM_0_END)) {
+            bank = mode_1_ ? bank2_ << 5 : 0;
+            addr_in_bank = addr - ROM_0_BEGIN;
+        } else if (BETWEEN(ROM_SWITCHABLE_BEGIN, addr, ROM_SWITCHABLE_END)) {
+            bank = (bank2_ << 5) | bank1_;
+            addr_in_bank = addr - ROM_SWITCHABLE_BEGIN;
+        } else {
+            return 0xff;
+        }
+
+        return rom_[(bank * ROM_SWITCHABLE_SIZE + addr_in_bank) % rom_.size()];
+    }
+
+    void write(MemoryAddr addr, MemoryValue value) override {
+        if (BETWEEN(0x2000, addr, 0x3fff)) {
+            bank1_ = value & 0x1f;
+            if (bank1_ == 0) {
+                bank1_ = 1;
+            }
+        } else if (BETWEEN(0x4000, addr, 0x5fff)) {
+            bank2_ = value & 0x03;
+        } else if (BETWEEN(0x6000, addr, 0x7fff)) {
+            mode_1_ = (value & 1) != 0;
+        }
+    }
+
+private:
+    const std::vector<MemoryValue> rom_;
+    uint8_t bank1_;
+    uint8_t bank2_;
+    bool mode_1_;
+};
+
+class NullSink : public interrupt::Interruptible {
+public:
+    bool interrupt(interrupt::InterruptType) override { return false; }
+};
+
+/**
+ * All regions of a Game Boy, registered to an MMU in the order the emulator
+ * registers them: cartridge first, then RAM, then the peripherals.
+ */
+template <class MMUType>
+class Machine {
+public:
+    explicit Machine(std::unique_ptr<ROMLoadableMemory> cartridge)
+        : cartridge_(std::move(cartridge)),
+          ram_(),
+          serial_(),
+          joypad_(),
+          dma_(&mmu_),
+          sink_(),
+          interrupt_controller_(&sink_) {
+        mmu_.register_region(cartridge_.get(), ROM_0_BEGIN,
+                             ROM_SWITCHABLE_END);
+        mmu_.register_region(cartridge_.get(), RAM_EXTERNAL_BEGIN,
+                             RAM_EXTERNAL_END);
+        mmu_.register_region(&ram_, RAM_INTERNAL_BEGIN, RAM_INTERNAL_END);
+        mmu_.register_region(&ram_, RAM_ECHO_BEGIN, RAM_ECHO_END);
+        mmu_.register_region(&joypad_, 0xff00, 0xff00);
+        mmu_.register_region(&serial_, 0xff01, 0xff02);
+        mmu_.register_region(&interrupt_controller_, 0xff0f, 0xff0f);
+        mmu_.register_region(&dma_, 0xff46, 0xff46);
+        mmu_.register_region(&ram_, HRAM_BEGIN, HRAM_END);
+        mmu_.register_region(&interrupt_controller_, IE_REG, IE_REG);
+    }
+
+    MMUType &mmu() { return mmu_; }
+
+private:
+    MMUType mmu_;
+
+    std::unique_ptr<ROMLoadableMemory> cartridge_;
+    InternalRAM ram_;
+    peripherals::Serial serial_;
+    peripherals::Joypad joypad_;
+    ppu::DMA dma_;
+    NullSink sink_;
+    interrupt::InterruptController interrupt_controller_;
+};
+
+/**
+ * Generate a trace of read addresses resembling a running game: mostly
+ * instruction fetches from ROM, then WRAM and HRAM accesses, and the
+ * occasional IO register poll.
+ */
+std::vector<MemoryAddr> generate_trace() {
+    constexpr size_t TRACE_SIZE = 1 << 16;
+
+    const std::vector<MemoryAddr> io_registers = {0xff00, 0xff01, 0xff02,
+                                                  0xff0f, 0xff46, 0xffff};
+
+    std::mt19937 rng(0x6b6e6f63);
+    std::discrete_distribution<int> kind({60, 10, 15, 10, 5});
+    std::uniform_int_distribution<uint32_t> any;
+
+    std::vector<MemoryAddr> trace;
+    trace.reserve(TRACE_SIZE);
+    for (size_t i = 0; i < TRACE_SIZE; ++i) {
+        switch (kind(rng)) {
+            case 0:
+                trace.push_back(ROM_0_BEGIN + any(rng) % (ROM_0_SIZE * 2));
+                break;
+            case 1:
+                trace.push_back(RAM_EXTERNAL_BEGIN +
+                                any(rng) % RAM_EXTERNAL_SIZE);
+                break;
+            case 2:
+                trace.push_back(RAM_INTERNAL_BEGIN +
+                                any(rng) % RAM_INTERNAL_SIZE);
+                break;
+            case 3: trace.push_back(HRAM_BEGIN + any(rng) % HRAM_SIZE); break;
+            case 4:
+                trace.push_back(io_registers[any(rng) % io_registers.size()]);
+                break;
+        }
+    }
+
+    return trace;
+}
+
+template <class MemoryType>
+uint32_t read_trace(const MemoryType &mmu, const std::vector<MemoryAddr> &trace) {
+    uint32_t sum = 0;
+    for (MemoryAddr addr : trace) {
+        sum += mmu.read(addr);
+    }
+
+    return sum;
+}
+
+std::unique_ptr<ROMLoadableMemory> make_flat_rom() {
+    return std::make_unique<FlatROM>(
+        std::vector<MemoryValue>(ROM_0_SIZE + ROM_SWITCHABLE_SIZE, 0x00),
+        RAM_EXTERNAL_SIZE);
+}
+
+std::unique_ptr<ROMLoadableMemory> make_mbc1() {
+    auto mbc1 = std::make_unique<MBC1>(
+        std::vector<MemoryValue>(64 * ROM_SWITCHABLE_SIZE, 0x00),
+        RAM_EXTERNAL_SIZE);
+    // Enable RAM so reads to the external RAM do not log.
+    mbc1->write(0x0000, 0x0a);
+    return mbc1;
+}
+
+/**
+ * An access to the cartridge: a ROM read, or a bank switch if |bank| is set.
+ */
+struct CartridgeAccess {
+    MemoryAddr addr;
+    bool bank;
+    MemoryValue value;
+};
+
+/**
+ * Generate a trace of ROM reads, as runs of instruction fetches from both ROM
+ * regions, with the occasional bank switch.
+ */
+std::vector<CartridgeAccess> generate_rom_trace() {
+    constexpr size_t TRACE_SIZE = 1 << 16;
+    constexpr size_t RUN_LENGTH = 16;
+
+    std::mt19937 rng(0x6d626331);
+    std::uniform_int_distribution<uint32_t> any;
+
+    std::vector<CartridgeAccess> trace;
+    trace.reserve(TRACE_SIZE);
+    while (trace.size() < TRACE_SIZE) {
+        if (any(rng) % 16 == 0) {
+            trace.push_back({0x2000, true, static_cast<MemoryValue>(any(rng))});
+        }
+
+        const auto start = static_cast<MemoryAddr>(
+            ROM_0_BEGIN + any(rng) % (ROM_0_SIZE * 2 - RUN_LENGTH));
+        for (size_t i = 0; i < RUN_LENGTH; ++i) {
+            trace.push_back({static_cast<MemoryAddr>(start + i), false, 0});
+        }
+    }
+
+    return trace;
+}
+
+uint32_t run_rom_trace(Memory *cartridge,
+                       const std::vector<CartridgeAccess> &trace) {
+    uint32_t sum = 0;
+    for (const CartridgeAccess &access : trace) {
+        if (access.bank) {
+            cartridge->write(access.addr, access.value);
+        } else {
+            sum += cartridge->read(access.addr);
+        }
+    }
+
+    return sum;
+}
+
+}  // namespace
+
+TEST_CASE("MMU dispatch (FlatROM)", "[benchmark][memory][mmu]") {
+    const auto trace = generate_trace();
+
+    Machine<LinearMMU> linear(make_flat_rom());
+    Machine<MMU> paged(make_flat_rom());
+
+    REQUIRE(read_trace(linear.mmu(), trace) == read_trace(paged.mmu(), trace));
+
+    DirectMemory direct(&paged.mmu());
+    REQUIRE(read_trace(direct, trace) == read_trace(paged.mmu(), trace));
+
+    BENCHMARK("Linear scan") { return read_trace(linear.mmu(), trace); };
+    BENCHMARK("Page table") { return read_trace(paged.mmu(), trace); };
+    BENCHMARK("Host pointers") { return read_trace(direct, trace); };
+}
+
+TEST_CASE("MMU dispatch (MBC1)", "[benchmark][memory][mmu]") {
+    const auto trace = generate_trace();
+
+    Machine<LinearMMU> linear(make_mbc1());
+    Machine<MMU> paged(make_mbc1());
+
+    REQUIRE(read_trace(linear.mmu(), trace) == read_trace(paged.mmu(), trace));
+
+    DirectMemory direct(&paged.mmu());
+    REQUIRE(read_trace(direct, trace) == read_trace(paged.mmu(), trace));
+
+    BENCHMARK("Linear scan") { return read_trace(linear.mmu(), trace); };
+    BENCHMARK("Page table") { return read_trace(paged.mmu(), trace); };
+    BENCHMARK("Host pointers") { return read_trace(direct, trace); };
+}
+
+TEST_CASE("MMU blocks (MBC1)", "[benchmark][memory][mmu]") {
+    Machine<MMU> machine(make_mbc1());
+    MMU &mmu = machine.mmu();
+
+    // The cartridge ROM and RAM, and WRAM.
+    const MemoryAddr begin = ROM_0_BEGIN;
+    const MemorySize size = RAM_INTERNAL_END + 1 - begin;
+    std::vector<MemoryValue> bytes(size);
+    std::vector<MemoryValue> blocks(size);
+
+    auto read_bytes = [&] {
+        for (MemorySize i = 0; i < size; ++i) {
+            // Skip VRAM, which is not registered here.
+            if (!BETWEEN(VRAM_BEGIN, begin + i, VRAM_END)) {
+                bytes[i] = mmu.read(begin + i);
+            }
+        }
+        return bytes[size - 1];
+    };
+    auto read_blocks = [&] {
+        mmu.read_block(ROM_0_BEGIN, blocks.data(), VRAM_BEGIN - ROM_0_BEGIN);
+        mmu.read_block(RAM_EXTERNAL_BEGIN,
+                       blocks.data() + (RAM_EXTERNAL_BEGIN - begin),
+                       RAM_INTERNAL_END + 1 - RAM_EXTERNAL_BEGIN);
+        return blocks[size - 1];
+    };
+
+    read_bytes();
+    read_blocks();
+    REQUIRE(bytes == blocks);
+
+    BENCHMARK("Byte by byte") { return read_bytes(); };
+    BENCHMARK("Blocks") { return read_blocks(); };
+}
+
+TEST_CASE("MBC1 ROM reads", "[benchmark][memory][mbc1]") {
+    const auto trace = generate_rom_trace();
+
+    // A 1 MByte ROM, each byte holding the low bits of its bank number.
+    std::vector<MemoryValue> rom(64 * ROM_SWITCHABLE_SIZE);
+    for (size_t i = 0; i < rom.size(); ++i) {
+        rom[i] = static_cast<MemoryValue>(i / ROM_SWITCHABLE_SIZE);
+    }
+
+    // The cartridge is read directly, as the MMU reads the ROM through host
+    // pointers and would not call read().
+    TranslatingMBC1 translating(rom);
+    MBC1 cached(rom, 0);
+
+    REQUIRE(run_rom_trace(&translating, trace) ==
+            run_rom_trace(&cached, trace));
+
+    BENCHMARK("Translated on every read") {
+        return run_rom_trace(&translating, trace);
+    };
+    BENCHMARK("Cached bank bases") { return run_rom_trace(&cached, trace); };
+}
+
+TEST_CASE("MBC5 ROM reads", "[benchmark][memory][mbc5]") {
+    const auto trace = generate_rom_trace();
+
+    // A bank switch costs the same whatever the size of the ROM, and so does
+    // a read.
+    auto make_rom = [](size_t banks) {
+        std::vector<MemoryValue> rom(banks * ROM_SWITCHABLE_SIZE);
+        for (size_t i = 0; i < rom.size(); ++i) {
+            rom[i] = static_cast<MemoryValue>(i / ROM_SWITCHABLE_SIZE);
+        }
+        return rom;
+    };
+    MBC5 small(make_rom(2), 0, false);
+    MBC5 large(make_rom(512), 0, false);
+    large.write(0x3000, 0x01);
+
+    BENCHMARK("32 KByte ROM") { return run_rom_trace(&small, trace); };
+    BENCHMARK("8 MByte ROM") { return run_rom_trace(&large, trace); };
+}
+
+}  // namespace memory
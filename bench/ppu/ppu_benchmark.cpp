@@ -0,0 +1,178 @@
+/**
+ * Measure the scanline renderer on a busy frame: a scrolled background, the
+ * window over the bottom half and rows of 10 sprites, with and without
+ * the tile cache, and compare the tile decoders it is built on. Also measure
+ * the frame skip modes, which keep the timing of the PPU but draw fewer frames,
+ * and OAM DMA copying one byte per cycle or whole transfers at once.
+ * @file ppu_benchmark.cpp
+ */
+#include <catch2/catch.hpp>
+
+#include <chrono>
+#include <random>
+#include <vector>
+
+#include <knocknock/interrupt.h>
+#include <knocknock/memory/internal_ram.h>
+#include <knocknock/memory/mmu.h>
+#include <knocknock/memory/regions.h>
+#include <knocknock/peripherals/scheduler.h>
+#include <knocknock/ppu/dma.h>
+#include <knocknock/ppu/ppu.h>
+#include <knocknock/ppu/tile.h>
+#include <knocknock/ppu/tile_cache.h>
+
+#include "peripherals/stubs.h"
+
+namespace ppu {
+
+namespace {
+
+using peripherals::testing::IgnoreInterrupts;
+using peripherals::testing::NoCPU;
+
+// Frames rendered to measure the rate of lines.
+constexpr int RATE_FRAMES = 1000;
+
+// M-cycles in a frame.
+constexpr uint32_t FRAME_CYCLES = 17556;
+
+/**
+ * A PPU with random tiles and maps, and the window and 40 sprites enabled.
+ */
+void setup_busy_frame(PPU *ppu) {
+    std::mt19937 rng(42);
+    std::uniform_int_distribution<int> byte(0x00, 0xff);
+
+    for (memory::MemoryAddr addr = memory::VRAM_BEGIN;
+         addr <= memory::VRAM_END; ++addr) {
+        ppu->write(addr, byte(rng));
+    }
+
+    // Sprites in 4 rows of 10, the most a line can show.
+    for (int i = 0; i < 40; ++i) {
+        const memory::MemoryAddr addr = memory::OAM_BEGIN + i * 4;
+        ppu->write(addr, 16 + (i / 10) * 36);
+        ppu->write(addr + 1, 8 + (i % 10) * 15);
+        ppu->write(addr + 2, byte(rng));
+        ppu->write(addr + 3, byte(rng) & 0xf0);
+    }
+
+    ppu->write(0xff40, 0xf7);  // Everything on, 8x16 sprites.
+    ppu->write(0xff42, 13);    // SCY
+    ppu->write(0xff43, 5);     // SCX
+    ppu->write(0xff47, 0xe4);  // BGP
+    ppu->write(0xff48, 0xd2);  // OBP0
+    ppu->write(0xff49, 0x1b);  // OBP1
+    ppu->write(0xff4a, 72);    // WY
+    ppu->write(0xff4b, 47);    // WX
+}
+
+uint8_t render_frame(PPU *ppu) {
+    for (size_t line = 0; line < SCREEN_HEIGHT; ++line) {
+        ppu->render_line(line);
+    }
+    return ppu->framebuffer()[SCREEN_WIDTH * SCREEN_HEIGHT / 2];
+}
+
+}  // namespace
+
+TEST_CASE("Scanline renderer", "[benchmark][ppu]") {
+    IgnoreInterrupts interrupts;
+    PPU ppu(&interrupts);
+    setup_busy_frame(&ppu);
+
+    const auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < RATE_FRAMES; ++i) {
+        render_frame(&ppu);
+    }
+    const std::chrono::duration<double> elapsed =
+        std::chrono::steady_clock::now() - start;
+    WARN("Rendered lines per second: "
+         << static_cast<uint64_t>(RATE_FRAMES * SCREEN_HEIGHT /
+                                  elapsed.count()));
+
+    WARN("Lines per frame: " << SCREEN_HEIGHT);
+    BENCHMARK("Frame") { return render_frame(&ppu); };
+
+    // Every tile is decoded again, as if the tile cache did not exist.
+    BENCHMARK("Frame, all tiles rewritten") {
+        for (size_t i = 0; i < TILE_COUNT * TILE_SIZE; i += TILE_SIZE) {
+            const memory::MemoryAddr addr = memory::VRAM_BEGIN + i;
+            ppu.write(addr, ppu.read(addr));
+        }
+        return render_frame(&ppu);
+    };
+}
+
+TEST_CASE("Tile decoders", "[benchmark][ppu]") {
+    // The rows of the tiles spanning a line.
+    constexpr size_t ROWS = SCREEN_WIDTH / TILE_WIDTH + 1;
+
+    std::mt19937 rng(42);
+    std::uniform_int_distribution<int> byte(0x00, 0xff);
+    std::vector<uint8_t> rows(ROWS * 2);
+    for (uint8_t &value : rows) {
+        value = byte(rng);
+    }
+    std::vector<uint8_t> pixels(ROWS * TILE_WIDTH);
+
+    BENCHMARK("Scalar") {
+        decode_tile_rows_scalar(rows.data(), ROWS, pixels.data());
+        return pixels[ROWS];
+    };
+    BENCHMARK("Vectorized") {
+        decode_tile_rows(rows.data(), ROWS, pixels.data());
+        return pixels[ROWS];
+    };
+}
+
+TEST_CASE("Frame skip", "[benchmark][ppu]") {
+    IgnoreInterrupts interrupts;
+    NoCPU cpu;
+    peripherals::Scheduler scheduler(&cpu);
+    PPU ppu(&interrupts, &scheduler);
+    setup_busy_frame(&ppu);
+
+    // Each run goes through one frame of PPU events, so the mean of one frame
+    // out of 4 is the average over drawn and skipped frames.
+    ppu.set_frame_skip(1);
+    BENCHMARK("Every frame") { return scheduler.run(FRAME_CYCLES); };
+
+    ppu.set_frame_skip(4);
+    BENCHMARK("One frame out of 4") { return scheduler.run(FRAME_CYCLES); };
+
+    ppu.set_render_on_demand(true);
+    BENCHMARK("On demand, none requested") {
+        return scheduler.run(FRAME_CYCLES);
+    };
+}
+
+TEST_CASE("OAM DMA", "[benchmark][ppu]") {
+    IgnoreInterrupts interrupts;
+    NoCPU cpu;
+    peripherals::Scheduler scheduler(&cpu);
+    memory::InternalRAM ram;
+    PPU ppu(&interrupts);
+    memory::MMU mmu;
+    mmu.register_region(&ram, memory::RAM_INTERNAL_BEGIN,
+                        memory::RAM_INTERNAL_END);
+    ppu.register_to_mmu(&mmu);
+    DMA dma(&mmu, &scheduler);
+    dma.register_to_mmu(&mmu);
+
+    // A whole transfer from WRAM, as games copy their sprites.
+    auto transfer = [&] {
+        mmu.write(0xff46, memory::RAM_INTERNAL_BEGIN >> 8);
+        return scheduler.run(memory::OAM_SIZE);
+    };
+
+    BENCHMARK("One byte per cycle") { return transfer(); };
+
+    // Copied at once while the LCD is off.
+    ppu.write(0xff40, 0x00);
+    dma.set_bulk_transfers(true, &ppu);
+    BENCHMARK("Whole transfer") { return transfer(); };
+}
+
+}  // namespace ppu
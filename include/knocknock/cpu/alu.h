@@ -0,0 +1,451 @@
+/**
+ * Arithmetic and logic primitives shared by the interpreters. Each one comes
+ * in two overloads: one computing the flags into a FlagRegister, and one
+ * deferring them to a LazyFlagRegister.
+ * @file alu.h
+ */
+#pragma once
+
+#include <cstdint>
+
+#include "knocknock/cpu/instruction.h"
+#include "knocknock/cpu/registers.h"
+
+namespace cpu::alu {
+
+inline uint8_t low_nibble(uint8_t value) {
+    return value & 0x0Fu;
+}
+
+inline uint8_t high_nibble(uint8_t value) {
+    return value >> 4u;
+}
+
+/**
+ * Evaluate the condition of a conditional instruction.
+ * @param flag FlagC, FlagNC, FlagZ or FlagNZ. Any other operand means the
+ * instruction is unconditional.
+ * @return true if the condition holds.
+ */
+template <typename FlagsT>
+bool condition(const FlagsT &f, Instruction::Operand flag) {
+    switch (flag) {
+        case Instruction::Operand::FlagC: return f.carry();
+        case Instruction::Operand::FlagNC: return !f.carry();
+        case Instruction::Operand::FlagZ: return f.zero();
+        case Instruction::Operand::FlagNZ: return !f.zero();
+        default: return true;
+    }
+}
+
+inline uint8_t add(FlagRegister &f, uint8_t x, uint8_t y) {
+    uint8_t new_value = x + y;
+
+    f.set_zero(new_value == 0);
+    f.set_subtract(false);
+    f.set_half_carry(low_nibble(x) + low_nibble(y) > 0xFu);
+    //    x + y > 0xFF
+    // => x     > 0xFF - y
+    f.set_carry(x > (0xFF - y));
+
+    return new_value;
+}
+
+inline uint8_t adc(FlagRegister &f, uint8_t x, uint8_t y) {
+    uint8_t carry = f.carry();
+    uint8_t new_value = x + y + carry;
+
+    f.set_zero(new_value == 0);
+    f.set_subtract(false);
+    f.set_half_carry((low_nibble(x) + low_nibble(y) + carry) > 0x0Fu);
+
+    // There are two possible scenarios here:
+    // * (x + y) overflows => (x + y + carry) overflows
+    // * x + y == 0xff, which does not overflow, but if carry = 1 then
+    //   x + y + carry == 0, which overflows.
+    f.set_carry((x > (0xFFu - y)) || (x + y == 0xFFu && carry));
+
+    return new_value;
+}
+
+inline uint8_t sub(FlagRegister &f, uint8_t x, uint8_t y) {
+    uint8_t new_value = x - y;
+
+    f.set_zero(new_value == 0);
+    f.set_subtract(true);
+    f.set_half_carry(low_nibble(x) < low_nibble(y));
+    f.set_carry(x < y);
+
+    return new_value;
+}
+
+inline uint8_t sbc(FlagRegister &f, uint8_t x, uint8_t y) {
+    uint8_t carry = f.carry();
+    uint8_t new_value = x - y - carry;
+
+    f.set_zero(new_value == 0);
+    f.set_subtract(true);
+    f.set_half_carry(low_nibble(x) < (low_nibble(y) + carry));
+
+    // There are two possible scenarios here:
+    // * (x - y) overflows => (x - y - carry) overflows.
+    // * (x - y) == 0, which does not overflow, but (x - y - carry) would
+    //   overflow if carry == 1.
+    f.set_carry((x < y) || (x == y && carry));
+
+    return new_value;
+}
+
+// AND instruction, named "and_" to avoid conflict with the "and" keyword.
+inline uint8_t and_(FlagRegister &f, uint8_t x, uint8_t y) {
+    uint8_t new_value = x & y;
+
+    f.set_carry(false);
+    f.set_half_carry(true);
+    f.set_subtract(false);
+    f.set_zero(new_value == 0);
+
+    return new_value;
+}
+
+// OR instruction, named "or_" to avoid conflict with the "or" keyword.
+inline uint8_t or_(FlagRegister &f, uint8_t x, uint8_t y) {
+    uint8_t new_value = x | y;
+
+    f.set_carry(false);
+    f.set_half_carry(false);
+    f.set_subtract(false);
+    f.set_zero(new_value == 0);
+
+    return new_value;
+}
+
+// XOR instruction, named "xor_" to avoid conflict with the "xor" keyword.
+inline uint8_t xor_(FlagRegister &f, uint8_t x, uint8_t y) {
+    uint8_t new_value = x ^ y;
+
+    f.set_carry(false);
+    f.set_half_carry(false);
+    f.set_subtract(false);
+    f.set_zero(new_value == 0);
+
+    return new_value;
+}
+
+// CP only sets the flags of the subtraction x - y.
+inline void cp(FlagRegister &f, uint8_t x, uint8_t y) {
+    f.set_zero(x == y);
+    f.set_subtract(true);
+    f.set_half_carry(low_nibble(x) < low_nibble(y));
+    f.set_carry(x < y);
+}
+
+inline uint8_t inc(FlagRegister &f, uint8_t value) {
+    uint8_t new_value = value + 1;
+
+    f.set_zero(new_value == 0);
+    f.set_subtract(false);
+    // If the low nibble of value is 0b1111 then 0b1111 + 0b1 would generate
+    // a carry bit.
+    f.set_half_carry(low_nibble(value) == 0xFu);
+
+    return new_value;
+}
+
+inline uint8_t dec(FlagRegister &f, uint8_t value) {
+    uint8_t new_value = value - 1;
+
+    f.set_zero(new_value == 0);
+    f.set_subtract(true);
+    // If the low nibble of value is 0b0000 then 0b0000 - 0b1 would generate
+    // a borrow.
+    f.set_half_carry(low_nibble(value) == 0x0u);
+
+    return new_value;
+}
+
+// ADD HL, rr
+inline uint16_t add16(FlagRegister &f, uint16_t x, uint16_t y) {
+    f.set_subtract(false);
+    f.set_half_carry((x & 0x0FFFu) + (y & 0x0FFFu) > 0x0FFFu);
+    //    x + y > 0xFFFF
+    // => x     > 0xFFFF - y
+    f.set_carry(x > (0xFFFF - y));
+
+    return x + y;
+}
+
+// SP + Imm8Sign, shared by ADD SP, Imm8Sign and LDHL SP, Imm8Sign.
+inline uint16_t add_sp(FlagRegister &f, uint16_t x, int8_t y) {
+    f.set_zero(false);
+    f.set_subtract(false);
+    // The half_carry flag here signifies carry from bit 3 to 4, not 11 to 12.
+    f.set_half_carry((x & 0x000Fu) + low_nibble(y) > 0x000Fu);
+    // The half_carry flag here signifies carry from bit 7 to 8, not 15 to 16.
+    f.set_carry((x & 0x00FFu) > (0x00FFu - (uint8_t)(y)));
+
+    return x + y;
+}
+
+inline uint8_t rlc(FlagRegister &f, uint8_t value) {
+    uint8_t new_value = (value << 1u) | (value >> 7u);
+
+    f.set_zero(new_value == 0);
+    f.set_subtract(false);
+    f.set_half_carry(false);
+    f.set_carry(value >> 7u);
+
+    return new_value;
+}
+
+inline uint8_t rrc(FlagRegister &f, uint8_t value) {
+    uint8_t new_value = (value >> 1u) | ((value & 0x1u) << 7u);
+
+    f.set_zero(new_value == 0);
+    f.set_subtract(false);
+    f.set_half_carry(false);
+    f.set_carry(value & 0x1u);
+
+    return new_value;
+}
+
+inline uint8_t rl(FlagRegister &f, uint8_t value) {
+    uint8_t carry = f.carry();
+    uint8_t new_value = (value << 1u) | carry;
+
+    f.set_zero(new_value == 0);
+    f.set_subtract(false);
+    f.set_half_carry(false);
+    f.set_carry(value >> 7u);
+
+    return new_value;
+}
+
+inline uint8_t rr(FlagRegister &f, uint8_t value) {
+    uint8_t carry = f.carry();
+    uint8_t new_value = (value >> 1u)     // shift the old value to the left
+                        | (carry << 7u);  // and make the 7th bit the carry
+
+    f.set_zero(new_value == 0);
+    f.set_subtract(false);
+    f.set_half_carry(false);
+    // Carry flag contains the value of bit 0
+    f.set_carry(value & 0x1u);
+
+    return new_value;
+}
+
+inline uint8_t sla(FlagRegister &f, uint8_t value) {
+    uint8_t new_value = value << 1u;
+
+    f.set_zero(new_value == 0);
+    f.set_subtract(false);
+    f.set_half_carry(false);
+    f.set_carry(value >> 7u);
+
+    return new_value;
+}
+
+inline uint8_t sra(FlagRegister &f, uint8_t value) {
+    uint8_t new_value = (value >> 1u) | ((value >> 7u) << 7u);
+
+    f.set_zero(new_value == 0);
+    f.set_subtract(false);
+    f.set_half_carry(false);
+    f.set_carry(value & 0x1u);
+
+    return new_value;
+}
+
+inline uint8_t swap(FlagRegister &f, uint8_t value) {
+    uint8_t new_value = high_nibble(value) | (low_nibble(value) << 4u);
+
+    f.set_zero(new_value == 0);
+    f.set_subtract(false);
+    f.set_half_carry(false);
+    f.set_carry(false);
+
+    return new_value;
+}
+
+inline uint8_t srl(FlagRegister &f, uint8_t value) {
+    uint8_t new_value = value >> 1u;
+
+    f.set_zero(new_value == 0);
+    f.set_subtract(false);
+    f.set_half_carry(false);
+    // Carry flag contains the value of bit 0
+    f.set_carry(value & 0x1u);
+
+    return new_value;
+}
+
+// BIT only sets the flags according to bit |bit| of |value|.
+inline void bit(FlagRegister &f, uint8_t bit, uint8_t value) {
+    f.set_zero(!(value & (1u << bit)));
+    f.set_subtract(false);
+    f.set_half_carry(true);
+}
+
+template <typename FlagsT>
+uint8_t daa(FlagsT &f, uint8_t a) {
+    if (!f.subtract()) {
+        if (f.half_carry() || ((a & 0x0f) > 0x09)) {
+            // Explanation: a is an uint8_t, so if the below addition overflows
+            // and the carry flag is false, then the condition (a > 0x9f) below
+            // fails, which is not we're looking for when a is between 0xf0 and
+            // 0xff. So we "abuse" the carry flag to also indicate that the
+            // addition will overflow, thus making sure the below condition is
+            // true.
+            f.set_carry(f.carry() || ((0xffu - a) < 0x06));
+
+            a += 0x06;
+        }
+
+        if (f.carry() || (a > 0x9f)) {
+            a += 0x60;
+            f.set_carry(true);
+        }
+    } else {
+        if (f.half_carry()) {
+            a -= 0x06;
+        }
+
+        if (f.carry()) {
+            a -= 0x60;
+        }
+    }
+
+    f.set_half_carry(false);
+    f.set_zero(a == 0);
+
+    return a;
+}
+
+// The same primitives, with lazily computed flags.
+
+using LazyOp = LazyFlagRegister::Operation;
+
+inline uint8_t add(LazyFlagRegister &f, uint8_t x, uint8_t y) {
+    uint8_t new_value = x + y;
+    f.defer(LazyOp::ADD, x, y, new_value);
+    return new_value;
+}
+
+inline uint8_t adc(LazyFlagRegister &f, uint8_t x, uint8_t y) {
+    uint8_t new_value = x + y + f.carry();
+    f.defer(LazyOp::ADC, x, y, new_value);
+    return new_value;
+}
+
+inline uint8_t sub(LazyFlagRegister &f, uint8_t x, uint8_t y) {
+    uint8_t new_value = x - y;
+    f.defer(LazyOp::SUB, x, y, new_value);
+    return new_value;
+}
+
+inline uint8_t sbc(LazyFlagRegister &f, uint8_t x, uint8_t y) {
+    uint8_t new_value = x - y - f.carry();
+    f.defer(LazyOp::SBC, x, y, new_value);
+    return new_value;
+}
+
+inline uint8_t and_(LazyFlagRegister &f, uint8_t x, uint8_t y) {
+    uint8_t new_value = x & y;
+    f.defer(LazyOp::AND, x, y, new_value);
+    return new_value;
+}
+
+inline uint8_t or_(LazyFlagRegister &f, uint8_t x, uint8_t y) {
+    uint8_t new_value = x | y;
+    f.defer(LazyOp::OR, x, y, new_value);
+    return new_value;
+}
+
+inline uint8_t xor_(LazyFlagRegister &f, uint8_t x, uint8_t y) {
+    uint8_t new_value = x ^ y;
+    f.defer(LazyOp::OR, x, y, new_value);
+    return new_value;
+}
+
+inline void cp(LazyFlagRegister &f, uint8_t x, uint8_t y) {
+    f.defer(LazyOp::SUB, x, y, (uint8_t)(x - y));
+}
+
+inline uint8_t inc(LazyFlagRegister &f, uint8_t value) {
+    uint8_t new_value = value + 1;
+    f.defer(LazyOp::INC, value, 1, new_value);
+    return new_value;
+}
+
+inline uint8_t dec(LazyFlagRegister &f, uint8_t value) {
+    uint8_t new_value = value - 1;
+    f.defer(LazyOp::DEC, value, 1, new_value);
+    return new_value;
+}
+
+inline uint16_t add16(LazyFlagRegister &f, uint16_t x, uint16_t y) {
+    uint16_t new_value = x + y;
+    f.defer(LazyOp::ADD16, x, y, new_value);
+    return new_value;
+}
+
+inline uint16_t add_sp(LazyFlagRegister &f, uint16_t x, int8_t y) {
+    uint16_t new_value = x + y;
+    f.defer(LazyOp::ADD_SP, x, (uint8_t)(y), new_value);
+    return new_value;
+}
+
+inline uint8_t rlc(LazyFlagRegister &f, uint8_t value) {
+    uint8_t new_value = (value << 1u) | (value >> 7u);
+    f.defer(LazyOp::SHIFT_LEFT, value, 0, new_value);
+    return new_value;
+}
+
+inline uint8_t rrc(LazyFlagRegister &f, uint8_t value) {
+    uint8_t new_value = (value >> 1u) | ((value & 0x1u) << 7u);
+    f.defer(LazyOp::SHIFT_RIGHT, value, 0, new_value);
+    return new_value;
+}
+
+inline uint8_t rl(LazyFlagRegister &f, uint8_t value) {
+    uint8_t new_value = (value << 1u) | f.carry();
+    f.defer(LazyOp::SHIFT_LEFT, value, 0, new_value);
+    return new_value;
+}
+
+inline uint8_t rr(LazyFlagRegister &f, uint8_t value) {
+    uint8_t new_value = (value >> 1u) | (f.carry() << 7u);
+    f.defer(LazyOp::SHIFT_RIGHT, value, 0, new_value);
+    return new_value;
+}
+
+inline uint8_t sla(LazyFlagRegister &f, uint8_t value) {
+    uint8_t new_value = value << 1u;
+    f.defer(LazyOp::SHIFT_LEFT, value, 0, new_value);
+    return new_value;
+}
+
+inline uint8_t sra(LazyFlagRegister &f, uint8_t value) {
+    uint8_t new_value = (value >> 1u) | ((value >> 7u) << 7u);
+    f.defer(LazyOp::SHIFT_RIGHT, value, 0, new_value);
+    return new_value;
+}
+
+inline uint8_t swap(LazyFlagRegister &f, uint8_t value) {
+    uint8_t new_value = high_nibble(value) | (low_nibble(value) << 4u);
+    f.defer(LazyOp::OR, value, 0, new_value);
+    return new_value;
+}
+
+inline uint8_t srl(LazyFlagRegister &f, uint8_t value) {
+    uint8_t new_value = value >> 1u;
+    f.defer(LazyOp::SHIFT_RIGHT, value, 0, new_value);
+    return new_value;
+}
+
+inline void bit(LazyFlagRegister &f, uint8_t bit, uint8_t value) {
+    f.defer(LazyOp::BIT, value, bit, value & (1u << bit));
+}
+
+}  // namespace cpu::alu
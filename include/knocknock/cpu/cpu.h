@@ -1,38 +1,146 @@
 #pragma once
 
+#include <algorithm>
+#include <array>
 #include <queue>
+#include <utility>
+#include <vector>
 
+#include "knocknock/cpu/decoded_cache.h"
 #include "knocknock/cpu/decoder.h"
-#include "knocknock/cpu/operands.h"
+#include "knocknock/cpu/registers.h"
 #include "knocknock/interrupt.h"
+#include "knocknock/memory/direct_memory.h"
 #include "knocknock/memory/memory.h"
+#include "knocknock/peripherals/scheduler.h"
 #include "knocknock/peripherals/tickable.h"
 
 namespace cpu {
 
 class CPU : public peripherals::Tickable, public interrupt::Interruptible {
 public:
-    CPU(memory::Memory *mem);
+    /**
+     * The ways the CPU can run instructions.
+     */
+    enum class Interpreter {
+        /**
+         * Decode one byte per tick into an Instruction, then execute it by
+         * dispatching on its opcode and operands.
+         */
+        DECODER,
+
+        /**
+         * Same as DECODER, but instructions which were decoded before are
+         * taken from a DecodedCache instead of being read and decoded again.
+         */
+        CACHED_DECODER,
+
+        /**
+         * Execute a whole instruction in one tick through a handler
+         * specialized for its encoding, then stall for the remaining
+         * M-cycles of the instruction.
+         */
+        THREADED,
+
+        /**
+         * Run one micro-op per tick, from a sequence precomputed for each
+         * opcode, so that every memory access happens in its own M-cycle.
+         * The last micro-op of an instruction also fetches the next opcode,
+         * like the fetch/execute overlap of the hardware.
+         */
+        MICRO_OP,
+    };
+
+    /**
+     * With the CACHED_DECODER interpreter, the CPU observes |mem| for writes
+     * it does not make itself, so |mem| should be the MMU rather than a
+     * region registered to it.
+     */
+    CPU(memory::Memory *mem, Interpreter interpreter = Interpreter::DECODER);
+
+    /**
+     * Whether the CPU is halted, waiting for an interrupt.
+     */
+    [[nodiscard]] bool halted() const { return halted_; }
+
+    /**
+     * The cache of decoded instructions, only used by the CACHED_DECODER
+     * interpreter.
+     */
+    [[nodiscard]] const DecodedCache &decoded_cache() const {
+        return decoded_cache_;
+    }
 
     // clock::Tickable::
     void tick() override;
 
+    /**
+     * Run instructions until |cycles| M-cycles have elapsed, without going
+     * through tick() for each of them. The threaded interpreter only stops
+     * between two instructions, and may run a few M-cycles past the budget.
+     * Cycles spent halted count as elapsed.
+     * @return the number of elapsed M-cycles.
+     */
+    uint32_t run(uint32_t cycles) override;
+
+    /**
+     * Report the progress of run() to |scheduler|, which runs the CPU, so
+     * that the components see the current cycle when the CPU accesses them,
+     * and events they schedule during run() end it early.
+     */
+    void set_scheduler(peripherals::Scheduler *scheduler) {
+        scheduler_ = scheduler;
+    }
+
+    /**
+     * Service the interrupts of |controller| as soon as the CPU can take
+     * them: at the end of every instruction while interrupts are enabled,
+     * including right after EI and RETI, and when halting with an interrupt
+     * pending. Needed when the controller is driven by a scheduler, since it
+     * does not offer an interrupt the CPU refused again.
+     */
+    void set_interrupt_controller(
+        interrupt::InterruptController *controller) {
+        interrupt_controller_ = controller;
+    }
+
+    /**
+     * Idle while halted.
+     */
+    [[nodiscard]] bool idle() const override { return halted_; }
+
+    /**
+     * Whether run() skips the iterations of idle loops, such as a loop
+     * polling a register until an interrupt or a peripheral changes it. The
+     * outcome is the same as running them. Only the threaded interpreter
+     * detects idle loops; off by default.
+     */
+    void set_skip_idle_loops(bool enabled) { skip_idle_loops_ = enabled; }
+
+    /**
+     * Number of M-cycles skipped in idle loops.
+     */
+    [[nodiscard]] uint64_t idle_cycles_skipped() const {
+        return idle_cycles_skipped_;
+    }
+
     // interrupt::Interruptible
     bool interrupt(interrupt::InterruptType reason) override;
 
 private:
-    Register8 a_, b_, c_, d_, e_, h_, l_;
-    FlagRegister f_;
-    Register16Mirror af_, bc_, de_, hl_;
-    Register16 sp_;
+    RegisterFile regs_;
+
+    // Immediates of the instruction being executed.
+    uint8_t imm8_;
+    int8_t imm8sign_;
+    uint16_t imm16_;
 
-    Register8 imm8_;
-    Register8Sign imm8sign_;
-    Register16 imm16_;
+    memory::DirectMemory mem_;
 
-    memory::Memory *mem_;
-    memory::MemoryAddr pc_;
+    peripherals::Scheduler *scheduler_;
+    interrupt::InterruptController *interrupt_controller_;
 
+    DecodedCache decoded_cache_;
     Decoder decoder_;
 
     /**
@@ -60,14 +168,275 @@ private:
      */
     bool halted_;
 
-    std::optional<Operand8 *> get_operand8(Instruction::Operand lhs);
-    std::optional<Operand16 *> get_operand16(Instruction::Operand lhs);
+    const Interpreter interpreter_;
+
+    /**
+     * Number of ticks left before the threaded interpreter runs the next
+     * instruction.
+     */
+    uint8_t stall_cycles_;
+
+    /**
+     * Micro-op of one M-cycle of an instruction, run by the micro-op
+     * interpreter.
+     */
+    using MicroOp = void (CPU::*)();
+
+    /**
+     * The micro-ops of an instruction. The last one executes the instruction
+     * itself and fetches the next opcode; a conditional instruction which is
+     * not taken skips to it.
+     */
+    struct MicroOps {
+        std::array<MicroOp, 6> ops;
+        uint8_t length;
+
+        /**
+         * Number of micro-ops run when the condition does not hold, or 0 for
+         * unconditional instructions. Only used to check the tables.
+         */
+        uint8_t skipped_length;
+    };
+
+    /**
+     * Sequence of the instruction being run by the micro-op interpreter, and
+     * the index of its next micro-op.
+     */
+    const MicroOps *sequence_;
+    uint8_t next_micro_op_;
+
+    bool skip_idle_loops_;
+    uint64_t idle_cycles_skipped_;
+
+    /**
+     * Addresses read through Memory::read() in an iteration of an idle loop.
+     */
+    std::vector<memory::MemoryAddr> idle_loop_reads_;
+
+    /**
+     * Number of writes to memory, to tell whether an instruction wrote to
+     * memory.
+     */
+    uint32_t writes_;
+
+    /**
+     * Get the address of a memory operand such as (HL), resolved at compile
+     * time.
+     */
+    template <Instruction::Operand OPERAND>
+    memory::MemoryAddr address_of() const {
+        using Operand = Instruction::Operand;
+
+        if constexpr (OPERAND == Operand::PtrC) {
+            return 0xff00 + regs_.c;
+        } else if constexpr (OPERAND == Operand::PtrImm8) {
+            return 0xff00 + imm8_;
+        } else if constexpr (OPERAND == Operand::PtrBC) {
+            return regs_.bc();
+        } else if constexpr (OPERAND == Operand::PtrDE) {
+            return regs_.de();
+        } else if constexpr (OPERAND == Operand::PtrHL) {
+            return regs_.hl();
+        } else {
+            static_assert(OPERAND == Operand::PtrImm16,
+                          "Operand is not a memory operand");
+            return imm16_;
+        }
+    }
+
+    /**
+     * Read an operand, resolved at compile time.
+     * @return uint8_t for the 8-bit operands, uint16_t for the 16-bit ones.
+     */
+    template <Instruction::Operand OPERAND>
+    auto read_operand() const {
+        if constexpr (is_register(OPERAND)) {
+            return regs_.get<OPERAND>();
+        } else if constexpr (OPERAND == Instruction::Operand::Imm8) {
+            return imm8_;
+        } else if constexpr (OPERAND == Instruction::Operand::Imm16) {
+            return imm16_;
+        } else {
+            return mem_.read(address_of<OPERAND>());
+        }
+    }
+
+    /**
+     * Write an operand, resolved at compile time.
+     */
+    template <Instruction::Operand OPERAND>
+    void write_operand(uint16_t value) {
+        if constexpr (is_register(OPERAND)) {
+            regs_.set<OPERAND>(value);
+        } else {
+            write_memory(address_of<OPERAND>(), value);
+        }
+    }
+
+    /**
+     * Write to memory. All writes of the CPU go through here, so that the
+     * instructions cached at |addr| can be dropped.
+     */
+    void write_memory(memory::MemoryAddr addr, memory::MemoryValue value) {
+        mem_.write(addr, value);
+        writes_++;
+        if (interpreter_ == Interpreter::CACHED_DECODER) {
+            decoded_cache_.invalidate(addr);
+        }
+    }
+
+    // Runtime counterparts of read_operand() and write_operand(), used by the
+    // decoder interpreter.
+    uint8_t read8(Instruction::Operand operand) const;
+    void write8(Instruction::Operand operand, uint8_t value);
+    uint16_t read16(Instruction::Operand operand) const;
+    void write16(Instruction::Operand operand, uint16_t value);
+
+    void tick_decoder();
+    void tick_threaded();
+    void tick_micro_op();
+    uint32_t run_threaded(uint32_t cycles);
+
+    /**
+     * Report |spent| more M-cycles of run() to the scheduler, if any, once
+     * |elapsed| of its budget of |cycles| have elapsed.
+     * @return the budget, shortened if an event is now due before its end.
+     */
+    uint32_t advance_scheduler(uint32_t spent,
+                               uint32_t elapsed,
+                               uint32_t cycles) {
+        if (scheduler_ == nullptr) {
+            return cycles;
+        }
+
+        const uint32_t left = scheduler_->advance(spent);
+        return elapsed < cycles ? elapsed + std::min(left, cycles - elapsed)
+                                : cycles;
+    }
+
+    /**
+     * Longest idle loop detected, in instructions.
+     */
+    static constexpr int MAX_IDLE_LOOP_LENGTH = 8;
+
+    /**
+     * Run one iteration of the loop starting at PC, if any, and skip as many
+     * further iterations as fit in |cycles| and before the next event of the
+     * scheduler if they would all be the same.
+     * @return the number of elapsed M-cycles, including the skipped ones.
+     */
+    uint32_t skip_idle_loop(uint32_t cycles);
 
     void execute_instruction(Instruction inst);
 
-    // TODO: remove these
-    Memory8 ptr_bc_, ptr_de_, ptr_hl_, ptr_imm16_;
-    Memory8HiMem ptr_c_, ptr_imm8_;
+    // Threaded interpreter, implemented in threaded.cpp.
+
+    /**
+     * Handler of an encoded opcode. Executes the whole instruction, including
+     * reading its immediate, and returns its duration in M-cycles.
+     */
+    using Handler = uint8_t (CPU::*)();
+
+    /**
+     * Handlers indexed by the opcode byte, and by the byte following the CB
+     * prefix respectively.
+     */
+    static const std::array<Handler, 256> BASE_HANDLERS;
+    static const std::array<Handler, 256> CB_HANDLERS;
+
+    /**
+     * Run whole instructions until at least |cycles| M-cycles have elapsed or
+     * the CPU halts.
+     * @return the number of elapsed M-cycles.
+     */
+    uint32_t execute_threaded(uint32_t cycles);
+
+    /**
+     * Apply the side effects due at the boundary between two instructions,
+     * and service a pending interrupt if the CPU can take it.
+     */
+    void end_instruction();
+
+    template <uint8_t OPCODE>
+    uint8_t execute_base();
+    template <uint8_t OPCODE>
+    uint8_t execute_cb();
+    template <bool PREFIXED, uint8_t OPCODE>
+    uint8_t execute_encoded();
+    template <Instruction::Opcode OPCODE,
+              Instruction::Operand LHS,
+              Instruction::Operand RHS>
+    bool execute_opcode();
+
+    // Micro-op interpreter, implemented in micro_op.cpp.
+
+    /**
+     * Micro-ops indexed by the opcode byte, and by the byte following the CB
+     * prefix respectively. The CB prefix itself reads the second byte.
+     */
+    static const std::array<MicroOps, 256> BASE_MICRO_OPS;
+    static const std::array<MicroOps, 256> CB_MICRO_OPS;
+
+    /**
+     * Micro-ops of an interrupt dispatch, jumping to the vector in imm16_.
+     */
+    static const MicroOps INTERRUPT_MICRO_OPS;
+
+    template <bool PREFIXED, uint8_t OPCODE>
+    static constexpr MicroOps micro_ops();
+    template <bool PREFIXED, size_t... OPCODES>
+    static constexpr std::array<MicroOps, 256> make_micro_ops(
+        std::index_sequence<OPCODES...>);
+
+    /**
+     * Skip to the last micro-op of the instruction unless |COND| holds.
+     */
+    template <Instruction::Operand COND>
+    void skip_unless();
+
+    /**
+     * Read the next opcode, and start running its micro-ops.
+     */
+    void fetch_opcode();
+
+    template <Instruction::Operand COND>
+    void uop_idle();
+    void uop_read_imm8();
+    template <Instruction::Operand COND>
+    void uop_read_imm8sign();
+    void uop_read_imm16_low();
+    template <Instruction::Operand COND>
+    void uop_read_imm16_high();
+    template <Instruction::Opcode OPCODE, Instruction::Operand ADDR>
+    void uop_load();
+    template <Instruction::Opcode OPCODE,
+              Instruction::Operand ADDR,
+              Instruction::Operand SRC>
+    void uop_store();
+    template <Instruction::Opcode OPCODE, uint8_t BIT>
+    void uop_modify();
+    template <bool HIGH>
+    void uop_store_sp();
+    template <Instruction::Operand SRC, bool HIGH>
+    void uop_push();
+    template <bool HIGH>
+    void uop_push_pc();
+    void uop_pop_low();
+    void uop_pop_high();
+    template <uint16_t VECTOR>
+    void uop_load_vector();
+    void uop_enable_interrupts();
+    void uop_unwind_pc();
+    void uop_prefix();
+    template <Instruction::Opcode OPCODE,
+              Instruction::Operand LHS,
+              Instruction::Operand RHS,
+              uint8_t IMPLICIT_IMM8 = 0>
+    void uop_last();
+    template <uint8_t BIT>
+    void uop_last_bit();
+    template <uint8_t OPCODE>
+    void uop_unknown();
 
     void nop();
     void jp(Instruction::Operand lhs, Instruction::Operand rhs);
@@ -0,0 +1,170 @@
+/**
+ * Cache of decoded instructions, so that code which runs again is not read
+ * and decoded again.
+ * @file decoded_cache.h
+ */
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+
+#include "knocknock/cpu/instruction.h"
+#include "knocknock/cpu/opcode_table.h"
+#include "knocknock/memory/host_page_table.h"
+
+namespace cpu {
+
+/**
+ * Decoded instructions, indexed by their address and by the host memory
+ * behind it.
+ *
+ * Instructions are only cached when their bytes are backed by host memory,
+ * and the host pointer of their page stands for the active bank: after a bank
+ * switch, the same address resolves to another set of entries, and switching
+ * back finds the old ones again. Mirrors such as the echo RAM share the
+ * entries of the memory they mirror.
+ *
+ * Entries are invalidated by invalidate(), which must be called for every
+ * write the CPU makes, so that code in RAM can be rewritten. Other writes,
+ * such as the blocks written through the MMU or a save loaded by a memory
+ * controller, reach the cache as the observer of the memory of the CPU.
+ */
+class DecodedCache : public memory::HostPageObserver {
+public:
+    /**
+     * A cached instruction.
+     */
+    struct Entry {
+        Instruction instruction;
+
+        /** The opcode table entry, or nullptr if the entry is empty. */
+        const OpcodeInfo *info = nullptr;
+    };
+
+    explicit DecodedCache(const memory::HostPageTable *pages);
+
+    /**
+     * Look up the instruction at |addr|, and count a hit or a miss.
+     * @return the entry, or nullptr if there is none.
+     */
+    const Entry *find(memory::MemoryAddr addr) {
+        Block *block = block_of(addr, false);
+        if (block != nullptr) {
+            const Entry &entry = block->entries[offset_in_page(addr)];
+            if (entry.info != nullptr) {
+                hits_++;
+                return &entry;
+            }
+        }
+
+        misses_++;
+        return nullptr;
+    }
+
+    /**
+     * Cache |instruction|, decoded from |info| at |addr|. Does nothing if
+     * the instruction is not entirely backed by host memory, or crosses a
+     * page boundary.
+     */
+    void insert(memory::MemoryAddr addr,
+                const OpcodeInfo *info,
+                Instruction instruction);
+
+    /**
+     * Drop the instructions that a write to |addr| could change.
+     */
+    void invalidate(memory::MemoryAddr addr) {
+        Block *block = block_of(addr, false);
+        if (block == nullptr) {
+            return;
+        }
+
+        // Instructions are up to 3 bytes long, and never cross a page.
+        const memory::MemoryAddr offset = offset_in_page(addr);
+        for (memory::MemoryAddr i = 0; i < 3 && i <= offset; ++i) {
+            block->entries[offset - i].info = nullptr;
+        }
+    }
+
+    // memory::HostPageObserver::
+    void host_pages_changed(memory::Memory *,
+                            memory::MemoryAddr,
+                            memory::MemoryAddr) override {
+        // Entries follow the host pointers by themselves.
+    }
+    void host_memory_written(const memory::MemoryValue *data,
+                             memory::MemorySize size) override;
+
+    /** Number of find() calls which returned an entry. */
+    uint64_t hits() const { return hits_; }
+
+    /** Number of find() calls which did not. */
+    uint64_t misses() const { return misses_; }
+
+private:
+    struct Block {
+        std::array<Entry, memory::PAGE_SIZE> entries;
+    };
+
+    // The host memory behind a page: the address its host pointers are
+    // relative to, or 0 if the address has no host pointer.
+    using Tag = uintptr_t;
+
+    // The block last used for a page, to skip the lookup in |blocks_|.
+    struct CurrentBlock {
+        Tag tag = 0;
+        Block *block = nullptr;
+    };
+
+    static memory::MemoryAddr page_of(memory::MemoryAddr addr) {
+        return addr >> 8;
+    }
+    static memory::MemoryAddr offset_in_page(memory::MemoryAddr addr) {
+        return addr & 0xff;
+    }
+
+    Tag tag_of(memory::MemoryAddr addr) const {
+        const memory::MemoryValue *ptr = pages_->read_ptr(addr);
+        if (ptr == nullptr) {
+            return 0;
+        }
+
+        return reinterpret_cast<Tag>(ptr) - offset_in_page(addr);
+    }
+
+    /**
+     * Get the block holding the entry of |addr| in the memory currently
+     * mapped there.
+     * @param create whether to create the block if it doesn't exist yet.
+     * @return the block, or nullptr if it doesn't exist or |addr| has no host
+     * pointer.
+     */
+    Block *block_of(memory::MemoryAddr addr, bool create) {
+        const Tag tag = tag_of(addr);
+        if (tag == 0) {
+            return nullptr;
+        }
+
+        CurrentBlock &current = current_[page_of(addr)];
+        if (current.tag != tag || (current.block == nullptr && create)) {
+            current.tag = tag;
+            current.block = lookup(tag, create);
+        }
+
+        return current.block;
+    }
+
+    Block *lookup(Tag tag, bool create);
+
+    const memory::HostPageTable *pages_;
+
+    std::array<CurrentBlock, 0x100> current_;
+    std::unordered_map<Tag, std::unique_ptr<Block>> blocks_;
+
+    uint64_t hits_;
+    uint64_t misses_;
+};
+
+}  // namespace cpu
@@ -1,22 +1,45 @@
 #pragma once
 
-#include <optional>
-
+#include "knocknock/cpu/decoded_cache.h"
 #include "knocknock/cpu/instruction.h"
-#include "knocknock/memory/memory.h"
+#include "knocknock/cpu/opcode_table.h"
+#include "knocknock/memory/direct_memory.h"
 
 namespace cpu {
 
 class Decoder {
 public:
-    Decoder(const memory::Memory *memory, memory::MemoryAddr *pc);
+    /**
+     * @param cache if not nullptr, instructions found in it are replayed
+     * instead of decoded, and decoded instructions are added to it.
+     */
+    Decoder(const memory::DirectMemory *memory,
+            memory::MemoryAddr *pc,
+            DecodedCache *cache = nullptr);
 
     void step();
 
-    [[nodiscard]] std::optional<Instruction> decoded_instruction() const {
+    /**
+     * Whether the last step() finished decoding an instruction.
+     */
+    [[nodiscard]] bool has_decoded_instruction() const { return decoded_; }
+
+    /**
+     * Get the last decoded instruction.
+     * @return const Instruction& the instruction, only meaningful when
+     * has_decoded_instruction() is true.
+     */
+    [[nodiscard]] const Instruction &decoded_instruction() const {
         return decoded_instruction_;
     }
 
+    /**
+     * Get the table entry of the last decoded instruction.
+     * @return const OpcodeInfo& the entry, only meaningful when
+     * has_decoded_instruction() is true.
+     */
+    [[nodiscard]] const OpcodeInfo &decoded_info() const { return *info_; }
+
 private:
     enum class State {
         OPCODE,
@@ -24,34 +47,33 @@ private:
         IMMEDIATE_8,
         IMMEDIATE_8_SIGN,
         IMMEDIATE_16_LOW,
-        IMMEDIATE_16_HIGH
+        IMMEDIATE_16_HIGH,
+        // Skipping the remaining bytes of a cached instruction.
+        CACHED
     };
 
     void reset();
+    void begin(const OpcodeInfo *info);
     void assemble();
-
-    bool decode_cb(uint8_t opcode);
-    bool decode_ld_8bit(uint8_t opcode);
-    bool decode_alu(uint8_t opcode);
-    bool decode_rst(uint8_t opcode);
-    bool decode_assorted(uint8_t opcode);
-
-    bool needs_imm8(Instruction::Operand operand);
-    bool needs_imm8sign(Instruction::Operand operand);
-    bool needs_imm16(Instruction::Operand operand);
+    void replay(const DecodedCache::Entry &entry);
 
     State state_;
 
-    const memory::Memory *memory_;
+    const memory::DirectMemory *memory_;
     memory::MemoryAddr *pc_;
+    DecodedCache *cache_;
+
+    // Address of the instruction being decoded.
+    memory::MemoryAddr start_;
+    // Bytes of a cached instruction left to skip.
+    uint8_t cached_bytes_left_;
 
-    Instruction::Opcode opcode_;
-    Instruction::Operand lhs_, rhs_;
-    std::optional<uint8_t> imm8_;
-    std::optional<int8_t> imm8sign_;
-    std::optional<uint16_t> imm16_;
+    const OpcodeInfo *info_;
+    uint8_t imm_low_;
+    uint16_t imm_;
 
-    std::optional<Instruction> decoded_instruction_;
+    bool decoded_;
+    Instruction decoded_instruction_;
 };
 
 }  // namespace cpu
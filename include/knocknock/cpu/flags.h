@@ -0,0 +1,218 @@
+/**
+ * The F register, in its eager and lazy flavors.
+ * @file flags.h
+ */
+#pragma once
+
+#include <cstdint>
+
+// Build with -DKNOCKNOCK_LAZY_FLAGS=1 (CMake option WITH_LAZY_FLAGS) to make
+// the CPU compute its flags only when they're read.
+#ifndef KNOCKNOCK_LAZY_FLAGS
+#define KNOCKNOCK_LAZY_FLAGS 0
+#endif
+
+namespace cpu {
+
+/**
+ * The F register, holding the flags in its upper nibble. The lower nibble
+ * always reads as 0.
+ */
+class FlagRegister {
+public:
+    static constexpr uint8_t ZERO_MASK = 1 << 7;
+    static constexpr uint8_t SUBTRACT_MASK = 1 << 6;
+    static constexpr uint8_t HALF_CARRY_MASK = 1 << 5;
+    static constexpr uint8_t CARRY_MASK = 1 << 4;
+    static constexpr uint8_t FLAGS_MASK =
+        ZERO_MASK | SUBTRACT_MASK | HALF_CARRY_MASK | CARRY_MASK;
+
+    uint8_t read() const { return value_; }
+    void write(uint8_t value) { value_ = value & FLAGS_MASK; }
+
+    bool zero() const { return value_ & ZERO_MASK; }
+    bool subtract() const { return value_ & SUBTRACT_MASK; }
+    bool half_carry() const { return value_ & HALF_CARRY_MASK; }
+    bool carry() const { return value_ & CARRY_MASK; }
+
+    void set_zero(bool value) { set(ZERO_MASK, value); }
+    void set_subtract(bool value) { set(SUBTRACT_MASK, value); }
+    void set_half_carry(bool value) { set(HALF_CARRY_MASK, value); }
+    void set_carry(bool value) { set(CARRY_MASK, value); }
+
+private:
+    void set(uint8_t mask, bool value) {
+        value_ = (value_ & ~mask) | (value ? mask : 0);
+    }
+
+    uint8_t value_;
+};
+
+/**
+ * The F register, but instead of computing the flags of every ALU operation,
+ * only the last operation, its operands and its result are recorded. The flags
+ * are computed from them when they're read, which for most operations is
+ * never since the next one overwrites them.
+ *
+ * Has the same interface as FlagRegister, plus defer() for the ALU.
+ */
+class LazyFlagRegister {
+public:
+    static constexpr uint8_t ZERO_MASK = FlagRegister::ZERO_MASK;
+    static constexpr uint8_t SUBTRACT_MASK = FlagRegister::SUBTRACT_MASK;
+    static constexpr uint8_t HALF_CARRY_MASK = FlagRegister::HALF_CARRY_MASK;
+    static constexpr uint8_t CARRY_MASK = FlagRegister::CARRY_MASK;
+    static constexpr uint8_t FLAGS_MASK = FlagRegister::FLAGS_MASK;
+
+    /**
+     * Operations whose flags can be computed later.
+     */
+    enum class Operation : uint8_t {
+        // No pending operation, the flags are stored as is.
+        NONE,
+        ADD,
+        ADC,
+        // Also CP, which is a SUB that discards its result.
+        SUB,
+        SBC,
+        AND,
+        // Also XOR and SWAP: Z from the result, everything else reset.
+        OR,
+        INC,
+        DEC,
+        // ADD HL, rr
+        ADD16,
+        // ADD SP, Imm8Sign and LDHL SP, Imm8Sign
+        ADD_SP,
+        // RLC, RL and SLA: C is the bit shifted out of bit 7.
+        SHIFT_LEFT,
+        // RRC, RR, SRA and SRL: C is the bit shifted out of bit 0.
+        SHIFT_RIGHT,
+        // The result is the tested bit, still in place.
+        BIT,
+    };
+
+    uint8_t read() const {
+        switch (op_) {
+            case Operation::NONE: return base_;
+            case Operation::ADD:
+                return pack(result_ == 0, false,
+                            (x_ & 0xFu) + (y_ & 0xFu) > 0xFu, x_ + y_ > 0xFF);
+            case Operation::ADC:
+                return pack(result_ == 0, false,
+                            (x_ & 0xFu) + (y_ & 0xFu) + carry_in() > 0xFu,
+                            x_ + y_ + carry_in() > 0xFF);
+            case Operation::SUB:
+                return pack(result_ == 0, true, (x_ & 0xFu) < (y_ & 0xFu),
+                            x_ < y_);
+            case Operation::SBC:
+                return pack(result_ == 0, true,
+                            (x_ & 0xFu) < (y_ & 0xFu) + carry_in(),
+                            x_ < y_ + carry_in());
+            case Operation::AND: return pack(result_ == 0, false, true, false);
+            case Operation::OR: return pack(result_ == 0, false, false, false);
+            case Operation::INC:
+                return pack(result_ == 0, false, (x_ & 0xFu) == 0xFu,
+                            carry_in());
+            case Operation::DEC:
+                return pack(result_ == 0, true, (x_ & 0xFu) == 0x0u,
+                            carry_in());
+            case Operation::ADD16:
+                return pack(base_ & ZERO_MASK, false,
+                            (x_ & 0x0FFFu) + (y_ & 0x0FFFu) > 0x0FFFu,
+                            x_ + y_ > 0xFFFFu);
+            case Operation::ADD_SP:
+                return pack(false, false, (x_ & 0x0Fu) + (y_ & 0x0Fu) > 0x0Fu,
+                            (x_ & 0xFFu) + (y_ & 0xFFu) > 0xFFu);
+            case Operation::SHIFT_LEFT:
+                return pack(result_ == 0, false, false, x_ >> 7u);
+            case Operation::SHIFT_RIGHT:
+                return pack(result_ == 0, false, false, x_ & 0x1u);
+            case Operation::BIT:
+                return pack(result_ == 0, false, true, carry_in());
+        }
+
+        return base_;
+    }
+
+    void write(uint8_t value) {
+        base_ = value & FLAGS_MASK;
+        op_ = Operation::NONE;
+    }
+
+    bool zero() const {
+        // Z is the most read flag, since it's the condition of most
+        // conditional jumps, and is cheap to get without computing the others.
+        switch (op_) {
+            case Operation::NONE:
+            case Operation::ADD16: return base_ & ZERO_MASK;
+            case Operation::ADD_SP: return false;
+            default: return result_ == 0;
+        }
+    }
+    bool subtract() const { return read() & SUBTRACT_MASK; }
+    bool half_carry() const { return read() & HALF_CARRY_MASK; }
+    bool carry() const { return read() & CARRY_MASK; }
+
+    void set_zero(bool value) { set(ZERO_MASK, value); }
+    void set_subtract(bool value) { set(SUBTRACT_MASK, value); }
+    void set_half_carry(bool value) { set(HALF_CARRY_MASK, value); }
+    void set_carry(bool value) { set(CARRY_MASK, value); }
+
+    /**
+     * Record |op| as the last flag-setting operation.
+     * @param x the first operand, or the only one.
+     * @param y the second operand, if any. For ADD_SP, the signed immediate
+     * cast to uint8_t.
+     * @param result the result of the operation.
+     */
+    void defer(Operation op, uint16_t x, uint16_t y, uint16_t result) {
+        // These operations keep some flags or take the carry as an input, so
+        // the flags as of before them must be computed now.
+        switch (op) {
+            case Operation::ADC:
+            case Operation::SBC:
+            case Operation::INC:
+            case Operation::DEC:
+            case Operation::ADD16:
+            case Operation::BIT: base_ = read(); break;
+            default: break;
+        }
+
+        op_ = op;
+        x_ = x;
+        y_ = y;
+        result_ = result;
+    }
+
+private:
+    static constexpr uint8_t pack(bool zero,
+                                  bool subtract,
+                                  bool half_carry,
+                                  bool carry) {
+        return (zero ? ZERO_MASK : 0) | (subtract ? SUBTRACT_MASK : 0) |
+               (half_carry ? HALF_CARRY_MASK : 0) | (carry ? CARRY_MASK : 0);
+    }
+
+    // The carry flag as of before the pending operation.
+    uint8_t carry_in() const { return (base_ & CARRY_MASK) ? 1 : 0; }
+
+    void set(uint8_t mask, bool value) {
+        write((read() & ~mask) | (value ? mask : 0));
+    }
+
+    Operation op_;
+    // The flags as of before op_, or the flags if there's no pending operation.
+    uint8_t base_;
+    uint16_t x_;
+    uint16_t y_;
+    uint16_t result_;
+};
+
+#if KNOCKNOCK_LAZY_FLAGS
+using Flags = LazyFlagRegister;
+#else
+using Flags = FlagRegister;
+#endif
+
+}  // namespace cpu
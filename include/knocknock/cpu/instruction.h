@@ -1,7 +1,9 @@
 #pragma once
 
-#include <optional>
+#include <array>
+#include <cstdint>
 #include <string>
+#include <type_traits>
 
 #include "knocknock/memory/memory.h"
 
@@ -13,13 +15,16 @@ namespace cpu {
  * An Instruction is an instruction which can be understood by the CPU. An
  * Instruction contains an opcode, which represents the operation to be done,
  * and either zero, one or two operands, which are arguments to the operation.
+ *
+ * Instructions are packed in 4 bytes: the opcode, the index of the operands
+ * in OPERAND_PAIRS, and the immediate, so that they're cheap to copy around.
  */
 class Instruction {
 public:
     /**
      * Enum of all available opcodes.
      */
-    enum class Opcode {
+    enum class Opcode : uint8_t {
         NOP,
         RLC,
         RRC,
@@ -71,7 +76,7 @@ public:
     /**
      * Enum of all possible operands.
      */
-    enum class Operand {
+    enum class Operand : uint8_t {
         None, /**< Filler when an operand is not needed */
 
         // 8 bit registers and its pointers.
@@ -108,9 +113,41 @@ public:
         PtrImm16, /**< (Imm16) */
     };
 
+    /**
+     * The operands of an instruction.
+     */
+    struct OperandPair {
+        Operand lhs;
+        Operand rhs;
+    };
+
+    /**
+     * Every pair of operands used by an opcode, generated from the opcode
+     * tables. The pair at index 0 is (None, None).
+     */
+    static const std::array<OperandPair, 256> OPERAND_PAIRS;
+
+    /**
+     * Construct a NOP.
+     */
+    Instruction() = default;
+
+    /**
+     * Construct an Instruction from its packed encoding.
+     *
+     * @param opcode Opcode of the instruction.
+     * @param operands index of the operands in OPERAND_PAIRS, as found in
+     * OpcodeInfo::operands.
+     * @param imm the immediate, with 8-bit ones in the low byte, or 0 if the
+     * instruction has none.
+     */
+    Instruction(Opcode opcode, uint8_t operands, uint16_t imm)
+        : opcode_(opcode), operands_(operands), imm_(imm) {}
+
     /**
      * Construct an Instruction with the specified opcode and operands, and
-     * without immediates.
+     * without immediates. The operands must be those of an opcode in the
+     * opcode tables, since they're looked up in OPERAND_PAIRS.
      *
      * @param opcode Opcode of the instruction.
      * @param lhs the operand on the left hand side, or None if not available.
@@ -170,34 +207,40 @@ public:
      * Get the left hand sign operand.
      * @return Operand the left hand sign operand.
      */
-    Operand lhs() const { return lhs_; }
+    Operand lhs() const { return OPERAND_PAIRS[operands_].lhs; }
 
     /**
      * Get the right hand sign operand.
      * @return Operand the right hand sign operand.
      */
-    Operand rhs() const { return rhs_; }
+    Operand rhs() const { return OPERAND_PAIRS[operands_].rhs; }
 
     /**
-     * Get the unsigned 8-bit immediate, if available.
-     * @return std::optional<uint8_t> the immediate wrapped around
-     * std::optional. The user must check whether a value is contained or not.
+     * Get the index of the operands in OPERAND_PAIRS.
+     * @return uint8_t the index.
      */
-    std::optional<uint8_t> imm8() const { return imm8_; }
+    uint8_t operands() const { return operands_; }
 
     /**
-     * Get the signed 8-bit immediate, if available.
-     * @return std::optional<int8_t> the immediate wrapped around
-     * std::optional. The user must check whether a value is contained or not.
+     * Get the unsigned 8-bit immediate. Only meaningful if one of the operands
+     * is Imm8 or PtrImm8.
+     * @return uint8_t the immediate.
      */
-    std::optional<int8_t> imm8sign() const { return imm8sign_; }
+    uint8_t imm8() const { return imm_; }
 
     /**
-     * Get the unsigned 16-bit immediate, if available.
-     * @return std::optional<uint16_t> the immediate wrapped around
-     * std::optional. The user must check whether a value is contained or not.
+     * Get the signed 8-bit immediate. Only meaningful if one of the operands
+     * is Imm8Sign.
+     * @return int8_t the immediate.
      */
-    std::optional<uint16_t> imm16() const { return imm16_; }
+    int8_t imm8sign() const { return (int8_t)(imm_); }
+
+    /**
+     * Get the unsigned 16-bit immediate. Only meaningful if one of the
+     * operands is Imm16 or PtrImm16.
+     * @return uint16_t the immediate.
+     */
+    uint16_t imm16() const { return imm_; }
 
     /**
      * Return the assembly command that represents this instruction.
@@ -209,12 +252,13 @@ private:
     std::string disassemble_opcode() const;
     std::string disassemble_operand(Operand operand) const;
 
-    Opcode opcode_;
-    Operand lhs_, rhs_;
-
-    std::optional<uint8_t> imm8_;
-    std::optional<int8_t> imm8sign_;
-    std::optional<uint16_t> imm16_;
+    Opcode opcode_ = Opcode::NOP;
+    uint8_t operands_ = 0;
+    uint16_t imm_ = 0;
 };
 
+static_assert(std::is_trivially_copyable_v<Instruction>,
+              "Instruction must be trivially copyable");
+static_assert(sizeof(Instruction) == 4, "Instruction must be packed");
+
 }  // namespace cpu
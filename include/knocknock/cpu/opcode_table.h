@@ -0,0 +1,449 @@
+/**
+ * Compile-time generated tables describing every opcode encoding.
+ * @file opcode_table.h
+ */
+#pragma once
+
+#include <array>
+#include <cstdint>
+
+#include "knocknock/cpu/instruction.h"
+
+namespace cpu {
+
+/**
+ * Kind of immediate following an opcode in the instruction stream.
+ */
+enum class ImmediateKind : uint8_t {
+    None,     /**< No immediate follows the opcode */
+    Imm8,     /**< An unsigned 8-bit immediate follows the opcode */
+    Imm8Sign, /**< A signed 8-bit immediate follows the opcode */
+    Imm16,    /**< A little-endian 16-bit immediate follows the opcode */
+};
+
+/**
+ * Everything known about an encoded opcode before executing it.
+ */
+struct OpcodeInfo {
+    /** Whether the encoding is a valid instruction. */
+    bool valid;
+
+    Instruction::Opcode opcode;
+    Instruction::Operand lhs;
+    Instruction::Operand rhs;
+
+    /** Immediate read from the instruction stream after the opcode. */
+    ImmediateKind immediate;
+
+    /**
+     * Unsigned 8-bit immediate encoded in the opcode itself: the vector of
+     * RST, or the bit index of BIT, RES and SET.
+     */
+    uint8_t implicit_imm8;
+
+    /** Length of the instruction in bytes, including prefix and immediate. */
+    uint8_t length;
+
+    /**
+     * Duration in M-cycles. For conditional instructions, this is the
+     * duration when the condition does not hold.
+     */
+    uint8_t cycles;
+
+    /** Duration in M-cycles of a conditional instruction which is taken. */
+    uint8_t cycles_taken;
+
+    /** Index of (lhs, rhs) in Instruction::OPERAND_PAIRS. */
+    uint8_t operands;
+};
+
+namespace opcode_table_internal {
+
+using Opcode = Instruction::Opcode;
+using Operand = Instruction::Operand;
+
+// Bits 7-6 of n
+constexpr uint8_t x(uint8_t n) {
+    return n >> 6;
+}
+
+// Bits 5-3 of n
+constexpr uint8_t y(uint8_t n) {
+    return (n & 0b00111000) >> 3;
+}
+
+// Bits 2-0 of n
+constexpr uint8_t z(uint8_t n) {
+    return n & 0b00000111;
+}
+
+constexpr Operand R[] = {
+    Operand::B,      // 0
+    Operand::C,      // 1
+    Operand::D,      // 2
+    Operand::E,      // 3
+    Operand::H,      // 4
+    Operand::L,      // 5
+    Operand::PtrHL,  // 6
+    Operand::A       // 7
+};
+
+constexpr Opcode ROT[] = {
+    Opcode::RLC,   // 0
+    Opcode::RRC,   // 1
+    Opcode::RL,    // 2
+    Opcode::RR,    // 3
+    Opcode::SLA,   // 4
+    Opcode::SRA,   // 5
+    Opcode::SWAP,  // 6
+    Opcode::SRL    // 7
+};
+
+constexpr ImmediateKind immediate_of(Operand operand) {
+    switch (operand) {
+        case Operand::Imm8:
+        case Operand::PtrImm8: return ImmediateKind::Imm8;
+        case Operand::Imm8Sign: return ImmediateKind::Imm8Sign;
+        case Operand::Imm16:
+        case Operand::PtrImm16: return ImmediateKind::Imm16;
+        default: return ImmediateKind::None;
+    }
+}
+
+constexpr uint8_t length_of(ImmediateKind immediate) {
+    switch (immediate) {
+        case ImmediateKind::None: return 1;
+        case ImmediateKind::Imm8:
+        case ImmediateKind::Imm8Sign: return 2;
+        case ImmediateKind::Imm16: return 3;
+    }
+
+    return 1;
+}
+
+/**
+ * Build an entry whose immediate (if any) is read from the instruction
+ * stream, as deduced from its operands.
+ */
+constexpr OpcodeInfo entry(Opcode opcode,
+                           Operand lhs,
+                           Operand rhs,
+                           uint8_t cycles,
+                           uint8_t cycles_taken = 0) {
+    ImmediateKind immediate = immediate_of(lhs);
+    if (immediate == ImmediateKind::None) {
+        immediate = immediate_of(rhs);
+    }
+
+    return {true,
+            opcode,
+            lhs,
+            rhs,
+            immediate,
+            0,
+            length_of(immediate),
+            cycles,
+            cycles_taken != 0 ? cycles_taken : cycles,
+            0};
+}
+
+constexpr OpcodeInfo entry(Opcode opcode, Operand lhs, uint8_t cycles) {
+    return entry(opcode, lhs, Operand::None, cycles);
+}
+
+constexpr OpcodeInfo entry(Opcode opcode, uint8_t cycles) {
+    return entry(opcode, Operand::None, Operand::None, cycles);
+}
+
+/**
+ * Build an entry whose unsigned 8-bit immediate is encoded in the opcode.
+ */
+constexpr OpcodeInfo implicit_entry(Opcode opcode,
+                                    Operand rhs,
+                                    uint8_t imm8,
+                                    uint8_t length,
+                                    uint8_t cycles) {
+    return {true,   opcode, Operand::Imm8, rhs, ImmediateKind::None,
+            imm8,   length, cycles,        cycles, 0};
+}
+
+constexpr OpcodeInfo invalid_entry() {
+    return {false, Opcode::NOP, Operand::None, Operand::None,
+            ImmediateKind::None, 0, 1, 1, 1, 0};
+}
+
+// Opcodes which do not follow the regular patterns of the 8-bit loads and
+// ALU instructions.
+constexpr OpcodeInfo assorted(uint8_t opcode) {
+    switch (opcode) {
+        case 0x00: return entry(Opcode::NOP, 1);
+        case 0x01: return entry(Opcode::LD, Operand::BC, Operand::Imm16, 3);
+        case 0x02: return entry(Opcode::LD, Operand::PtrBC, Operand::A, 2);
+        case 0x03: return entry(Opcode::INC, Operand::BC, 2);
+        case 0x04: return entry(Opcode::INC, Operand::B, 1);
+        case 0x05: return entry(Opcode::DEC, Operand::B, 1);
+        case 0x06: return entry(Opcode::LD, Operand::B, Operand::Imm8, 2);
+        case 0x07: return entry(Opcode::RLCA, 1);
+        case 0x08: return entry(Opcode::LD, Operand::PtrImm16, Operand::SP, 5);
+        case 0x09: return entry(Opcode::ADD, Operand::HL, Operand::BC, 2);
+        case 0x0a: return entry(Opcode::LD, Operand::A, Operand::PtrBC, 2);
+        case 0x0b: return entry(Opcode::DEC, Operand::BC, 2);
+        case 0x0c: return entry(Opcode::INC, Operand::C, 1);
+        case 0x0d: return entry(Opcode::DEC, Operand::C, 1);
+        case 0x0e: return entry(Opcode::LD, Operand::C, Operand::Imm8, 2);
+        case 0x0f: return entry(Opcode::RRCA, 1);
+        case 0x10: return entry(Opcode::STOP, 1);
+        case 0x11: return entry(Opcode::LD, Operand::DE, Operand::Imm16, 3);
+        case 0x12: return entry(Opcode::LD, Operand::PtrDE, Operand::A, 2);
+        case 0x13: return entry(Opcode::INC, Operand::DE, 2);
+        case 0x14: return entry(Opcode::INC, Operand::D, 1);
+        case 0x15: return entry(Opcode::DEC, Operand::D, 1);
+        case 0x16: return entry(Opcode::LD, Operand::D, Operand::Imm8, 2);
+        case 0x17: return entry(Opcode::RLA, 1);
+        case 0x18: return entry(Opcode::JR, Operand::Imm8Sign, 3);
+        case 0x19: return entry(Opcode::ADD, Operand::HL, Operand::DE, 2);
+        case 0x1a: return entry(Opcode::LD, Operand::A, Operand::PtrDE, 2);
+        case 0x1b: return entry(Opcode::DEC, Operand::DE, 2);
+        case 0x1c: return entry(Opcode::INC, Operand::E, 1);
+        case 0x1d: return entry(Opcode::DEC, Operand::E, 1);
+        case 0x1e: return entry(Opcode::LD, Operand::E, Operand::Imm8, 2);
+        case 0x1f: return entry(Opcode::RRA, 1);
+        case 0x20:
+            return entry(Opcode::JR, Operand::FlagNZ, Operand::Imm8Sign, 2, 3);
+        case 0x21: return entry(Opcode::LD, Operand::HL, Operand::Imm16, 3);
+        case 0x22: return entry(Opcode::LDI, Operand::PtrHL, Operand::A, 2);
+        case 0x23: return entry(Opcode::INC, Operand::HL, 2);
+        case 0x24: return entry(Opcode::INC, Operand::H, 1);
+        case 0x25: return entry(Opcode::DEC, Operand::H, 1);
+        case 0x26: return entry(Opcode::LD, Operand::H, Operand::Imm8, 2);
+        case 0x27: return entry(Opcode::DAA, 1);
+        case 0x28:
+            return entry(Opcode::JR, Operand::FlagZ, Operand::Imm8Sign, 2, 3);
+        case 0x29: return entry(Opcode::ADD, Operand::HL, Operand::HL, 2);
+        case 0x2a: return entry(Opcode::LDI, Operand::A, Operand::PtrHL, 2);
+        case 0x2b: return entry(Opcode::DEC, Operand::HL, 2);
+        case 0x2c: return entry(Opcode::INC, Operand::L, 1);
+        case 0x2d: return entry(Opcode::DEC, Operand::L, 1);
+        case 0x2e: return entry(Opcode::LD, Operand::L, Operand::Imm8, 2);
+        case 0x2f: return entry(Opcode::CPL, 1);
+        case 0x30:
+            return entry(Opcode::JR, Operand::FlagNC, Operand::Imm8Sign, 2, 3);
+        case 0x31: return entry(Opcode::LD, Operand::SP, Operand::Imm16, 3);
+        case 0x32: return entry(Opcode::LDD, Operand::PtrHL, Operand::A, 2);
+        case 0x33: return entry(Opcode::INC, Operand::SP, 2);
+        case 0x34: return entry(Opcode::INC, Operand::PtrHL, 3);
+        case 0x35: return entry(Opcode::DEC, Operand::PtrHL, 3);
+        case 0x36: return entry(Opcode::LD, Operand::PtrHL, Operand::Imm8, 3);
+        case 0x37: return entry(Opcode::SCF, 1);
+        case 0x38:
+            return entry(Opcode::JR, Operand::FlagC, Operand::Imm8Sign, 2, 3);
+        case 0x39: return entry(Opcode::ADD, Operand::HL, Operand::SP, 2);
+        case 0x3a: return entry(Opcode::LDD, Operand::A, Operand::PtrHL, 2);
+        case 0x3b: return entry(Opcode::DEC, Operand::SP, 2);
+        case 0x3c: return entry(Opcode::INC, Operand::A, 1);
+        case 0x3d: return entry(Opcode::DEC, Operand::A, 1);
+        case 0x3e: return entry(Opcode::LD, Operand::A, Operand::Imm8, 2);
+        case 0x3f: return entry(Opcode::CCF, 1);
+        case 0xc0: return entry(Opcode::RET, Operand::FlagNZ, Operand::None, 2, 5);
+        case 0xc1: return entry(Opcode::POP, Operand::BC, 3);
+        case 0xc2:
+            return entry(Opcode::JP, Operand::FlagNZ, Operand::Imm16, 3, 4);
+        case 0xc3: return entry(Opcode::JP, Operand::Imm16, 4);
+        case 0xc4:
+            return entry(Opcode::CALL, Operand::FlagNZ, Operand::Imm16, 3, 6);
+        case 0xc5: return entry(Opcode::PUSH, Operand::BC, 4);
+        case 0xc6: return entry(Opcode::ADD, Operand::A, Operand::Imm8, 2);
+        case 0xc8: return entry(Opcode::RET, Operand::FlagZ, Operand::None, 2, 5);
+        case 0xc9: return entry(Opcode::RET, 4);
+        case 0xca:
+            return entry(Opcode::JP, Operand::FlagZ, Operand::Imm16, 3, 4);
+        case 0xcc:
+            return entry(Opcode::CALL, Operand::FlagZ, Operand::Imm16, 3, 6);
+        case 0xcd: return entry(Opcode::CALL, Operand::Imm16, 6);
+        case 0xce: return entry(Opcode::ADC, Operand::A, Operand::Imm8, 2);
+        case 0xd0: return entry(Opcode::RET, Operand::FlagNC, Operand::None, 2, 5);
+        case 0xd1: return entry(Opcode::POP, Operand::DE, 3);
+        case 0xd2:
+            return entry(Opcode::JP, Operand::FlagNC, Operand::Imm16, 3, 4);
+        case 0xd4:
+            return entry(Opcode::CALL, Operand::FlagNC, Operand::Imm16, 3, 6);
+        case 0xd5: return entry(Opcode::PUSH, Operand::DE, 4);
+        case 0xd6: return entry(Opcode::SUB, Operand::Imm8, 2);
+        case 0xd8: return entry(Opcode::RET, Operand::FlagC, Operand::None, 2, 5);
+        case 0xd9: return entry(Opcode::RETI, 4);
+        case 0xda:
+            return entry(Opcode::JP, Operand::FlagC, Operand::Imm16, 3, 4);
+        case 0xdc:
+            return entry(Opcode::CALL, Operand::FlagC, Operand::Imm16, 3, 6);
+        case 0xde: return entry(Opcode::SBC, Operand::A, Operand::Imm8, 2);
+        case 0xe0: return entry(Opcode::LD, Operand::PtrImm8, Operand::A, 3);
+        case 0xe1: return entry(Opcode::POP, Operand::HL, 3);
+        case 0xe2: return entry(Opcode::LD, Operand::PtrC, Operand::A, 2);
+        case 0xe5: return entry(Opcode::PUSH, Operand::HL, 4);
+        case 0xe6: return entry(Opcode::AND, Operand::Imm8, 2);
+        case 0xe8: return entry(Opcode::ADD, Operand::SP, Operand::Imm8Sign, 4);
+        case 0xe9: return entry(Opcode::JP, Operand::HL, 1);
+        case 0xea: return entry(Opcode::LD, Operand::PtrImm16, Operand::A, 4);
+        case 0xee: return entry(Opcode::XOR, Operand::Imm8, 2);
+        case 0xf0: return entry(Opcode::LD, Operand::A, Operand::PtrImm8, 3);
+        case 0xf1: return entry(Opcode::POP, Operand::AF, 3);
+        case 0xf2: return entry(Opcode::LD, Operand::A, Operand::PtrC, 2);
+        case 0xf3: return entry(Opcode::DI, 1);
+        case 0xf5: return entry(Opcode::PUSH, Operand::AF, 4);
+        case 0xf6: return entry(Opcode::OR, Operand::Imm8, 2);
+        case 0xf8:
+            return entry(Opcode::LDHL, Operand::SP, Operand::Imm8Sign, 3);
+        case 0xf9: return entry(Opcode::LD, Operand::SP, Operand::HL, 2);
+        case 0xfa: return entry(Opcode::LD, Operand::A, Operand::PtrImm16, 4);
+        case 0xfb: return entry(Opcode::EI, 1);
+        case 0xfe: return entry(Opcode::CP, Operand::Imm8, 2);
+
+        default: return invalid_entry();
+    }
+}
+
+constexpr OpcodeInfo decode_base(uint8_t opcode) {
+    // RST: the vector is encoded in bits 5-3.
+    if (x(opcode) == 3 && z(opcode) == 7) {
+        return implicit_entry(Opcode::RST, Operand::None, y(opcode) * 8, 1, 4);
+    }
+
+    // 8-bit loads. LD (HL), (HL) is repurposed as the HALT instruction.
+    if (x(opcode) == 1) {
+        if (opcode == 0x76) {
+            return entry(Opcode::HALT, 1);
+        }
+
+        const Operand lhs = R[y(opcode)], rhs = R[z(opcode)];
+        const bool memory = (lhs == Operand::PtrHL || rhs == Operand::PtrHL);
+        return entry(Opcode::LD, lhs, rhs, memory ? 2 : 1);
+    }
+
+    // ALU instructions.
+    if (x(opcode) == 2) {
+        const Operand reg = R[z(opcode)];
+        const uint8_t cycles = (reg == Operand::PtrHL) ? 2 : 1;
+
+        switch (y(opcode)) {
+            case 0: return entry(Opcode::ADD, Operand::A, reg, cycles);
+            case 1: return entry(Opcode::ADC, Operand::A, reg, cycles);
+            case 2: return entry(Opcode::SUB, reg, cycles);
+            case 3: return entry(Opcode::SBC, Operand::A, reg, cycles);
+            case 4: return entry(Opcode::AND, reg, cycles);
+            case 5: return entry(Opcode::XOR, reg, cycles);
+            case 6: return entry(Opcode::OR, reg, cycles);
+            case 7: return entry(Opcode::CP, reg, cycles);
+        }
+    }
+
+    return assorted(opcode);
+}
+
+// Decode a CB-prefix instruction. |opcode| is the second byte following the
+// CB prefix.
+constexpr OpcodeInfo decode_cb(uint8_t opcode) {
+    const Operand reg = R[z(opcode)];
+    const bool memory = (reg == Operand::PtrHL);
+
+    switch (x(opcode)) {
+        case 0: {
+            OpcodeInfo info = entry(ROT[y(opcode)], reg, memory ? 4 : 2);
+            info.length = 2;
+            return info;
+        }
+        case 1:
+            // BIT only reads (HL), so it takes one cycle less than RES/SET.
+            return implicit_entry(Opcode::BIT, reg, y(opcode), 2,
+                                  memory ? 3 : 2);
+        case 2:
+            return implicit_entry(Opcode::RES, reg, y(opcode), 2,
+                                  memory ? 4 : 2);
+        default:
+            return implicit_entry(Opcode::SET, reg, y(opcode), 2,
+                                  memory ? 4 : 2);
+    }
+}
+
+template <class Decode>
+constexpr std::array<OpcodeInfo, 256> make_table(Decode decode) {
+    std::array<OpcodeInfo, 256> table{};
+    for (size_t opcode = 0; opcode < table.size(); ++opcode) {
+        table[opcode] = decode(static_cast<uint8_t>(opcode));
+    }
+
+    return table;
+}
+
+// The tables without OpcodeInfo::operands, from which the operand pairs are
+// collected.
+inline constexpr std::array<OpcodeInfo, 256> BASE_ENTRIES =
+    make_table(decode_base);
+inline constexpr std::array<OpcodeInfo, 256> CB_ENTRIES = make_table(decode_cb);
+
+/**
+ * Every distinct pair of operands of the valid entries, in order of first
+ * appearance. Unused slots are (None, None).
+ */
+constexpr std::array<Instruction::OperandPair, 256> make_operand_pairs() {
+    std::array<Instruction::OperandPair, 256> pairs{};
+    size_t count = 1;
+
+    for (const auto *table : {&BASE_ENTRIES, &CB_ENTRIES}) {
+        for (const OpcodeInfo &info : *table) {
+            bool found = false;
+            for (size_t i = 0; i < count; ++i) {
+                found |= pairs[i].lhs == info.lhs && pairs[i].rhs == info.rhs;
+            }
+
+            if (info.valid && !found) {
+                pairs[count++] = {info.lhs, info.rhs};
+            }
+        }
+    }
+
+    return pairs;
+}
+
+inline constexpr std::array<Instruction::OperandPair, 256> OPERAND_PAIRS =
+    make_operand_pairs();
+
+constexpr uint8_t operand_pair_index(Operand lhs, Operand rhs) {
+    for (size_t i = 0; i < OPERAND_PAIRS.size(); ++i) {
+        if (OPERAND_PAIRS[i].lhs == lhs && OPERAND_PAIRS[i].rhs == rhs) {
+            return i;
+        }
+    }
+
+    return 0;
+}
+
+constexpr std::array<OpcodeInfo, 256> with_operands(
+    std::array<OpcodeInfo, 256> table) {
+    for (OpcodeInfo &info : table) {
+        info.operands = operand_pair_index(info.lhs, info.rhs);
+    }
+
+    return table;
+}
+
+}  // namespace opcode_table_internal
+
+/**
+ * The CB prefix, which selects CB_OPCODES for the following byte.
+ */
+inline constexpr uint8_t CB_PREFIX = 0xcb;
+
+/**
+ * Table of all unprefixed opcodes, indexed by the opcode byte. The entry for
+ * CB_PREFIX itself is invalid.
+ */
+inline constexpr std::array<OpcodeInfo, 256> BASE_OPCODES =
+    opcode_table_internal::with_operands(opcode_table_internal::BASE_ENTRIES);
+
+/**
+ * Table of all CB-prefixed opcodes, indexed by the byte following the prefix.
+ */
+inline constexpr std::array<OpcodeInfo, 256> CB_OPCODES =
+    opcode_table_internal::with_operands(opcode_table_internal::CB_ENTRIES);
+
+}  // namespace cpu
@@ -0,0 +1,168 @@
+/**
+ * The register file of the CPU.
+ * @file registers.h
+ */
+#pragma once
+
+#include <cstdint>
+#include <type_traits>
+
+#include "knocknock/cpu/flags.h"
+#include "knocknock/cpu/instruction.h"
+
+namespace cpu {
+
+/**
+ * Whether |operand| is one of the registers stored in RegisterFile.
+ */
+constexpr bool is_register(Instruction::Operand operand) {
+    switch (operand) {
+        case Instruction::Operand::A:
+        case Instruction::Operand::B:
+        case Instruction::Operand::C:
+        case Instruction::Operand::D:
+        case Instruction::Operand::E:
+        case Instruction::Operand::H:
+        case Instruction::Operand::L:
+        case Instruction::Operand::AF:
+        case Instruction::Operand::BC:
+        case Instruction::Operand::DE:
+        case Instruction::Operand::HL:
+        case Instruction::Operand::SP: return true;
+        default: return false;
+    }
+}
+
+/**
+ * Whether |operand| holds a 16-bit value, as opposed to an 8-bit one.
+ */
+constexpr bool is_operand16(Instruction::Operand operand) {
+    switch (operand) {
+        case Instruction::Operand::AF:
+        case Instruction::Operand::BC:
+        case Instruction::Operand::DE:
+        case Instruction::Operand::HL:
+        case Instruction::Operand::SP:
+        case Instruction::Operand::Imm16: return true;
+        default: return false;
+    }
+}
+
+/**
+ * All registers of the CPU, packed in 12 bytes with eager flags. The 8-bit
+ * registers are laid out so that each pair is little-endian, the same as the
+ * 16-bit registers.
+ *
+ * The register file is trivial so that it can be copied as plain bytes, and
+ * must be value-initialized to zero its registers.
+ */
+struct RegisterFile {
+    Flags f;
+    uint8_t a;
+    uint8_t c, b;
+    uint8_t e, d;
+    uint8_t l, h;
+    uint16_t sp;
+    uint16_t pc;
+
+    uint16_t af() const { return (a << 8) | f.read(); }
+    uint16_t bc() const { return (b << 8) | c; }
+    uint16_t de() const { return (d << 8) | e; }
+    uint16_t hl() const { return (h << 8) | l; }
+
+    void set_af(uint16_t value) {
+        a = value >> 8;
+        f.write(value & 0xff);
+    }
+    void set_bc(uint16_t value) {
+        b = value >> 8;
+        c = value & 0xff;
+    }
+    void set_de(uint16_t value) {
+        d = value >> 8;
+        e = value & 0xff;
+    }
+    void set_hl(uint16_t value) {
+        h = value >> 8;
+        l = value & 0xff;
+    }
+
+    /**
+     * Read the register named by |REGISTER|, resolved at compile time.
+     * @return uint8_t for the 8-bit registers, uint16_t for the 16-bit ones.
+     */
+    template <Instruction::Operand REGISTER>
+    auto get() const {
+        using Operand = Instruction::Operand;
+        static_assert(is_register(REGISTER), "Operand is not a register");
+
+        if constexpr (REGISTER == Operand::A) {
+            return a;
+        } else if constexpr (REGISTER == Operand::B) {
+            return b;
+        } else if constexpr (REGISTER == Operand::C) {
+            return c;
+        } else if constexpr (REGISTER == Operand::D) {
+            return d;
+        } else if constexpr (REGISTER == Operand::E) {
+            return e;
+        } else if constexpr (REGISTER == Operand::H) {
+            return h;
+        } else if constexpr (REGISTER == Operand::L) {
+            return l;
+        } else if constexpr (REGISTER == Operand::AF) {
+            return af();
+        } else if constexpr (REGISTER == Operand::BC) {
+            return bc();
+        } else if constexpr (REGISTER == Operand::DE) {
+            return de();
+        } else if constexpr (REGISTER == Operand::HL) {
+            return hl();
+        } else {
+            return sp;
+        }
+    }
+
+    /**
+     * Write the register named by |REGISTER|, resolved at compile time.
+     */
+    template <Instruction::Operand REGISTER>
+    void set(uint16_t value) {
+        using Operand = Instruction::Operand;
+        static_assert(is_register(REGISTER), "Operand is not a register");
+
+        if constexpr (REGISTER == Operand::A) {
+            a = value;
+        } else if constexpr (REGISTER == Operand::B) {
+            b = value;
+        } else if constexpr (REGISTER == Operand::C) {
+            c = value;
+        } else if constexpr (REGISTER == Operand::D) {
+            d = value;
+        } else if constexpr (REGISTER == Operand::E) {
+            e = value;
+        } else if constexpr (REGISTER == Operand::H) {
+            h = value;
+        } else if constexpr (REGISTER == Operand::L) {
+            l = value;
+        } else if constexpr (REGISTER == Operand::AF) {
+            set_af(value);
+        } else if constexpr (REGISTER == Operand::BC) {
+            set_bc(value);
+        } else if constexpr (REGISTER == Operand::DE) {
+            set_de(value);
+        } else if constexpr (REGISTER == Operand::HL) {
+            set_hl(value);
+        } else {
+            sp = value;
+        }
+    }
+};
+
+static_assert(std::is_trivial_v<RegisterFile> &&
+                  std::is_standard_layout_v<RegisterFile>,
+              "RegisterFile must be a POD");
+static_assert(KNOCKNOCK_LAZY_FLAGS || sizeof(RegisterFile) == 12,
+              "RegisterFile must be packed");
+
+}  // namespace cpu
@@ -1,16 +1,18 @@
 #pragma once
 
-#include <map>
+#include <cstdint>
 
 #include "knocknock/memory/memory.h"
+#include "knocknock/peripherals/scheduler.h"
 #include "knocknock/peripherals/tickable.h"
 
 namespace interrupt {
 
 /**
- * Enum of all possible interrupt types.
+ * Enum of all possible interrupt types, in order of priority. The value of
+ * each type is the index of its bit in IE and IF.
  */
-enum class InterruptType {
+enum class InterruptType : uint8_t {
     /**
      * Vertical blank.
      */
@@ -58,7 +60,14 @@ class InterruptController : public Interruptible,
                             public memory::Memory,
                             public peripherals::Tickable {
 public:
-    InterruptController(Interruptible *sink);
+    /**
+     * @param scheduler if not nullptr, the controller schedules a tick when
+     * an enabled interrupt is requested, instead of being ticked on every
+     * cycle. An interrupt refused by the sink is not offered again until the
+     * sink calls service(), which the CPU does once it can take it.
+     */
+    explicit InterruptController(Interruptible *sink,
+                                 peripherals::Scheduler *scheduler = nullptr);
 
     // Interruptible::
     bool interrupt(InterruptType reason) override;
@@ -70,11 +79,36 @@ public:
     // clock::Tickable::
     void tick() override;
 
+    /**
+     * Offer the pending interrupt of the highest priority to the sink, and
+     * clear its request if the sink takes it.
+     * @return true if the sink took an interrupt.
+     */
+    bool service();
+
+    /**
+     * Interrupts both requested and enabled, as a mask of IF bits.
+     */
+    [[nodiscard]] uint8_t pending() const { return pending_; }
+
 private:
+    /**
+     * Schedule a tick if an enabled interrupt is requested.
+     * @param delay cycles until the tick.
+     */
+    void schedule_if_pending(peripherals::Scheduler::Timestamp delay);
+
     Interruptible *sink_;
+    peripherals::Scheduler *scheduler_;
 
-    std::map<InterruptType, bool> interrupt_enabled_;
-    std::map<InterruptType, bool> interrupt_requested_;
+    // The 5 used bits of IE and IF.
+    uint8_t enabled_;
+    uint8_t requested_;
+
+    /**
+     * enabled_ & requested_, updated whenever either of them changes.
+     */
+    uint8_t pending_;
 };
 
 }  // namespace interrupt
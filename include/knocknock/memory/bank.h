@@ -0,0 +1,69 @@
+/**
+ * Helpers shared by the memory bank controllers.
+ * @file bank.h
+ */
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+#include "knocknock/memory/memory.h"
+#include "knocknock/memory/regions.h"
+
+namespace memory {
+
+/**
+ * Pad |rom| with 0xff up to a whole number of banks of |bank_size|, and at
+ * least one, so that every bank a controller maps is contiguous and in range.
+ */
+std::vector<MemoryValue> pad_to_banks(std::vector<MemoryValue> rom,
+                                      MemorySize bank_size);
+
+/**
+ * Bank of the external RAM mapped to the external RAM region. RAM smaller
+ * than a bank is mirrored over the whole region.
+ */
+struct RAMBank {
+    static constexpr MemorySize SIZE = 0x2000;
+
+    /**
+     * Offset in the RAM of the bank.
+     */
+    uint32_t base = 0;
+
+    /**
+     * Mask of the offset in the bank.
+     */
+    uint32_t mask = 0;
+
+    /**
+     * Offset in the RAM of the external RAM at |addr|.
+     */
+    [[nodiscard]] uint32_t translate(MemoryAddr addr) const {
+        return base + ((addr - RAM_EXTERNAL_BEGIN) & mask);
+    }
+
+    /**
+     * Number of bytes from |addr|, up to |size|, which are contiguous in the
+     * RAM, before the end of the bank or of a mirror.
+     */
+    [[nodiscard]] MemorySize span(MemoryAddr addr, MemorySize size) const {
+        return std::min<MemorySize>(
+            size, mask + 1 - ((addr - RAM_EXTERNAL_BEGIN) & mask));
+    }
+};
+
+/**
+ * Check that a RAM of |ram_size| bytes fits in |max_size| bytes, and is either
+ * made of whole banks, or smaller than a bank and mirrored.
+ */
+void check_ram_size(MemorySize ram_size, MemorySize max_size);
+
+/**
+ * Bank |bank| of a RAM of |ram_size| bytes, wrapped around the number of
+ * banks.
+ */
+RAMBank select_ram_bank(MemorySize ram_size, uint32_t bank);
+
+}  // namespace memory
@@ -0,0 +1,30 @@
+/**
+ * Creation of the memory controller of a cartridge.
+ * @file controller.h
+ */
+#pragma once
+
+#include <memory>
+
+#include "knocknock/cartridge.h"
+#include "knocknock/memory/memory.h"
+#include "knocknock/peripherals/scheduler.h"
+
+namespace memory {
+
+/**
+ * Create the memory controller for the type of |cartridge|: FlatROM, MBC1,
+ * MBC2, MBC3 or MBC5, all of them final classes. The ROM is the content of
+ * the cartridge, padded with 0xff or truncated to rom_size(), and the RAM is
+ * ram_size() on the types with RAM.
+ *
+ * @param scheduler the cycles counted by the real time clock of MBC3. The
+ * clock counts the host time if nullptr.
+ * @return nullptr if the type of the cartridge is not supported, or its RAM
+ * is too large for its controller. The reason is logged.
+ */
+std::unique_ptr<ROMLoadableMemory> make_controller(
+    const Cartridge &cartridge,
+    const peripherals::Scheduler *scheduler = nullptr);
+
+}  // namespace memory
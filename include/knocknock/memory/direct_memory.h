@@ -0,0 +1,85 @@
+/**
+ * Fast access to a memory through the host pointers it publishes.
+ * @file direct_memory.h
+ */
+#pragma once
+
+#include <vector>
+
+#include "knocknock/memory/host_page_table.h"
+#include "knocknock/memory/memory.h"
+
+namespace memory {
+
+/**
+ * Accesses a memory by dereferencing the host pointers published in its
+ * HostPageTable, and falls back to the virtual read() and write() for
+ * addresses without one, such as memory-mapped IO.
+ */
+class DirectMemory {
+public:
+    explicit DirectMemory(Memory *memory)
+        : memory_(memory),
+          pages_(memory->host_page_table() != nullptr
+                     ? memory->host_page_table()
+                     : &HostPageTable::empty()),
+          indirect_reads_(nullptr) {}
+
+    MemoryValue read(MemoryAddr addr) const {
+        const MemoryValue *ptr = pages_->read_ptr(addr);
+        if (ptr != nullptr) {
+            return *ptr;
+        }
+
+        if (indirect_reads_ != nullptr) {
+            indirect_reads_->push_back(addr);
+        }
+        return memory_->read(addr);
+    }
+
+    void write(MemoryAddr addr, MemoryValue value) const {
+        MemoryValue *ptr = pages_->write_ptr(addr);
+        if (ptr != nullptr) {
+            *ptr = value;
+            return;
+        }
+
+        memory_->write(addr, value);
+    }
+
+    uint16_t read16(MemoryAddr addr) const {
+        // Gameboy is little-endian => first byte is LSB, second byte is MSB
+        return read(addr) | (read(addr + 1) << 8);
+    }
+
+    void write16(MemoryAddr addr, uint16_t value) const {
+        write(addr, value & 0x00ffu);
+        write(addr + 1, value >> 8u);
+    }
+
+    /**
+     * The underlying memory.
+     */
+    Memory *memory() const { return memory_; }
+
+    /**
+     * The host pointers of the underlying memory, or an empty table if it
+     * doesn't publish any.
+     */
+    const HostPageTable *host_page_table() const { return pages_; }
+
+    /**
+     * Append the addresses read through the read() of the underlying memory,
+     * rather than a host pointer, to |log| from now on, or stop if nullptr.
+     */
+    void log_indirect_reads(std::vector<MemoryAddr> *log) {
+        indirect_reads_ = log;
+    }
+
+private:
+    Memory *memory_;
+    const HostPageTable *pages_;
+    std::vector<MemoryAddr> *indirect_reads_;
+};
+
+}  // namespace memory
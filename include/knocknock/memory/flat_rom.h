@@ -12,7 +12,7 @@ namespace memory {
  *  * 0x08: ROM only + RAM
  *  * 0x09: ROM only + RAM + BATT
  */
-class FlatROM : public ROMLoadableMemory {
+class FlatROM final : public ROMLoadableMemory {
 public:
     /**
      * Initialize a Flat ROM with optional external RAM.
@@ -22,8 +22,28 @@ public:
 
     MemoryValue read(MemoryAddr addr) const override;
     void write(MemoryAddr addr, MemoryValue value) override;
+    void read_block(MemoryAddr addr,
+                    MemoryValue *data,
+                    MemorySize size) const override;
+    void write_block(MemoryAddr addr,
+                     const MemoryValue *data,
+                     MemorySize size) override;
+    void peek_block(MemoryAddr addr,
+                    MemoryValue *data,
+                    MemorySize size) const override;
+    const MemoryValue *host_read_ptr(MemoryAddr addr) const override;
+    MemoryValue *host_write_ptr(MemoryAddr addr) override;
 
 private:
+    /**
+     * Implementation of read_block() and peek_block(), which only log invalid
+     * reads if |log| is set.
+     */
+    void copy_block(MemoryAddr addr,
+                    MemoryValue *data,
+                    MemorySize size,
+                    bool log) const;
+
     const MemorySize ram_size_;
     const MemoryAddr ram_end_addr_;
 
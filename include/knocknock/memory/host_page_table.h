@@ -0,0 +1,93 @@
+/**
+ * Table of host pointers published by memory regions.
+ * @file host_page_table.h
+ */
+#pragma once
+
+#include <array>
+
+#include "knocknock/memory/memory.h"
+
+namespace memory {
+
+/**
+ * Host pointers for every page of the address space which is backed by plain
+ * memory, such as ROM banks, WRAM or HRAM. The high page (0xff00 - 0xffff)
+ * mixes memory-mapped IO with HRAM, so it is tracked per byte instead.
+ */
+class HostPageTable {
+public:
+    HostPageTable()
+        : read_pages_(), write_pages_(), high_read_(), high_write_() {}
+
+    /**
+     * Get the host pointer to read |addr| from.
+     * @return the pointer, or nullptr if |addr| is not backed by host memory.
+     */
+    const MemoryValue *read_ptr(MemoryAddr addr) const {
+        const MemoryValue *page = read_pages_[page_of(addr)];
+        if (page != nullptr) {
+            return page + offset_in_page(addr);
+        }
+
+        if (page_of(addr) == HIGH_PAGE) {
+            return high_read_[offset_in_page(addr)];
+        }
+
+        return nullptr;
+    }
+
+    /**
+     * Get the host pointer to write |addr| to.
+     * @return the pointer, or nullptr if |addr| is not backed by host memory.
+     */
+    MemoryValue *write_ptr(MemoryAddr addr) const {
+        MemoryValue *page = write_pages_[page_of(addr)];
+        if (page != nullptr) {
+            return page + offset_in_page(addr);
+        }
+
+        if (page_of(addr) == HIGH_PAGE) {
+            return high_write_[offset_in_page(addr)];
+        }
+
+        return nullptr;
+    }
+
+    /**
+     * Set the host pointers of the page containing |addr|. For the high page,
+     * only the byte at |addr| is set.
+     */
+    void set(MemoryAddr addr, const MemoryValue *read, MemoryValue *write) {
+        if (page_of(addr) == HIGH_PAGE) {
+            high_read_[offset_in_page(addr)] = read;
+            high_write_[offset_in_page(addr)] = write;
+            return;
+        }
+
+        read_pages_[page_of(addr)] = read;
+        write_pages_[page_of(addr)] = write;
+    }
+
+    /**
+     * A table without any host pointers.
+     */
+    static const HostPageTable &empty() {
+        static const HostPageTable table;
+        return table;
+    }
+
+private:
+    static constexpr MemoryAddr HIGH_PAGE = 0xff;
+
+    static MemoryAddr page_of(MemoryAddr addr) { return addr >> 8; }
+    static MemoryAddr offset_in_page(MemoryAddr addr) { return addr & 0xff; }
+
+    std::array<const MemoryValue *, 0x100> read_pages_;
+    std::array<MemoryValue *, 0x100> write_pages_;
+
+    std::array<const MemoryValue *, PAGE_SIZE> high_read_;
+    std::array<MemoryValue *, PAGE_SIZE> high_write_;
+};
+
+}  // namespace memory
@@ -11,8 +11,24 @@ public:
 
     MemoryValue read(MemoryAddr addr) const override;
     void write(MemoryAddr addr, MemoryValue value) override;
+    void read_block(MemoryAddr addr,
+                    MemoryValue *data,
+                    MemorySize size) const override;
+    void write_block(MemoryAddr addr,
+                     const MemoryValue *data,
+                     MemorySize size) override;
+    const MemoryValue *host_read_ptr(MemoryAddr addr) const override;
+    MemoryValue *host_write_ptr(MemoryAddr addr) override;
 
 private:
+    /**
+     * Find the byte at |addr| in WRAM, echo RAM or HRAM.
+     * @param available receives the number of bytes from |addr| to the end
+     *        of its area.
+     * @return the byte, or nullptr if |addr| is outside of these areas.
+     */
+    MemoryValue *find(MemoryAddr addr, MemorySize *available);
+
     MemoryValue ram_[RAM_INTERNAL_SIZE];
     MemoryValue hram_[HRAM_SIZE];
 };
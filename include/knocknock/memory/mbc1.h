@@ -4,6 +4,7 @@
  */
 #pragma once
 
+#include "knocknock/memory/bank.h"
 #include "knocknock/memory/memory.h"
 
 namespace memory {
@@ -17,7 +18,7 @@ namespace memory {
  * * 0x02 (ROM + MBC1 + RAM)
  * * 0x05 (ROM + MBC1 + RAM + BATT)
  */
-class MBC1 : public ROMLoadableMemory {
+class MBC1 final : public ROMLoadableMemory {
 public:
     /**
      * Create a MBC1.
@@ -28,6 +29,17 @@ public:
 
     MemoryValue read(MemoryAddr addr) const override;
     void write(MemoryAddr addr, MemoryValue value) override;
+    void read_block(MemoryAddr addr,
+                    MemoryValue *data,
+                    MemorySize size) const override;
+    void write_block(MemoryAddr addr,
+                     const MemoryValue *data,
+                     MemorySize size) override;
+    void peek_block(MemoryAddr addr,
+                    MemoryValue *data,
+                    MemorySize size) const override;
+    const MemoryValue *host_read_ptr(MemoryAddr addr) const override;
+    MemoryValue *host_write_ptr(MemoryAddr addr) override;
 
 private:
     /**
@@ -47,10 +59,25 @@ private:
         MODE_1
     };
 
-    uint32_t translate_ram_address(MemoryAddr addr) const;
+    /**
+     * Recompute the bank bases from the bank and mode registers.
+     */
+    void update_banks();
 
+    /**
+     * Offset in |rom_| of the ROM at |addr|.
+     */
     uint32_t translate_rom_address(MemoryAddr addr) const;
 
+    /**
+     * Implementation of read_block() and peek_block(), which only log invalid
+     * reads if |log| is set.
+     */
+    void copy_block(MemoryAddr addr,
+                    MemoryValue *data,
+                    MemorySize size,
+                    bool log) const;
+
     /**
      * Whether the RAM is enabled or not.
      */
@@ -64,6 +91,15 @@ private:
 
     AddressingMode mode_;
 
+    /**
+     * Offsets in |rom_| of the banks mapped to the ROM_0 and switchable ROM
+     * regions, indexed by addr / ROM_BANK_SIZE, and in |ram_| of the bank
+     * mapped to the external RAM region. Only updated when a register is
+     * written, so that reads do not decode the registers.
+     */
+    uint32_t rom_bases_[2];
+    RAMBank mapped_ram_;
+
     static constexpr MemorySize ROM_BANK_SIZE = 0x4000;
 
     /**
@@ -72,10 +108,10 @@ private:
      */
     static constexpr MemorySize MAX_ROM_SIZE = 128 * ROM_BANK_SIZE;
 
-    static constexpr MemorySize RAM_BANK_SIZE = 0x2000;
+    static constexpr MemorySize RAM_BANK_SIZE = RAMBank::SIZE;
 
     /**
-     * Constant ROM data.
+     * Constant ROM data, padded to whole banks.
      */
     const std::vector<MemoryValue> rom_;
 
@@ -4,15 +4,39 @@
 
 namespace memory {
 
-class MBC2 : public ROMLoadableMemory {
+class MBC2 final : public ROMLoadableMemory {
 public:
     MBC2(std::vector<MemoryValue> rom);
 
     // Memory::
     MemoryValue read(MemoryAddr addr) const override;
     void write(MemoryAddr addr, MemoryValue value) override;
+    void read_block(MemoryAddr addr,
+                    MemoryValue *data,
+                    MemorySize size) const override;
+    void write_block(MemoryAddr addr,
+                     const MemoryValue *data,
+                     MemorySize size) override;
+    void peek_block(MemoryAddr addr,
+                    MemoryValue *data,
+                    MemorySize size) const override;
+    const MemoryValue *host_read_ptr(MemoryAddr addr) const override;
 
 private:
+    /**
+     * Recompute the bank base from the bank register.
+     */
+    void update_banks();
+
+    /**
+     * Implementation of read_block() and peek_block(), which only log invalid
+     * reads if |log| is set.
+     */
+    void copy_block(MemoryAddr addr,
+                    MemoryValue *data,
+                    MemorySize size,
+                    bool log) const;
+
     static constexpr MemorySize ROM_BANK_SIZE = 0x4000;
 
     /**
@@ -27,9 +51,20 @@ private:
 
     uint8_t selected_bank_;
 
+    /**
+     * Offsets in |rom_| of the banks mapped to the ROM_0 and switchable ROM
+     * regions, indexed by addr / ROM_BANK_SIZE. Only updated when the bank
+     * register is written.
+     */
+    uint32_t rom_bases_[2];
+
+    /**
+     * Constant ROM data, padded to whole banks.
+     */
     const std::vector<MemoryValue> rom_;
 
-    // Fixed 512 byte RAM.
+    // Fixed 512 byte RAM. Only the lower nibble is backed by the cartridge, the
+    // upper nibble is stored as 0xF so the RAM can be read directly.
     MemoryValue ram_[RAM_SIZE];
 };
 
@@ -0,0 +1,220 @@
+/**
+ * Implementation of the Memory Bank Controller 3.
+ * @file mbc3.h
+ */
+#pragma once
+
+#include <vector>
+
+#include "knocknock/memory/bank.h"
+#include "knocknock/memory/memory.h"
+#include "knocknock/memory/regions.h"
+#include "knocknock/peripherals/scheduler.h"
+
+namespace memory {
+
+/**
+ * The Memory Bank Controller 3, which features up to 2MByte of ROM, 32KByte
+ * of RAM and an optional real time clock.
+ *
+ * These cartridge types corresponds to MBC3:
+ * * 0x0f (ROM + MBC3 + TIMER + BATT)
+ * * 0x10 (ROM + MBC3 + TIMER + RAM + BATT)
+ * * 0x11 (ROM + MBC3)
+ * * 0x12 (ROM + MBC3 + RAM)
+ * * 0x13 (ROM + MBC3 + RAM + BATT)
+ *
+ * The clock is never ticked: its registers are brought up to date from the
+ * time elapsed since they were last, when they are latched or written.
+ */
+class MBC3 final : public ROMLoadableMemory {
+public:
+    /**
+     * The time counted by the real time clock.
+     */
+    enum class ClockSource {
+        /**
+         * The cycles of the scheduler: the clock runs as fast as the
+         * emulation, and stops with it.
+         */
+        EMULATED,
+        /**
+         * The time of the host, as the cartridge would count it, including
+         * while the emulator is not running.
+         */
+        HOST,
+    };
+
+    /**
+     * Create a MBC3.
+     * @param ram_size RAM size.
+     * @param has_rtc whether the cartridge has a real time clock.
+     * @param scheduler the cycles counted by the clock in EMULATED mode. The
+     * clock counts the host time if nullptr.
+     */
+    MBC3(std::vector<MemoryValue> rom,
+         MemorySize ram_size,
+         bool has_rtc,
+         const peripherals::Scheduler *scheduler = nullptr);
+
+    MemoryValue read(MemoryAddr addr) const override;
+    void write(MemoryAddr addr, MemoryValue value) override;
+    void read_block(MemoryAddr addr,
+                    MemoryValue *data,
+                    MemorySize size) const override;
+    void write_block(MemoryAddr addr,
+                     const MemoryValue *data,
+                     MemorySize size) override;
+    void peek_block(MemoryAddr addr,
+                    MemoryValue *data,
+                    MemorySize size) const override;
+    const MemoryValue *host_read_ptr(MemoryAddr addr) const override;
+    MemoryValue *host_write_ptr(MemoryAddr addr) override;
+
+    /**
+     * Select the time counted by the clock from now on. EMULATED requires a
+     * scheduler.
+     */
+    void set_clock_source(ClockSource source);
+
+    [[nodiscard]] ClockSource clock_source() const { return clock_source_; }
+
+    /**
+     * The battery-backed state, as stored in a save file: the RAM, followed,
+     * with a clock, by the live and latched clock registers and the host time
+     * of the save, in the format of BGB and VBA-M.
+     */
+    [[nodiscard]] std::vector<MemoryValue> save() const;
+
+    /**
+     * Restore the state from save(). With a clock counting the host time, the
+     * clock catches up with the time elapsed since the save.
+     * @return false if |data| is not the size of a save, in which case
+     * nothing is restored.
+     */
+    bool load_save(const std::vector<MemoryValue> &data);
+
+private:
+    /**
+     * The registers of the clock.
+     */
+    struct Clock {
+        uint8_t seconds = 0;
+        uint8_t minutes = 0;
+        uint8_t hours = 0;
+        uint16_t days = 0;
+        bool halted = false;
+        bool carry = false;
+
+        /**
+         * Count |elapsed| seconds, as the clock does when it is not halted.
+         */
+        void advance(uint64_t elapsed);
+
+        /**
+         * The register |reg|, 0x08 (seconds) to 0x0c (upper bit of the day
+         * counter and flags).
+         */
+        [[nodiscard]] MemoryValue get(uint8_t reg) const;
+        void set(uint8_t reg, MemoryValue value);
+    };
+
+    /**
+     * The current time of the clock source, in ticks_per_second() units.
+     */
+    [[nodiscard]] uint64_t now() const;
+    [[nodiscard]] uint64_t ticks_per_second() const;
+
+    /**
+     * Count the whole seconds elapsed since |clock_origin_| in |clock_|, and
+     * move the origin by as much.
+     */
+    void update_clock();
+
+    /**
+     * Recompute the bank bases from the bank registers.
+     */
+    void update_banks();
+
+    /**
+     * Whether the external RAM region maps a clock register instead of RAM.
+     */
+    [[nodiscard]] bool rtc_selected() const { return ram_bank_ >= 0x08; }
+
+    /**
+     * Implementation of read_block() and peek_block(), which only log invalid
+     * reads if |log| is set.
+     */
+    void copy_block(MemoryAddr addr,
+                    MemoryValue *data,
+                    MemorySize size,
+                    bool log) const;
+
+    static constexpr MemorySize ROM_BANK_SIZE = 0x4000;
+
+    /**
+     * Maximum ROM size. There are a maximum of 128 ROM banks, which resolves to
+     * the maximum size of 2MByte.
+     */
+    static constexpr MemorySize MAX_ROM_SIZE = 128 * ROM_BANK_SIZE;
+
+    static constexpr MemorySize RAM_BANK_SIZE = RAMBank::SIZE;
+
+    /**
+     * Whether the RAM and the clock registers are enabled or not.
+     */
+    bool ram_enabled_;
+
+    uint8_t rom_bank_;
+
+    /**
+     * RAM bank (0x00 - 0x03), or clock register (0x08 - 0x0c) mapped to the
+     * external RAM region.
+     */
+    uint8_t ram_bank_;
+
+    /**
+     * Offsets in |rom_| of the banks mapped to the ROM_0 and switchable ROM
+     * regions, indexed by addr / ROM_BANK_SIZE, and in |ram_| of the bank
+     * mapped to the external RAM region. Only updated when a register is
+     * written.
+     */
+    uint32_t rom_bases_[2];
+    RAMBank mapped_ram_;
+
+    /**
+     * Constant ROM data, padded to whole banks.
+     */
+    const std::vector<MemoryValue> rom_;
+
+    /**
+     * RAM region. There are a maximum of 4 RAM banks, which resolves to
+     * the maximum size of 32KByte.
+     */
+    MemoryValue ram_[4 * RAM_BANK_SIZE];
+    MemorySize ram_size_;
+
+    const bool has_rtc_;
+    const peripherals::Scheduler *scheduler_;
+    ClockSource clock_source_;
+
+    /**
+     * The clock registers as of |clock_origin_|, and as last latched.
+     */
+    Clock clock_;
+    Clock latched_;
+
+    /**
+     * Time of the clock source up to which |clock_| counted the elapsed
+     * seconds.
+     */
+    uint64_t clock_origin_;
+
+    /**
+     * Whether 0x00 was written to the latch register, so that writing 0x01
+     * next latches the clock.
+     */
+    bool latch_armed_;
+};
+
+}  // namespace memory
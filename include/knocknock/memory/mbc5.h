@@ -0,0 +1,131 @@
+/**
+ * Implementation of the Memory Bank Controller 5.
+ * @file mbc5.h
+ */
+#pragma once
+
+#include <vector>
+
+#include "knocknock/memory/bank.h"
+#include "knocknock/memory/memory.h"
+#include "knocknock/memory/regions.h"
+
+namespace memory {
+
+/**
+ * The Memory Bank Controller 5, which features up to 8MByte of ROM and/or
+ * 128KByte of RAM, and optionally a rumble motor.
+ *
+ * These cartridge types corresponds to MBC5:
+ * * 0x19 (ROM + MBC5)
+ * * 0x1a (ROM + MBC5 + RAM)
+ * * 0x1b (ROM + MBC5 + RAM + BATT)
+ * * 0x1c (ROM + MBC5 + RUMBLE)
+ * * 0x1d (ROM + MBC5 + RUMBLE + SRAM)
+ * * 0x1e (ROM + MBC5 + RUMBLE + SRAM + BATT)
+ */
+class MBC5 final : public ROMLoadableMemory {
+public:
+    /**
+     * Create a MBC5.
+     * @param ram_size RAM size.
+     * @param has_rumble whether the cartridge has a rumble motor, driven by
+     * bit 3 of the RAM bank register instead of the RAM bank.
+     */
+    MBC5(std::vector<MemoryValue> rom, MemorySize ram_size, bool has_rumble);
+
+    MemoryValue read(MemoryAddr addr) const override;
+    void write(MemoryAddr addr, MemoryValue value) override;
+    void read_block(MemoryAddr addr,
+                    MemoryValue *data,
+                    MemorySize size) const override;
+    void write_block(MemoryAddr addr,
+                     const MemoryValue *data,
+                     MemorySize size) override;
+    void peek_block(MemoryAddr addr,
+                    MemoryValue *data,
+                    MemorySize size) const override;
+    const MemoryValue *host_read_ptr(MemoryAddr addr) const override;
+    MemoryValue *host_write_ptr(MemoryAddr addr) override;
+
+    /**
+     * Whether the rumble motor is on. Always false without a motor.
+     */
+    [[nodiscard]] bool rumble() const { return rumble_; }
+
+private:
+    /**
+     * Recompute the bank bases from the bank registers.
+     */
+    void update_banks();
+
+    /**
+     * Offset in |rom_| of the ROM at |addr|.
+     */
+    [[nodiscard]] uint32_t translate_rom_address(MemoryAddr addr) const {
+        return rom_bases_[addr / ROM_BANK_SIZE] + addr % ROM_BANK_SIZE;
+    }
+
+    /**
+     * Implementation of read_block() and peek_block(), which only log invalid
+     * reads if |log| is set.
+     */
+    void copy_block(MemoryAddr addr,
+                    MemoryValue *data,
+                    MemorySize size,
+                    bool log) const;
+
+    static constexpr MemorySize ROM_BANK_SIZE = 0x4000;
+
+    /**
+     * Maximum ROM size. There are a maximum of 512 ROM banks, which resolves to
+     * the maximum size of 8MByte.
+     */
+    static constexpr MemorySize MAX_ROM_SIZE = 512 * ROM_BANK_SIZE;
+
+    static constexpr MemorySize RAM_BANK_SIZE = RAMBank::SIZE;
+
+    /**
+     * Maximum RAM size. There are a maximum of 16 RAM banks, which resolves to
+     * the maximum size of 128KByte.
+     */
+    static constexpr MemorySize MAX_RAM_SIZE = 16 * RAM_BANK_SIZE;
+
+    /**
+     * Whether the RAM is enabled or not.
+     */
+    bool ram_enabled_;
+
+    /**
+     * ROM bank register, 9 bits. Unlike the other MBCs, bank 0 can be mapped
+     * to the switchable region.
+     */
+    uint16_t rom_bank_;
+
+    uint8_t ram_bank_;
+
+    const bool has_rumble_;
+    bool rumble_;
+
+    /**
+     * Offsets in |rom_| of the banks mapped to the ROM_0 and switchable ROM
+     * regions, indexed by addr / ROM_BANK_SIZE, and in |ram_| of the bank
+     * mapped to the external RAM region. Only updated when a register is
+     * written, so that reads cost the same whatever the size of the ROM.
+     */
+    uint32_t rom_bases_[2];
+    RAMBank mapped_ram_;
+
+    /**
+     * Constant ROM data, padded to whole banks.
+     */
+    const std::vector<MemoryValue> rom_;
+
+    /**
+     * RAM region, allocated to its size since it can be up to 128KByte.
+     */
+    std::vector<MemoryValue> ram_;
+    MemorySize ram_size_;
+};
+
+}  // namespace memory
@@ -12,6 +12,45 @@ using MemoryAddr = uint16_t;
 using MemorySize = uint32_t;
 using MemoryValue = uint8_t;
 
+/**
+ * Size of a page, the granularity at which the MMU dispatches accesses and
+ * at which regions publish host pointers.
+ */
+inline constexpr MemorySize PAGE_SIZE = 0x100;
+
+class HostPageTable;
+class Memory;
+
+/**
+ * Interface for components which cache the host pointers published by a
+ * memory region, for example the MMU, or data derived from the memory behind
+ * them.
+ */
+class HostPageObserver {
+public:
+    /**
+     * Called by |region| when the host pointers it publishes for addresses
+     * between start and end (inclusive) changed, for example after a bank
+     * switch.
+     */
+    virtual void host_pages_changed(Memory *region,
+                                    MemoryAddr start,
+                                    MemoryAddr end) = 0;
+
+    /**
+     * Called when the |size| bytes of host memory from |data| on were
+     * written by anything but the CPU, for example when a region loads a
+     * save, or when the MMU writes a block. Single writes through the MMU
+     * are the CPU's, and are not reported. The bytes may be in a bank which
+     * is not mapped.
+     */
+    virtual void host_memory_written(
+        [[maybe_unused]] const MemoryValue *data,
+        [[maybe_unused]] MemorySize size) {}
+
+    virtual ~HostPageObserver() = default;
+};
+
 class Memory {
 private:
     class Proxy {
@@ -37,11 +76,104 @@ public:
 
     virtual ~Memory() = default;
 
+    /**
+     * Read the |size| bytes from |addr| on into |data|, as read() would. The
+     * range must not wrap around the address space.
+     *
+     * Calls read() for each byte, unless the region overrides it to copy the
+     * whole range at once.
+     */
+    virtual void read_block(MemoryAddr addr,
+                            MemoryValue *data,
+                            MemorySize size) const;
+
+    /**
+     * Write the |size| bytes of |data| from |addr| on, as write() would, in
+     * order. The range must not wrap around the address space.
+     */
+    virtual void write_block(MemoryAddr addr,
+                             const MemoryValue *data,
+                             MemorySize size);
+
+    /**
+     * Same as read_block(), but without logging invalid accesses, for
+     * debuggers, save states and memory viewers.
+     */
+    virtual void peek_block(MemoryAddr addr,
+                            MemoryValue *data,
+                            MemorySize size) const {
+        read_block(addr, data, size);
+    }
+
+    /**
+     * Get a host pointer to the byte at |addr| which can be read instead of
+     * calling read(). The bytes following it up to the end of the page
+     * containing |addr| must be contiguous in host memory as well. The pointer
+     * stays valid until the region calls notify_host_pages_changed() for
+     * |addr|.
+     * @return the host pointer, or nullptr if reads at |addr| must go through
+     *         read().
+     */
+    virtual const MemoryValue *host_read_ptr(
+        [[maybe_unused]] MemoryAddr addr) const {
+        return nullptr;
+    }
+
+    /**
+     * Same as host_read_ptr(), but for writes. A region shall only publish a
+     * write pointer when writing to it is all that write() would do.
+     * @return the host pointer, or nullptr if writes at |addr| must go through
+     *         write().
+     */
+    virtual MemoryValue *host_write_ptr([[maybe_unused]] MemoryAddr addr) {
+        return nullptr;
+    }
+
+    /**
+     * Whether reading |addr| may give a different value from one cycle to the
+     * next without any write, for example a register derived from the
+     * current cycle such as DIV. Only plain memory, which publishes a host
+     * pointer, is assumed not to, unless the region overrides this.
+     */
+    virtual bool varies_between_events(MemoryAddr addr) const {
+        return host_read_ptr(addr) == nullptr;
+    }
+
+    /**
+     * Get the table of host pointers collected from the regions behind this
+     * memory, if it maintains one.
+     * @return the table, or nullptr.
+     */
+    virtual const HostPageTable *host_page_table() const { return nullptr; }
+
+    /**
+     * Set the observer notified when the published host pointers change.
+     */
+    void set_host_page_observer(HostPageObserver *observer) {
+        host_page_observer_ = observer;
+    }
+
     // Helper function to read and write 16-bit values using read() and write()
     uint16_t read16(MemoryAddr addr) const;
     void write16(MemoryAddr addr, uint16_t value);
 
     Proxy operator[](MemoryAddr addr);
+
+protected:
+    /**
+     * Notify the observer, if any, that the host pointers published for
+     * addresses between start and end (inclusive) changed.
+     */
+    void notify_host_pages_changed(MemoryAddr start, MemoryAddr end);
+
+    /**
+     * Notify the observer, if any, that the |size| bytes of host memory from
+     * |data| on changed other than through the write pointers published.
+     */
+    void notify_host_memory_written(const MemoryValue *data, MemorySize size);
+
+private:
+    HostPageObserver *host_page_observer_ = nullptr;
 };
 
 class ROMLoadableMemory : public Memory {
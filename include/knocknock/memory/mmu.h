@@ -1,41 +1,130 @@
 #pragma once
 
-#include <vector>
+#include <array>
+#include <memory>
 
+#include "knocknock/memory/host_page_table.h"
 #include "knocknock/memory/memory.h"
 
 namespace memory {
 
-class MMU : public Memory {
+/**
+ * The memory management unit, which dispatches reads and writes to the
+ * regions registered to it.
+ *
+ * Regions are resolved once at registration time into a page table with one
+ * entry per high address byte, so every access costs a single indexed lookup
+ * instead of a scan over all registered regions. Pages which are shared
+ * between several regions or only partially mapped (for example the
+ * memory-mapped IO page at 0xff00) get a fine-grained sub-table with one entry
+ * per byte.
+ *
+ * The MMU also collects the host pointers published by its regions into a
+ * HostPageTable, so reads and writes to plain memory skip the region's
+ * virtual read() and write() altogether.
+ */
+class MMU : public Memory, public HostPageObserver {
 public:
     MMU();
 
+    /**
+     * Register a region to handle all accesses between start and end.
+     * @param region the region.
+     * @param start first address handled by the region.
+     * @param end last address (inclusive) handled by the region.
+     * @return true if the region was registered, false if it overlaps with
+     *         already registered regions.
+     */
     bool register_region(Memory *region, MemoryAddr start, MemoryAddr end);
 
     // Memory::
     MemoryValue read(MemoryAddr addr) const override;
     void write(MemoryAddr addr, MemoryValue value) override;
+    void read_block(MemoryAddr addr,
+                    MemoryValue *data,
+                    MemorySize size) const override;
+    void write_block(MemoryAddr addr,
+                     const MemoryValue *data,
+                     MemorySize size) override;
+    void peek_block(MemoryAddr addr,
+                    MemoryValue *data,
+                    MemorySize size) const override;
+    bool varies_between_events(MemoryAddr addr) const override;
+    const HostPageTable *host_page_table() const override {
+        return &host_pages_;
+    }
+
+    // HostPageObserver::
+    void host_pages_changed(Memory *region,
+                            MemoryAddr start,
+                            MemoryAddr end) override;
+    void host_memory_written(const MemoryValue *data,
+                             MemorySize size) override;
 
 private:
-    bool has_overlapping_regions(MemoryAddr start, MemoryAddr end) const;
+    static constexpr MemorySize PAGE_COUNT = 0x100;
+    static constexpr MemoryAddr HIGH_PAGE = 0xff;
 
-    class MemoryRegion {
+    using SubTable = std::array<Memory *, PAGE_SIZE>;
+
+    class Page {
     public:
-        MemoryRegion(Memory *region, MemoryAddr start, MemoryAddr end)
-            : region_(region), start_(start), end_(end) {}
-
-        Memory *region() const { return region_; }
-        MemoryAddr start() const { return start_; }
-        MemoryAddr end() const { return end_; }
-        MemoryAddr size() const { return (end_ - start_ + 1); }
-
-    private:
-        Memory *region_;
-        MemoryAddr start_;
-        MemoryAddr end_;
+        /**
+         * Region handling the entire page, or nullptr if the page is unmapped
+         * or is resolved per byte through |sub_table|.
+         */
+        Memory *region = nullptr;
+
+        /**
+         * Per-byte regions, only allocated for pages which are not entirely
+         * handled by one region.
+         */
+        std::unique_ptr<SubTable> sub_table;
     };
 
-    std::vector<MemoryRegion> regions_;
+    static MemoryAddr page_of(MemoryAddr addr) { return addr >> 8; }
+    static MemoryAddr offset_in_page(MemoryAddr addr) { return addr & 0xff; }
+
+    bool has_overlapping_regions(MemoryAddr start, MemoryAddr end) const;
+
+    /**
+     * Query |region| again for the host pointers of the pages it handles
+     * between start and end.
+     */
+    void refresh_host_pages(Memory *region, MemoryAddr start, MemoryAddr end);
+
+    /**
+     * Notify the observer of the MMU about the host memory behind the |size|
+     * bytes written from |addr| on, page by page.
+     */
+    void notify_written(MemoryAddr addr, MemorySize size);
+
+    /**
+     * Split the |size| bytes from |addr| on into runs of consecutive
+     * addresses handled by the same region, and call
+     * |access(region, start, offset, length)| for each of them, in order.
+     * |region| is nullptr for unmapped addresses, and |offset| is the offset
+     * of |start| in the block.
+     */
+    template <typename Access>
+    void for_each_run(MemoryAddr addr, MemorySize size, Access access) const;
+
+    /**
+     * Find the region handling |addr|.
+     * @return the region, or nullptr if no region is registered at |addr|.
+     */
+    Memory *region_at(MemoryAddr addr) const {
+        const Page &page = pages_[page_of(addr)];
+        if (page.sub_table) {
+            return (*page.sub_table)[offset_in_page(addr)];
+        }
+
+        return page.region;
+    }
+
+    std::array<Page, PAGE_COUNT> pages_;
+
+    HostPageTable host_pages_;
 };
 
 }  // namespace memory
@@ -16,11 +16,30 @@ public:
     // Tickable::
     void tick() override;
 
+    /**
+     * Advance the outputs by |ticks| input ticks. Instead of interleaving the
+     * outputs tick by tick, each of them runs the whole period in a single
+     * call, in the order they were added. Callers should thus keep |ticks|
+     * short of the next event an output has to see in time, such as an
+     * interrupt.
+     */
+    uint32_t run(uint32_t ticks) override;
+
 private:
+    struct Output {
+        Tickable *tickable;
+
+        /**
+         * Number of output ticks the output has already run past the last
+         * period, to be deducted from the next one.
+         */
+        uint32_t ahead;
+    };
+
     const uint64_t in_frequency_;
     const uint64_t out_frequency_;
 
-    std::vector<Tickable *> outputs_;
+    std::vector<Output> outputs_;
 };
 
 }  // namespace peripherals
@@ -0,0 +1,147 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "knocknock/peripherals/tickable.h"
+
+namespace peripherals {
+
+/**
+ * Drives the machine by events instead of ticking every component on every
+ * cycle.
+ *
+ * Components schedule the cycle at which they next have something to do, and
+ * are ticked once at the end of that cycle, after the CPU; an idle component
+ * has no event and costs nothing. Between two events, the CPU runs
+ * uninterrupted through Tickable::run().
+ *
+ * Time is counted in M-cycles from the creation of the scheduler. While the
+ * CPU runs, it reports the cycles it went through with advance(), so that
+ * now() is the cycle the CPU is in when it accesses memory, as if every
+ * component was ticked on every cycle. An event scheduled by the CPU before
+ * the end of its slice, for example through a write to a register, ends the
+ * slice early so that the event runs on time. A CPU which does not report its
+ * progress leaves now() at the start of its slice, which is at most
+ * MAX_SLICE cycles long.
+ *
+ * While the CPU is idle, for example halted, time skips straight to the next
+ * event without running it.
+ */
+class Scheduler : public Tickable {
+public:
+    using Timestamp = uint64_t;
+
+    /**
+     * Longest run of the CPU without handing control back: one scanline.
+     */
+    static constexpr uint32_t MAX_SLICE = 114;
+
+    /**
+     * @param cpu component running between events, usually the CPU.
+     */
+    explicit Scheduler(Tickable *cpu);
+
+    /**
+     * The current cycle: the cycle of the event being run, if any, or else
+     * the number of cycles elapsed.
+     */
+    [[nodiscard]] Timestamp now() const { return now_; }
+
+    /**
+     * Tick |component| at the end of the cycle |delay| cycles after now(). A
+     * component has at most one pending event: scheduling it again moves the
+     * event.
+     * @param delay number of cycles from now; 0 ticks |component| at the end
+     * of the current cycle. A component being ticked by the scheduler must
+     * not schedule itself with no delay.
+     */
+    void schedule(Tickable *component, Timestamp delay);
+
+    /**
+     * Drop the pending event of |component|, if any.
+     */
+    void cancel(Tickable *component);
+
+    /**
+     * Whether |component| has a pending event.
+     */
+    [[nodiscard]] bool scheduled(const Tickable *component) const;
+
+    // Tickable::
+    void tick() override;
+
+    /**
+     * Run the CPU and the events due in the next |ticks| cycles. The CPU may
+     * run a few cycles past the budget to finish an instruction, and the
+     * events due in them are run too.
+     */
+    uint32_t run(uint32_t ticks) override;
+
+    /**
+     * Called by the CPU while it runs its slice: it went through |cycles|
+     * more cycles, and now() moves by as much. Does nothing outside of a
+     * slice.
+     * @return the number of cycles left in the slice, which events scheduled
+     * during the slice may have shortened; 0 when the CPU should return.
+     */
+    uint32_t advance(uint32_t cycles) {
+        if (!in_slice_) {
+            return UNBOUNDED;
+        }
+
+        now_ += cycles;
+        return slice_end_ > now_ ? slice_end_ - now_ : 0;
+    }
+
+    /**
+     * Returned by advance() outside of a slice.
+     */
+    static constexpr uint32_t UNBOUNDED = ~uint32_t(0);
+
+private:
+    struct Event {
+        Timestamp time;
+
+        /**
+         * Order in which the event was scheduled, so that events due at the
+         * same cycle run in that order.
+         */
+        uint64_t sequence;
+
+        Tickable *component;
+    };
+
+    // Comparator for a min-heap in |events_|.
+    static bool later(const Event &lhs, const Event &rhs) {
+        if (lhs.time != rhs.time) {
+            return lhs.time > rhs.time;
+        }
+        return lhs.sequence > rhs.sequence;
+    }
+
+    /**
+     * Tick the components whose event is in a cycle the CPU has run.
+     */
+    void run_due_events();
+
+    Tickable *cpu_;
+
+    Timestamp now_;
+    Timestamp elapsed_;
+    uint64_t next_sequence_;
+
+    /**
+     * Whether the CPU is running a slice, and the cycle at which the slice
+     * ends.
+     */
+    bool in_slice_;
+    Timestamp slice_end_;
+
+    /**
+     * Pending events, as a min-heap ordered by later().
+     */
+    std::vector<Event> events_;
+};
+
+}  // namespace peripherals
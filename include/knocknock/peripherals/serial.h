@@ -5,6 +5,7 @@
 
 #include "knocknock/memory/memory.h"
 #include "knocknock/memory/mmu.h"
+#include "knocknock/peripherals/scheduler.h"
 #include "knocknock/peripherals/tickable.h"
 
 namespace peripherals {
@@ -17,8 +18,10 @@ class Serial : public memory::Memory, public peripherals::Tickable {
 public:
     /**
      * Initialize a new Serial.
+     * @param scheduler if not nullptr, the Serial schedules its ticks for the
+     * duration of a session instead of being ticked on every cycle.
      */
-    Serial();
+    explicit Serial(Scheduler *scheduler = nullptr);
 
     // Memory::
     memory::MemoryValue read(memory::MemoryAddr addr) const override;
@@ -49,6 +52,8 @@ private:
 
     void end_session();
 
+    Scheduler *scheduler_;
+
     /**
      * Whether the Serial is in a send/receive session.
      */
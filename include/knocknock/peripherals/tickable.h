@@ -1,11 +1,32 @@
 #pragma once
 
+#include <cstdint>
+
 namespace peripherals {
 
 class Tickable {
 public:
     virtual void tick() = 0;
 
+    /**
+     * Advance by |ticks| ticks at once. Implementations may run a few ticks
+     * past the budget to finish a unit of work, such as an instruction.
+     * @return the number of ticks elapsed, at least |ticks|.
+     */
+    virtual uint32_t run(uint32_t ticks) {
+        for (uint32_t i = 0; i < ticks; ++i) {
+            tick();
+        }
+        return ticks;
+    }
+
+    /**
+     * Whether the component has nothing to do until something else wakes it
+     * up, such as an interrupt for a halted CPU. Time can then be skipped
+     * without running the component at all.
+     */
+    [[nodiscard]] virtual bool idle() const { return false; }
+
     virtual ~Tickable() = default;
 };
 
@@ -0,0 +1,109 @@
+#pragma once
+
+#include <cstdint>
+
+#include "knocknock/interrupt.h"
+#include "knocknock/memory/memory.h"
+#include "knocknock/memory/mmu.h"
+#include "knocknock/peripherals/scheduler.h"
+#include "knocknock/peripherals/tickable.h"
+
+namespace peripherals {
+
+/**
+ * The timer: DIV, TIMA, TMA and TAC.
+ *
+ * Nothing is counted cycle by cycle. DIV and TIMA are derived from the current
+ * cycle when they are accessed, and the Timer is only ticked on the cycle TIMA
+ * is reloaded from TMA after an overflow, to raise the TIMER interrupt.
+ *
+ * TIMA is incremented on the falling edge of a bit of the internal divider,
+ * selected by TAC, so resetting the divider through DIV or changing TAC may
+ * increment it too, like on the DMG.
+ */
+class Timer : public memory::Memory, public peripherals::Tickable {
+public:
+    /**
+     * @param interrupts where the TIMER interrupt is requested.
+     * @param scheduler if not nullptr, the current cycle is taken from the
+     * scheduler, and the Timer schedules its ticks for the overflows of TIMA.
+     * Otherwise, the Timer must be ticked on every cycle, after the CPU.
+     */
+    explicit Timer(interrupt::Interruptible *interrupts,
+                   Scheduler *scheduler = nullptr);
+
+    // Memory::
+    memory::MemoryValue read(memory::MemoryAddr addr) const override;
+    void write(memory::MemoryAddr addr, memory::MemoryValue value) override;
+
+    // Tickable::
+    void tick() override;
+
+    void register_to_mmu(memory::MMU *mmu);
+
+private:
+    using Timestamp = Scheduler::Timestamp;
+
+    /**
+     * Never, for |reload_at_|.
+     */
+    static constexpr Timestamp NEVER = ~Timestamp(0);
+
+    [[nodiscard]] Timestamp now() const;
+
+    /**
+     * Value of the internal divider during cycle |time|, in M-cycles.
+     */
+    [[nodiscard]] Timestamp divider_at(Timestamp time) const;
+
+    /**
+     * Value of TIMA during cycle |time|, counting from |tima_| without
+     * wrapping: 0x100 during the cycle following an overflow.
+     */
+    [[nodiscard]] uint16_t tima_at(Timestamp time) const;
+
+    /**
+     * Whether the falling edge detector of TIMA sees a high input during
+     * cycle |time|.
+     */
+    [[nodiscard]] bool edge_input_at(Timestamp time) const;
+
+    /**
+     * Bring |tima_| up to date with the current cycle.
+     */
+    void sync();
+
+    /**
+     * Compute when TIMA next overflows, and schedule the reload.
+     */
+    void schedule_reload();
+
+    interrupt::Interruptible *interrupts_;
+    Scheduler *scheduler_;
+
+    /**
+     * Number of ticks, the current cycle without a scheduler.
+     */
+    Timestamp ticks_;
+
+    /**
+     * Cycle at which the internal divider was last reset.
+     */
+    Timestamp divider_origin_;
+
+    /**
+     * Value of TIMA during cycle |tima_time_|.
+     */
+    uint16_t tima_;
+    Timestamp tima_time_;
+
+    uint8_t tma_;
+    uint8_t tac_;
+
+    /**
+     * Cycle at the end of which TIMA is reloaded from TMA, or NEVER.
+     */
+    Timestamp reload_at_;
+};
+
+}  // namespace peripherals
@@ -2,16 +2,35 @@
 
 #include "knocknock/memory/memory.h"
 #include "knocknock/memory/mmu.h"
+#include "knocknock/peripherals/scheduler.h"
 #include "knocknock/peripherals/tickable.h"
 
 namespace ppu {
 
+class PPU;
+
 class DMA : public memory::Memory, public peripherals::Tickable {
 public:
-    DMA(memory::Memory *memory);
+    /**
+     * @param scheduler if not nullptr, the DMA schedules its ticks for the
+     * duration of a transfer instead of being ticked on every cycle.
+     */
+    explicit DMA(memory::Memory *memory,
+                 peripherals::Scheduler *scheduler = nullptr);
 
     void register_to_mmu(memory::MMU *mmu);
 
+    /**
+     * Copy each transfer as a whole on its first cycle, instead of one byte
+     * per cycle, straight to the OAM of |ppu|. This is only exact when nothing
+     * observes OAM or the bus until the transfer ends. The DMA checks with
+     * |ppu| that OAM is not read before then, and the caller guarantees that
+     * the CPU runs from HRAM, as the DMA routine of most games does. The
+     * transfer still lasts as long, and other transfers, or transfers from
+     * memory without host pointers, are copied one byte per cycle.
+     */
+    void set_bulk_transfers(bool enabled, PPU *ppu);
+
     // memory::Memory::
     memory::MemoryValue read(memory::MemoryAddr addr) const override;
     void write(memory::MemoryAddr addr, memory::MemoryValue value) override;
@@ -20,7 +39,15 @@ public:
     void tick() override;
 
 private:
+    /**
+     * Copy the whole transfer at once, if its source is backed by host
+     * memory and OAM is not read before it ends.
+     * @return whether the transfer was copied.
+     */
+    bool copy_transfer();
+
     memory::Memory *memory_;
+    peripherals::Scheduler *scheduler_;
 
     /**
      * Whether the DMA is transferring data or not.
@@ -37,6 +64,14 @@ private:
      * address.
      */
     uint8_t current_byte_;
+
+    bool bulk_transfers_;
+    PPU *ppu_;
+
+    /**
+     * Whether the current transfer was copied as a whole on its first cycle.
+     */
+    bool bulk_copied_;
 };
 
 }  // namespace ppu
@@ -0,0 +1,275 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+
+#include "knocknock/interrupt.h"
+#include "knocknock/memory/memory.h"
+#include "knocknock/memory/mmu.h"
+#include "knocknock/memory/regions.h"
+#include "knocknock/peripherals/scheduler.h"
+#include "knocknock/peripherals/tickable.h"
+#include "knocknock/ppu/tile_cache.h"
+
+namespace ppu {
+
+inline constexpr size_t SCREEN_WIDTH = 160;
+inline constexpr size_t SCREEN_HEIGHT = 144;
+
+/**
+ * The picture processing unit: VRAM, OAM, the LCD registers, and a renderer
+ * drawing the background, the window and the sprites of a whole scanline at
+ * once.
+ *
+ * LY and the mode in STAT are derived from the current cycle when read. The
+ * PPU is only ticked when they change, that is on the first cycle of a line,
+ * of its pixel transfer and of its HBlank, to request the VBLANK and
+ * LCD_STATUS interrupts, and draw the line as its HBlank starts.
+ */
+class PPU : public memory::Memory, public peripherals::Tickable {
+public:
+    /**
+     * Shades of gray (0-3, from white to black) of the pixels on the screen,
+     * row by row.
+     */
+    using Framebuffer = std::array<uint8_t, SCREEN_WIDTH * SCREEN_HEIGHT>;
+
+    /**
+     * @param interrupts where the VBLANK and LCD_STATUS interrupts are
+     * requested.
+     * @param scheduler if not nullptr, the current cycle is taken from the
+     * scheduler, and the PPU schedules its ticks for the changes of LY and of
+     * mode. Otherwise, the PPU must be ticked on every cycle, after the CPU.
+     */
+    explicit PPU(interrupt::Interruptible *interrupts,
+                 peripherals::Scheduler *scheduler = nullptr);
+
+    /**
+     * Map VRAM, OAM and the LCD registers, except DMA which is ppu::DMA.
+     */
+    void register_to_mmu(memory::MMU *mmu);
+
+    // memory::Memory::
+    memory::MemoryValue read(memory::MemoryAddr addr) const override;
+    void write(memory::MemoryAddr addr, memory::MemoryValue value) override;
+    const memory::MemoryValue *host_read_ptr(
+        memory::MemoryAddr addr) const override;
+    bool varies_between_events(memory::MemoryAddr addr) const override;
+
+    // peripherals::Tickable::
+    void tick() override;
+
+    /**
+     * Draw scanline |line| to the framebuffer, from the current contents of
+     * VRAM, OAM and the LCD registers. Lines are expected in order within a
+     * frame, since the window keeps its own line counter.
+     */
+    void render_line(uint8_t line);
+
+    [[nodiscard]] const Framebuffer &framebuffer() const {
+        return framebuffer_;
+    }
+
+    /**
+     * Draw only one frame out of |interval|, starting with the next one; 1
+     * draws them all. Skipped frames leave the framebuffer as it is, but
+     * their timing, interrupts, LY and STAT are unchanged.
+     */
+    void set_frame_skip(uint32_t interval);
+
+    /**
+     * Only draw the frames requested through request_frame(), instead of
+     * following set_frame_skip().
+     */
+    void set_render_on_demand(bool enabled) { render_on_demand_ = enabled; }
+
+    /**
+     * Draw the next frame which starts, in render-on-demand mode.
+     */
+    void request_frame() { frame_requested_ = true; }
+
+    /**
+     * Number of frames which reached VBlank, drawn or not.
+     */
+    [[nodiscard]] uint64_t frames() const { return frames_; }
+
+    /**
+     * Number of frames which reached VBlank and were drawn.
+     */
+    [[nodiscard]] uint64_t rendered_frames() const { return rendered_frames_; }
+
+    /**
+     * The decoded tiles of VRAM, brought up to date, for example for a tile
+     * viewer.
+     */
+    [[nodiscard]] const TileCache &tile_cache() {
+        tile_cache_.update();
+        return tile_cache_;
+    }
+
+    /**
+     * OAM, for ppu::DMA to copy whole transfers to. Writes to it do not need
+     * to go through write().
+     */
+    [[nodiscard]] memory::MemoryValue *oam() { return oam_.data(); }
+
+    /**
+     * Whether the PPU does not read OAM during the |cycles| M-cycles from the
+     * current one on: the LCD is off, or stays in VBlank all along, unless
+     * LCDC is written in the meantime. ppu::DMA then copies a transfer as a
+     * whole.
+     */
+    [[nodiscard]] bool oam_unread_for(uint32_t cycles) const;
+
+private:
+    using Timestamp = peripherals::Scheduler::Timestamp;
+
+    /**
+     * Never, for |next_event_|.
+     */
+    static constexpr Timestamp NEVER = ~Timestamp(0);
+
+    /**
+     * Modes of the PPU, as reported in STAT.
+     */
+    enum class Mode : uint8_t {
+        HBLANK = 0,
+        VBLANK = 1,
+        OAM_SCAN = 2,
+        PIXEL_TRANSFER = 3,
+    };
+
+    [[nodiscard]] Timestamp now() const;
+
+    [[nodiscard]] bool lcd_enabled() const;
+
+    /**
+     * M-cycles since the start of the frame during cycle |time|. Only
+     * meaningful while the LCD is enabled.
+     */
+    [[nodiscard]] uint32_t frame_cycle_at(Timestamp time) const;
+
+    [[nodiscard]] uint8_t ly_at(Timestamp time) const;
+    [[nodiscard]] Mode mode_at(Timestamp time) const;
+
+    /**
+     * Whether any of the sources of the LCD_STATUS interrupt enabled in STAT
+     * is active during cycle |time|. The interrupt is requested when this
+     * goes from false to true.
+     */
+    [[nodiscard]] bool stat_line_at(Timestamp time) const;
+
+    /**
+     * Schedule the tick for the first change of LY or mode from cycle |time|
+     * on.
+     */
+    void schedule_next_event(Timestamp time);
+
+    /**
+     * A sprite of OAM, as it is laid out there.
+     */
+    struct Sprite {
+        uint8_t y;
+        uint8_t x;
+        uint8_t tile;
+        uint8_t attributes;
+    };
+
+    /**
+     * Color indices of the background and the window on the line being drawn,
+     * before the palette: sprites behind the background need them.
+     */
+    using LineIndices = std::array<uint8_t, SCREEN_WIDTH>;
+
+    /**
+     * Copy the row |tile_row| of |count| decoded tiles into |pixels|,
+     * starting at column |first_column| of row |map_row| of the tile map at
+     * offset |map| in VRAM, and wrapping around the map.
+     */
+    void fetch_tiles(size_t map,
+                     uint8_t map_row,
+                     uint8_t first_column,
+                     uint8_t tile_row,
+                     size_t count,
+                     uint8_t *pixels) const;
+
+    void render_background(uint8_t line, LineIndices *indices) const;
+    void render_window(uint8_t line, LineIndices *indices);
+    void render_sprites(uint8_t line, const LineIndices &indices,
+                        uint8_t *shades) const;
+
+    /**
+     * Index in the tile data of the tile |index| of the background and window,
+     * as selected by LCDC.
+     */
+    [[nodiscard]] size_t background_tile(uint8_t index) const;
+
+    std::array<memory::MemoryValue, memory::VRAM_SIZE> vram_;
+
+    /**
+     * The tile data of |vram_|, decoded. Invalidated by write(), and updated
+     * before drawing a line.
+     */
+    TileCache tile_cache_;
+
+    std::array<memory::MemoryValue, memory::OAM_SIZE> oam_;
+
+    interrupt::Interruptible *interrupts_;
+    peripherals::Scheduler *scheduler_;
+
+    /**
+     * Number of ticks, the current cycle without a scheduler.
+     */
+    Timestamp ticks_;
+
+    /**
+     * Cycle at which the LCD was enabled, the start of its first frame.
+     */
+    Timestamp frame_origin_;
+
+    /**
+     * Cycle of the next tick which has something to do, or NEVER.
+     */
+    Timestamp next_event_;
+
+    // LCD registers, $ff40 - $ff4b. LY and the read-only bits of STAT are
+    // computed when read.
+    uint8_t lcdc_;
+    uint8_t stat_;
+    uint8_t scy_;
+    uint8_t scx_;
+    uint8_t lyc_;
+    uint8_t bgp_;
+    uint8_t obp0_;
+    uint8_t obp1_;
+    uint8_t wy_;
+    uint8_t wx_;
+
+    /**
+     * Line of the window drawn next. The window only advances on the lines it
+     * is drawn on.
+     */
+    uint8_t window_line_;
+
+    Framebuffer framebuffer_;
+
+    // Frame skip settings.
+    uint32_t frame_skip_interval_;
+    bool render_on_demand_;
+    bool frame_requested_;
+
+    /**
+     * Frames started since the frame skip interval was set.
+     */
+    uint32_t skip_counter_;
+
+    /**
+     * Whether the current frame is drawn.
+     */
+    bool rendering_frame_;
+
+    uint64_t frames_;
+    uint64_t rendered_frames_;
+};
+
+}  // namespace ppu
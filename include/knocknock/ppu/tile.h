@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace ppu {
+
+/**
+ * Number of pixels in a row of a tile.
+ */
+inline constexpr size_t TILE_WIDTH = 8;
+
+/**
+ * Size of a tile in VRAM: 8 rows of 2 bytes.
+ */
+inline constexpr size_t TILE_SIZE = 16;
+
+/**
+ * Convert rows of tiles from the 2 bits per pixel planar format of VRAM to one
+ * color index (0-3) per pixel, leftmost pixel first.
+ *
+ * Uses AVX2 or SSE2 when the compiler targets them, eight pixels per lane
+ * group, and falls back to decode_tile_rows_scalar() otherwise.
+ *
+ * @param rows |count| rows of 2 bytes each, the low bit plane first, as they
+ * are laid out in VRAM.
+ * @param pixels receives TILE_WIDTH color indices per row.
+ */
+void decode_tile_rows(const uint8_t *rows, size_t count, uint8_t *pixels);
+
+/**
+ * Portable implementation of decode_tile_rows(), one pixel at a time.
+ */
+void decode_tile_rows_scalar(const uint8_t *rows, size_t count,
+                             uint8_t *pixels);
+
+}  // namespace ppu
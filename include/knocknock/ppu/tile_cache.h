@@ -0,0 +1,76 @@
+#pragma once
+
+#include <array>
+#include <bitset>
+#include <cstdint>
+
+#include "knocknock/memory/memory.h"
+#include "knocknock/ppu/tile.h"
+
+namespace ppu {
+
+/**
+ * Number of tiles in the tile data of VRAM, $8000 - $97ff.
+ */
+inline constexpr size_t TILE_COUNT = 384;
+
+/**
+ * The tiles of VRAM, decoded to one color index per pixel.
+ *
+ * Writes to the tile data mark their tile dirty through invalidate(), and
+ * update() only decodes the dirty tiles again, so tiles which do not change
+ * are decoded once.
+ */
+class TileCache {
+public:
+    /**
+     * Number of pixels of a decoded tile.
+     */
+    static constexpr size_t TILE_PIXELS = TILE_WIDTH * TILE_WIDTH;
+
+    /**
+     * @param tile_data the tile data, TILE_COUNT tiles of TILE_SIZE bytes,
+     * which must outlive the cache. All tiles start dirty.
+     */
+    explicit TileCache(const memory::MemoryValue *tile_data);
+
+    /**
+     * Mark the tile containing the byte at |offset| in the tile data dirty.
+     * Offsets past the tile data are ignored, so that any write to VRAM can be
+     * passed on.
+     */
+    void invalidate(size_t offset) {
+        if (offset < TILE_COUNT * TILE_SIZE) {
+            dirty_.set(offset / TILE_SIZE);
+        }
+    }
+
+    /**
+     * Decode the dirty tiles.
+     */
+    void update();
+
+    /**
+     * The color indices of tile |index|, row by row. Up to date as of the
+     * last update(). Tiles are stored one after the other, so the second
+     * tile of a 8x16 sprite follows the first.
+     */
+    [[nodiscard]] const uint8_t *tile(size_t index) const {
+        return &pixels_[index * TILE_PIXELS];
+    }
+
+    /**
+     * Number of tiles decoded since the creation of the cache.
+     */
+    [[nodiscard]] uint64_t decoded_tiles() const { return decoded_tiles_; }
+
+private:
+    const memory::MemoryValue *tile_data_;
+
+    std::bitset<TILE_COUNT> dirty_;
+    std::array<uint8_t, TILE_COUNT * TILE_PIXELS> pixels_;
+
+    uint64_t decoded_tiles_;
+};
+
+}  // namespace ppu
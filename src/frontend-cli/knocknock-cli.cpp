@@ -3,6 +3,7 @@
 #include <optional>
 
 #include <knocknock/cartridge.h>
+#include <knocknock/memory/controller.h>
 
 int main(int argc, char *argv[]) {
     google::InitGoogleLogging(argv[0]);
@@ -11,6 +12,13 @@ int main(int argc, char *argv[]) {
     std::optional<Cartridge> cartridge = Cartridge::from_file(argv[1]);
     if (!cartridge) {
         LOG(ERROR) << "Unable to load cartridge";
+        return 1;
+    }
+
+    auto controller = memory::make_controller(*cartridge);
+    if (!controller) {
+        LOG(ERROR) << "Unable to create the memory controller";
+        return 1;
     }
 
     return 0;
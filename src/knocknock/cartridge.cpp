@@ -53,6 +53,8 @@ bool get_rom_size(const CartridgeContent &content, size_t *result) {
         case 0x04: *result = 512 * KBYTE; break;
         case 0x05: *result = 1024 * KBYTE; break;
         case 0x06: *result = 2048 * KBYTE; break;
+        case 0x07: *result = 4096 * KBYTE; break;
+        case 0x08: *result = 8192 * KBYTE; break;
         case 0x52: *result = 1152 * KBYTE; break;  // 1.1MByte
         case 0x53: *result = 1280 * KBYTE; break;  // 1.2MByte
         case 0x54: *result = 1536 * KBYTE; break;  // 1.5MByte
@@ -74,6 +76,7 @@ bool get_ram_size(const CartridgeContent &content, size_t *result) {
         case 0x02: *result = 8 * KBYTE; break;
         case 0x03: *result = 32 * KBYTE; break;
         case 0x04: *result = 128 * KBYTE; break;
+        case 0x05: *result = 64 * KBYTE; break;
 
         default:
             LOG(ERROR) << fmt::format("Unknown RAM size {0:#x}", raw_type);
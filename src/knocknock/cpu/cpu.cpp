@@ -1,102 +1,139 @@
 #include "knocknock/cpu/cpu.h"
 
+#include <algorithm>
+
 #include <fmt/format.h>
 #include <glog/logging.h>
 
-#include <iostream>
+#include "knocknock/cpu/alu.h"
 
 namespace cpu {
 
 namespace {
 
-uint8_t low_nibble(uint8_t value) {
-    return value & 0x0Fu;
-}
-
-uint8_t high_nibble(uint8_t value) {
-    return value >> 4u;
-}
-
 constexpr memory::MemoryAddr IRQ_VBLANK = 0x0040;
 constexpr memory::MemoryAddr IRQ_LCD_STATUS = 0x0048;
 constexpr memory::MemoryAddr IRQ_TIMER = 0x0050;
 constexpr memory::MemoryAddr IRQ_SERIAL = 0x0058;
 constexpr memory::MemoryAddr IRQ_JOYPAD = 0x0060;
 
+memory::MemoryAddr vector_of(interrupt::InterruptType reason) {
+    switch (reason) {
+        case interrupt::InterruptType::VBLANK: return IRQ_VBLANK;
+        case interrupt::InterruptType::LCD_STATUS: return IRQ_LCD_STATUS;
+        case interrupt::InterruptType::TIMER: return IRQ_TIMER;
+        case interrupt::InterruptType::JOYPAD: return IRQ_JOYPAD;
+        case interrupt::InterruptType::SERIAL: return IRQ_SERIAL;
+    }
+
+    return IRQ_VBLANK;
+}
+
 }  // namespace
 
 using Opcode = Instruction::Opcode;
 using Operand = Instruction::Operand;
 
-CPU::CPU(memory::Memory *memory)
-    : a_(),
-      b_(),
-      c_(),
-      d_(),
-      e_(),
-      h_(),
-      l_(),
-      f_(),
-      af_(&a_, &f_),
-      bc_(&b_, &c_),
-      de_(&d_, &e_),
-      hl_(&h_, &l_),
-      sp_(),
-      imm8_(),
-      imm8sign_(),
-      imm16_(),
+CPU::CPU(memory::Memory *memory, Interpreter interpreter)
+    : regs_(),
+      imm8_(0),
+      imm8sign_(0),
+      imm16_(0),
       mem_(memory),
-      decoder_(mem_, &pc_),
+      scheduler_(nullptr),
+      interrupt_controller_(nullptr),
+      decoded_cache_(mem_.host_page_table()),
+      decoder_(&mem_,
+               &regs_.pc,
+               interpreter == Interpreter::CACHED_DECODER ? &decoded_cache_
+                                                          : nullptr),
       interrupt_enabled_(false),
       allow_interrupt_service_(true),
       schedule_interrupt_enable_(false),
       halted_(false),
-      ptr_bc_(mem_, bc_),
-      ptr_de_(mem_, de_),
-      ptr_hl_(mem_, hl_),
-      ptr_imm16_(mem_, imm16_),
-      ptr_c_(mem_, c_),
-      ptr_imm8_(mem_, imm8_) {
-    DCHECK(mem_);
-
+      interpreter_(interpreter),
+      stall_cycles_(0),
+      sequence_(&BASE_MICRO_OPS[0x00]),
+      next_micro_op_(0),
+      skip_idle_loops_(false),
+      idle_cycles_skipped_(0),
+      writes_(0) {
     // initialize all registers
-    af_.write(0x01b0);
-    bc_.write(0x0013);
-    de_.write(0x00d8);
-    hl_.write(0x014d);
-    sp_.write(0xfffe);
-    pc_ = 0x0100;
+    regs_.set_af(0x01b0);
+    regs_.set_bc(0x0013);
+    regs_.set_de(0x00d8);
+    regs_.set_hl(0x014d);
+    regs_.sp = 0xfffe;
+    regs_.pc = 0x0100;
+
+    // Writes which do not come from the CPU must drop the cached instructions
+    // too.
+    if (interpreter_ == Interpreter::CACHED_DECODER) {
+        memory->set_host_page_observer(&decoded_cache_);
+    }
 }
 
-std::optional<Operand8 *> CPU::get_operand8(Operand operand) {
+uint8_t CPU::read8(Operand operand) const {
+    switch (operand) {
+        case Operand::A: return read_operand<Operand::A>();
+        case Operand::B: return read_operand<Operand::B>();
+        case Operand::C: return read_operand<Operand::C>();
+        case Operand::PtrC: return read_operand<Operand::PtrC>();
+        case Operand::D: return read_operand<Operand::D>();
+        case Operand::E: return read_operand<Operand::E>();
+        case Operand::H: return read_operand<Operand::H>();
+        case Operand::L: return read_operand<Operand::L>();
+        case Operand::Imm8: return read_operand<Operand::Imm8>();
+        case Operand::PtrImm8: return read_operand<Operand::PtrImm8>();
+        case Operand::PtrBC: return read_operand<Operand::PtrBC>();
+        case Operand::PtrDE: return read_operand<Operand::PtrDE>();
+        case Operand::PtrHL: return read_operand<Operand::PtrHL>();
+        case Operand::PtrImm16: return read_operand<Operand::PtrImm16>();
+        default: DCHECK(false) << "Not an 8-bit operand"; return 0;
+    }
+}
+
+void CPU::write8(Operand operand, uint8_t value) {
     switch (operand) {
-        case Operand::A: return &a_;
-        case Operand::B: return &b_;
-        case Operand::C: return &c_;
-        case Operand::PtrC: return &ptr_c_;
-        case Operand::D: return &d_;
-        case Operand::E: return &e_;
-        case Operand::H: return &h_;
-        case Operand::L: return &l_;
-        case Operand::Imm8: return &imm8_;
-        case Operand::PtrImm8: return &ptr_imm8_;
-        case Operand::PtrBC: return &ptr_bc_;
-        case Operand::PtrDE: return &ptr_de_;
-        case Operand::PtrHL: return &ptr_hl_;
-        case Operand::PtrImm16: return &ptr_imm16_;
-        default: return {};
-    }
-}
-
-std::optional<Operand16 *> CPU::get_operand16(Operand operand) {
+        case Operand::A: write_operand<Operand::A>(value); break;
+        case Operand::B: write_operand<Operand::B>(value); break;
+        case Operand::C: write_operand<Operand::C>(value); break;
+        case Operand::PtrC: write_operand<Operand::PtrC>(value); break;
+        case Operand::D: write_operand<Operand::D>(value); break;
+        case Operand::E: write_operand<Operand::E>(value); break;
+        case Operand::H: write_operand<Operand::H>(value); break;
+        case Operand::L: write_operand<Operand::L>(value); break;
+        case Operand::PtrImm8: write_operand<Operand::PtrImm8>(value); break;
+        case Operand::PtrBC: write_operand<Operand::PtrBC>(value); break;
+        case Operand::PtrDE: write_operand<Operand::PtrDE>(value); break;
+        case Operand::PtrHL: write_operand<Operand::PtrHL>(value); break;
+        case Operand::PtrImm16:
+            write_operand<Operand::PtrImm16>(value);
+            break;
+        default: DCHECK(false) << "Not a writable 8-bit operand"; break;
+    }
+}
+
+uint16_t CPU::read16(Operand operand) const {
     switch (operand) {
-        case Operand::AF: return &af_;
-        case Operand::BC: return &bc_;
-        case Operand::DE: return &de_;
-        case Operand::HL: return &hl_;
-        case Operand::SP: return &sp_;
-        case Operand::Imm16: return &imm16_;
-        default: return {};
+        case Operand::AF: return read_operand<Operand::AF>();
+        case Operand::BC: return read_operand<Operand::BC>();
+        case Operand::DE: return read_operand<Operand::DE>();
+        case Operand::HL: return read_operand<Operand::HL>();
+        case Operand::SP: return read_operand<Operand::SP>();
+        case Operand::Imm16: return read_operand<Operand::Imm16>();
+        default: DCHECK(false) << "Not a 16-bit operand"; return 0;
+    }
+}
+
+void CPU::write16(Operand operand, uint16_t value) {
+    switch (operand) {
+        case Operand::AF: write_operand<Operand::AF>(value); break;
+        case Operand::BC: write_operand<Operand::BC>(value); break;
+        case Operand::DE: write_operand<Operand::DE>(value); break;
+        case Operand::HL: write_operand<Operand::HL>(value); break;
+        case Operand::SP: write_operand<Operand::SP>(value); break;
+        default: DCHECK(false) << "Not a writable 16-bit operand"; break;
     }
 }
 
@@ -105,34 +142,161 @@ void CPU::tick() {
         return;
     }
 
+    switch (interpreter_) {
+        case Interpreter::DECODER:
+        case Interpreter::CACHED_DECODER: tick_decoder(); break;
+        case Interpreter::THREADED: tick_threaded(); break;
+        case Interpreter::MICRO_OP: tick_micro_op(); break;
+    }
+}
+
+uint32_t CPU::run(uint32_t cycles) {
+    uint32_t elapsed = 0;
+
+    // One loop per interpreter, so that the dispatch on the interpreter is
+    // not repeated for every M-cycle.
+    switch (interpreter_) {
+        case Interpreter::DECODER:
+        case Interpreter::CACHED_DECODER:
+            while (elapsed < cycles && !halted_) {
+                tick_decoder();
+                cycles = advance_scheduler(1, ++elapsed, cycles);
+            }
+            break;
+        case Interpreter::THREADED: elapsed = run_threaded(cycles); break;
+        case Interpreter::MICRO_OP:
+            while (elapsed < cycles && !halted_) {
+                tick_micro_op();
+                cycles = advance_scheduler(1, ++elapsed, cycles);
+            }
+            break;
+    }
+
+    // The rest of the budget, which an event may have shortened, is spent
+    // halted.
+    cycles = advance_scheduler(0, elapsed, cycles);
+    return std::max(elapsed, cycles);
+}
+
+void CPU::tick_decoder() {
     allow_interrupt_service_ = false;
 
     decoder_.step();
 
-    if (!decoder_.decoded_instruction().has_value()) {
+    if (!decoder_.has_decoded_instruction()) {
         return;
     }
 
-    Instruction inst = decoder_.decoded_instruction().value();
-    if (inst.imm8().has_value()) {
-        imm8_.write(inst.imm8().value());
+    Instruction inst = decoder_.decoded_instruction();
+    imm8_ = inst.imm8();
+    imm8sign_ = inst.imm8sign();
+    imm16_ = inst.imm16();
+
+    execute_instruction(inst);
+
+    end_instruction();
+}
+
+void CPU::tick_threaded() {
+    // The instruction has already been executed in its first M-cycle; wait
+    // for the remaining ones to pass.
+    if (stall_cycles_ > 0) {
+        stall_cycles_--;
+        allow_interrupt_service_ = (stall_cycles_ == 0);
+        return;
     }
-    if (inst.imm8sign().has_value()) {
-        imm8sign_.write(inst.imm8sign().value());
+
+    allow_interrupt_service_ = false;
+
+    stall_cycles_ = execute_threaded(1) - 1;
+
+    allow_interrupt_service_ = (stall_cycles_ == 0);
+}
+
+uint32_t CPU::run_threaded(uint32_t cycles) {
+    // Finish waiting for the instruction started by tick_threaded() first.
+    uint32_t elapsed = std::min<uint32_t>(stall_cycles_, cycles);
+    stall_cycles_ -= elapsed;
+    allow_interrupt_service_ = (stall_cycles_ == 0);
+    cycles = advance_scheduler(elapsed, elapsed, cycles);
+
+    if (skip_idle_loops_ && elapsed < cycles && !halted_) {
+        elapsed += skip_idle_loop(cycles - elapsed);
     }
-    if (inst.imm16().has_value()) {
-        imm16_.write(inst.imm16().value());
+    if (elapsed < cycles && !halted_) {
+        elapsed += execute_threaded(cycles - elapsed);
     }
 
+    return elapsed;
+}
 
-    execute_instruction(inst);
+uint32_t CPU::skip_idle_loop(uint32_t cycles) {
+    // Between two events, nothing but the CPU changes memory, except for
+    // registers derived from the current cycle such as DIV. So an iteration
+    // which writes nothing, reads none of those registers and leaves the CPU
+    // exactly as it found it is followed by identical iterations until the
+    // next event.
+    const RegisterFile before = regs_;
+    const bool interrupt_enabled = interrupt_enabled_;
+    const bool schedule_interrupt_enable = schedule_interrupt_enable_;
+    const uint32_t writes = writes_;
+
+    uint32_t elapsed = 0;
+    bool looped = false;
+    idle_loop_reads_.clear();
+    mem_.log_indirect_reads(&idle_loop_reads_);
+    for (int i = 0; i < MAX_IDLE_LOOP_LENGTH && !looped; ++i) {
+        // One instruction at a time.
+        elapsed += execute_threaded(1);
+        if (halted_ || writes_ != writes || elapsed >= cycles) {
+            break;
+        }
+        looped = (regs_.pc == before.pc);
+    }
+    mem_.log_indirect_reads(nullptr);
+
+    if (!looped || regs_.sp != before.sp || regs_.af() != before.af() ||
+        regs_.bc() != before.bc() || regs_.de() != before.de() ||
+        regs_.hl() != before.hl() ||
+        interrupt_enabled_ != interrupt_enabled ||
+        schedule_interrupt_enable_ != schedule_interrupt_enable) {
+        return elapsed;
+    }
+
+    const memory::Memory *memory = mem_.memory();
+    if (std::any_of(idle_loop_reads_.begin(), idle_loop_reads_.end(),
+                    [memory](memory::MemoryAddr addr) {
+                        return memory->varies_between_events(addr);
+                    })) {
+        return elapsed;
+    }
 
+    // The budget ends with the cycle of the next event.
+    cycles = advance_scheduler(0, elapsed, cycles);
+    if (elapsed >= cycles) {
+        return elapsed;
+    }
+
+    const uint32_t skipped = (cycles - elapsed) / elapsed * elapsed;
+    idle_cycles_skipped_ += skipped;
+    advance_scheduler(skipped, elapsed + skipped, cycles);
+    return elapsed + skipped;
+}
+
+void CPU::end_instruction() {
     if (schedule_interrupt_enable_) {
         interrupt_enabled_ = true;
         schedule_interrupt_enable_ = false;
     }
 
     allow_interrupt_service_ = true;
+
+    // A halted CPU wakes up on a pending interrupt even if it can't take it.
+    if (interrupt_controller_ != nullptr &&
+        (interrupt_enabled_ || halted_) &&
+        interrupt_controller_->pending() != 0) {
+        interrupt_controller_->service();
+    }
 }
 
 bool CPU::interrupt(interrupt::InterruptType reason) {
@@ -153,17 +317,20 @@ bool CPU::interrupt(interrupt::InterruptType reason) {
     // Disable interrupt.
     di();
 
+    // The micro-op interpreter spends the M-cycles of the dispatch pushing PC
+    // and jumping to the handler.
+    if (interpreter_ == Interpreter::MICRO_OP) {
+        imm16_ = vector_of(reason);
+        sequence_ = &INTERRUPT_MICRO_OPS;
+        next_micro_op_ = 0;
+        return true;
+    }
+
     // Push the current PC onto the stack.
-    push_to_stack(pc_);
+    push_to_stack(regs_.pc);
 
     // Then jump to the interrupt handler, depending on the interrupt reason.
-    switch (reason) {
-        case interrupt::InterruptType::VBLANK: pc_ = IRQ_VBLANK; break;
-        case interrupt::InterruptType::LCD_STATUS: pc_ = IRQ_LCD_STATUS; break;
-        case interrupt::InterruptType::TIMER: pc_ = IRQ_TIMER; break;
-        case interrupt::InterruptType::JOYPAD: pc_ = IRQ_JOYPAD; break;
-        case interrupt::InterruptType::SERIAL: pc_ = IRQ_SERIAL; break;
-    }
+    regs_.pc = vector_of(reason);
 
     return true;
 }
@@ -226,48 +393,23 @@ void CPU::execute_instruction(Instruction inst) {
 void CPU::nop() {}
 
 // Status: NOT cycle accurate
-void CPU::jp(Operand lhs, Operand rhs) {
-    // One operand
-    switch (lhs) {
-        case Operand::Imm16: pc_ = imm16_.read(); return;
-        case Operand::HL: pc_ = hl_.read(); return;
-    }
-
-    // Two operands
-    bool should_jump = false;
-    switch (lhs) {
-        case Operand::FlagC: should_jump = f_.carry; break;
-        case Operand::FlagNC: should_jump = !f_.carry; break;
-        case Operand::FlagZ: should_jump = f_.zero; break;
-        case Operand::FlagNZ: should_jump = !f_.zero; break;
+void CPU::jp(Operand lhs, [[maybe_unused]] Operand rhs) {
+    if (lhs == Operand::HL) {
+        regs_.pc = regs_.hl();
+        return;
     }
 
-    if (should_jump) {
-        DCHECK(rhs == Operand::Imm16);
-        pc_ = imm16_.read();
+    if (alu::condition(regs_.f, lhs)) {
+        DCHECK(lhs == Operand::Imm16 || rhs == Operand::Imm16);
+        regs_.pc = imm16_;
     }
 }
 
 // Status: NOT cycle accurate
-void CPU::jr(Operand lhs, Operand rhs) {
-    // One operand
-    if (lhs == Operand::Imm8Sign) {
-        pc_ += imm8sign_.read();
-        return;
-    }
-
-    // Two operands
-    bool should_jump = false;
-    switch (lhs) {
-        case Operand::FlagC: should_jump = f_.carry; break;
-        case Operand::FlagNC: should_jump = !f_.carry; break;
-        case Operand::FlagZ: should_jump = f_.zero; break;
-        case Operand::FlagNZ: should_jump = !f_.zero; break;
-    }
-
-    if (should_jump) {
-        DCHECK(rhs == Operand::Imm8Sign);
-        pc_ += imm8sign_.read();
+void CPU::jr(Operand lhs, [[maybe_unused]] Operand rhs) {
+    if (alu::condition(regs_.f, lhs)) {
+        DCHECK(lhs == Operand::Imm8Sign || rhs == Operand::Imm8Sign);
+        regs_.pc += imm8sign_;
     }
 }
 
@@ -275,94 +417,44 @@ void CPU::ld(Operand lhs, Operand rhs) {
     // Special exception for 0x08: LD (Imm16), SP
     // Load LSB of SP into Imm16 and MSB of SP into Imm16 + 1
     if (lhs == Operand::PtrImm16 && rhs == Operand::SP) {
-        uint16_t addr = imm16_.read();
-
-        mem_->write(addr, sp_.read() & 0x00FFu);
-        mem_->write(addr + 1, sp_.read() >> 8u);
-        return;
-    }
-
-    // lhs and rhs are Operand8s
-    auto l8 = get_operand8(lhs), r8 = get_operand8(rhs);
-    if (l8 && r8) {
-        (*l8)->write((*r8)->read());
+        write_memory(imm16_, regs_.sp & 0x00FFu);
+        write_memory(imm16_ + 1, regs_.sp >> 8u);
         return;
     }
 
-    // lhs and rhs are Operand16s
-    auto l16 = get_operand16(lhs), r16 = get_operand16(rhs);
-    if (l16 && r16) {
-        (*l16)->write((*r16)->read());
-        return;
+    if (is_operand16(lhs)) {
+        write16(lhs, read16(rhs));
+    } else {
+        write8(lhs, read8(rhs));
     }
-
-    DCHECK(false);
 }
 
 void CPU::cp(Operand lhs) {
-    auto reg = get_operand8(lhs);
-    DCHECK(reg);
-
-    uint8_t x = a_.read(), y = (*reg)->read();
-
-    f_.zero = (x == y);
-    f_.subtract = true;
-    f_.half_carry = (low_nibble(x) < low_nibble(y));
-    f_.carry = (x < y);
+    alu::cp(regs_.f, regs_.a, read8(lhs));
 }
 
 void CPU::swap(Operand lhs) {
-    std::optional<Operand8 *> reg = get_operand8(lhs);
-    DCHECK(reg.has_value());
-
-    uint8_t val = (*reg)->read();
-    uint8_t new_val = high_nibble(val) | (low_nibble(val) << 4u);
-    (*reg)->write(new_val);
-
-    f_.zero = (new_val == 0);
-    f_.subtract = false;
-    f_.half_carry = false;
-    f_.carry = false;
+    write8(lhs, alu::swap(regs_.f, read8(lhs)));
 }
 
 void CPU::rlc(Operand lhs) {
-    auto op8 = get_operand8(lhs);
-    DCHECK(op8);
-
-    uint8_t value = (*op8)->read();
-    uint8_t new_value = (value << 1u) | (value >> 7u);
-    (*op8)->write(new_value);
-
-    f_.zero = (new_value == 0);
-    f_.subtract = false;
-    f_.half_carry = false;
-    f_.carry = (value >> 7u);
+    write8(lhs, alu::rlc(regs_.f, read8(lhs)));
 }
 
 // Specialization of RLC for A register. RRCA set the zero flag to 0, unlike RLC
 void CPU::rlca() {
     rlc(Operand::A);
-    f_.zero = false;
+    regs_.f.set_zero(false);
 }
 
 void CPU::rl(Operand lhs) {
-    auto op8 = get_operand8(lhs);
-    DCHECK(op8);
-
-    uint8_t value = (*op8)->read(), carry = f_.carry;
-    uint8_t new_value = (value << 1u) | carry;
-    (*op8)->write(new_value);
-
-    f_.zero = (new_value == 0);
-    f_.subtract = false;
-    f_.half_carry = false;
-    f_.carry = (value >> 7u);
+    write8(lhs, alu::rl(regs_.f, read8(lhs)));
 }
 
 // Specialization of RLC for A register. RRCA set the zero flag to 0, unlike RLC
 void CPU::rla() {
     rl(Operand::A);
-    f_.zero = false;
+    regs_.f.set_zero(false);
 }
 
 void CPU::di() {
@@ -375,380 +467,169 @@ void CPU::ei() {
     schedule_interrupt_enable_ = true;
 }
 
-void CPU::call(Operand lhs, Operand rhs) {
-    bool should_jump;
-
-    switch (lhs) {
-        // One operand
-        case Operand::Imm16: should_jump = true; break;
-        // Two operands
-        case Operand::FlagC: should_jump = f_.carry; break;
-        case Operand::FlagNC: should_jump = !f_.carry; break;
-        case Operand::FlagZ: should_jump = f_.zero; break;
-        case Operand::FlagNZ: should_jump = !f_.zero; break;
-    }
-
-    if (should_jump) {
+void CPU::call(Operand lhs, [[maybe_unused]] Operand rhs) {
+    if (alu::condition(regs_.f, lhs)) {
         // Push current PC onto stack
-        push_to_stack(pc_);
-        pc_ = imm16_.read();
+        push_to_stack(regs_.pc);
+        regs_.pc = imm16_;
     }
 }
 
 void CPU::ret(Operand lhs) {
-    bool should_return = false;
-
-    switch (lhs) {
-        case Operand::None: should_return = true; break;
-        case Operand::FlagC: should_return = f_.carry; break;
-        case Operand::FlagNC: should_return = !f_.carry; break;
-        case Operand::FlagZ: should_return = f_.zero; break;
-        case Operand::FlagNZ: should_return = !f_.zero; break;
-    }
-
-    if (should_return) {
-        pc_ = pop_from_stack();
+    if (alu::condition(regs_.f, lhs)) {
+        regs_.pc = pop_from_stack();
     }
 }
 
 void CPU::reti() {
-    pc_ = pop_from_stack();
+    regs_.pc = pop_from_stack();
     interrupt_enabled_ = true;
 }
 
 void CPU::push(Operand lhs) {
-    auto value = get_operand16(lhs);
-    DCHECK(value);
-    push_to_stack((*value)->read());
+    push_to_stack(read16(lhs));
 }
 
 void CPU::pop(Operand lhs) {
-    auto value = get_operand16(lhs);
-    DCHECK(value);
-    (*value)->write(pop_from_stack());
+    write16(lhs, pop_from_stack());
 }
 
 void CPU::push_to_stack(uint16_t value) {
     // MSB first into SP - 1
-    sp_.write(sp_.read() - 1);
-    mem_->write(sp_.read(), value >> 8u);
+    regs_.sp--;
+    write_memory(regs_.sp, value >> 8u);
 
     // Then LSB into SP - 2
-    sp_.write(sp_.read() - 1);
-    mem_->write(sp_.read(), value & 0x00FFu);
+    regs_.sp--;
+    write_memory(regs_.sp, value & 0x00FFu);
 }
 
 uint16_t CPU::pop_from_stack() {
     uint16_t value;
 
     // LSB first from SP.
-    value = mem_->read(sp_.read());
-    sp_.write(sp_.read() + 1);
+    value = mem_.read(regs_.sp);
+    regs_.sp++;
 
     // Then MSB from SP + 1.
-    value |= mem_->read(sp_.read()) << 8u;
-    sp_.write(sp_.read() + 1);
+    value |= mem_.read(regs_.sp) << 8u;
+    regs_.sp++;
 
     return value;
 }
 
 void CPU::inc(Operand lhs) {
-    auto op8 = get_operand8(lhs);
-    if (op8) {
-        uint8_t value = (*op8)->read();
-        uint8_t new_value = value + 1;
-        (*op8)->write(new_value);
-
-        f_.zero = (new_value == 0);
-        f_.subtract = false;
-        // If the low nibble of value is 0b1111 then 0b1111 + 0b1 would generate
-        // a carry bit.
-        f_.half_carry = (low_nibble(value) == 0xFu);
-
-        return;
+    if (is_operand16(lhs)) {
+        write16(lhs, read16(lhs) + 1);
+    } else {
+        write8(lhs, alu::inc(regs_.f, read8(lhs)));
     }
-
-    auto op16 = get_operand16(lhs);
-    DCHECK(op16);
-    (*op16)->write((*op16)->read() + 1);
 }
 
 void CPU::ldi(Operand lhs, Operand rhs) {
-    if (lhs == Operand::PtrHL && rhs == Operand::A) {
-        ptr_hl_.write(a_.read());
-        hl_.write(hl_.read() + 1);
-        return;
-    }
-
-    if (lhs == Operand::A && rhs == Operand::PtrHL) {
-        a_.write(ptr_hl_.read());
-        hl_.write(hl_.read() + 1);
-        return;
-    }
+    DCHECK((lhs == Operand::PtrHL && rhs == Operand::A) ||
+           (lhs == Operand::A && rhs == Operand::PtrHL));
 
-    DCHECK(false);
+    write8(lhs, read8(rhs));
+    regs_.set_hl(regs_.hl() + 1);
 }
 
 void CPU::or_(Operand lhs) {
-    auto op8 = get_operand8(lhs);
-    DCHECK(op8);
-
-    uint8_t new_value = a_.read() | ((*op8)->read());
-    a_.write(new_value);
-
-    f_.carry = false;
-    f_.half_carry = false;
-    f_.subtract = false;
-    f_.zero = (new_value == 0);
+    regs_.a = alu::or_(regs_.f, regs_.a, read8(lhs));
 }
 
 void CPU::and_(Operand lhs) {
-    auto op8 = get_operand8(lhs);
-    DCHECK(op8);
-
-    uint8_t new_value = a_.read() & ((*op8)->read());
-    a_.write(new_value);
-
-    f_.carry = false;
-    f_.half_carry = true;
-    f_.subtract = false;
-    f_.zero = (new_value == 0);
+    regs_.a = alu::and_(regs_.f, regs_.a, read8(lhs));
 }
 
 void CPU::dec(Operand lhs) {
-    auto op8 = get_operand8(lhs);
-    if (op8) {
-        uint8_t value = (*op8)->read();
-        uint8_t new_value = value - 1;
-        (*op8)->write(new_value);
-
-        f_.zero = (new_value == 0);
-        f_.subtract = true;
-        // If the low nibble of value is 0b0000 then 0b0000 - 0b1 would generate
-        // a borrow.
-        f_.half_carry = (low_nibble(value) == 0x0u);
-
-        return;
+    if (is_operand16(lhs)) {
+        write16(lhs, read16(lhs) - 1);
+    } else {
+        write8(lhs, alu::dec(regs_.f, read8(lhs)));
     }
-
-    auto op16 = get_operand16(lhs);
-    DCHECK(op16);
-    (*op16)->write((*op16)->read() - 1);
 }
 
 void CPU::xor_(Operand lhs) {
-    auto op8 = get_operand8(lhs);
-    DCHECK(op8);
-
-    uint8_t new_value = a_.read() ^ ((*op8)->read());
-    a_.write(new_value);
-
-    f_.carry = false;
-    f_.half_carry = false;
-    f_.subtract = false;
-    f_.zero = (new_value == 0);
+    regs_.a = alu::xor_(regs_.f, regs_.a, read8(lhs));
 }
 
 void CPU::add(Operand lhs, Operand rhs) {
-    if (lhs == Operand::A) {
-        auto op8 = get_operand8(rhs);
-        DCHECK(op8);
-
-        uint8_t x = a_.read(), y = (*op8)->read();
-        uint8_t new_value = x + y;
-        a_.write(new_value);
-
-        f_.zero = (new_value == 0);
-        f_.subtract = false;
-        f_.half_carry = (low_nibble(x) + low_nibble(y) > 0xFu);
-        //    x + y > 0xFF
-        // => x     > 0xFF - y
-        f_.carry = (x > (0xFF - y));
-
-        return;
-    }
-
-    if (lhs == Operand::HL) {
-        auto op16 = get_operand16(rhs);
-        DCHECK(op16);
-
-        uint16_t x = hl_.read(), y = (*op16)->read();
-        hl_.write(x + y);
-
-        f_.subtract = false;
-        f_.half_carry = ((x & 0x0FFFu) + (y & 0x0FFFu) > 0x0FFFu);
-        //    x + y > 0xFFFF
-        // => x     > 0xFFFF - y
-        f_.carry = (x > (0xFFFF - y));
-
-        return;
-    }
-
-    if (lhs == Operand::SP && rhs == Operand::Imm8Sign) {
-        uint16_t x = sp_.read();
-        int8_t y = imm8sign_.read();
-
-        sp_.write(x + y);
-
-        f_.zero = false;
-        f_.subtract = false;
-        // The half_carry flag here signifies carry from bit 3 to 4, not 11
-        // to 12.
-        f_.half_carry = ((x & 0x000Fu) + low_nibble(y) > 0x000Fu);
-        // The half_carry flag here signifies carry from bit 7 to 8, not 15
-        // to 16.
-        f_.carry = ((x & 0x00FFu) > (0x00FFu - (uint8_t)(y)));
-
-        return;
+    switch (lhs) {
+        case Operand::A:
+            regs_.a = alu::add(regs_.f, regs_.a, read8(rhs));
+            break;
+        case Operand::HL:
+            regs_.set_hl(alu::add16(regs_.f, regs_.hl(), read16(rhs)));
+            break;
+        case Operand::SP:
+            DCHECK(rhs == Operand::Imm8Sign);
+            regs_.sp = alu::add_sp(regs_.f, regs_.sp, imm8sign_);
+            break;
+        default: DCHECK(false); break;
     }
-
-    DCHECK(false);
 }
 
 void CPU::ldd(Operand lhs, Operand rhs) {
-    if (lhs == Operand::PtrHL && rhs == Operand::A) {
-        ptr_hl_.write(a_.read());
-        hl_.write(hl_.read() - 1);
-        return;
-    }
+    DCHECK((lhs == Operand::PtrHL && rhs == Operand::A) ||
+           (lhs == Operand::A && rhs == Operand::PtrHL));
 
-    if (lhs == Operand::A && rhs == Operand::PtrHL) {
-        a_.write(ptr_hl_.read());
-        hl_.write(hl_.read() - 1);
-        return;
-    }
-
-    DCHECK(false);
+    write8(lhs, read8(rhs));
+    regs_.set_hl(regs_.hl() - 1);
 }
 
 void CPU::sub(Operand lhs) {
-    auto op8 = get_operand8(lhs);
-    DCHECK(op8);
-
-    uint8_t x = a_.read(), y = (*op8)->read();
-    uint8_t new_value = x - y;
-    a_.write(new_value);
-
-    f_.zero = (new_value == 0);
-    f_.subtract = true;
-    f_.half_carry = (low_nibble(x) < low_nibble(y));
-    f_.carry = (x < y);
+    regs_.a = alu::sub(regs_.f, regs_.a, read8(lhs));
 }
 
 void CPU::srl(Operand lhs) {
-    auto op8 = get_operand8(lhs);
-    DCHECK(op8);
-
-    uint8_t value = (*op8)->read();
-    uint8_t new_value = value >> 1u;
-    (*op8)->write(new_value);
-
-    f_.zero = (new_value == 0);
-    f_.subtract = false;
-    f_.half_carry = false;
-    // Carry flag contains the value of bit 0
-    f_.carry = (value & 0x1u);
+    write8(lhs, alu::srl(regs_.f, read8(lhs)));
 }
 
 void CPU::rr(Operand lhs) {
-    auto op8 = get_operand8(lhs);
-    DCHECK(op8);
-
-    uint8_t value = (*op8)->read();
-    uint8_t carry = f_.carry;
-
-    uint8_t new_value = (value >> 1u)     // shift the old value to the left
-                        | (carry << 7u);  // and make the 7th bit the carry
-
-    (*op8)->write(new_value);
-
-    f_.zero = (new_value == 0);
-    f_.subtract = false;
-    f_.half_carry = false;
-    // Carry flag contains the value of bit 0
-    f_.carry = (value & 0x1u);
+    write8(lhs, alu::rr(regs_.f, read8(lhs)));
 }
 
 void CPU::adc(Operand lhs, Operand rhs) {
     DCHECK(lhs == Operand::A);
 
-    auto op8 = get_operand8(rhs);
-    DCHECK(op8);
-
-    uint8_t x = a_.read(), y = (*op8)->read(), carry = f_.carry;
-    uint8_t new_value = x + y + carry;
-    a_.write(new_value);
-
-    f_.zero = (new_value == 0);
-    f_.subtract = false;
-    f_.half_carry = ((low_nibble(x) + low_nibble(y) + carry) > 0x0Fu);
-
-    // There are two possible scenarios here:
-    // * (x + y) overflows => (x + y + carry) overflows
-    // * x + y == 0xff, which does not overflow, but if carry = 1 then
-    //   x + y + carry == 0, which overflows.
-    f_.carry = (x > (0xFFu - y)) || (x + y == 0xFFu && carry);
+    regs_.a = alu::adc(regs_.f, regs_.a, read8(rhs));
 }
 
 void CPU::sbc(Operand lhs, Operand rhs) {
     DCHECK(lhs == Operand::A);
 
-    auto op8 = get_operand8(rhs);
-    DCHECK(op8);
-
-    uint8_t x = a_.read(), y = (*op8)->read(), carry = f_.carry;
-    uint8_t new_value = x - y - carry;
-    a_.write(new_value);
-
-    f_.zero = (new_value == 0);
-    f_.subtract = true;
-    f_.half_carry = (low_nibble(x) < (low_nibble(y) + carry));
-
-    // There are two possible scenarios here:
-    // * (x - y) overflows => (x - y - carry) overflows.
-    // * (x - y) == 0, which does not overflow, but (x - y - carry) would
-    //   overflow if carry == 1.
-    f_.carry = (x < y) || (x == y && carry);
+    regs_.a = alu::sbc(regs_.f, regs_.a, read8(rhs));
 }
 
 void CPU::cpl() {
-    a_.write(~a_.read());
+    regs_.a = ~regs_.a;
 
-    f_.subtract = true;
-    f_.half_carry = true;
+    regs_.f.set_subtract(true);
+    regs_.f.set_half_carry(true);
 }
 
 void CPU::scf() {
-    f_.subtract = false;
-    f_.half_carry = false;
-    f_.carry = true;
+    regs_.f.set_subtract(false);
+    regs_.f.set_half_carry(false);
+    regs_.f.set_carry(true);
 }
 
 void CPU::ccf() {
-    f_.subtract = false;
-    f_.half_carry = false;
-    f_.carry = !f_.carry;
+    regs_.f.set_subtract(false);
+    regs_.f.set_half_carry(false);
+    regs_.f.set_carry(!regs_.f.carry());
 }
 
 // Specialization of RR for A register. RRA set the zero flag to 0, unlike RR.
 void CPU::rra() {
     rr(Operand::A);
 
-    f_.zero = false;
+    regs_.f.set_zero(false);
 }
 
 void CPU::rrc(Operand lhs) {
-    auto op8 = get_operand8(lhs);
-    DCHECK(op8);
-
-    uint8_t value = (*op8)->read();
-    uint8_t new_value = (value >> 1u) | ((value & 0x1u) << 7u);
-    (*op8)->write(new_value);
-
-    f_.zero = (new_value == 0);
-    f_.subtract = false;
-    f_.half_carry = false;
-    f_.carry = (value & 0x1u);
+    write8(lhs, alu::rrc(regs_.f, read8(lhs)));
 }
 
 // Specialization of RRC for A register. RRCA set the zero flag to 0, unlike
@@ -756,130 +637,51 @@ void CPU::rrc(Operand lhs) {
 void CPU::rrca() {
     rrc(Operand::A);
 
-    f_.zero = false;
+    regs_.f.set_zero(false);
 }
 
 void CPU::sla(Operand lhs) {
-    auto op8 = get_operand8(lhs);
-    DCHECK(op8);
-
-    uint8_t value = (*op8)->read();
-    uint8_t new_value = value << 1u;
-    (*op8)->write(new_value);
-
-    f_.zero = (new_value == 0);
-    f_.subtract = false;
-    f_.half_carry = false;
-    f_.carry = (value >> 7u);
+    write8(lhs, alu::sla(regs_.f, read8(lhs)));
 }
 
 void CPU::sra(Operand lhs) {
-    auto op8 = get_operand8(lhs);
-    DCHECK(op8);
-
-    uint8_t value = (*op8)->read();
-    uint8_t new_value = (value >> 1u) | ((value >> 7u) << 7u);
-    (*op8)->write(new_value);
-
-    f_.zero = (new_value == 0);
-    f_.subtract = false;
-    f_.half_carry = false;
-    f_.carry = (value & 0x1u);
+    write8(lhs, alu::sra(regs_.f, read8(lhs)));
 }
 
 void CPU::rst(Operand lhs) {
     DCHECK(lhs == Operand::Imm8);
 
-    push_to_stack(pc_);
-    pc_ = imm8_.read();
+    push_to_stack(regs_.pc);
+    regs_.pc = imm8_;
 }
 
 void CPU::bit(Operand lhs, Operand rhs) {
     DCHECK(lhs == Operand::Imm8);
 
-    auto op8 = get_operand8(rhs);
-    DCHECK(op8);
-
-    uint8_t x = imm8_.read(), y = (*op8)->read();
-
-    f_.zero = !(y & (1u << x));
-    f_.subtract = false;
-    f_.half_carry = true;
+    alu::bit(regs_.f, imm8_, read8(rhs));
 }
 
 void CPU::res(Operand lhs, Operand rhs) {
     DCHECK(lhs == Operand::Imm8);
 
-    auto op8 = get_operand8(rhs);
-    DCHECK(op8);
-
-    uint8_t x = imm8_.read(), y = (*op8)->read();
-    uint8_t new_value = y & (~(1u << x));
-    (*op8)->write(new_value);
+    write8(rhs, read8(rhs) & ~(1u << imm8_));
 }
 
 void CPU::set(Operand lhs, Operand rhs) {
     DCHECK(lhs == Operand::Imm8);
 
-    auto op8 = get_operand8(rhs);
-    DCHECK(op8);
-
-    uint8_t x = imm8_.read(), y = (*op8)->read();
-    uint8_t new_value = y | (1u << x);
-    (*op8)->write(new_value);
+    write8(rhs, read8(rhs) | (1u << imm8_));
 }
 
 void CPU::daa() {
-    uint8_t a = a_.read();
-
-    if (!f_.subtract) {
-        if (f_.half_carry || ((a & 0x0f) > 0x09)) {
-            // Explanation: a is an uint8_t, so if the below addition overflows
-            // and f_.carry is false, then the condition (a > 0x9f) below fails,
-            // which is not we're looking for when a is between 0xf0 and 0xff.
-            // So we "abuse" the f_.carry flag to also indicate that the
-            // addition will overflow, thus making sure the below condition is
-            // true.
-            f_.carry |= ((0xffu - a) < 0x06);
-
-            a += 0x06;
-        }
-
-        if (f_.carry || (a > 0x9f)) {
-            a += 0x60;
-            f_.carry = true;
-        }
-    } else {
-        if (f_.half_carry) {
-            a -= 0x06;
-        }
-
-        if (f_.carry) {
-            a -= 0x60;
-        }
-    }
-
-    a_.write(a);
-
-    f_.half_carry = false;
-    f_.zero = (a == 0);
+    regs_.a = alu::daa(regs_.f, regs_.a);
 }
 
 void CPU::ldhl(Instruction::Operand lhs, Instruction::Operand rhs) {
     DCHECK(lhs == Instruction::Operand::SP);
     DCHECK(rhs == Instruction::Operand::Imm8Sign);
 
-    uint16_t x = sp_.read();
-    int8_t y = imm8sign_.read();
-
-    hl_.write(x + y);
-
-    f_.zero = false;
-    f_.subtract = false;
-    // The half_carry flag here signifies carry from bit 3 to 4, not 11 to 12.
-    f_.half_carry = ((x & 0x000Fu) + low_nibble(y) > 0x000Fu);
-    // The half_carry flag here signifies carry from bit 7 to 8, not 15 to 16.
-    f_.carry = ((x & 0x00FFu) > (0x00FFu - (uint8_t)(y)));
+    regs_.set_hl(alu::add_sp(regs_.f, regs_.sp, imm8sign_));
 }
 
 void CPU::halt() {
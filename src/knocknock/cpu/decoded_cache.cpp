@@ -0,0 +1,67 @@
+#include "knocknock/cpu/decoded_cache.h"
+
+#include <algorithm>
+
+namespace cpu {
+
+DecodedCache::DecodedCache(const memory::HostPageTable *pages)
+    : pages_(pages), current_(), blocks_(), hits_(0), misses_(0) {}
+
+void DecodedCache::insert(memory::MemoryAddr addr,
+                          const OpcodeInfo *info,
+                          Instruction instruction) {
+    // An instruction crossing a page could have its bytes in two different
+    // banks, and a write to one page would not invalidate it.
+    if (offset_in_page(addr) + info->length > memory::PAGE_SIZE) {
+        return;
+    }
+
+    // Every byte must be backed by host memory, which is not a given in the
+    // high page where HRAM is next to memory-mapped IO.
+    const memory::MemoryValue *ptr = pages_->read_ptr(addr);
+    for (uint8_t i = 0; i < info->length; ++i) {
+        if (ptr == nullptr || pages_->read_ptr(addr + i) != ptr + i) {
+            return;
+        }
+    }
+
+    Block *block = block_of(addr, true);
+    block->entries[offset_in_page(addr)] = {instruction, info};
+}
+
+void DecodedCache::host_memory_written(const memory::MemoryValue *data,
+                                       memory::MemorySize size) {
+    // The written bytes may be in any bank, so every block is checked against
+    // the host memory it was tagged with. Instructions are up to 3 bytes
+    // long, so those starting up to 2 bytes before |data| change too.
+    const Tag begin = reinterpret_cast<Tag>(data);
+    const Tag end = begin + size;
+    for (auto &[tag, block] : blocks_) {
+        if (end <= tag || tag + memory::PAGE_SIZE + 2 <= begin) {
+            continue;
+        }
+
+        const Tag first = begin > tag + 2 ? begin - tag - 2 : 0;
+        const Tag last = std::min<Tag>(memory::PAGE_SIZE, end - tag);
+        for (Tag i = first; i < last; ++i) {
+            block->entries[i].info = nullptr;
+        }
+    }
+}
+
+DecodedCache::Block *DecodedCache::lookup(Tag tag, bool create) {
+    auto it = blocks_.find(tag);
+    if (it != blocks_.end()) {
+        return it->second.get();
+    }
+
+    if (!create) {
+        return nullptr;
+    }
+
+    auto &block = blocks_[tag];
+    block = std::make_unique<Block>();
+    return block.get();
+}
+
+}  // namespace cpu
@@ -0,0 +1,165 @@
+/**
+ * Execution of an instruction with its operands resolved at compile time,
+ * shared by the threaded and micro-op interpreters.
+ * @file execute_opcode.h
+ */
+#pragma once
+
+#include <glog/logging.h>
+
+#include "knocknock/cpu/alu.h"
+#include "knocknock/cpu/cpu.h"
+
+namespace cpu {
+
+// Execute an instruction whose immediate has already been read. Returns
+// whether a conditional instruction is taken.
+template <Instruction::Opcode OPCODE,
+          Instruction::Operand LHS,
+          Instruction::Operand RHS>
+bool CPU::execute_opcode() {
+    using Opcode = Instruction::Opcode;
+    using Operand = Instruction::Operand;
+
+    Flags &f = regs_.f;
+
+    if constexpr (OPCODE == Opcode::NOP) {
+        // Nothing to do.
+    } else if constexpr (OPCODE == Opcode::LD) {
+        if constexpr (LHS == Operand::PtrImm16 && RHS == Operand::SP) {
+            // Load LSB of SP into Imm16 and MSB of SP into Imm16 + 1
+            write_memory(imm16_, regs_.sp & 0x00FFu);
+            write_memory(imm16_ + 1, regs_.sp >> 8u);
+        } else {
+            write_operand<LHS>(read_operand<RHS>());
+        }
+    } else if constexpr (OPCODE == Opcode::LDI || OPCODE == Opcode::LDD) {
+        write_operand<LHS>(read_operand<RHS>());
+        regs_.set_hl(regs_.hl() + (OPCODE == Opcode::LDI ? 1 : -1));
+    } else if constexpr (OPCODE == Opcode::LDHL) {
+        regs_.set_hl(alu::add_sp(f, regs_.sp, imm8sign_));
+    } else if constexpr (OPCODE == Opcode::PUSH) {
+        push_to_stack(read_operand<LHS>());
+    } else if constexpr (OPCODE == Opcode::POP) {
+        write_operand<LHS>(pop_from_stack());
+    } else if constexpr (OPCODE == Opcode::JP) {
+        if constexpr (LHS == Operand::HL) {
+            regs_.pc = regs_.hl();
+        } else {
+            if (!alu::condition(f, LHS)) {
+                return false;
+            }
+            regs_.pc = imm16_;
+        }
+    } else if constexpr (OPCODE == Opcode::JR) {
+        if (!alu::condition(f, LHS)) {
+            return false;
+        }
+        regs_.pc += imm8sign_;
+    } else if constexpr (OPCODE == Opcode::CALL) {
+        if (!alu::condition(f, LHS)) {
+            return false;
+        }
+        push_to_stack(regs_.pc);
+        regs_.pc = imm16_;
+    } else if constexpr (OPCODE == Opcode::RET) {
+        if (!alu::condition(f, LHS)) {
+            return false;
+        }
+        regs_.pc = pop_from_stack();
+    } else if constexpr (OPCODE == Opcode::RETI) {
+        reti();
+    } else if constexpr (OPCODE == Opcode::RST) {
+        push_to_stack(regs_.pc);
+        regs_.pc = imm8_;
+    } else if constexpr (OPCODE == Opcode::ADD) {
+        if constexpr (LHS == Operand::A) {
+            regs_.a = alu::add(f, regs_.a, read_operand<RHS>());
+        } else if constexpr (LHS == Operand::HL) {
+            regs_.set_hl(alu::add16(f, regs_.hl(), read_operand<RHS>()));
+        } else {
+            regs_.sp = alu::add_sp(f, regs_.sp, imm8sign_);
+        }
+    } else if constexpr (OPCODE == Opcode::ADC) {
+        regs_.a = alu::adc(f, regs_.a, read_operand<RHS>());
+    } else if constexpr (OPCODE == Opcode::SBC) {
+        regs_.a = alu::sbc(f, regs_.a, read_operand<RHS>());
+    } else if constexpr (OPCODE == Opcode::SUB) {
+        regs_.a = alu::sub(f, regs_.a, read_operand<LHS>());
+    } else if constexpr (OPCODE == Opcode::AND) {
+        regs_.a = alu::and_(f, regs_.a, read_operand<LHS>());
+    } else if constexpr (OPCODE == Opcode::OR) {
+        regs_.a = alu::or_(f, regs_.a, read_operand<LHS>());
+    } else if constexpr (OPCODE == Opcode::XOR) {
+        regs_.a = alu::xor_(f, regs_.a, read_operand<LHS>());
+    } else if constexpr (OPCODE == Opcode::CP) {
+        alu::cp(f, regs_.a, read_operand<LHS>());
+    } else if constexpr (OPCODE == Opcode::INC) {
+        if constexpr (is_operand16(LHS)) {
+            write_operand<LHS>(read_operand<LHS>() + 1);
+        } else {
+            write_operand<LHS>(alu::inc(f, read_operand<LHS>()));
+        }
+    } else if constexpr (OPCODE == Opcode::DEC) {
+        if constexpr (is_operand16(LHS)) {
+            write_operand<LHS>(read_operand<LHS>() - 1);
+        } else {
+            write_operand<LHS>(alu::dec(f, read_operand<LHS>()));
+        }
+    } else if constexpr (OPCODE == Opcode::RLCA) {
+        regs_.a = alu::rlc(f, regs_.a);
+        f.set_zero(false);
+    } else if constexpr (OPCODE == Opcode::RLA) {
+        regs_.a = alu::rl(f, regs_.a);
+        f.set_zero(false);
+    } else if constexpr (OPCODE == Opcode::RRCA) {
+        regs_.a = alu::rrc(f, regs_.a);
+        f.set_zero(false);
+    } else if constexpr (OPCODE == Opcode::RRA) {
+        regs_.a = alu::rr(f, regs_.a);
+        f.set_zero(false);
+    } else if constexpr (OPCODE == Opcode::RLC) {
+        write_operand<LHS>(alu::rlc(f, read_operand<LHS>()));
+    } else if constexpr (OPCODE == Opcode::RRC) {
+        write_operand<LHS>(alu::rrc(f, read_operand<LHS>()));
+    } else if constexpr (OPCODE == Opcode::RL) {
+        write_operand<LHS>(alu::rl(f, read_operand<LHS>()));
+    } else if constexpr (OPCODE == Opcode::RR) {
+        write_operand<LHS>(alu::rr(f, read_operand<LHS>()));
+    } else if constexpr (OPCODE == Opcode::SLA) {
+        write_operand<LHS>(alu::sla(f, read_operand<LHS>()));
+    } else if constexpr (OPCODE == Opcode::SRA) {
+        write_operand<LHS>(alu::sra(f, read_operand<LHS>()));
+    } else if constexpr (OPCODE == Opcode::SWAP) {
+        write_operand<LHS>(alu::swap(f, read_operand<LHS>()));
+    } else if constexpr (OPCODE == Opcode::SRL) {
+        write_operand<LHS>(alu::srl(f, read_operand<LHS>()));
+    } else if constexpr (OPCODE == Opcode::BIT) {
+        alu::bit(f, imm8_, read_operand<RHS>());
+    } else if constexpr (OPCODE == Opcode::RES) {
+        write_operand<RHS>(read_operand<RHS>() & ~(1u << imm8_));
+    } else if constexpr (OPCODE == Opcode::SET) {
+        write_operand<RHS>(read_operand<RHS>() | (1u << imm8_));
+    } else if constexpr (OPCODE == Opcode::DAA) {
+        daa();
+    } else if constexpr (OPCODE == Opcode::CPL) {
+        cpl();
+    } else if constexpr (OPCODE == Opcode::SCF) {
+        scf();
+    } else if constexpr (OPCODE == Opcode::CCF) {
+        ccf();
+    } else if constexpr (OPCODE == Opcode::DI) {
+        di();
+    } else if constexpr (OPCODE == Opcode::EI) {
+        ei();
+    } else if constexpr (OPCODE == Opcode::HALT) {
+        halt();
+    } else {
+        static_assert(OPCODE == Opcode::STOP, "Opcode has no handler");
+        DCHECK(false) << "Instruction not recognized: STOP";
+    }
+
+    return true;
+}
+
+}  // namespace cpu
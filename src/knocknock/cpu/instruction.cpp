@@ -3,8 +3,37 @@
 #include <fmt/format.h>
 #include <glog/logging.h>
 
+#include "knocknock/cpu/opcode_table.h"
+
 namespace cpu {
 
+namespace {
+
+// Index of (lhs, rhs) in OPERAND_PAIRS, for the instructions built from their
+// operands rather than from an opcode table.
+uint8_t find_operands(Instruction::Operand lhs, Instruction::Operand rhs) {
+    for (size_t i = 0; i < Instruction::OPERAND_PAIRS.size(); ++i) {
+        if (Instruction::OPERAND_PAIRS[i].lhs == lhs &&
+            Instruction::OPERAND_PAIRS[i].rhs == rhs) {
+            return i;
+        }
+    }
+
+    DCHECK(false) << fmt::format("No opcode has operands {}, {}", lhs, rhs);
+    return 0;
+}
+
+}  // namespace
+
+const std::array<Instruction::OperandPair, 256> Instruction::OPERAND_PAIRS =
+    opcode_table_internal::OPERAND_PAIRS;
+
+static_assert(opcode_table_internal::OPERAND_PAIRS[0].lhs ==
+                      Instruction::Operand::None &&
+                  opcode_table_internal::OPERAND_PAIRS[0].rhs ==
+                      Instruction::Operand::None,
+              "A default-constructed Instruction must have no operands");
+
 std::string Instruction::disassemble_opcode() const {
     switch (opcode_) {
         case Instruction::Opcode::RLC: return "RLC";
@@ -89,15 +118,15 @@ std::string Instruction::disassemble_operand(
 
         // Special handling for immediate operands
         case Instruction::Operand::Imm8:
-            return fmt::format("{:#02X}", imm8_.value());
+            return fmt::format("{:#02X}", imm8());
         case Instruction::Operand::Imm8Sign:
-            return fmt::format("{:#02d}", imm8sign_.value());
+            return fmt::format("{:#02d}", imm8sign());
         case Instruction::Operand::PtrImm8:
-            return fmt::format("({:#02X})", imm8_.value());
+            return fmt::format("({:#02X})", imm8());
         case Instruction::Operand::Imm16:
-            return fmt::format("{:#04X}", imm16_.value());
+            return fmt::format("{:#04X}", imm16());
         case Instruction::Operand::PtrImm16:
-            return fmt::format("({:#04X})", imm16_.value());
+            return fmt::format("({:#04X})", imm16());
     }
 
     DCHECK(false) << fmt::format("Unknown operand: {}", operand);
@@ -105,50 +134,38 @@ std::string Instruction::disassemble_operand(
 }  // namespace
 
 Instruction::Instruction(Opcode opcode, Operand lhs, Operand rhs)
-    : opcode_(opcode), lhs_(lhs), rhs_(rhs), imm8_(), imm8sign_(), imm16_() {
+    : opcode_(opcode), operands_(find_operands(lhs, rhs)), imm_(0) {
     // If rhs is not None, then lhs is also not None. Thus it's invalid that
     // rhs is not None but lhs is None.
-    DCHECK(!((lhs_ == Operand::None) && (rhs_ != Operand::None)));
+    DCHECK(!((lhs == Operand::None) && (rhs != Operand::None)));
 }
 
 Instruction::Instruction(Opcode opcode, Operand lhs, Operand rhs, uint8_t imm8)
-    : opcode_(opcode),
-      lhs_(lhs),
-      rhs_(rhs),
-      imm8_(imm8),
-      imm8sign_(),
-      imm16_() {}
+    : opcode_(opcode), operands_(find_operands(lhs, rhs)), imm_(imm8) {}
 
 Instruction::Instruction(Opcode opcode,
                          Operand lhs,
                          Operand rhs,
                          int8_t imm8sign)
     : opcode_(opcode),
-      lhs_(lhs),
-      rhs_(rhs),
-      imm8_(),
-      imm8sign_(imm8sign),
-      imm16_() {}
+      operands_(find_operands(lhs, rhs)),
+      imm_((uint8_t)(imm8sign)) {}
 
 Instruction::Instruction(Opcode opcode,
                          Operand lhs,
                          Operand rhs,
                          uint16_t imm16)
-    : opcode_(opcode),
-      lhs_(lhs),
-      rhs_(rhs),
-      imm8_(),
-      imm8sign_(),
-      imm16_(imm16) {}
+    : opcode_(opcode), operands_(find_operands(lhs, rhs)), imm_(imm16) {}
 
 std::string Instruction::disassemble() const {
     std::string result = disassemble_opcode();
 
-    if (lhs_ != Instruction::Operand::None) {
-        result += " " + disassemble_operand(lhs_);
+    const OperandPair &operands = OPERAND_PAIRS[operands_];
+    if (operands.lhs != Instruction::Operand::None) {
+        result += " " + disassemble_operand(operands.lhs);
 
-        if (rhs_ != Instruction::Operand::None) {
-            result += ", " + disassemble_operand(rhs_);
+        if (operands.rhs != Instruction::Operand::None) {
+            result += ", " + disassemble_operand(operands.rhs);
         }
     }
 
@@ -0,0 +1,409 @@
+/**
+ * Micro-op interpreter: every instruction is split into one micro-op per
+ * M-cycle, from sequences built at compile time from the opcode tables.
+ * @file micro_op.cpp
+ */
+#include <fmt/format.h>
+#include <glog/logging.h>
+
+#include "knocknock/cpu/alu.h"
+#include "knocknock/cpu/cpu.h"
+#include "knocknock/cpu/opcode_table.h"
+
+#include "execute_opcode.h"
+
+namespace cpu {
+
+using Opcode = Instruction::Opcode;
+using Operand = Instruction::Operand;
+
+namespace {
+
+constexpr bool is_condition(Operand operand) {
+    switch (operand) {
+        case Operand::FlagC:
+        case Operand::FlagNC:
+        case Operand::FlagZ:
+        case Operand::FlagNZ: return true;
+        default: return false;
+    }
+}
+
+constexpr bool is_memory(Operand operand) {
+    switch (operand) {
+        case Operand::PtrC:
+        case Operand::PtrBC:
+        case Operand::PtrDE:
+        case Operand::PtrHL:
+        case Operand::PtrImm8:
+        case Operand::PtrImm16: return true;
+        default: return false;
+    }
+}
+
+constexpr bool is_load(Opcode opcode) {
+    return opcode == Opcode::LD || opcode == Opcode::LDI ||
+           opcode == Opcode::LDD;
+}
+
+constexpr bool is_arithmetic(Opcode opcode) {
+    switch (opcode) {
+        case Opcode::ADD:
+        case Opcode::ADC:
+        case Opcode::SUB:
+        case Opcode::SBC:
+        case Opcode::AND:
+        case Opcode::OR:
+        case Opcode::XOR:
+        case Opcode::CP: return true;
+        default: return false;
+    }
+}
+
+// The operand the last micro-op reads in place of |operand|: a memory operand
+// has been loaded into imm8_ by then.
+constexpr Operand loaded(Operand operand) {
+    return is_memory(operand) ? Operand::Imm8 : operand;
+}
+
+// Check that every sequence takes as many M-cycles as its opcode, both when a
+// conditional instruction is taken and when it is not.
+template <typename Table>
+constexpr bool cycles_match(const Table &table,
+                            const std::array<OpcodeInfo, 256> &infos,
+                            bool prefixed) {
+    for (size_t i = 0; i < table.size(); ++i) {
+        const OpcodeInfo &info = infos[i];
+        if (!info.valid) {
+            continue;
+        }
+
+        const uint8_t prefix = prefixed ? 1 : 0;
+        if (table[i].length + prefix != info.cycles_taken) {
+            return false;
+        }
+        if (table[i].skipped_length != 0 &&
+            table[i].skipped_length + prefix != info.cycles) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+}  // namespace
+
+template <bool PREFIXED, uint8_t OPCODE>
+constexpr CPU::MicroOps CPU::micro_ops() {
+    constexpr OpcodeInfo INFO =
+        PREFIXED ? CB_OPCODES[OPCODE] : BASE_OPCODES[OPCODE];
+    constexpr Opcode OP = INFO.opcode;
+    constexpr Operand LHS = INFO.lhs;
+    constexpr Operand RHS = INFO.rhs;
+    constexpr Operand COND = is_condition(LHS) ? LHS : Operand::None;
+
+    MicroOps uops{};
+    auto add = [&uops](MicroOp uop) { uops.ops[uops.length++] = uop; };
+
+    if constexpr (!PREFIXED && OPCODE == CB_PREFIX) {
+        add(&CPU::uop_prefix);
+        return uops;
+    } else if constexpr (!INFO.valid) {
+        add(&CPU::uop_unknown<OPCODE>);
+        return uops;
+    } else {
+        // Memory operands are accessed by the micro-ops before the last one,
+        // which only works on registers and immediates.
+        MicroOp last = &CPU::uop_last<OP, LHS, RHS, INFO.implicit_imm8>;
+
+        // JR, JP and CALL check their condition along with their immediate.
+        if constexpr (INFO.immediate == ImmediateKind::Imm8) {
+            add(&CPU::uop_read_imm8);
+        } else if constexpr (INFO.immediate == ImmediateKind::Imm8Sign) {
+            add(&CPU::uop_read_imm8sign<COND>);
+        } else if constexpr (INFO.immediate == ImmediateKind::Imm16) {
+            add(&CPU::uop_read_imm16_low);
+            add(&CPU::uop_read_imm16_high<COND>);
+        }
+        if constexpr (INFO.immediate != ImmediateKind::None &&
+                      COND != Operand::None) {
+            uops.skipped_length = uops.length + 1;
+        }
+
+        if constexpr (OP == Opcode::RET || OP == Opcode::RETI) {
+            if constexpr (COND != Operand::None) {
+                add(&CPU::uop_idle<COND>);
+                uops.skipped_length = uops.length + 1;
+            }
+            add(&CPU::uop_pop_low);
+            add(&CPU::uop_pop_high);
+            if constexpr (OP == Opcode::RETI) {
+                add(&CPU::uop_enable_interrupts);
+            }
+            last = &CPU::uop_last<Opcode::JP, LHS, Operand::None>;
+        } else if constexpr (OP == Opcode::CALL) {
+            add(&CPU::uop_idle<Operand::None>);
+            add(&CPU::uop_push_pc<true>);
+            add(&CPU::uop_push_pc<false>);
+            last = &CPU::uop_last<Opcode::JP, LHS, RHS>;
+        } else if constexpr (OP == Opcode::RST) {
+            add(&CPU::uop_load_vector<INFO.implicit_imm8>);
+            add(&CPU::uop_push_pc<true>);
+            add(&CPU::uop_push_pc<false>);
+            last = &CPU::uop_last<Opcode::JP, Operand::Imm16, Operand::None>;
+        } else if constexpr (OP == Opcode::PUSH) {
+            add(&CPU::uop_idle<Operand::None>);
+            add(&CPU::uop_push<LHS, true>);
+            add(&CPU::uop_push<LHS, false>);
+            last = &CPU::uop_last<Opcode::NOP, Operand::None, Operand::None>;
+        } else if constexpr (OP == Opcode::POP) {
+            add(&CPU::uop_pop_low);
+            add(&CPU::uop_pop_high);
+            last = &CPU::uop_last<Opcode::LD, LHS, Operand::Imm16>;
+        } else if constexpr (OP == Opcode::LD && RHS == Operand::SP &&
+                             LHS == Operand::PtrImm16) {
+            add(&CPU::uop_store_sp<false>);
+            add(&CPU::uop_store_sp<true>);
+            last = &CPU::uop_last<Opcode::NOP, Operand::None, Operand::None>;
+        } else if constexpr (is_load(OP) && is_memory(LHS)) {
+            add(&CPU::uop_store<OP, LHS, RHS>);
+            last = &CPU::uop_last<Opcode::NOP, Operand::None, Operand::None>;
+        } else if constexpr (is_load(OP) && is_memory(RHS)) {
+            add(&CPU::uop_load<OP, RHS>);
+            last = &CPU::uop_last<Opcode::LD, LHS, Operand::Imm8>;
+        } else if constexpr (OP == Opcode::BIT && is_memory(RHS)) {
+            // imm8_ holds the value read, the bit index is known statically.
+            add(&CPU::uop_load<Opcode::NOP, RHS>);
+            last = &CPU::uop_last_bit<INFO.implicit_imm8>;
+        } else if constexpr (is_arithmetic(OP) &&
+                             (is_memory(LHS) || is_memory(RHS))) {
+            add(&CPU::uop_load<Opcode::NOP, is_memory(LHS) ? LHS : RHS>);
+            last = &CPU::uop_last<OP, loaded(LHS), loaded(RHS)>;
+        } else if constexpr (is_memory(LHS) || is_memory(RHS)) {
+            // Read-modify-write of (HL): INC, DEC, rotations, shifts, RES
+            // and SET.
+            add(&CPU::uop_load<Opcode::NOP, Operand::PtrHL>);
+            add(&CPU::uop_modify<OP, INFO.implicit_imm8>);
+            last = &CPU::uop_last<Opcode::NOP, Operand::None, Operand::None>;
+        }
+
+        // Internal M-cycles, such as the 16-bit arithmetic of INC rr or the
+        // jump of JP.
+        while (uops.length + 1 + (PREFIXED ? 1 : 0) < INFO.cycles_taken) {
+            add(&CPU::uop_idle<Operand::None>);
+        }
+        add(last);
+
+        return uops;
+    }
+}
+
+template <bool PREFIXED, size_t... OPCODES>
+constexpr std::array<CPU::MicroOps, 256> CPU::make_micro_ops(
+    std::index_sequence<OPCODES...>) {
+    constexpr std::array<MicroOps, 256> TABLE = {
+        {micro_ops<PREFIXED, OPCODES>()...}};
+    static_assert(
+        cycles_match(TABLE, PREFIXED ? CB_OPCODES : BASE_OPCODES, PREFIXED),
+        "Micro-ops do not match the cycles of the opcode table");
+
+    return TABLE;
+}
+
+const std::array<CPU::MicroOps, 256> CPU::BASE_MICRO_OPS =
+    make_micro_ops<false>(std::make_index_sequence<256>());
+const std::array<CPU::MicroOps, 256> CPU::CB_MICRO_OPS =
+    make_micro_ops<true>(std::make_index_sequence<256>());
+
+// The opcode fetched by the last instruction is not run: PC is moved back to
+// it before being pushed.
+const CPU::MicroOps CPU::INTERRUPT_MICRO_OPS = {
+    {
+        &CPU::uop_unwind_pc,
+        &CPU::uop_idle<Operand::None>,
+        &CPU::uop_push_pc<true>,
+        &CPU::uop_push_pc<false>,
+        &CPU::uop_last<Opcode::JP, Operand::Imm16, Operand::None>,
+    },
+    5,
+    0,
+};
+
+void CPU::tick_micro_op() {
+    allow_interrupt_service_ = false;
+
+    const MicroOp uop = sequence_->ops[next_micro_op_++];
+    (this->*uop)();
+}
+
+template <Operand COND>
+void CPU::skip_unless() {
+    if constexpr (COND != Operand::None) {
+        if (!alu::condition(regs_.f, COND)) {
+            next_micro_op_ = sequence_->length - 1;
+        }
+    }
+}
+
+void CPU::fetch_opcode() {
+    sequence_ = &BASE_MICRO_OPS[mem_.read(regs_.pc++)];
+    next_micro_op_ = 0;
+
+    // An interrupt serviced now replaces the fetched opcode, and unwinds PC.
+    end_instruction();
+}
+
+template <Operand COND>
+void CPU::uop_idle() {
+    skip_unless<COND>();
+}
+
+void CPU::uop_read_imm8() {
+    imm8_ = mem_.read(regs_.pc++);
+}
+
+template <Operand COND>
+void CPU::uop_read_imm8sign() {
+    imm8sign_ = (int8_t)(mem_.read(regs_.pc++));
+    skip_unless<COND>();
+}
+
+void CPU::uop_read_imm16_low() {
+    imm16_ = mem_.read(regs_.pc++);
+}
+
+template <Operand COND>
+void CPU::uop_read_imm16_high() {
+    imm16_ |= (uint16_t)(mem_.read(regs_.pc++)) << 8u;
+    skip_unless<COND>();
+}
+
+template <Opcode OPCODE, Operand ADDR>
+void CPU::uop_load() {
+    imm8_ = mem_.read(address_of<ADDR>());
+
+    if constexpr (OPCODE == Opcode::LDI || OPCODE == Opcode::LDD) {
+        regs_.set_hl(regs_.hl() + (OPCODE == Opcode::LDI ? 1 : -1));
+    }
+}
+
+template <Opcode OPCODE, Operand ADDR, Operand SRC>
+void CPU::uop_store() {
+    write_memory(address_of<ADDR>(), read_operand<SRC>());
+
+    if constexpr (OPCODE == Opcode::LDI || OPCODE == Opcode::LDD) {
+        regs_.set_hl(regs_.hl() + (OPCODE == Opcode::LDI ? 1 : -1));
+    }
+}
+
+template <Opcode OPCODE, uint8_t BIT>
+void CPU::uop_modify() {
+    Flags &f = regs_.f;
+    uint8_t value = imm8_;
+
+    if constexpr (OPCODE == Opcode::INC) {
+        value = alu::inc(f, value);
+    } else if constexpr (OPCODE == Opcode::DEC) {
+        value = alu::dec(f, value);
+    } else if constexpr (OPCODE == Opcode::RLC) {
+        value = alu::rlc(f, value);
+    } else if constexpr (OPCODE == Opcode::RRC) {
+        value = alu::rrc(f, value);
+    } else if constexpr (OPCODE == Opcode::RL) {
+        value = alu::rl(f, value);
+    } else if constexpr (OPCODE == Opcode::RR) {
+        value = alu::rr(f, value);
+    } else if constexpr (OPCODE == Opcode::SLA) {
+        value = alu::sla(f, value);
+    } else if constexpr (OPCODE == Opcode::SRA) {
+        value = alu::sra(f, value);
+    } else if constexpr (OPCODE == Opcode::SWAP) {
+        value = alu::swap(f, value);
+    } else if constexpr (OPCODE == Opcode::SRL) {
+        value = alu::srl(f, value);
+    } else if constexpr (OPCODE == Opcode::RES) {
+        value &= ~(1u << BIT);
+    } else {
+        static_assert(OPCODE == Opcode::SET, "Opcode does not modify (HL)");
+        value |= 1u << BIT;
+    }
+
+    write_memory(regs_.hl(), value);
+}
+
+template <bool HIGH>
+void CPU::uop_store_sp() {
+    // LSB of SP into Imm16, then MSB into Imm16 + 1.
+    if constexpr (HIGH) {
+        write_memory(imm16_ + 1, regs_.sp >> 8u);
+    } else {
+        write_memory(imm16_, regs_.sp & 0x00FFu);
+    }
+}
+
+template <Operand SRC, bool HIGH>
+void CPU::uop_push() {
+    const uint16_t value = read_operand<SRC>();
+
+    // MSB first into SP - 1, then LSB into SP - 2.
+    regs_.sp--;
+    write_memory(regs_.sp, HIGH ? value >> 8u : value & 0x00FFu);
+}
+
+template <bool HIGH>
+void CPU::uop_push_pc() {
+    regs_.sp--;
+    write_memory(regs_.sp, HIGH ? regs_.pc >> 8u : regs_.pc & 0x00FFu);
+}
+
+void CPU::uop_pop_low() {
+    imm16_ = mem_.read(regs_.sp++);
+}
+
+void CPU::uop_pop_high() {
+    imm16_ |= (uint16_t)(mem_.read(regs_.sp++)) << 8u;
+}
+
+template <uint16_t VECTOR>
+void CPU::uop_load_vector() {
+    imm16_ = VECTOR;
+}
+
+void CPU::uop_enable_interrupts() {
+    interrupt_enabled_ = true;
+}
+
+void CPU::uop_unwind_pc() {
+    regs_.pc--;
+}
+
+void CPU::uop_prefix() {
+    sequence_ = &CB_MICRO_OPS[mem_.read(regs_.pc++)];
+    next_micro_op_ = 0;
+}
+
+template <Opcode OPCODE, Operand LHS, Operand RHS, uint8_t IMPLICIT_IMM8>
+void CPU::uop_last() {
+    // BIT, RES and SET on a register take their bit index from imm8_.
+    if constexpr (OPCODE == Opcode::BIT || OPCODE == Opcode::RES ||
+                  OPCODE == Opcode::SET) {
+        imm8_ = IMPLICIT_IMM8;
+    }
+
+    execute_opcode<OPCODE, LHS, RHS>();
+    fetch_opcode();
+}
+
+template <uint8_t BIT>
+void CPU::uop_last_bit() {
+    alu::bit(regs_.f, BIT, imm8_);
+    fetch_opcode();
+}
+
+template <uint8_t OPCODE>
+void CPU::uop_unknown() {
+    LOG(ERROR) << fmt::format("Unknown opcode: {:#02x}, assuming NOP", OPCODE);
+    fetch_opcode();
+}
+
+}  // namespace cpu
@@ -0,0 +1,167 @@
+/**
+ * Threaded interpreter: one handler per encoded opcode, specialized at compile
+ * time from the opcode tables, and dispatched through handler tables or
+ * computed goto.
+ * @file threaded.cpp
+ */
+#include <fmt/format.h>
+#include <glog/logging.h>
+
+#include "knocknock/cpu/alu.h"
+#include "knocknock/cpu/cpu.h"
+#include "knocknock/cpu/opcode_table.h"
+
+#include "execute_opcode.h"
+
+// GCC and Clang support taking the address of labels, which lets every
+// handler jump straight to the next one instead of returning to a central
+// dispatch loop.
+#if defined(__GNUC__)
+#define KNOCKNOCK_COMPUTED_GOTO 1
+#else
+#define KNOCKNOCK_COMPUTED_GOTO 0
+#endif
+
+// Expand M(00) M(01) ... M(ff), one for each possible opcode byte.
+#define REPEAT_16(M, HI)                                                   \
+    M(HI##0) M(HI##1) M(HI##2) M(HI##3) M(HI##4) M(HI##5) M(HI##6) M(HI##7) \
+    M(HI##8) M(HI##9) M(HI##a) M(HI##b) M(HI##c) M(HI##d) M(HI##e) M(HI##f)
+#define REPEAT_256(M)                                                       \
+    REPEAT_16(M, 0) REPEAT_16(M, 1) REPEAT_16(M, 2) REPEAT_16(M, 3)         \
+    REPEAT_16(M, 4) REPEAT_16(M, 5) REPEAT_16(M, 6) REPEAT_16(M, 7)         \
+    REPEAT_16(M, 8) REPEAT_16(M, 9) REPEAT_16(M, a) REPEAT_16(M, b)         \
+    REPEAT_16(M, c) REPEAT_16(M, d) REPEAT_16(M, e) REPEAT_16(M, f)
+
+namespace cpu {
+
+using Opcode = Instruction::Opcode;
+using Operand = Instruction::Operand;
+
+#define BASE_HANDLER(n) &CPU::execute_base<0x##n>,
+#define CB_HANDLER(n) &CPU::execute_cb<0x##n>,
+
+const std::array<CPU::Handler, 256> CPU::BASE_HANDLERS = {
+    REPEAT_256(BASE_HANDLER)};
+const std::array<CPU::Handler, 256> CPU::CB_HANDLERS = {
+    REPEAT_256(CB_HANDLER)};
+
+#undef BASE_HANDLER
+#undef CB_HANDLER
+
+template <bool PREFIXED, uint8_t OPCODE>
+uint8_t CPU::execute_encoded() {
+    constexpr OpcodeInfo INFO =
+        PREFIXED ? CB_OPCODES[OPCODE] : BASE_OPCODES[OPCODE];
+
+    if constexpr (!INFO.valid) {
+        LOG(ERROR) << fmt::format("Unknown opcode: {:#02x}, assuming NOP",
+                                  OPCODE);
+        return INFO.cycles;
+    } else {
+        if constexpr (INFO.immediate == ImmediateKind::Imm8) {
+            imm8_ = mem_.read(regs_.pc++);
+        } else if constexpr (INFO.immediate == ImmediateKind::Imm8Sign) {
+            imm8sign_ = (int8_t)(mem_.read(regs_.pc++));
+        } else if constexpr (INFO.immediate == ImmediateKind::Imm16) {
+            imm16_ = mem_.read(regs_.pc++);
+            imm16_ |= (uint16_t)(mem_.read(regs_.pc++)) << 8u;
+        } else if constexpr (INFO.lhs == Operand::Imm8) {
+            // RST, BIT, RES and SET carry their immediate in the opcode.
+            imm8_ = INFO.implicit_imm8;
+        }
+
+        const bool taken = execute_opcode<INFO.opcode, INFO.lhs, INFO.rhs>();
+        return taken ? INFO.cycles_taken : INFO.cycles;
+    }
+}
+
+template <uint8_t OPCODE>
+uint8_t CPU::execute_base() {
+    if constexpr (OPCODE == CB_PREFIX) {
+        return (this->*CB_HANDLERS[mem_.read(regs_.pc++)])();
+    } else {
+        return execute_encoded<false, OPCODE>();
+    }
+}
+
+template <uint8_t OPCODE>
+uint8_t CPU::execute_cb() {
+    return execute_encoded<true, OPCODE>();
+}
+
+#if KNOCKNOCK_COMPUTED_GOTO
+
+// Taking the address of a label and jumping to it are GNU extensions.
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wpedantic"
+
+uint32_t CPU::execute_threaded(uint32_t cycles) {
+    uint32_t elapsed = 0;
+    uint8_t spent = 0;
+
+#define BASE_LABEL_ADDRESS(n) &&base_##n,
+#define CB_LABEL_ADDRESS(n) &&cb_##n,
+
+    static const void *const BASE_LABELS[] = {REPEAT_256(BASE_LABEL_ADDRESS)};
+    static const void *const CB_LABELS[] = {REPEAT_256(CB_LABEL_ADDRESS)};
+
+#undef BASE_LABEL_ADDRESS
+#undef CB_LABEL_ADDRESS
+
+// Count the |spent| M-cycles of the last instruction, then jump to the handler
+// of the next instruction, unless the budget is used up or the CPU halted.
+#define DISPATCH(spent)                                        \
+    do {                                                       \
+        elapsed += (spent);                                    \
+        cycles = advance_scheduler((spent), elapsed, cycles);  \
+        if (elapsed >= cycles || halted_) {                    \
+            return elapsed;                                    \
+        }                                                      \
+        goto *BASE_LABELS[mem_.read(regs_.pc++)];              \
+    } while (false)
+
+#define BASE_LABEL(n)                                 \
+    base_##n : if constexpr (0x##n == CB_PREFIX) {    \
+        goto *CB_LABELS[mem_.read(regs_.pc++)];       \
+    }                                                 \
+    else {                                            \
+        spent = execute_encoded<false, 0x##n>();      \
+        end_instruction();                            \
+        DISPATCH(spent);                              \
+    }
+
+#define CB_LABEL(n)                                   \
+    cb_##n : spent = execute_encoded<true, 0x##n>();  \
+    end_instruction();                                \
+    DISPATCH(spent);
+
+    DISPATCH(0);
+
+    REPEAT_256(BASE_LABEL)
+    REPEAT_256(CB_LABEL)
+
+#undef DISPATCH
+#undef BASE_LABEL
+#undef CB_LABEL
+}
+
+#pragma GCC diagnostic pop
+
+#else
+
+uint32_t CPU::execute_threaded(uint32_t cycles) {
+    uint32_t elapsed = 0;
+
+    do {
+        const uint8_t spent = (this->*BASE_HANDLERS[mem_.read(regs_.pc++)])();
+        end_instruction();
+        elapsed += spent;
+        cycles = advance_scheduler(spent, elapsed, cycles);
+    } while (elapsed < cycles && !halted_);
+
+    return elapsed;
+}
+
+#endif
+
+}  // namespace cpu
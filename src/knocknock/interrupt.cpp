@@ -9,75 +9,84 @@ namespace {
 constexpr memory::MemoryAddr IF = 0xff0f;
 constexpr memory::MemoryAddr IE = 0xffff;
 
-const std::map<InterruptType, bool> DEFAULT_MAP = {
-    {InterruptType::VBLANK, false},
-    {InterruptType::SERIAL, false},
-    {InterruptType::JOYPAD, false},
-    {InterruptType::TIMER, false},
-    {InterruptType::LCD_STATUS, false}};
-
-constexpr memory::MemoryValue VBLANK_MASK = 1 << 0;
-constexpr memory::MemoryValue LCD_STATUS_MASK = 1 << 1;
-constexpr memory::MemoryValue TIMER_MASK = 1 << 2;
-constexpr memory::MemoryValue SERIAL_MASK = 1 << 3;
-constexpr memory::MemoryValue JOYPAD_MASK = 1 << 4;
-
-memory::MemoryValue to_value(const std::map<InterruptType, bool> &map) {
-    // Unused bits are always high.
-    memory::MemoryValue result = 0b1110'0000;
-
-    if (map.at(InterruptType::VBLANK))
-        result |= VBLANK_MASK;
-    if (map.at(InterruptType::LCD_STATUS))
-        result |= LCD_STATUS_MASK;
-    if (map.at(InterruptType::TIMER))
-        result |= TIMER_MASK;
-    if (map.at(InterruptType::SERIAL))
-        result |= SERIAL_MASK;
-    if (map.at(InterruptType::JOYPAD))
-        result |= JOYPAD_MASK;
-
-    return result;
-}
+constexpr uint8_t INTERRUPT_COUNT = 5;
+
+// Unused bits of IE and IF are always read high.
+constexpr memory::MemoryValue USED_BITS = (1u << INTERRUPT_COUNT) - 1;
+constexpr memory::MemoryValue UNUSED_BITS = ~USED_BITS & 0xffu;
 
-void from_value(std::map<InterruptType, bool> *map, memory::MemoryValue value) {
-    map->at(InterruptType::VBLANK) = value & VBLANK_MASK;
-    map->at(InterruptType::LCD_STATUS) = value & LCD_STATUS_MASK;
-    map->at(InterruptType::TIMER) = value & TIMER_MASK;
-    map->at(InterruptType::SERIAL) = value & SERIAL_MASK;
-    map->at(InterruptType::JOYPAD) = value & JOYPAD_MASK;
+constexpr uint8_t mask_of(InterruptType type) {
+    return 1u << static_cast<uint8_t>(type);
 }
 
+static_assert(mask_of(InterruptType::VBLANK) == 1 << 0);
+static_assert(mask_of(InterruptType::LCD_STATUS) == 1 << 1);
+static_assert(mask_of(InterruptType::TIMER) == 1 << 2);
+static_assert(mask_of(InterruptType::SERIAL) == 1 << 3);
+static_assert(mask_of(InterruptType::JOYPAD) == 1 << 4);
+
 }  // namespace
 
-InterruptController::InterruptController(Interruptible *sink)
+InterruptController::InterruptController(Interruptible *sink,
+                                         peripherals::Scheduler *scheduler)
     : sink_(sink),
-      interrupt_enabled_(DEFAULT_MAP),
-      interrupt_requested_(DEFAULT_MAP) {}
+      scheduler_(scheduler),
+      enabled_(0),
+      requested_(0),
+      pending_(0) {}
 
 bool InterruptController::interrupt(InterruptType reason) {
-    interrupt_requested_[reason] = true;
+    requested_ |= mask_of(reason);
+    pending_ = enabled_ & requested_;
+    schedule_if_pending(0);
 
     return true;
 }
 
 void InterruptController::tick() {
-    for (auto &[reason, requested] : interrupt_requested_) {
-        if (requested && interrupt_enabled_[reason]) {
-            // Attempt to interrupt the sink
-            if (sink_->interrupt(reason)) {
-                // Attempt successful, mark that the IRQ is not requested
-                // anymore.
-                requested = false;
-            }
-        }
+    // A sink which refused is not polled: it calls service() once it can take
+    // the interrupt, for example when the CPU enables interrupts. One which
+    // took it may take the next one right away.
+    if (service()) {
+        schedule_if_pending(1);
+    }
+}
+
+bool InterruptController::service() {
+    if (pending_ == 0) {
+        return false;
+    }
+
+    // Only the pending interrupt of the highest priority, the lowest bit, is
+    // serviced. The sink refuses interrupts as a whole, so there is no point
+    // in offering it the others.
+    uint8_t bit = 0;
+    while ((pending_ & (1u << bit)) == 0) {
+        bit++;
+    }
+
+    // Attempt to interrupt the sink, and mark that the IRQ is not requested
+    // anymore if successful.
+    if (!sink_->interrupt(static_cast<InterruptType>(bit))) {
+        return false;
+    }
+
+    requested_ &= ~(1u << bit);
+    pending_ = enabled_ & requested_;
+    return true;
+}
+
+void InterruptController::schedule_if_pending(
+    peripherals::Scheduler::Timestamp delay) {
+    if (scheduler_ != nullptr && pending_ != 0) {
+        scheduler_->schedule(this, delay);
     }
 }
 
 memory::MemoryValue InterruptController::read(memory::MemoryAddr addr) const {
     switch (addr) {
-        case IF: return to_value(interrupt_requested_);
-        case IE: return to_value(interrupt_enabled_);
+        case IF: return UNUSED_BITS | requested_;
+        case IE: return UNUSED_BITS | enabled_;
         default:
             DCHECK(false) << "Invalid read to InterruptController";
             return 0xff;
@@ -87,10 +96,13 @@ memory::MemoryValue InterruptController::read(memory::MemoryAddr addr) const {
 void InterruptController::write(memory::MemoryAddr addr,
                                 memory::MemoryValue value) {
     switch (addr) {
-        case IF: from_value(&interrupt_requested_, value); break;
-        case IE: from_value(&interrupt_enabled_, value); break;
+        case IF: requested_ = value & USED_BITS; break;
+        case IE: enabled_ = value & USED_BITS; break;
         default: DCHECK(false) << "Invalid write to InterruptController"; break;
     }
+    pending_ = enabled_ & requested_;
+
+    schedule_if_pending(0);
 }
 
 }  // namespace interrupt
@@ -0,0 +1,35 @@
+#include "knocknock/memory/bank.h"
+
+#include <fmt/format.h>
+#include <glog/logging.h>
+
+#include <algorithm>
+
+namespace memory {
+
+std::vector<MemoryValue> pad_to_banks(std::vector<MemoryValue> rom,
+                                      MemorySize bank_size) {
+    const size_t banks =
+        std::max<size_t>(1, (rom.size() + bank_size - 1) / bank_size);
+    rom.resize(banks * bank_size, 0xff);
+    return rom;
+}
+
+void check_ram_size(MemorySize ram_size, MemorySize max_size) {
+    DCHECK(ram_size <= max_size)
+        << fmt::format("RAM size too large: {}", ram_size);
+    DCHECK(ram_size % RAMBank::SIZE == 0 ||
+           (ram_size < RAMBank::SIZE && (ram_size & (ram_size - 1)) == 0))
+        << fmt::format("Unsupported RAM size: {}", ram_size);
+}
+
+RAMBank select_ram_bank(MemorySize ram_size, uint32_t bank) {
+    if (ram_size >= RAMBank::SIZE) {
+        const uint32_t banks = ram_size / RAMBank::SIZE;
+        return {(bank % banks) * RAMBank::SIZE, RAMBank::SIZE - 1};
+    }
+
+    return {0, ram_size > 0 ? ram_size - 1 : 0};
+}
+
+}  // namespace memory
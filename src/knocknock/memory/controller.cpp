@@ -0,0 +1,143 @@
+#include "knocknock/memory/controller.h"
+
+#include <fmt/format.h>
+#include <glog/logging.h>
+
+#include <optional>
+
+#include "knocknock/memory/flat_rom.h"
+#include "knocknock/memory/mbc1.h"
+#include "knocknock/memory/mbc2.h"
+#include "knocknock/memory/mbc3.h"
+#include "knocknock/memory/mbc5.h"
+#include "knocknock/memory/regions.h"
+
+namespace memory {
+
+namespace {
+
+using CartridgeType = Cartridge::CartridgeType;
+
+constexpr MemorySize KBYTE = 1024;
+
+// Largest RAM each controller can map.
+constexpr MemorySize MAX_FLAT_RAM_SIZE = RAM_EXTERNAL_SIZE;
+constexpr MemorySize MAX_MBC1_RAM_SIZE = 32 * KBYTE;
+constexpr MemorySize MAX_MBC3_RAM_SIZE = 32 * KBYTE;
+constexpr MemorySize MAX_MBC5_RAM_SIZE = 128 * KBYTE;
+
+/**
+ * The content of |cartridge|, sized as its header says.
+ */
+std::vector<MemoryValue> rom_of(const Cartridge &cartridge) {
+    std::vector<MemoryValue> rom = cartridge.content();
+    LOG_IF(WARNING, rom.size() != cartridge.rom_size()) << fmt::format(
+        "Cartridge content ({} bytes) does not match the ROM size of its "
+        "header ({} bytes)",
+        rom.size(), cartridge.rom_size());
+    rom.resize(cartridge.rom_size(), 0xff);
+
+    return rom;
+}
+
+/**
+ * The RAM size of |cartridge|, or nothing if it is larger than |max_size|.
+ */
+std::optional<MemorySize> ram_of(const Cartridge &cartridge,
+                                 MemorySize max_size) {
+    if (cartridge.ram_size() > max_size) {
+        LOG(ERROR) << fmt::format(
+            "RAM size {} of cartridge type {:#04x} is larger than the maximum "
+            "of its controller ({})",
+            cartridge.ram_size(), static_cast<int>(cartridge.type()),
+            max_size);
+        return {};
+    }
+
+    return cartridge.ram_size();
+}
+
+}  // namespace
+
+std::unique_ptr<ROMLoadableMemory> make_controller(
+    const Cartridge &cartridge,
+    const peripherals::Scheduler *scheduler) {
+    const CartridgeType type = cartridge.type();
+
+    switch (type) {
+        case CartridgeType::ROM:
+            return std::make_unique<FlatROM>(rom_of(cartridge), 0);
+
+        case CartridgeType::ROM_RAM:
+        case CartridgeType::ROM_RAM_BATT: {
+            const auto ram_size = ram_of(cartridge, MAX_FLAT_RAM_SIZE);
+            if (!ram_size) {
+                return nullptr;
+            }
+            return std::make_unique<FlatROM>(rom_of(cartridge), *ram_size);
+        }
+
+        case CartridgeType::ROM_MBC1:
+            return std::make_unique<MBC1>(rom_of(cartridge), 0);
+
+        case CartridgeType::ROM_MBC1_RAM:
+        case CartridgeType::ROM_MBC1_RAM_BATT: {
+            const auto ram_size = ram_of(cartridge, MAX_MBC1_RAM_SIZE);
+            if (!ram_size) {
+                return nullptr;
+            }
+            return std::make_unique<MBC1>(rom_of(cartridge), *ram_size);
+        }
+
+        // MBC2 has its own RAM, whatever the header says.
+        case CartridgeType::ROM_MBC2:
+        case CartridgeType::ROM_MBC2_BATT:
+            return std::make_unique<MBC2>(rom_of(cartridge));
+
+        case CartridgeType::ROM_MBC3:
+        case CartridgeType::ROM_MBC3_RTC_BATT:
+            return std::make_unique<MBC3>(
+                rom_of(cartridge), 0,
+                type == CartridgeType::ROM_MBC3_RTC_BATT, scheduler);
+
+        case CartridgeType::ROM_MBC3_RAM:
+        case CartridgeType::ROM_MBC3_RAM_BATT:
+        case CartridgeType::ROM_MBC3_RTC_RAM_BATT: {
+            const auto ram_size = ram_of(cartridge, MAX_MBC3_RAM_SIZE);
+            if (!ram_size) {
+                return nullptr;
+            }
+            return std::make_unique<MBC3>(
+                rom_of(cartridge), *ram_size,
+                type == CartridgeType::ROM_MBC3_RTC_RAM_BATT, scheduler);
+        }
+
+        case CartridgeType::ROM_MBC5:
+        case CartridgeType::ROM_MBC5_RUMBLE:
+            return std::make_unique<MBC5>(
+                rom_of(cartridge), 0, type == CartridgeType::ROM_MBC5_RUMBLE);
+
+        case CartridgeType::ROM_MBC5_RAM:
+        case CartridgeType::ROM_MBC5_RAM_BATT:
+        case CartridgeType::ROM_MBC5_RUMBLE_SRAM:
+        case CartridgeType::ROM_MBC5_RUMBLE_SRAM_BATT: {
+            const auto ram_size = ram_of(cartridge, MAX_MBC5_RAM_SIZE);
+            if (!ram_size) {
+                return nullptr;
+            }
+            const bool has_rumble =
+                type == CartridgeType::ROM_MBC5_RUMBLE_SRAM ||
+                type == CartridgeType::ROM_MBC5_RUMBLE_SRAM_BATT;
+            return std::make_unique<MBC5>(rom_of(cartridge), *ram_size,
+                                          has_rumble);
+        }
+
+        default:
+            LOG(ERROR) << fmt::format(
+                "Unsupported cartridge type {:#04x} for \"{}\"",
+                static_cast<int>(type), cartridge.title());
+            return nullptr;
+    }
+}
+
+}  // namespace memory
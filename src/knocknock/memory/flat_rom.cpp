@@ -3,6 +3,9 @@
 #include <fmt/format.h>
 #include <glog/logging.h>
 
+#include <algorithm>
+#include <cstring>
+
 namespace memory {
 
 FlatROM::FlatROM(std::vector<MemoryValue> rom, MemorySize ram_size)
@@ -43,4 +46,101 @@ void FlatROM::write(MemoryAddr addr, MemoryValue value) {
     DCHECK(false) << fmt::format("Invalid write at {:#04x}", addr);
 }
 
+void FlatROM::read_block(MemoryAddr addr,
+                         MemoryValue *data,
+                         MemorySize size) const {
+    copy_block(addr, data, size, true);
+}
+
+void FlatROM::peek_block(MemoryAddr addr,
+                         MemoryValue *data,
+                         MemorySize size) const {
+    copy_block(addr, data, size, false);
+}
+
+void FlatROM::copy_block(MemoryAddr addr,
+                         MemoryValue *data,
+                         MemorySize size,
+                         bool log) const {
+    while (size > 0) {
+        MemorySize length = 1;
+        if (BETWEEN(ROM_0_BEGIN, addr, ROM_SWITCHABLE_END)) {
+            length = std::min<MemorySize>(size, ROM_SWITCHABLE_END - addr + 1);
+            // Bytes past the end of a smaller ROM read as 0xff.
+            const MemorySize in_rom =
+                addr < rom_.size()
+                    ? std::min<MemorySize>(length, rom_.size() - addr)
+                    : 0;
+            if (in_rom > 0) {
+                std::memcpy(data, &rom_[addr], in_rom);
+            }
+            std::fill_n(data + in_rom, length - in_rom, 0xff);
+        } else if (BETWEEN(RAM_EXTERNAL_BEGIN, addr, ram_end_addr_)) {
+            length = std::min<MemorySize>(size, ram_end_addr_ - addr + 1);
+            std::memcpy(data, &ram_[addr - RAM_EXTERNAL_BEGIN], length);
+        } else if (BETWEEN(RAM_EXTERNAL_BEGIN, addr, RAM_EXTERNAL_END)) {
+            // Past the end of the RAM, if any.
+            length = std::min<MemorySize>(size, RAM_EXTERNAL_END - addr + 1);
+            LOG_IF(ERROR, log) << fmt::format(
+                "No external RAM at {:#04x}, returning {} junk values", addr,
+                length);
+            std::fill_n(data, length, 0xff);
+        } else {
+            *data = log ? read(addr) : 0xff;
+        }
+
+        addr += length;
+        data += length;
+        size -= length;
+    }
+}
+
+void FlatROM::write_block(MemoryAddr addr,
+                          const MemoryValue *data,
+                          MemorySize size) {
+    while (size > 0) {
+        MemorySize length = 1;
+        if (BETWEEN(ROM_0_BEGIN, addr, ROM_SWITCHABLE_END)) {
+            length = std::min<MemorySize>(size, ROM_SWITCHABLE_END - addr + 1);
+            LOG(ERROR) << fmt::format(
+                FMT_STRING("Invalid write of {} bytes to ROM at {:#04x}, "
+                           "ignoring"),
+                length, addr);
+        } else if (BETWEEN(RAM_EXTERNAL_BEGIN, addr, ram_end_addr_)) {
+            length = std::min<MemorySize>(size, ram_end_addr_ - addr + 1);
+            std::memcpy(&ram_[addr - RAM_EXTERNAL_BEGIN], data, length);
+        } else {
+            write(addr, *data);
+        }
+
+        addr += length;
+        data += length;
+        size -= length;
+    }
+}
+
+const MemoryValue *FlatROM::host_read_ptr(MemoryAddr addr) const {
+    if (BETWEEN(ROM_0_BEGIN, addr, ROM_0_END) ||
+        BETWEEN(ROM_SWITCHABLE_BEGIN, addr, ROM_SWITCHABLE_END)) {
+        // Only publish pages which are entirely inside the ROM.
+        if ((addr | (PAGE_SIZE - 1)) >= rom_.size()) {
+            return nullptr;
+        }
+
+        return &rom_[addr];
+    }
+
+    return const_cast<FlatROM *>(this)->host_write_ptr(addr);
+}
+
+MemoryValue *FlatROM::host_write_ptr(MemoryAddr addr) {
+    // Only publish pages which are entirely inside the RAM.
+    if (BETWEEN(RAM_EXTERNAL_BEGIN, addr, ram_end_addr_) &&
+        (addr | (PAGE_SIZE - 1)) <= ram_end_addr_) {
+        return &ram_[addr - RAM_EXTERNAL_BEGIN];
+    }
+
+    return nullptr;
+}
+
 }  // namespace memory
@@ -1,5 +1,8 @@
 #include "knocknock/memory/internal_ram.h"
 
+#include <algorithm>
+#include <cstring>
+
 #include <glog/logging.h>
 
 namespace memory {
@@ -42,4 +45,73 @@ void InternalRAM::write(MemoryAddr addr, MemoryValue value) {
     DCHECK(false) << "Invalid write to InternalRAM";
 }
 
+void InternalRAM::read_block(MemoryAddr addr,
+                             MemoryValue *data,
+                             MemorySize size) const {
+    while (size > 0) {
+        MemorySize available = 0;
+        const MemoryValue *source =
+            const_cast<InternalRAM *>(this)->find(addr, &available);
+        if (source == nullptr) {
+            DCHECK(false) << "Invalid read to InternalRAM";
+            std::fill_n(data, size, 0xff);
+            return;
+        }
+
+        const MemorySize length = std::min(size, available);
+        std::memcpy(data, source, length);
+        addr += length;
+        data += length;
+        size -= length;
+    }
+}
+
+void InternalRAM::write_block(MemoryAddr addr,
+                              const MemoryValue *data,
+                              MemorySize size) {
+    while (size > 0) {
+        MemorySize available = 0;
+        MemoryValue *destination = find(addr, &available);
+        if (destination == nullptr) {
+            DCHECK(false) << "Invalid write to InternalRAM";
+            return;
+        }
+
+        const MemorySize length = std::min(size, available);
+        std::memcpy(destination, data, length);
+        addr += length;
+        data += length;
+        size -= length;
+    }
+}
+
+MemoryValue *InternalRAM::find(MemoryAddr addr, MemorySize *available) {
+    if (BETWEEN(RAM_INTERNAL_BEGIN, addr, RAM_INTERNAL_END)) {
+        *available = RAM_INTERNAL_END - addr + 1;
+        return &ram_[addr - RAM_INTERNAL_BEGIN];
+    }
+
+    // Echo RAM aliases the WRAM it mirrors.
+    if (BETWEEN(RAM_ECHO_BEGIN, addr, RAM_ECHO_END)) {
+        *available = RAM_ECHO_END - addr + 1;
+        return &ram_[addr - RAM_ECHO_BEGIN];
+    }
+
+    if (BETWEEN(HRAM_BEGIN, addr, HRAM_END)) {
+        *available = HRAM_END - addr + 1;
+        return &hram_[addr - HRAM_BEGIN];
+    }
+
+    return nullptr;
+}
+
+const MemoryValue *InternalRAM::host_read_ptr(MemoryAddr addr) const {
+    return const_cast<InternalRAM *>(this)->host_write_ptr(addr);
+}
+
+MemoryValue *InternalRAM::host_write_ptr(MemoryAddr addr) {
+    MemorySize available = 0;
+    return find(addr, &available);
+}
+
 }
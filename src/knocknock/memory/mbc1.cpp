@@ -3,6 +3,10 @@
 #include <fmt/format.h>
 #include <glog/logging.h>
 
+#include <algorithm>
+#include <cstring>
+
+#include "knocknock/memory/bank.h"
 #include "knocknock/memory/regions.h"
 
 namespace memory {
@@ -28,65 +32,47 @@ MBC1::MBC1(std::vector<MemoryValue> rom, MemorySize ram_size)
       bank1_(1),
       bank2_(0),
       mode_(AddressingMode::MODE_0),
-      rom_(std::move(rom)),
+      rom_bases_(),
+      mapped_ram_(),
+      rom_(pad_to_banks(std::move(rom), ROM_BANK_SIZE)),
       ram_(),
       ram_size_(ram_size) {
     LOG_IF(ERROR, rom_.size() > MAX_ROM_SIZE) << fmt::format(
         "ROM (size = {}) is larger than the maximum addressable size ({})",
         rom_.size(), MAX_ROM_SIZE);
 
-    DCHECK(ram_size_ <= sizeof(ram_))
-        << fmt::format("RAM size too large: {}", ram_size_);
-}
+    check_ram_size(ram_size_, sizeof(ram_));
 
-uint32_t MBC1::translate_rom_address(MemoryAddr addr) const {
-    uint32_t bank = 0;
-    uint32_t addr_in_bank = 0;
-
-    if (BETWEEN(ROM_0_BEGIN, addr, ROM_0_END)) {
-        // Reading from bank 0.
-        switch (mode_) {
-            case AddressingMode::MODE_0: bank = 0; break;
-            case AddressingMode::MODE_1: bank = bank2_ << 5; break;
-        }
+    update_banks();
+}
 
-        addr_in_bank = addr - ROM_0_BEGIN;
-    } else if (BETWEEN(ROM_SWITCHABLE_BEGIN, addr, ROM_SWITCHABLE_END)) {
-        // Reading from switchable bank area.
-        bank = (bank2_ << 5) | bank1_;
-        addr_in_bank = addr - ROM_SWITCHABLE_BEGIN;
-    } else {
-        DCHECK(false);
+void MBC1::update_banks() {
+    const uint32_t rom_banks = rom_.size() / ROM_BANK_SIZE;
+    const uint32_t upper_bits = bank2_ << 5;
+
+    // In mode 1, BANK2 also selects the bank of the ROM_0 region, and the RAM
+    // bank.
+    uint32_t rom0_bank = 0;
+    uint32_t ram_bank = 0;
+    if (mode_ == AddressingMode::MODE_1) {
+        rom0_bank = upper_bits;
+        ram_bank = bank2_;
     }
 
-    uint32_t real_addr = bank * ROM_BANK_SIZE + addr_in_bank;
-    real_addr %= rom_.size();
+    rom_bases_[0] = (rom0_bank % rom_banks) * ROM_BANK_SIZE;
+    rom_bases_[1] = ((upper_bits | bank1_) % rom_banks) * ROM_BANK_SIZE;
 
-    return real_addr;
+    mapped_ram_ = select_ram_bank(ram_size_, ram_bank);
 }
 
-uint32_t MBC1::translate_ram_address(MemoryAddr addr) const {
-    uint32_t bank = 0;
-    uint32_t addr_in_bank = addr - RAM_EXTERNAL_BEGIN;
-
-    if (mode_ == AddressingMode::MODE_0) {
-        bank = 0;
-    } else if (mode_ == AddressingMode::MODE_1) {
-        bank = bank2_;
-    }
-
-    uint32_t real_addr = bank * RAM_BANK_SIZE + addr_in_bank;
-    real_addr %= ram_size_;
-
-    return real_addr;
+uint32_t MBC1::translate_rom_address(MemoryAddr addr) const {
+    DCHECK(BETWEEN(ROM_0_BEGIN, addr, ROM_SWITCHABLE_END));
+    return rom_bases_[addr / ROM_BANK_SIZE] + addr % ROM_BANK_SIZE;
 }
 
 MemoryValue MBC1::read(MemoryAddr addr) const {
-    if (BETWEEN(ROM_0_BEGIN, addr, ROM_0_END) ||
-        BETWEEN(ROM_SWITCHABLE_BEGIN, addr, ROM_SWITCHABLE_END)) {
-        uint32_t real_addr = translate_rom_address(addr);
-
-        return rom_[real_addr];
+    if (BETWEEN(ROM_0_BEGIN, addr, ROM_SWITCHABLE_END)) {
+        return rom_[translate_rom_address(addr)];
     }
 
     if (BETWEEN(RAM_EXTERNAL_BEGIN, addr, RAM_EXTERNAL_END)) {
@@ -100,7 +86,7 @@ MemoryValue MBC1::read(MemoryAddr addr) const {
             return 0xff;
         }
 
-        uint32_t real_addr = translate_ram_address(addr);
+        uint32_t real_addr = mapped_ram_.translate(addr);
 
         return ram_[real_addr];
     }
@@ -117,6 +103,7 @@ void MBC1::write(MemoryAddr addr, MemoryValue value) {
     //   S: 1010 (0xA) to enable the RAM, any other value to disable it.
     if (BETWEEN(RAM_ENABLE_BEGIN, addr, RAM_ENABLE_END)) {
         ram_enabled_ = ((value & 0x0f) == 0xAu);
+        notify_host_pages_changed(RAM_EXTERNAL_BEGIN, RAM_EXTERNAL_END);
         return;
     }
 
@@ -125,12 +112,18 @@ void MBC1::write(MemoryAddr addr, MemoryValue value) {
         bank1_ = value & 0b00011111u;
         if (bank1_ == 0)
             bank1_ = 1;
+        update_banks();
+        notify_host_pages_changed(ROM_SWITCHABLE_BEGIN, ROM_SWITCHABLE_END);
         return;
     }
 
     // BANK2 register. Only the lower 2 bits count.
     if (BETWEEN(BANK2_BEGIN, addr, BANK2_END)) {
         bank2_ = value & 0b00000011u;
+        update_banks();
+        // BANK2 selects the upper bits of all ROM banks, and the RAM bank.
+        notify_host_pages_changed(ROM_0_BEGIN, ROM_SWITCHABLE_END);
+        notify_host_pages_changed(RAM_EXTERNAL_BEGIN, RAM_EXTERNAL_END);
         return;
     }
 
@@ -144,7 +137,10 @@ void MBC1::write(MemoryAddr addr, MemoryValue value) {
         } else {
             mode_ = AddressingMode::MODE_1;
         }
+        update_banks();
 
+        notify_host_pages_changed(ROM_0_BEGIN, ROM_0_END);
+        notify_host_pages_changed(RAM_EXTERNAL_BEGIN, RAM_EXTERNAL_END);
         return;
     }
 
@@ -160,7 +156,7 @@ void MBC1::write(MemoryAddr addr, MemoryValue value) {
             return;
         }
 
-        uint32_t real_addr = translate_ram_address(addr);
+        uint32_t real_addr = mapped_ram_.translate(addr);
         ram_[real_addr] = value;
 
         return;
@@ -169,4 +165,99 @@ void MBC1::write(MemoryAddr addr, MemoryValue value) {
     LOG(ERROR) << fmt::format("Out of range write to MBC1: {:#04x}", addr);
 }
 
+void MBC1::read_block(MemoryAddr addr,
+                      MemoryValue *data,
+                      MemorySize size) const {
+    copy_block(addr, data, size, true);
+}
+
+void MBC1::peek_block(MemoryAddr addr,
+                      MemoryValue *data,
+                      MemorySize size) const {
+    copy_block(addr, data, size, false);
+}
+
+void MBC1::copy_block(MemoryAddr addr,
+                      MemoryValue *data,
+                      MemorySize size,
+                      bool log) const {
+    while (size > 0) {
+        MemorySize length = 1;
+        if (BETWEEN(ROM_0_BEGIN, addr, ROM_SWITCHABLE_END)) {
+            // Banks are contiguous in the ROM.
+            length = std::min<MemorySize>(
+                size, ROM_BANK_SIZE - addr % ROM_BANK_SIZE);
+            const uint32_t real_addr = translate_rom_address(addr);
+            std::memcpy(data, &rom_[real_addr], length);
+        } else if (BETWEEN(RAM_EXTERNAL_BEGIN, addr, RAM_EXTERNAL_END)) {
+            length = std::min<MemorySize>(size, RAM_EXTERNAL_END - addr + 1);
+            if (!ram_enabled_ || ram_size_ == 0) {
+                LOG_IF(INFO, log) << fmt::format(
+                    "RAM not enabled or empty, returning {} junk values",
+                    length);
+                std::fill_n(data, length, 0xff);
+            } else {
+                length = mapped_ram_.span(addr, length);
+                const uint32_t real_addr = mapped_ram_.translate(addr);
+                std::memcpy(data, &ram_[real_addr], length);
+            }
+        } else {
+            *data = log ? read(addr) : 0xff;
+        }
+
+        addr += length;
+        data += length;
+        size -= length;
+    }
+}
+
+void MBC1::write_block(MemoryAddr addr,
+                       const MemoryValue *data,
+                       MemorySize size) {
+    while (size > 0) {
+        MemorySize length = 1;
+        if (BETWEEN(RAM_EXTERNAL_BEGIN, addr, RAM_EXTERNAL_END)) {
+            length = std::min<MemorySize>(size, RAM_EXTERNAL_END - addr + 1);
+            if (!ram_enabled_ || ram_size_ == 0) {
+                LOG(ERROR) << fmt::format(
+                    "RAM not enabled or empty, ignoring write of {} bytes to "
+                    "addr {:#04x}",
+                    length, addr);
+            } else {
+                length = mapped_ram_.span(addr, length);
+                const uint32_t real_addr = mapped_ram_.translate(addr);
+                std::memcpy(&ram_[real_addr], data, length);
+            }
+        } else {
+            // The registers, in order.
+            write(addr, *data);
+        }
+
+        addr += length;
+        data += length;
+        size -= length;
+    }
+}
+
+const MemoryValue *MBC1::host_read_ptr(MemoryAddr addr) const {
+    if (BETWEEN(ROM_0_BEGIN, addr, ROM_SWITCHABLE_END)) {
+        return &rom_[translate_rom_address(addr)];
+    }
+
+    return const_cast<MBC1 *>(this)->host_write_ptr(addr);
+}
+
+MemoryValue *MBC1::host_write_ptr(MemoryAddr addr) {
+    if (!BETWEEN(RAM_EXTERNAL_BEGIN, addr, RAM_EXTERNAL_END)) {
+        return nullptr;
+    }
+
+    // Reads and writes to disabled or missing RAM have to be logged.
+    if (!ram_enabled_ || ram_size_ == 0 || (ram_size_ % PAGE_SIZE) != 0) {
+        return nullptr;
+    }
+
+    return &ram_[mapped_ram_.translate(addr)];
+}
+
 }  // namespace memory
@@ -3,6 +3,10 @@
 #include <fmt/format.h>
 #include <glog/logging.h>
 
+#include <algorithm>
+#include <cstring>
+
+#include "knocknock/memory/bank.h"
 #include "knocknock/memory/regions.h"
 
 namespace memory {
@@ -18,24 +22,28 @@ uint8_t low_nibble(uint8_t value) {
 }  // namespace
 
 MBC2::MBC2(std::vector<MemoryValue> rom)
-    : ram_enabled_(false), selected_bank_(1), rom_(std::move(rom)), ram_() {
+    : ram_enabled_(false),
+      selected_bank_(1),
+      rom_bases_(),
+      rom_(pad_to_banks(std::move(rom), ROM_BANK_SIZE)),
+      ram_() {
+    std::fill(std::begin(ram_), std::end(ram_), 0xf0);
+    update_banks();
+
     LOG_IF(ERROR, rom_.size() > MAX_ROM_SIZE)
         << fmt::format(FMT_STRING("ROM (size = {}) is bigger than the maximum "
                                   "addressable ROM size ({})"),
                        rom_.size(), MAX_ROM_SIZE);
 }
 
-MemoryValue MBC2::read(MemoryAddr addr) const {
-    if (BETWEEN(ROM_0_BEGIN, addr, ROM_0_END)) {
-        return rom_[addr];
-    }
-
-    if (BETWEEN(ROM_SWITCHABLE_BEGIN, addr, ROM_SWITCHABLE_END)) {
-        uint32_t real_addr =
-            (selected_bank_ * ROM_BANK_SIZE) + (addr - ROM_SWITCHABLE_BEGIN);
-        real_addr %= rom_.size();
+void MBC2::update_banks() {
+    const uint32_t rom_banks = rom_.size() / ROM_BANK_SIZE;
+    rom_bases_[1] = (selected_bank_ % rom_banks) * ROM_BANK_SIZE;
+}
 
-        return rom_[real_addr];
+MemoryValue MBC2::read(MemoryAddr addr) const {
+    if (BETWEEN(ROM_0_BEGIN, addr, ROM_SWITCHABLE_END)) {
+        return rom_[rom_bases_[addr / ROM_BANK_SIZE] + addr % ROM_BANK_SIZE];
     }
 
     if (BETWEEN(RAM_EXTERNAL_BEGIN, addr, RAM_EXTERNAL_END)) {
@@ -46,9 +54,7 @@ MemoryValue MBC2::read(MemoryAddr addr) const {
 
         MemoryAddr real_addr = (addr - RAM_EXTERNAL_BEGIN) % RAM_SIZE;
 
-        // BGB says to make the upper nibble 0xF.
-        // https://bgb.bircd.org/mbc2save.html
-        return (0xf0 | ram_[real_addr]);
+        return ram_[real_addr];
     }
 
     LOG(ERROR) << "Invalid read to MBC2, returning dummy value";
@@ -62,8 +68,12 @@ void MBC2::write(MemoryAddr addr, MemoryValue value) {
             if (selected_bank_ == 0) {
                 selected_bank_ = 1;
             }
+            update_banks();
+            notify_host_pages_changed(ROM_SWITCHABLE_BEGIN,
+                                      ROM_SWITCHABLE_END);
         } else {
             ram_enabled_ = ((value & 0x0f) == 0x0a);
+            notify_host_pages_changed(RAM_EXTERNAL_BEGIN, RAM_EXTERNAL_END);
         }
 
         return;
@@ -76,11 +86,105 @@ void MBC2::write(MemoryAddr addr, MemoryValue value) {
         }
 
         MemoryAddr real_addr = (addr - RAM_EXTERNAL_BEGIN) % RAM_SIZE;
-        ram_[real_addr] = low_nibble(value);
+        // BGB says to make the upper nibble 0xF.
+        // https://bgb.bircd.org/mbc2save.html
+        ram_[real_addr] = 0xf0 | low_nibble(value);
         return;
     }
 
     LOG(ERROR) << "Unknown write to MBC2, ignoring.";
 }
 
+void MBC2::read_block(MemoryAddr addr,
+                      MemoryValue *data,
+                      MemorySize size) const {
+    copy_block(addr, data, size, true);
+}
+
+void MBC2::peek_block(MemoryAddr addr,
+                      MemoryValue *data,
+                      MemorySize size) const {
+    copy_block(addr, data, size, false);
+}
+
+void MBC2::copy_block(MemoryAddr addr,
+                      MemoryValue *data,
+                      MemorySize size,
+                      bool log) const {
+    while (size > 0) {
+        MemorySize length = 1;
+        if (BETWEEN(ROM_0_BEGIN, addr, ROM_SWITCHABLE_END)) {
+            // Banks are contiguous in the ROM.
+            length = std::min<MemorySize>(
+                size, ROM_BANK_SIZE - addr % ROM_BANK_SIZE);
+            const uint32_t real_addr =
+                rom_bases_[addr / ROM_BANK_SIZE] + addr % ROM_BANK_SIZE;
+            std::memcpy(data, &rom_[real_addr], length);
+        } else if (BETWEEN(RAM_EXTERNAL_BEGIN, addr, RAM_EXTERNAL_END)) {
+            length = std::min<MemorySize>(size, RAM_EXTERNAL_END - addr + 1);
+            if (!ram_enabled_) {
+                LOG_IF(ERROR, log) << fmt::format(
+                    "Reading {} bytes from disabled RAM, returning dummy "
+                    "values",
+                    length);
+                std::fill_n(data, length, 0xff);
+            } else {
+                // The RAM is mirrored all over the external RAM area.
+                const MemoryAddr real_addr =
+                    (addr - RAM_EXTERNAL_BEGIN) % RAM_SIZE;
+                length = std::min<MemorySize>(length, RAM_SIZE - real_addr);
+                std::memcpy(data, &ram_[real_addr], length);
+            }
+        } else {
+            *data = log ? read(addr) : 0xff;
+        }
+
+        addr += length;
+        data += length;
+        size -= length;
+    }
+}
+
+void MBC2::write_block(MemoryAddr addr,
+                       const MemoryValue *data,
+                       MemorySize size) {
+    while (size > 0) {
+        MemorySize length = 1;
+        if (BETWEEN(RAM_EXTERNAL_BEGIN, addr, RAM_EXTERNAL_END)) {
+            length = std::min<MemorySize>(size, RAM_EXTERNAL_END - addr + 1);
+            if (!ram_enabled_) {
+                LOG(ERROR) << fmt::format(
+                    "Writing {} bytes to disabled RAM, ignoring", length);
+            } else {
+                // Only the lower nibble of each byte is stored.
+                for (MemorySize i = 0; i < length; ++i) {
+                    ram_[(addr + i - RAM_EXTERNAL_BEGIN) % RAM_SIZE] =
+                        0xf0 | low_nibble(data[i]);
+                }
+            }
+        } else {
+            // The registers, in order.
+            write(addr, *data);
+        }
+
+        addr += length;
+        data += length;
+        size -= length;
+    }
+}
+
+const MemoryValue *MBC2::host_read_ptr(MemoryAddr addr) const {
+    if (BETWEEN(ROM_0_BEGIN, addr, ROM_SWITCHABLE_END)) {
+        return &rom_[rom_bases_[addr / ROM_BANK_SIZE] + addr % ROM_BANK_SIZE];
+    }
+
+    // Writes are never published, since they have to discard the upper
+    // nibble.
+    if (BETWEEN(RAM_EXTERNAL_BEGIN, addr, RAM_EXTERNAL_END) && ram_enabled_) {
+        return &ram_[(addr - RAM_EXTERNAL_BEGIN) % RAM_SIZE];
+    }
+
+    return nullptr;
+}
+
 }  // namespace memory
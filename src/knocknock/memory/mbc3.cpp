@@ -0,0 +1,480 @@
+#include "knocknock/memory/mbc3.h"
+
+#include <fmt/format.h>
+#include <glog/logging.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <utility>
+
+#include "knocknock/memory/bank.h"
+#include "knocknock/memory/regions.h"
+
+namespace memory {
+
+namespace {
+
+constexpr MemoryAddr RAM_ENABLE_BEGIN = 0x0000;
+constexpr MemoryAddr RAM_ENABLE_END = 0x1fff;
+
+constexpr MemoryAddr ROM_BANK_BEGIN = 0x2000;
+constexpr MemoryAddr ROM_BANK_END = 0x3fff;
+
+constexpr MemoryAddr RAM_BANK_BEGIN = 0x4000;
+constexpr MemoryAddr RAM_BANK_END = 0x5fff;
+
+constexpr MemoryAddr LATCH_BEGIN = 0x6000;
+constexpr MemoryAddr LATCH_END = 0x7fff;
+
+// Clock registers, as selected through the RAM bank register.
+constexpr uint8_t RTC_SECONDS = 0x08;
+constexpr uint8_t RTC_MINUTES = 0x09;
+constexpr uint8_t RTC_HOURS = 0x0a;
+constexpr uint8_t RTC_DAYS_LOW = 0x0b;
+constexpr uint8_t RTC_DAYS_HIGH = 0x0c;
+
+constexpr uint8_t DAYS_HIGH_BIT = 1u << 0u;
+constexpr uint8_t HALT_BIT = 1u << 6u;
+constexpr uint8_t CARRY_BIT = 1u << 7u;
+
+// The day counter has 9 bits.
+constexpr uint32_t DAYS = 0x200;
+
+// M-cycles in an emulated second.
+constexpr uint64_t CYCLES_PER_SECOND = 1u << 20u;
+
+constexpr uint64_t MICROSECONDS_PER_SECOND = 1000000;
+
+// The clock in a save file: the 5 live then 5 latched registers, 4 bytes
+// little-endian each, and a 64-bit UNIX timestamp. Older saves only have a
+// 32-bit timestamp.
+constexpr size_t RTC_REGISTER_COUNT = 5;
+constexpr size_t RTC_SAVE_SIZE = 2 * RTC_REGISTER_COUNT * 4 + 8;
+constexpr size_t RTC_SAVE_SIZE_32 = 2 * RTC_REGISTER_COUNT * 4 + 4;
+
+uint64_t host_microseconds() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+               std::chrono::system_clock::now().time_since_epoch())
+        .count();
+}
+
+void append_le(std::vector<MemoryValue> *data, uint64_t value, size_t size) {
+    for (size_t i = 0; i < size; ++i) {
+        data->push_back(static_cast<MemoryValue>(value >> (8 * i)));
+    }
+}
+
+uint64_t parse_le(const MemoryValue *data, size_t size) {
+    uint64_t value = 0;
+    for (size_t i = 0; i < size; ++i) {
+        value |= static_cast<uint64_t>(data[i]) << (8 * i);
+    }
+
+    return value;
+}
+
+}  // namespace
+
+void MBC3::Clock::advance(uint64_t elapsed) {
+    uint64_t total = seconds + elapsed;
+    seconds = total % 60;
+    total = total / 60 + minutes;
+    minutes = total % 60;
+    total = total / 60 + hours;
+    hours = total % 24;
+    total = total / 24 + days;
+    if (total >= DAYS) {
+        carry = true;
+    }
+    days = total % DAYS;
+}
+
+MemoryValue MBC3::Clock::get(uint8_t reg) const {
+    switch (reg) {
+        case RTC_SECONDS: return seconds;
+        case RTC_MINUTES: return minutes;
+        case RTC_HOURS: return hours;
+        case RTC_DAYS_LOW: return days & 0xff;
+        case RTC_DAYS_HIGH:
+            return ((days >> 8) & DAYS_HIGH_BIT) | (halted ? HALT_BIT : 0) |
+                   (carry ? CARRY_BIT : 0);
+        default: DCHECK(false); return 0xff;
+    }
+}
+
+void MBC3::Clock::set(uint8_t reg, MemoryValue value) {
+    switch (reg) {
+        case RTC_SECONDS: seconds = value & 0x3f; break;
+        case RTC_MINUTES: minutes = value & 0x3f; break;
+        case RTC_HOURS: hours = value & 0x1f; break;
+        case RTC_DAYS_LOW: days = (days & 0x100) | value; break;
+        case RTC_DAYS_HIGH:
+            days = (days & 0xff) | ((value & DAYS_HIGH_BIT) << 8);
+            halted = (value & HALT_BIT) != 0;
+            carry = (value & CARRY_BIT) != 0;
+            break;
+        default: DCHECK(false); break;
+    }
+}
+
+MBC3::MBC3(std::vector<MemoryValue> rom,
+           MemorySize ram_size,
+           bool has_rtc,
+           const peripherals::Scheduler *scheduler)
+    : ram_enabled_(false),
+      rom_bank_(1),
+      ram_bank_(0),
+      rom_bases_(),
+      mapped_ram_(),
+      rom_(pad_to_banks(std::move(rom), ROM_BANK_SIZE)),
+      ram_(),
+      ram_size_(ram_size),
+      has_rtc_(has_rtc),
+      scheduler_(scheduler),
+      clock_source_(scheduler != nullptr ? ClockSource::EMULATED
+                                         : ClockSource::HOST),
+      clock_(),
+      latched_(),
+      clock_origin_(now()),
+      latch_armed_(false) {
+    LOG_IF(ERROR, rom_.size() > MAX_ROM_SIZE) << fmt::format(
+        "ROM (size = {}) is larger than the maximum addressable size ({})",
+        rom_.size(), MAX_ROM_SIZE);
+
+    check_ram_size(ram_size_, sizeof(ram_));
+
+    update_banks();
+}
+
+uint64_t MBC3::now() const {
+    if (clock_source_ == ClockSource::EMULATED) {
+        return scheduler_->now();
+    }
+
+    return host_microseconds();
+}
+
+uint64_t MBC3::ticks_per_second() const {
+    if (clock_source_ == ClockSource::EMULATED) {
+        return CYCLES_PER_SECOND;
+    }
+
+    return MICROSECONDS_PER_SECOND;
+}
+
+void MBC3::set_clock_source(ClockSource source) {
+    DCHECK(source == ClockSource::HOST || scheduler_ != nullptr)
+        << "Counting the emulated time requires a scheduler";
+
+    update_clock();
+    clock_source_ = source;
+    clock_origin_ = now();
+}
+
+void MBC3::update_clock() {
+    const uint64_t time = now();
+    if (time < clock_origin_) {
+        // The host clock went back: count from there.
+        clock_origin_ = time;
+        return;
+    }
+
+    const uint64_t elapsed = (time - clock_origin_) / ticks_per_second();
+    if (!clock_.halted) {
+        clock_.advance(elapsed);
+    }
+
+    // Keep the fraction of the current second.
+    clock_origin_ += elapsed * ticks_per_second();
+}
+
+void MBC3::update_banks() {
+    const uint32_t rom_banks = rom_.size() / ROM_BANK_SIZE;
+    rom_bases_[0] = 0;
+    rom_bases_[1] = (rom_bank_ % rom_banks) * ROM_BANK_SIZE;
+
+    mapped_ram_ = select_ram_bank(ram_size_, rtc_selected() ? 0 : ram_bank_);
+}
+
+MemoryValue MBC3::read(MemoryAddr addr) const {
+    if (BETWEEN(ROM_0_BEGIN, addr, ROM_SWITCHABLE_END)) {
+        return rom_[rom_bases_[addr / ROM_BANK_SIZE] + addr % ROM_BANK_SIZE];
+    }
+
+    if (BETWEEN(RAM_EXTERNAL_BEGIN, addr, RAM_EXTERNAL_END)) {
+        if (!ram_enabled_) {
+            LOG(INFO) << "RAM not enabled, returning junk value";
+            return 0xff;
+        }
+
+        if (rtc_selected()) {
+            if (!has_rtc_) {
+                LOG(ERROR) << "Reading from missing MBC3 clock, returning "
+                              "garbage";
+                return 0xff;
+            }
+
+            return latched_.get(ram_bank_);
+        }
+
+        if (ram_size_ == 0) {
+            LOG(ERROR) << "Reading from empty MBC3 RAM, returning garbage";
+            return 0xff;
+        }
+
+        return ram_[mapped_ram_.translate(addr)];
+    }
+
+    LOG(ERROR) << fmt::format(
+        "Out of range read to MBC3: {:#04x}, returning junk value", addr);
+    return 0xff;
+}
+
+void MBC3::write(MemoryAddr addr, MemoryValue value) {
+    // Enable / disable RAM and the clock registers.
+    // Command: XXXXSSSS
+    //   X: Don't care
+    //   S: 1010 (0xA) to enable the RAM, any other value to disable it.
+    if (BETWEEN(RAM_ENABLE_BEGIN, addr, RAM_ENABLE_END)) {
+        ram_enabled_ = ((value & 0x0f) == 0xAu);
+        notify_host_pages_changed(RAM_EXTERNAL_BEGIN, RAM_EXTERNAL_END);
+        return;
+    }
+
+    // ROM bank register. Only the lower 7 bits count.
+    if (BETWEEN(ROM_BANK_BEGIN, addr, ROM_BANK_END)) {
+        rom_bank_ = value & 0b01111111u;
+        if (rom_bank_ == 0) {
+            rom_bank_ = 1;
+        }
+        update_banks();
+        notify_host_pages_changed(ROM_SWITCHABLE_BEGIN, ROM_SWITCHABLE_END);
+        return;
+    }
+
+    // RAM bank (0x00 - 0x03) or clock register (0x08 - 0x0c) select.
+    if (BETWEEN(RAM_BANK_BEGIN, addr, RAM_BANK_END)) {
+        if (value > 0x03 && !BETWEEN(RTC_SECONDS, value, RTC_DAYS_HIGH)) {
+            LOG(ERROR) << fmt::format(
+                "Invalid MBC3 RAM bank {:#02x}, ignoring", value);
+            return;
+        }
+
+        ram_bank_ = value;
+        update_banks();
+        notify_host_pages_changed(RAM_EXTERNAL_BEGIN, RAM_EXTERNAL_END);
+        return;
+    }
+
+    // Latch the clock registers.
+    // Command: 0x00 then 0x01.
+    if (BETWEEN(LATCH_BEGIN, addr, LATCH_END)) {
+        if (value == 0x01 && latch_armed_ && has_rtc_) {
+            update_clock();
+            latched_ = clock_;
+        }
+
+        latch_armed_ = (value == 0x00);
+        return;
+    }
+
+    if (BETWEEN(RAM_EXTERNAL_BEGIN, addr, RAM_EXTERNAL_END)) {
+        if (!ram_enabled_) {
+            LOG(ERROR) << fmt::format(
+                "RAM not enabled, ignoring write to addr {:#04x}", addr);
+            return;
+        }
+
+        if (rtc_selected()) {
+            if (!has_rtc_) {
+                LOG(ERROR) << "Writing to missing MBC3 clock, ignoring";
+                return;
+            }
+
+            update_clock();
+            clock_.set(ram_bank_, value);
+            // Writing the seconds resets the fraction of the current second.
+            if (ram_bank_ == RTC_SECONDS) {
+                clock_origin_ = now();
+            }
+            return;
+        }
+
+        if (ram_size_ == 0) {
+            LOG(ERROR) << "Writing to empty MBC3 RAM, ignoring";
+            return;
+        }
+
+        ram_[mapped_ram_.translate(addr)] = value;
+        return;
+    }
+
+    LOG(ERROR) << fmt::format("Out of range write to MBC3: {:#04x}", addr);
+}
+
+void MBC3::read_block(MemoryAddr addr,
+                      MemoryValue *data,
+                      MemorySize size) const {
+    copy_block(addr, data, size, true);
+}
+
+void MBC3::peek_block(MemoryAddr addr,
+                      MemoryValue *data,
+                      MemorySize size) const {
+    copy_block(addr, data, size, false);
+}
+
+void MBC3::copy_block(MemoryAddr addr,
+                      MemoryValue *data,
+                      MemorySize size,
+                      bool log) const {
+    while (size > 0) {
+        MemorySize length = 1;
+        if (BETWEEN(ROM_0_BEGIN, addr, ROM_SWITCHABLE_END)) {
+            // Banks are contiguous in the ROM.
+            length = std::min<MemorySize>(
+                size, ROM_BANK_SIZE - addr % ROM_BANK_SIZE);
+            std::memcpy(data,
+                        &rom_[rom_bases_[addr / ROM_BANK_SIZE] +
+                              addr % ROM_BANK_SIZE],
+                        length);
+        } else if (BETWEEN(RAM_EXTERNAL_BEGIN, addr, RAM_EXTERNAL_END)) {
+            length = std::min<MemorySize>(size, RAM_EXTERNAL_END - addr + 1);
+            if (!ram_enabled_ || (rtc_selected() && !has_rtc_) ||
+                (!rtc_selected() && ram_size_ == 0)) {
+                LOG_IF(INFO, log) << fmt::format(
+                    "RAM not enabled or empty, returning {} junk values",
+                    length);
+                std::fill_n(data, length, 0xff);
+            } else if (rtc_selected()) {
+                // The register is mapped to the whole region.
+                std::fill_n(data, length, latched_.get(ram_bank_));
+            } else {
+                length = mapped_ram_.span(addr, length);
+                const uint32_t real_addr = mapped_ram_.translate(addr);
+                std::memcpy(data, &ram_[real_addr], length);
+            }
+        } else {
+            *data = log ? read(addr) : 0xff;
+        }
+
+        addr += length;
+        data += length;
+        size -= length;
+    }
+}
+
+void MBC3::write_block(MemoryAddr addr,
+                       const MemoryValue *data,
+                       MemorySize size) {
+    while (size > 0) {
+        MemorySize length = 1;
+        if (BETWEEN(RAM_EXTERNAL_BEGIN, addr, RAM_EXTERNAL_END) &&
+            ram_enabled_ && !rtc_selected() && ram_size_ != 0) {
+            length = mapped_ram_.span(addr, size);
+            const uint32_t real_addr = mapped_ram_.translate(addr);
+            std::memcpy(&ram_[real_addr], data, length);
+        } else {
+            // The registers and the clock, in order.
+            write(addr, *data);
+        }
+
+        addr += length;
+        data += length;
+        size -= length;
+    }
+}
+
+const MemoryValue *MBC3::host_read_ptr(MemoryAddr addr) const {
+    if (BETWEEN(ROM_0_BEGIN, addr, ROM_SWITCHABLE_END)) {
+        return &rom_[rom_bases_[addr / ROM_BANK_SIZE] + addr % ROM_BANK_SIZE];
+    }
+
+    return const_cast<MBC3 *>(this)->host_write_ptr(addr);
+}
+
+MemoryValue *MBC3::host_write_ptr(MemoryAddr addr) {
+    if (!BETWEEN(RAM_EXTERNAL_BEGIN, addr, RAM_EXTERNAL_END)) {
+        return nullptr;
+    }
+
+    // Reads and writes to disabled or missing RAM have to be logged, and the
+    // clock registers are not memory.
+    if (!ram_enabled_ || rtc_selected() || ram_size_ == 0 ||
+        (ram_size_ % PAGE_SIZE) != 0) {
+        return nullptr;
+    }
+
+    return &ram_[mapped_ram_.translate(addr)];
+}
+
+std::vector<MemoryValue> MBC3::save() const {
+    std::vector<MemoryValue> data(ram_, ram_ + ram_size_);
+    if (!has_rtc_) {
+        return data;
+    }
+
+    // The clock as of now, without moving its origin.
+    Clock clock = clock_;
+    const uint64_t time = now();
+    if (!clock.halted && time > clock_origin_) {
+        clock.advance((time - clock_origin_) / ticks_per_second());
+    }
+
+    for (const Clock *registers : {&std::as_const(clock), &latched_}) {
+        for (uint8_t reg = RTC_SECONDS; reg <= RTC_DAYS_HIGH; ++reg) {
+            append_le(&data, registers->get(reg), 4);
+        }
+    }
+    append_le(&data, host_microseconds() / MICROSECONDS_PER_SECOND, 8);
+
+    return data;
+}
+
+bool MBC3::load_save(const std::vector<MemoryValue> &data) {
+    // Saves without a clock, for example from an emulator which does not
+    // support it, only restore the RAM.
+    if (data.size() < ram_size_) {
+        LOG(ERROR) << fmt::format("MBC3 save too small ({} bytes), ignoring",
+                                  data.size());
+        return false;
+    }
+
+    const size_t footer = data.size() - ram_size_;
+    if (footer != 0 && (!has_rtc_ || (footer != RTC_SAVE_SIZE &&
+                                      footer != RTC_SAVE_SIZE_32))) {
+        LOG(ERROR) << fmt::format("Invalid MBC3 save of {} bytes, ignoring",
+                                  data.size());
+        return false;
+    }
+
+    std::copy_n(data.begin(), ram_size_, ram_);
+    notify_host_memory_written(ram_, ram_size_);
+    if (footer == 0) {
+        return true;
+    }
+
+    const MemoryValue *rtc = data.data() + ram_size_;
+    for (Clock *registers : {&clock_, &latched_}) {
+        for (uint8_t reg = RTC_SECONDS; reg <= RTC_DAYS_HIGH; ++reg) {
+            registers->set(reg, static_cast<MemoryValue>(parse_le(rtc, 4)));
+            rtc += 4;
+        }
+    }
+
+    clock_origin_ = now();
+
+    // The cartridge kept counting while the emulator was not running.
+    const uint64_t saved_at =
+        parse_le(rtc, footer - 2 * RTC_REGISTER_COUNT * 4);
+    const uint64_t host_now = host_microseconds() / MICROSECONDS_PER_SECOND;
+    if (clock_source_ == ClockSource::HOST && !clock_.halted &&
+        host_now > saved_at) {
+        clock_.advance(host_now - saved_at);
+    }
+
+    return true;
+}
+
+}  // namespace memory
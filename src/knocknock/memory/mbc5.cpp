@@ -0,0 +1,246 @@
+#include "knocknock/memory/mbc5.h"
+
+#include <fmt/format.h>
+#include <glog/logging.h>
+
+#include <algorithm>
+#include <cstring>
+
+#include "knocknock/memory/bank.h"
+#include "knocknock/memory/regions.h"
+
+namespace memory {
+
+namespace {
+
+constexpr MemoryAddr RAM_ENABLE_BEGIN = 0x0000;
+constexpr MemoryAddr RAM_ENABLE_END = 0x1fff;
+
+// Lower 8 bits of the ROM bank.
+constexpr MemoryAddr ROM_BANK_LOW_BEGIN = 0x2000;
+constexpr MemoryAddr ROM_BANK_LOW_END = 0x2fff;
+
+// Upper bit of the ROM bank.
+constexpr MemoryAddr ROM_BANK_HIGH_BEGIN = 0x3000;
+constexpr MemoryAddr ROM_BANK_HIGH_END = 0x3fff;
+
+constexpr MemoryAddr RAM_BANK_BEGIN = 0x4000;
+constexpr MemoryAddr RAM_BANK_END = 0x5fff;
+
+// Bit of the RAM bank register driving the motor of rumble cartridges.
+constexpr uint8_t RUMBLE_BIT = 1u << 3u;
+
+}  // namespace
+
+MBC5::MBC5(std::vector<MemoryValue> rom, MemorySize ram_size, bool has_rumble)
+    : ram_enabled_(false),
+      rom_bank_(1),
+      ram_bank_(0),
+      has_rumble_(has_rumble),
+      rumble_(false),
+      rom_bases_(),
+      mapped_ram_(),
+      rom_(pad_to_banks(std::move(rom), ROM_BANK_SIZE)),
+      ram_(ram_size),
+      ram_size_(ram_size) {
+    LOG_IF(ERROR, rom_.size() > MAX_ROM_SIZE) << fmt::format(
+        "ROM (size = {}) is larger than the maximum addressable size ({})",
+        rom_.size(), MAX_ROM_SIZE);
+
+    check_ram_size(ram_size_, MAX_RAM_SIZE);
+
+    update_banks();
+}
+
+void MBC5::update_banks() {
+    const uint32_t rom_banks = rom_.size() / ROM_BANK_SIZE;
+    rom_bases_[0] = 0;
+    rom_bases_[1] = (rom_bank_ % rom_banks) * ROM_BANK_SIZE;
+
+    mapped_ram_ = select_ram_bank(ram_size_, ram_bank_);
+}
+
+MemoryValue MBC5::read(MemoryAddr addr) const {
+    if (BETWEEN(ROM_0_BEGIN, addr, ROM_SWITCHABLE_END)) {
+        return rom_[translate_rom_address(addr)];
+    }
+
+    if (BETWEEN(RAM_EXTERNAL_BEGIN, addr, RAM_EXTERNAL_END)) {
+        if (!ram_enabled_) {
+            LOG(INFO) << "RAM not enabled, returning junk value";
+            return 0xff;
+        }
+
+        if (ram_size_ == 0) {
+            LOG(ERROR) << "Reading from empty MBC5 RAM, returning garbage";
+            return 0xff;
+        }
+
+        return ram_[mapped_ram_.translate(addr)];
+    }
+
+    LOG(ERROR) << fmt::format(
+        "Out of range read to MBC5: {:#04x}, returning junk value", addr);
+    return 0xff;
+}
+
+void MBC5::write(MemoryAddr addr, MemoryValue value) {
+    // Enable / disable RAM
+    // Command: XXXXSSSS
+    //   X: Don't care
+    //   S: 1010 (0xA) to enable the RAM, any other value to disable it.
+    if (BETWEEN(RAM_ENABLE_BEGIN, addr, RAM_ENABLE_END)) {
+        ram_enabled_ = ((value & 0x0f) == 0xAu);
+        notify_host_pages_changed(RAM_EXTERNAL_BEGIN, RAM_EXTERNAL_END);
+        return;
+    }
+
+    // Lower 8 bits of the ROM bank. Bank 0 is not remapped.
+    if (BETWEEN(ROM_BANK_LOW_BEGIN, addr, ROM_BANK_LOW_END)) {
+        rom_bank_ = (rom_bank_ & 0x100u) | value;
+        update_banks();
+        notify_host_pages_changed(ROM_SWITCHABLE_BEGIN, ROM_SWITCHABLE_END);
+        return;
+    }
+
+    // Upper bit of the ROM bank.
+    if (BETWEEN(ROM_BANK_HIGH_BEGIN, addr, ROM_BANK_HIGH_END)) {
+        rom_bank_ = (rom_bank_ & 0xffu) | ((value & 1u) << 8u);
+        update_banks();
+        notify_host_pages_changed(ROM_SWITCHABLE_BEGIN, ROM_SWITCHABLE_END);
+        return;
+    }
+
+    // RAM bank register. Only the lower 4 bits count, and on rumble
+    // cartridges bit 3 drives the motor instead.
+    if (BETWEEN(RAM_BANK_BEGIN, addr, RAM_BANK_END)) {
+        if (has_rumble_) {
+            rumble_ = (value & RUMBLE_BIT) != 0;
+            ram_bank_ = value & 0b00000111u;
+        } else {
+            ram_bank_ = value & 0b00001111u;
+        }
+        update_banks();
+        notify_host_pages_changed(RAM_EXTERNAL_BEGIN, RAM_EXTERNAL_END);
+        return;
+    }
+
+    if (BETWEEN(RAM_EXTERNAL_BEGIN, addr, RAM_EXTERNAL_END)) {
+        if (!ram_enabled_) {
+            LOG(ERROR) << fmt::format(
+                "RAM not enabled, ignoring write to addr {:#04x}", addr);
+            return;
+        }
+
+        if (ram_size_ == 0) {
+            LOG(ERROR) << "Writing to empty MBC5 RAM, ignoring";
+            return;
+        }
+
+        ram_[mapped_ram_.translate(addr)] = value;
+        return;
+    }
+
+    // 0x6000 - 0x7fff has no register on MBC5.
+    if (BETWEEN(ROM_0_BEGIN, addr, ROM_SWITCHABLE_END)) {
+        return;
+    }
+
+    LOG(ERROR) << fmt::format("Out of range write to MBC5: {:#04x}", addr);
+}
+
+void MBC5::read_block(MemoryAddr addr,
+                      MemoryValue *data,
+                      MemorySize size) const {
+    copy_block(addr, data, size, true);
+}
+
+void MBC5::peek_block(MemoryAddr addr,
+                      MemoryValue *data,
+                      MemorySize size) const {
+    copy_block(addr, data, size, false);
+}
+
+void MBC5::copy_block(MemoryAddr addr,
+                      MemoryValue *data,
+                      MemorySize size,
+                      bool log) const {
+    while (size > 0) {
+        MemorySize length = 1;
+        if (BETWEEN(ROM_0_BEGIN, addr, ROM_SWITCHABLE_END)) {
+            // Banks are contiguous in the ROM.
+            length = std::min<MemorySize>(
+                size, ROM_BANK_SIZE - addr % ROM_BANK_SIZE);
+            std::memcpy(data, &rom_[translate_rom_address(addr)], length);
+        } else if (BETWEEN(RAM_EXTERNAL_BEGIN, addr, RAM_EXTERNAL_END)) {
+            length = std::min<MemorySize>(size, RAM_EXTERNAL_END - addr + 1);
+            if (!ram_enabled_ || ram_size_ == 0) {
+                LOG_IF(INFO, log) << fmt::format(
+                    "RAM not enabled or empty, returning {} junk values",
+                    length);
+                std::fill_n(data, length, 0xff);
+            } else {
+                length = mapped_ram_.span(addr, length);
+                const uint32_t real_addr = mapped_ram_.translate(addr);
+                std::memcpy(data, &ram_[real_addr], length);
+            }
+        } else {
+            *data = log ? read(addr) : 0xff;
+        }
+
+        addr += length;
+        data += length;
+        size -= length;
+    }
+}
+
+void MBC5::write_block(MemoryAddr addr,
+                       const MemoryValue *data,
+                       MemorySize size) {
+    while (size > 0) {
+        MemorySize length = 1;
+        if (BETWEEN(RAM_EXTERNAL_BEGIN, addr, RAM_EXTERNAL_END)) {
+            length = std::min<MemorySize>(size, RAM_EXTERNAL_END - addr + 1);
+            if (!ram_enabled_ || ram_size_ == 0) {
+                LOG(ERROR) << fmt::format(
+                    "RAM not enabled or empty, ignoring write of {} bytes to "
+                    "addr {:#04x}",
+                    length, addr);
+            } else {
+                length = mapped_ram_.span(addr, length);
+                const uint32_t real_addr = mapped_ram_.translate(addr);
+                std::memcpy(&ram_[real_addr], data, length);
+            }
+        } else {
+            // The registers, in order.
+            write(addr, *data);
+        }
+
+        addr += length;
+        data += length;
+        size -= length;
+    }
+}
+
+const MemoryValue *MBC5::host_read_ptr(MemoryAddr addr) const {
+    if (BETWEEN(ROM_0_BEGIN, addr, ROM_SWITCHABLE_END)) {
+        return &rom_[translate_rom_address(addr)];
+    }
+
+    return const_cast<MBC5 *>(this)->host_write_ptr(addr);
+}
+
+MemoryValue *MBC5::host_write_ptr(MemoryAddr addr) {
+    if (!BETWEEN(RAM_EXTERNAL_BEGIN, addr, RAM_EXTERNAL_END)) {
+        return nullptr;
+    }
+
+    // Reads and writes to disabled or missing RAM have to be logged.
+    if (!ram_enabled_ || ram_size_ == 0 || (ram_size_ % PAGE_SIZE) != 0) {
+        return nullptr;
+    }
+
+    return &ram_[mapped_ram_.translate(addr)];
+}
+
+}  // namespace memory
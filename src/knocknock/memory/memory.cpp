@@ -22,6 +22,39 @@ void Memory::write16(MemoryAddr addr, uint16_t value) {
     write(addr + 1, value >> 8);  // MSB by discarding the last 8 bits
 }
 
+void Memory::read_block(MemoryAddr addr,
+                        MemoryValue *data,
+                        MemorySize size) const {
+    DCHECK(addr + size <= 0x10000) << "Block wraps around the address space";
+
+    for (MemorySize i = 0; i < size; ++i) {
+        data[i] = read(addr + i);
+    }
+}
+
+void Memory::write_block(MemoryAddr addr,
+                         const MemoryValue *data,
+                         MemorySize size) {
+    DCHECK(addr + size <= 0x10000) << "Block wraps around the address space";
+
+    for (MemorySize i = 0; i < size; ++i) {
+        write(addr + i, data[i]);
+    }
+}
+
+void Memory::notify_host_pages_changed(MemoryAddr start, MemoryAddr end) {
+    if (host_page_observer_ != nullptr) {
+        host_page_observer_->host_pages_changed(this, start, end);
+    }
+}
+
+void Memory::notify_host_memory_written(const MemoryValue *data,
+                                        MemorySize size) {
+    if (host_page_observer_ != nullptr) {
+        host_page_observer_->host_memory_written(data, size);
+    }
+}
+
 Memory::Proxy::Proxy(Memory *memory, MemoryAddr addr)
     : memory_(memory), addr_(addr) {
     DCHECK(memory);
@@ -3,14 +3,15 @@
 #include <fmt/format.h>
 #include <glog/logging.h>
 
+#include <algorithm>
+
 namespace memory {
 
-MMU::MMU() : regions_() {}
+MMU::MMU() : pages_(), host_pages_() {}
 
 bool MMU::has_overlapping_regions(MemoryAddr start, MemoryAddr end) const {
-    for (const MemoryRegion &region : regions_) {
-        if (BETWEEN(region.start(), start, region.end()) ||
-            BETWEEN(region.start(), end, region.end()))
+    for (uint32_t addr = start; addr <= end; ++addr) {
+        if (region_at(addr) != nullptr)
             return true;
     }
 
@@ -27,16 +28,86 @@ bool MMU::register_region(Memory *region, MemoryAddr start, MemoryAddr end) {
         return false;
     }
 
-    regions_.emplace_back(region, start, end);
+    for (uint32_t page_index = page_of(start); page_index <= page_of(end);
+         ++page_index) {
+        Page &page = pages_[page_index];
+        const uint32_t page_begin = page_index * PAGE_SIZE;
+        const uint32_t page_end = page_begin + PAGE_SIZE - 1;
+
+        // The region covers the entire page, and no other region has claimed
+        // a part of it.
+        if (start <= page_begin && page_end <= end && !page.sub_table) {
+            page.region = region;
+            continue;
+        }
+
+        // Otherwise the page has to be resolved per byte.
+        if (!page.sub_table) {
+            page.sub_table = std::make_unique<SubTable>();
+            page.sub_table->fill(nullptr);
+        }
+
+        for (uint32_t addr = std::max<uint32_t>(start, page_begin);
+             addr <= std::min<uint32_t>(end, page_end); ++addr) {
+            (*page.sub_table)[offset_in_page(addr)] = region;
+        }
+    }
+
+    region->set_host_page_observer(this);
+    refresh_host_pages(region, start, end);
+
     return true;
 }
 
-MemoryValue MMU::read(MemoryAddr addr) const {
-    for (const auto &region : regions_) {
-        if (BETWEEN(region.start(), addr, region.end())) {
-            return region.region()->read(addr);
+void MMU::host_pages_changed(Memory *region,
+                             MemoryAddr start,
+                             MemoryAddr end) {
+    refresh_host_pages(region, start, end);
+}
+
+void MMU::host_memory_written(const MemoryValue *data, MemorySize size) {
+    notify_host_memory_written(data, size);
+}
+
+void MMU::refresh_host_pages(Memory *region,
+                             MemoryAddr start,
+                             MemoryAddr end) {
+    for (uint32_t page_index = page_of(start); page_index <= page_of(end);
+         ++page_index) {
+        const uint32_t page_begin = page_index * PAGE_SIZE;
+        const uint32_t page_end = page_begin + PAGE_SIZE - 1;
+
+        // The high page is tracked per byte.
+        if (page_index == HIGH_PAGE) {
+            for (uint32_t addr = std::max<uint32_t>(start, page_begin);
+                 addr <= std::min<uint32_t>(end, page_end); ++addr) {
+                if (region_at(addr) == region) {
+                    host_pages_.set(addr, region->host_read_ptr(addr),
+                                    region->host_write_ptr(addr));
+                }
+            }
+            continue;
+        }
+
+        // Other pages only get host pointers when a single region handles
+        // the entire page.
+        if (pages_[page_index].region == region) {
+            host_pages_.set(page_begin, region->host_read_ptr(page_begin),
+                            region->host_write_ptr(page_begin));
         }
     }
+}
+
+MemoryValue MMU::read(MemoryAddr addr) const {
+    const MemoryValue *ptr = host_pages_.read_ptr(addr);
+    if (ptr != nullptr) {
+        return *ptr;
+    }
+
+    Memory *region = region_at(addr);
+    if (region != nullptr) {
+        return region->read(addr);
+    }
 
     LOG(ERROR) << fmt::format(
         "No matching region for addr {:#04x}, returning junk value", addr);
@@ -44,15 +115,123 @@ MemoryValue MMU::read(MemoryAddr addr) const {
 }
 
 void MMU::write(MemoryAddr addr, MemoryValue value) {
-    for (const auto &region : regions_) {
-        if (BETWEEN(region.start(), addr, region.end())) {
-            region.region()->write(addr, value);
-            return;
-        }
+    // Single writes are not reported to the observer: they come from the
+    // CPU, which invalidates what it derived from memory itself.
+    MemoryValue *ptr = host_pages_.write_ptr(addr);
+    if (ptr != nullptr) {
+        *ptr = value;
+        return;
+    }
+
+    Memory *region = region_at(addr);
+    if (region != nullptr) {
+        region->write(addr, value);
+        return;
     }
 
     LOG(ERROR) << fmt::format(
         "No matching region for addr {:#04x}, ignoring write", addr);
 }
 
+bool MMU::varies_between_events(MemoryAddr addr) const {
+    // Unmapped addresses always read as 0xff.
+    Memory *region = region_at(addr);
+    return region != nullptr && region->varies_between_events(addr);
+}
+
+template <typename Access>
+void MMU::for_each_run(MemoryAddr addr,
+                       MemorySize size,
+                       Access access) const {
+    DCHECK(addr + size <= 0x10000) << "Block wraps around the address space";
+
+    const uint32_t end = addr + size;
+    uint32_t start = addr;
+    while (start < end) {
+        Memory *region = region_at(start);
+
+        // Pages without a sub-table are handled by one region as a whole, so
+        // the run only has to be checked byte by byte in the others.
+        uint32_t next = start;
+        while (next < end && region_at(next) == region) {
+            if (!pages_[page_of(next)].sub_table) {
+                next = std::min<uint32_t>(end, (next | (PAGE_SIZE - 1)) + 1);
+            } else {
+                next++;
+            }
+        }
+
+        access(region, start, start - addr, next - start);
+        start = next;
+    }
+}
+
+void MMU::read_block(MemoryAddr addr,
+                     MemoryValue *data,
+                     MemorySize size) const {
+    for_each_run(addr, size,
+                 [&](Memory *region, MemoryAddr start, MemorySize offset,
+                     MemorySize length) {
+                     if (region != nullptr) {
+                         region->read_block(start, data + offset, length);
+                         return;
+                     }
+
+                     LOG(ERROR) << fmt::format(
+                         "No matching region for {} bytes at {:#04x}, "
+                         "returning junk values",
+                         length, start);
+                     std::fill_n(data + offset, length, 0xff);
+                 });
+}
+
+void MMU::write_block(MemoryAddr addr,
+                      const MemoryValue *data,
+                      MemorySize size) {
+    for_each_run(addr, size,
+                 [&](Memory *region, MemoryAddr start, MemorySize offset,
+                     MemorySize length) {
+                     if (region != nullptr) {
+                         region->write_block(start, data + offset, length);
+                         return;
+                     }
+
+                     LOG(ERROR) << fmt::format(
+                         "No matching region for {} bytes at {:#04x}, "
+                         "ignoring write",
+                         length, start);
+                 });
+    notify_written(addr, size);
+}
+
+void MMU::notify_written(MemoryAddr addr, MemorySize size) {
+    // Pages are contiguous in host memory, but the high page only per byte.
+    const uint32_t end = addr + size;
+    for (uint32_t start = addr; start < end;) {
+        const uint32_t next =
+            page_of(start) == HIGH_PAGE
+                ? start + 1
+                : std::min<uint32_t>(end, (start | (PAGE_SIZE - 1)) + 1);
+        const MemoryValue *ptr = host_pages_.read_ptr(start);
+        if (ptr != nullptr) {
+            notify_host_memory_written(ptr, next - start);
+        }
+        start = next;
+    }
+}
+
+void MMU::peek_block(MemoryAddr addr,
+                     MemoryValue *data,
+                     MemorySize size) const {
+    for_each_run(addr, size,
+                 [&](Memory *region, MemoryAddr start, MemorySize offset,
+                     MemorySize length) {
+                     if (region != nullptr) {
+                         region->peek_block(start, data + offset, length);
+                     } else {
+                         std::fill_n(data + offset, length, 0xff);
+                     }
+                 });
+}
+
 }  // namespace memory
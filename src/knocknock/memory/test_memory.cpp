@@ -1,5 +1,9 @@
 #include "knocknock/memory/test_memory.h"
 
+#include <cstring>
+
+#include <glog/logging.h>
+
 namespace memory {
 
 TestMemory::TestMemory() : memory_() {}
@@ -12,4 +16,18 @@ void TestMemory::write(MemoryAddr addr, MemoryValue value) {
     memory_[addr] = value;
 }
 
+void TestMemory::read_block(MemoryAddr addr,
+                            MemoryValue *data,
+                            MemorySize size) const {
+    DCHECK(addr + size <= sizeof(memory_));
+    std::memcpy(data, &memory_[addr], size);
+}
+
+void TestMemory::write_block(MemoryAddr addr,
+                             const MemoryValue *data,
+                             MemorySize size) {
+    DCHECK(addr + size <= sizeof(memory_));
+    std::memcpy(&memory_[addr], data, size);
+}
+
 }  // namespace memory
@@ -13,15 +13,35 @@ Clock::Clock(uint64_t in_frequency, uint64_t out_frequency)
 }
 
 void Clock::add_output(Tickable *output) {
-    outputs_.push_back(output);
+    outputs_.push_back({output, 0});
 }
 
 void Clock::tick() {
     for (uint64_t i = 0; i < (out_frequency_ / in_frequency_); ++i) {
-        for (Tickable *observer : outputs_) {
-            observer->tick();
+        for (Output &output : outputs_) {
+            if (output.ahead > 0) {
+                output.ahead--;
+            } else {
+                output.tickable->tick();
+            }
         }
     }
 }
 
+uint32_t Clock::run(uint32_t ticks) {
+    const uint32_t out_ticks = ticks * (out_frequency_ / in_frequency_);
+
+    for (Output &output : outputs_) {
+        if (output.ahead >= out_ticks) {
+            output.ahead -= out_ticks;
+            continue;
+        }
+
+        const uint32_t budget = out_ticks - output.ahead;
+        output.ahead = output.tickable->run(budget) - budget;
+    }
+
+    return ticks;
+}
+
 }  // namespace peripherals
@@ -0,0 +1,101 @@
+#include "knocknock/peripherals/scheduler.h"
+
+#include <algorithm>
+
+#include <glog/logging.h>
+
+namespace peripherals {
+
+Scheduler::Scheduler(Tickable *cpu)
+    : cpu_(cpu),
+      now_(0),
+      elapsed_(0),
+      next_sequence_(0),
+      in_slice_(false),
+      slice_end_(0),
+      events_() {
+    DCHECK(cpu_ != nullptr) << "Scheduler needs a CPU to run between events";
+}
+
+void Scheduler::schedule(Tickable *component, Timestamp delay) {
+    // There are only a handful of components, so finding their event by a
+    // linear scan is cheaper than indexing them.
+    cancel(component);
+
+    const Timestamp time = now_ + delay;
+    events_.push_back({time, next_sequence_++, component});
+    std::push_heap(events_.begin(), events_.end(), later);
+
+    // The CPU returns after the cycle of the event, for it to run on time.
+    if (in_slice_) {
+        slice_end_ = std::min(slice_end_, time + 1);
+    }
+}
+
+void Scheduler::cancel(Tickable *component) {
+    auto it = std::find_if(
+        events_.begin(), events_.end(),
+        [component](const Event &event) { return event.component == component; });
+    if (it == events_.end()) {
+        return;
+    }
+
+    events_.erase(it);
+    std::make_heap(events_.begin(), events_.end(), later);
+}
+
+bool Scheduler::scheduled(const Tickable *component) const {
+    return std::any_of(
+        events_.begin(), events_.end(),
+        [component](const Event &event) { return event.component == component; });
+}
+
+void Scheduler::tick() {
+    run(1);
+}
+
+uint32_t Scheduler::run(uint32_t ticks) {
+    const Timestamp start = elapsed_;
+    const Timestamp end = elapsed_ + ticks;
+
+    while (elapsed_ < end) {
+        // Run the CPU up to and including the cycle of the next event.
+        Timestamp until = end;
+        if (!events_.empty()) {
+            until = std::min(until,
+                             std::max(events_.front().time + 1, elapsed_ + 1));
+        }
+
+        if (cpu_->idle()) {
+            // Nothing happens until the next event, which may wake the CPU.
+            elapsed_ = until;
+        } else {
+            until = std::min(until, elapsed_ + MAX_SLICE);
+            in_slice_ = true;
+            slice_end_ = until;
+            elapsed_ += cpu_->run(until - elapsed_);
+            in_slice_ = false;
+        }
+        run_due_events();
+    }
+
+    return elapsed_ - start;
+}
+
+void Scheduler::run_due_events() {
+    // A component may schedule itself again while being ticked, and the CPU
+    // may have run past its next event, so the heap is checked again after
+    // every event.
+    while (!events_.empty() && events_.front().time < elapsed_) {
+        std::pop_heap(events_.begin(), events_.end(), later);
+        const Event event = events_.back();
+        events_.pop_back();
+
+        now_ = event.time;
+        event.component->tick();
+    }
+
+    now_ = elapsed_;
+}
+
+}  // namespace peripherals
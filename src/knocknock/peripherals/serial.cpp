@@ -17,8 +17,9 @@ uint8_t MSB(uint8_t value) {
 
 }  // namespace
 
-Serial::Serial()
+Serial::Serial(Scheduler *scheduler)
     : memory::Memory(),
+      scheduler_(scheduler),
       is_in_session_(false),
       data_(),
       control_(),
@@ -93,6 +94,11 @@ void Serial::begin_session() {
     current_out_byte_ = 0;
 
     remaining_bits_ = 8;
+
+    // The first bit is shifted in the cycle of the write to SC.
+    if (scheduler_ != nullptr) {
+        scheduler_->schedule(this, 0);
+    }
 }
 
 void Serial::end_session() {
@@ -121,6 +127,8 @@ void Serial::tick() {
 
     if (remaining_bits_ == 0) {
         end_session();
+    } else if (scheduler_ != nullptr) {
+        scheduler_->schedule(this, 1);
     }
 }
 
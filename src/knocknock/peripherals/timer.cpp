@@ -0,0 +1,192 @@
+#include "knocknock/peripherals/timer.h"
+
+#include <algorithm>
+
+#include <glog/logging.h>
+
+namespace peripherals {
+
+namespace {
+
+constexpr memory::MemoryAddr DIV = 0xff04;
+constexpr memory::MemoryAddr TIMA = 0xff05;
+constexpr memory::MemoryAddr TMA = 0xff06;
+constexpr memory::MemoryAddr TAC = 0xff07;
+
+constexpr uint8_t TAC_ENABLE = 1u << 2u;
+constexpr uint8_t TAC_CLOCK_SELECT = 0x03;
+constexpr uint8_t TAC_USED_BITS = TAC_ENABLE | TAC_CLOCK_SELECT;
+
+// Period of TIMA in M-cycles for each clock select of TAC: 4096, 262144, 65536
+// and 16384 Hz. TIMA follows bit 9, 3, 5 and 7 of the divider in T-cycles.
+constexpr uint32_t PERIODS[] = {256, 4, 16, 64};
+
+// DIV is the upper byte of the divider in T-cycles.
+constexpr uint8_t DIV_SHIFT = 6;
+
+constexpr uint16_t TIMA_OVERFLOW = 0x100;
+
+}  // namespace
+
+Timer::Timer(interrupt::Interruptible *interrupts, Scheduler *scheduler)
+    : memory::Memory(),
+      interrupts_(interrupts),
+      scheduler_(scheduler),
+      ticks_(0),
+      divider_origin_(0),
+      tima_(0),
+      tima_time_(0),
+      tma_(0),
+      tac_(0),
+      reload_at_(NEVER) {
+    DCHECK(interrupts_ != nullptr) << "Timer needs to request interrupts";
+}
+
+memory::MemoryValue Timer::read(memory::MemoryAddr addr) const {
+    switch (addr) {
+        case DIV: return (divider_at(now()) >> DIV_SHIFT) & 0xff;
+        case TIMA: return tima_at(now()) & 0xff;
+        case TMA: return tma_;
+        case TAC: return ~TAC_USED_BITS | tac_;
+        default:
+            DCHECK(false) << "Invalid read from Timer.";
+            return 0xff;
+    }
+}
+
+void Timer::write(memory::MemoryAddr addr, memory::MemoryValue value) {
+    const Timestamp time = now();
+
+    switch (addr) {
+        case DIV: {
+            // Resetting the divider is a falling edge if the selected bit was
+            // set.
+            sync();
+            const bool was_high = edge_input_at(time);
+            divider_origin_ = time;
+            if (tima_ >= TIMA_OVERFLOW) {
+                // TIMA overflowed at the end of the last cycle, and its
+                // reload is already scheduled for this one.
+                break;
+            }
+            if (was_high) {
+                tima_++;
+            }
+            schedule_reload();
+            break;
+        }
+        case TIMA:
+            // Writing TIMA in the cycle after an overflow cancels the reload.
+            tima_ = value;
+            tima_time_ = time;
+            schedule_reload();
+            break;
+        case TMA: tma_ = value; break;
+        case TAC: {
+            // Disabling the timer, or selecting a bit which is low, is a
+            // falling edge if the bit selected before was set.
+            sync();
+            const bool was_high = edge_input_at(time);
+            tac_ = value & TAC_USED_BITS;
+            if (tima_ >= TIMA_OVERFLOW) {
+                // The reload is already scheduled, as for DIV.
+                break;
+            }
+            if (was_high && !edge_input_at(time)) {
+                tima_++;
+            }
+            schedule_reload();
+            break;
+        }
+        default: DCHECK(false) << "Invalid write to Timer."; break;
+    }
+}
+
+void Timer::tick() {
+    const Timestamp time = now();
+    if (scheduler_ == nullptr) {
+        ticks_++;
+        if (time != reload_at_) {
+            return;
+        }
+    }
+    DCHECK_EQ(time, reload_at_) << "Timer ticked off its reload";
+
+    tima_ = tma_;
+    tima_time_ = time + 1;
+    interrupts_->interrupt(interrupt::InterruptType::TIMER);
+
+    schedule_reload();
+}
+
+void Timer::register_to_mmu(memory::MMU *mmu) {
+    mmu->register_region(this, DIV, TAC);
+}
+
+Timer::Timestamp Timer::now() const {
+    return scheduler_ != nullptr ? scheduler_->now() : ticks_;
+}
+
+Timer::Timestamp Timer::divider_at(Timestamp time) const {
+    DCHECK_GE(time, divider_origin_);
+    return time - divider_origin_;
+}
+
+uint16_t Timer::tima_at(Timestamp time) const {
+    if ((tac_ & TAC_ENABLE) == 0 || time <= tima_time_) {
+        return tima_;
+    }
+
+    // One increment per multiple of the period the divider went through.
+    const uint32_t period = PERIODS[tac_ & TAC_CLOCK_SELECT];
+    const Timestamp increments =
+        divider_at(time) / period - divider_at(tima_time_) / period;
+    DCHECK_LE(tima_ + increments, TIMA_OVERFLOW)
+        << "TIMA read past its reload";
+
+    return tima_ + increments;
+}
+
+bool Timer::edge_input_at(Timestamp time) const {
+    if ((tac_ & TAC_ENABLE) == 0) {
+        return false;
+    }
+
+    const uint32_t period = PERIODS[tac_ & TAC_CLOCK_SELECT];
+    return divider_at(time) % period >= period / 2;
+}
+
+void Timer::sync() {
+    const Timestamp time = now();
+    tima_ = tima_at(time);
+    tima_time_ = std::max(tima_time_, time);
+}
+
+void Timer::schedule_reload() {
+    if (tima_ >= TIMA_OVERFLOW) {
+        // Overflowed during |tima_time_|, reloaded at the end of the next
+        // cycle.
+        reload_at_ = tima_time_ + 1;
+    } else if ((tac_ & TAC_ENABLE) == 0) {
+        reload_at_ = NEVER;
+    } else {
+        // The overflow happens at the end of the cycle before the divider
+        // reaches the multiple of the period, and the reload a cycle later.
+        const uint32_t period = PERIODS[tac_ & TAC_CLOCK_SELECT];
+        const Timestamp multiple =
+            divider_at(tima_time_) / period + (TIMA_OVERFLOW - tima_);
+        reload_at_ = divider_origin_ + multiple * period;
+    }
+
+    if (scheduler_ == nullptr) {
+        return;
+    }
+
+    if (reload_at_ == NEVER) {
+        scheduler_->cancel(this);
+    } else {
+        scheduler_->schedule(this, reload_at_ - now());
+    }
+}
+
+}  // namespace peripherals
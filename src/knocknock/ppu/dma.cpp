@@ -1,7 +1,12 @@
 #include "knocknock/ppu/dma.h"
 
+#include <algorithm>
+
 #include <glog/logging.h>
 
+#include "knocknock/memory/host_page_table.h"
+#include "knocknock/ppu/ppu.h"
+
 namespace ppu {
 
 namespace {
@@ -12,13 +17,26 @@ constexpr uint8_t OAM_SIZE = 0xa0;
 
 }  // namespace
 
-DMA::DMA(memory::Memory *memory)
-    : memory_(memory), transferring_(false), source_addr_(), current_byte_() {}
+DMA::DMA(memory::Memory *memory, peripherals::Scheduler *scheduler)
+    : memory_(memory),
+      scheduler_(scheduler),
+      transferring_(false),
+      source_addr_(),
+      current_byte_(),
+      bulk_transfers_(false),
+      ppu_(nullptr),
+      bulk_copied_(false) {}
 
 void DMA::register_to_mmu(memory::MMU *mmu) {
     mmu->register_region(this, DMA_ADDR, DMA_ADDR);
 }
 
+void DMA::set_bulk_transfers(bool enabled, PPU *ppu) {
+    DCHECK(!enabled || ppu != nullptr) << "Bulk transfers need the PPU";
+    bulk_transfers_ = enabled;
+    ppu_ = ppu;
+}
+
 memory::MemoryValue DMA::read(memory::MemoryAddr addr) const {
     if (addr != DMA_ADDR) {
         DCHECK(false) << "Invalid read to DMA, returning dummy";
@@ -30,7 +48,7 @@ memory::MemoryValue DMA::read(memory::MemoryAddr addr) const {
         return 0xff;
     }
 
-    return source_addr_;
+    return source_addr_ >> 8;
 }
 
 void DMA::write(memory::MemoryAddr addr, memory::MemoryValue value) {
@@ -49,6 +67,12 @@ void DMA::write(memory::MemoryAddr addr, memory::MemoryValue value) {
     // Value written is the upper byte of the source address.
     source_addr_ = static_cast<uint16_t>(value) << 8;
     current_byte_ = 0;
+    bulk_copied_ = false;
+
+    // The first byte is copied in the cycle of the write.
+    if (scheduler_ != nullptr) {
+        scheduler_->schedule(this, 0);
+    }
 }
 
 void DMA::tick() {
@@ -56,12 +80,51 @@ void DMA::tick() {
         return;
     }
 
-    memory_->write(OAM_BEGIN + current_byte_,
-                   memory_->read(source_addr_ + current_byte_));
+    if (current_byte_ == 0 && bulk_transfers_) {
+        bulk_copied_ = copy_transfer();
+    }
+
+    if (!bulk_copied_) {
+        memory_->write(OAM_BEGIN + current_byte_,
+                       memory_->read(source_addr_ + current_byte_));
+    }
     current_byte_++;
+
     if (current_byte_ == OAM_SIZE) {
         transferring_ = false;
+    } else if (scheduler_ != nullptr) {
+        if (bulk_copied_) {
+            // Nothing is left to copy, only the end of the transfer.
+            scheduler_->schedule(this, OAM_SIZE - current_byte_);
+            current_byte_ = OAM_SIZE - 1;
+        } else {
+            scheduler_->schedule(this, 1);
+        }
     }
 }
 
+bool DMA::copy_transfer() {
+    // The PPU must not see OAM half copied.
+    if (!ppu_->oam_unread_for(OAM_SIZE)) {
+        return false;
+    }
+
+    // The source starts on a page boundary, so the host pointer of its first
+    // byte covers the whole transfer. The high page is only tracked per byte.
+    if (source_addr_ >= 0xff00) {
+        return false;
+    }
+
+    const memory::HostPageTable *pages = memory_->host_page_table();
+    const memory::MemoryValue *source =
+        pages != nullptr ? pages->read_ptr(source_addr_)
+                         : memory_->host_read_ptr(source_addr_);
+    if (source == nullptr) {
+        return false;
+    }
+
+    std::copy_n(source, OAM_SIZE, ppu_->oam());
+    return true;
+}
+
 }  // namespace ppu
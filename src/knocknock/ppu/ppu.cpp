@@ -0,0 +1,520 @@
+#include "knocknock/ppu/ppu.h"
+
+#include <algorithm>
+
+#include <glog/logging.h>
+
+#include "knocknock/ppu/tile.h"
+
+namespace ppu {
+
+namespace {
+
+constexpr memory::MemoryAddr LCDC = 0xff40;
+constexpr memory::MemoryAddr STAT = 0xff41;
+constexpr memory::MemoryAddr SCY = 0xff42;
+constexpr memory::MemoryAddr SCX = 0xff43;
+constexpr memory::MemoryAddr LY = 0xff44;
+constexpr memory::MemoryAddr LYC = 0xff45;
+constexpr memory::MemoryAddr BGP = 0xff47;
+constexpr memory::MemoryAddr OBP0 = 0xff48;
+constexpr memory::MemoryAddr OBP1 = 0xff49;
+constexpr memory::MemoryAddr WY = 0xff4a;
+constexpr memory::MemoryAddr WX = 0xff4b;
+
+// Bits of LCDC.
+constexpr uint8_t LCDC_BG_WINDOW_ENABLE = 1u << 0u;
+constexpr uint8_t LCDC_OBJ_ENABLE = 1u << 1u;
+constexpr uint8_t LCDC_OBJ_SIZE = 1u << 2u;
+constexpr uint8_t LCDC_BG_MAP = 1u << 3u;
+constexpr uint8_t LCDC_TILE_DATA = 1u << 4u;
+constexpr uint8_t LCDC_WINDOW_ENABLE = 1u << 5u;
+constexpr uint8_t LCDC_WINDOW_MAP = 1u << 6u;
+constexpr uint8_t LCDC_LCD_ENABLE = 1u << 7u;
+
+// Bits of STAT. Only the interrupt sources are writable, and the highest bit
+// always reads high.
+constexpr uint8_t STAT_COINCIDENCE = 1u << 2u;
+constexpr uint8_t STAT_HBLANK_SOURCE = 1u << 3u;
+constexpr uint8_t STAT_VBLANK_SOURCE = 1u << 4u;
+constexpr uint8_t STAT_OAM_SCAN_SOURCE = 1u << 5u;
+constexpr uint8_t STAT_COINCIDENCE_SOURCE = 1u << 6u;
+constexpr uint8_t STAT_WRITABLE_BITS = 0x78;
+constexpr uint8_t STAT_UNUSED_BITS = 0x80;
+
+// Timing of a frame, in M-cycles. The pixel transfer is taken to always last
+// as long as with no scrolling, window or sprites.
+constexpr uint32_t LINE_CYCLES = 114;
+constexpr uint32_t FRAME_LINES = 154;
+constexpr uint32_t FRAME_CYCLES = LINE_CYCLES * FRAME_LINES;
+constexpr uint32_t OAM_SCAN_CYCLES = 20;
+constexpr uint32_t PIXEL_TRANSFER_CYCLES = 43;
+constexpr uint32_t HBLANK_START = OAM_SCAN_CYCLES + PIXEL_TRANSFER_CYCLES;
+
+// Bits of the attributes of a sprite.
+constexpr uint8_t SPRITE_BEHIND_BG = 1u << 7u;
+constexpr uint8_t SPRITE_Y_FLIP = 1u << 6u;
+constexpr uint8_t SPRITE_X_FLIP = 1u << 5u;
+constexpr uint8_t SPRITE_PALETTE = 1u << 4u;
+
+// Offsets in VRAM of the two tile maps, of 32x32 tiles each.
+constexpr size_t TILE_MAP_0 = 0x1800;
+constexpr size_t TILE_MAP_1 = 0x1c00;
+constexpr size_t TILE_MAP_WIDTH = 32;
+
+// Tiles of the background spanning a line: one more than fits the screen, as
+// the background may not be aligned on a tile.
+constexpr size_t MAX_TILES_PER_LINE = SCREEN_WIDTH / TILE_WIDTH + 1;
+
+constexpr size_t SPRITE_COUNT = memory::OAM_SIZE / 4;
+constexpr size_t MAX_SPRITES_PER_LINE = 10;
+
+// The position of a sprite in OAM is offset so that it can be placed fully
+// off screen, up and left; WX is offset the same way.
+constexpr int SPRITE_Y_OFFSET = 16;
+constexpr int SPRITE_X_OFFSET = 8;
+constexpr int WINDOW_X_OFFSET = 7;
+
+uint8_t apply_palette(uint8_t palette, uint8_t index) {
+    return (palette >> (index * 2u)) & 0x03u;
+}
+
+}  // namespace
+
+PPU::PPU(interrupt::Interruptible *interrupts,
+         peripherals::Scheduler *scheduler)
+    : memory::Memory(),
+      vram_(),
+      tile_cache_(vram_.data()),
+      oam_(),
+      interrupts_(interrupts),
+      scheduler_(scheduler),
+      ticks_(0),
+      frame_origin_(0),
+      next_event_(NEVER),
+      lcdc_(0x91),
+      stat_(0),
+      scy_(0),
+      scx_(0),
+      lyc_(0),
+      bgp_(0xfc),
+      obp0_(0),
+      obp1_(0),
+      wy_(0),
+      wx_(0),
+      window_line_(0),
+      framebuffer_(),
+      frame_skip_interval_(1),
+      render_on_demand_(false),
+      frame_requested_(false),
+      skip_counter_(0),
+      rendering_frame_(true),
+      frames_(0),
+      rendered_frames_(0) {
+    DCHECK(interrupts_ != nullptr) << "PPU needs to request interrupts";
+
+    // The LCD is enabled, and starts its first frame.
+    frame_origin_ = now();
+    schedule_next_event(frame_origin_);
+}
+
+void PPU::register_to_mmu(memory::MMU *mmu) {
+    mmu->register_region(this, memory::VRAM_BEGIN, memory::VRAM_END);
+    mmu->register_region(this, memory::OAM_BEGIN, memory::OAM_END);
+    mmu->register_region(this, LCDC, LYC);
+    mmu->register_region(this, BGP, WX);
+}
+
+memory::MemoryValue PPU::read(memory::MemoryAddr addr) const {
+    if (BETWEEN(memory::VRAM_BEGIN, addr, memory::VRAM_END)) {
+        return vram_[addr - memory::VRAM_BEGIN];
+    }
+
+    if (BETWEEN(memory::OAM_BEGIN, addr, memory::OAM_END)) {
+        return oam_[addr - memory::OAM_BEGIN];
+    }
+
+    switch (addr) {
+        case LCDC: return lcdc_;
+        case STAT: {
+            const Timestamp time = now();
+            uint8_t value =
+                STAT_UNUSED_BITS | stat_ | static_cast<uint8_t>(mode_at(time));
+            if (ly_at(time) == lyc_) {
+                value |= STAT_COINCIDENCE;
+            }
+            return value;
+        }
+        case SCY: return scy_;
+        case SCX: return scx_;
+        case LY: return ly_at(now());
+        case LYC: return lyc_;
+        case BGP: return bgp_;
+        case OBP0: return obp0_;
+        case OBP1: return obp1_;
+        case WY: return wy_;
+        case WX: return wx_;
+        default:
+            DCHECK(false) << "Invalid read from PPU.";
+            return 0xff;
+    }
+}
+
+void PPU::write(memory::MemoryAddr addr, memory::MemoryValue value) {
+    if (BETWEEN(memory::VRAM_BEGIN, addr, memory::VRAM_END)) {
+        vram_[addr - memory::VRAM_BEGIN] = value;
+        tile_cache_.invalidate(addr - memory::VRAM_BEGIN);
+        return;
+    }
+
+    if (BETWEEN(memory::OAM_BEGIN, addr, memory::OAM_END)) {
+        oam_[addr - memory::OAM_BEGIN] = value;
+        return;
+    }
+
+    const Timestamp time = now();
+    const bool stat_line = stat_line_at(time);
+
+    switch (addr) {
+        case LCDC: {
+            const bool was_enabled = lcd_enabled();
+            lcdc_ = value;
+            if (!was_enabled && lcd_enabled()) {
+                // A new frame starts in this cycle.
+                frame_origin_ = time;
+                schedule_next_event(time);
+            } else if (was_enabled && !lcd_enabled()) {
+                next_event_ = NEVER;
+                if (scheduler_ != nullptr) {
+                    scheduler_->cancel(this);
+                }
+            }
+            break;
+        }
+        case STAT: stat_ = value & STAT_WRITABLE_BITS; break;
+        case SCY: scy_ = value; break;
+        case SCX: scx_ = value; break;
+        case LY: break;  // Read only.
+        case LYC: lyc_ = value; break;
+        case BGP: bgp_ = value; break;
+        case OBP0: obp0_ = value; break;
+        case OBP1: obp1_ = value; break;
+        case WY: wy_ = value; break;
+        case WX: wx_ = value; break;
+        default: DCHECK(false) << "Invalid write to PPU."; break;
+    }
+
+    // Enabling a source which is active, or changing LYC to LY, is a rising
+    // edge too.
+    if (!stat_line && stat_line_at(time)) {
+        interrupts_->interrupt(interrupt::InterruptType::LCD_STATUS);
+    }
+}
+
+const memory::MemoryValue *PPU::host_read_ptr(memory::MemoryAddr addr) const {
+    // Writes to VRAM go through write(), to invalidate the tile cache.
+    if (BETWEEN(memory::VRAM_BEGIN, addr, memory::VRAM_END)) {
+        return &vram_[addr - memory::VRAM_BEGIN];
+    }
+
+    return nullptr;
+}
+
+bool PPU::varies_between_events(memory::MemoryAddr addr) const {
+    // LY and the mode in STAT only change on the cycles the PPU is scheduled
+    // for, and everything else when written.
+    return scheduler_ == nullptr && (addr == LY || addr == STAT);
+}
+
+void PPU::tick() {
+    const Timestamp time = now();
+    if (scheduler_ == nullptr) {
+        ticks_++;
+        if (time != next_event_) {
+            return;
+        }
+    }
+    DCHECK_EQ(time, next_event_) << "PPU ticked off its events";
+
+    const uint8_t line = ly_at(time);
+    const uint32_t cycle = frame_cycle_at(time) % LINE_CYCLES;
+    if (line == 0 && cycle == 0) {
+        // Whether to draw the frame is decided as it starts, so that frames
+        // are drawn whole.
+        if (render_on_demand_) {
+            rendering_frame_ = frame_requested_;
+            frame_requested_ = false;
+        } else {
+            rendering_frame_ = skip_counter_ % frame_skip_interval_ == 0;
+            skip_counter_++;
+        }
+    }
+    if (line < SCREEN_HEIGHT && cycle == HBLANK_START && rendering_frame_) {
+        render_line(line);
+    }
+    if (line == SCREEN_HEIGHT && cycle == 0) {
+        frames_++;
+        if (rendering_frame_) {
+            rendered_frames_++;
+        }
+        interrupts_->interrupt(interrupt::InterruptType::VBLANK);
+    }
+
+    // The sources of the interrupt only change on these ticks, apart from
+    // writes to STAT and LYC.
+    const bool was_high = time > frame_origin_ && stat_line_at(time - 1);
+    if (!was_high && stat_line_at(time)) {
+        interrupts_->interrupt(interrupt::InterruptType::LCD_STATUS);
+    }
+
+    schedule_next_event(time + 1);
+}
+
+void PPU::set_frame_skip(uint32_t interval) {
+    DCHECK_GT(interval, 0u) << "A frame skip interval can't be 0";
+    frame_skip_interval_ = interval;
+    skip_counter_ = 0;
+}
+
+bool PPU::oam_unread_for(uint32_t cycles) const {
+    if (!lcd_enabled()) {
+        return true;
+    }
+
+    // The next frame starts with the OAM scan of line 0.
+    const uint32_t frame_cycle = frame_cycle_at(now());
+    return frame_cycle >= SCREEN_HEIGHT * LINE_CYCLES &&
+           FRAME_CYCLES - frame_cycle >= cycles;
+}
+
+PPU::Timestamp PPU::now() const {
+    return scheduler_ != nullptr ? scheduler_->now() : ticks_;
+}
+
+bool PPU::lcd_enabled() const {
+    return (lcdc_ & LCDC_LCD_ENABLE) != 0;
+}
+
+uint32_t PPU::frame_cycle_at(Timestamp time) const {
+    DCHECK_GE(time, frame_origin_);
+    return (time - frame_origin_) % FRAME_CYCLES;
+}
+
+uint8_t PPU::ly_at(Timestamp time) const {
+    if (!lcd_enabled()) {
+        return 0;
+    }
+    return frame_cycle_at(time) / LINE_CYCLES;
+}
+
+PPU::Mode PPU::mode_at(Timestamp time) const {
+    if (!lcd_enabled()) {
+        return Mode::HBLANK;
+    }
+
+    const uint32_t frame_cycle = frame_cycle_at(time);
+    if (frame_cycle / LINE_CYCLES >= SCREEN_HEIGHT) {
+        return Mode::VBLANK;
+    }
+
+    const uint32_t cycle = frame_cycle % LINE_CYCLES;
+    if (cycle < OAM_SCAN_CYCLES) {
+        return Mode::OAM_SCAN;
+    }
+    if (cycle < HBLANK_START) {
+        return Mode::PIXEL_TRANSFER;
+    }
+    return Mode::HBLANK;
+}
+
+bool PPU::stat_line_at(Timestamp time) const {
+    if (!lcd_enabled()) {
+        return false;
+    }
+
+    if ((stat_ & STAT_COINCIDENCE_SOURCE) && ly_at(time) == lyc_) {
+        return true;
+    }
+
+    switch (mode_at(time)) {
+        case Mode::HBLANK: return stat_ & STAT_HBLANK_SOURCE;
+        case Mode::VBLANK: return stat_ & STAT_VBLANK_SOURCE;
+        case Mode::OAM_SCAN: return stat_ & STAT_OAM_SCAN_SOURCE;
+        case Mode::PIXEL_TRANSFER: return false;
+    }
+    return false;
+}
+
+void PPU::schedule_next_event(Timestamp time) {
+    // The first cycle from |time| on where a line, a pixel transfer or an
+    // HBlank starts.
+    const uint8_t line = ly_at(time);
+    const uint32_t cycle = frame_cycle_at(time) % LINE_CYCLES;
+
+    uint32_t next = LINE_CYCLES;
+    if (cycle == 0) {
+        next = 0;
+    } else if (line < SCREEN_HEIGHT && cycle <= OAM_SCAN_CYCLES) {
+        next = OAM_SCAN_CYCLES;
+    } else if (line < SCREEN_HEIGHT && cycle <= HBLANK_START) {
+        next = HBLANK_START;
+    }
+
+    next_event_ = time + (next - cycle);
+    if (scheduler_ != nullptr) {
+        scheduler_->schedule(this, next_event_ - now());
+    }
+}
+
+void PPU::render_line(uint8_t line) {
+    DCHECK_LT(line, SCREEN_HEIGHT);
+
+    if (line == 0) {
+        window_line_ = 0;
+    }
+
+    uint8_t *shades = &framebuffer_[line * SCREEN_WIDTH];
+    if ((lcdc_ & LCDC_LCD_ENABLE) == 0) {
+        std::fill_n(shades, SCREEN_WIDTH, 0);
+        return;
+    }
+
+    // Without the background and the window, the line is white.
+    tile_cache_.update();
+
+    LineIndices indices = {};
+    if (lcdc_ & LCDC_BG_WINDOW_ENABLE) {
+        render_background(line, &indices);
+        render_window(line, &indices);
+        for (size_t x = 0; x < SCREEN_WIDTH; ++x) {
+            shades[x] = apply_palette(bgp_, indices[x]);
+        }
+    } else {
+        std::fill_n(shades, SCREEN_WIDTH, 0);
+    }
+
+    if (lcdc_ & LCDC_OBJ_ENABLE) {
+        render_sprites(line, indices, shades);
+    }
+}
+
+void PPU::fetch_tiles(size_t map,
+                      uint8_t map_row,
+                      uint8_t first_column,
+                      uint8_t tile_row,
+                      size_t count,
+                      uint8_t *pixels) const {
+    DCHECK_LE(count, MAX_TILES_PER_LINE);
+
+    for (size_t i = 0; i < count; ++i) {
+        const size_t column = (first_column + i) % TILE_MAP_WIDTH;
+        const uint8_t index = vram_[map + map_row * TILE_MAP_WIDTH + column];
+        std::copy_n(tile_cache_.tile(background_tile(index)) +
+                        tile_row * TILE_WIDTH,
+                    TILE_WIDTH, pixels + i * TILE_WIDTH);
+    }
+}
+
+void PPU::render_background(uint8_t line, LineIndices *indices) const {
+    const uint8_t y = scy_ + line;
+    const size_t map = (lcdc_ & LCDC_BG_MAP) ? TILE_MAP_1 : TILE_MAP_0;
+
+    uint8_t pixels[MAX_TILES_PER_LINE * TILE_WIDTH];
+    fetch_tiles(map, y / TILE_WIDTH, scx_ / TILE_WIDTH, y % TILE_WIDTH,
+                MAX_TILES_PER_LINE, pixels);
+    std::copy_n(pixels + scx_ % TILE_WIDTH, SCREEN_WIDTH, indices->begin());
+}
+
+void PPU::render_window(uint8_t line, LineIndices *indices) {
+    const int left = static_cast<int>(wx_) - WINDOW_X_OFFSET;
+    if ((lcdc_ & LCDC_WINDOW_ENABLE) == 0 || line < wy_ ||
+        left >= static_cast<int>(SCREEN_WIDTH)) {
+        return;
+    }
+
+    // The window starts off screen when WX < 7.
+    const size_t skipped = left < 0 ? -left : 0;
+    const size_t start = left < 0 ? 0 : left;
+    const size_t width = SCREEN_WIDTH - start;
+    const size_t count = (skipped + width + TILE_WIDTH - 1) / TILE_WIDTH;
+    const size_t map = (lcdc_ & LCDC_WINDOW_MAP) ? TILE_MAP_1 : TILE_MAP_0;
+
+    uint8_t pixels[MAX_TILES_PER_LINE * TILE_WIDTH];
+    fetch_tiles(map, window_line_ / TILE_WIDTH, 0, window_line_ % TILE_WIDTH,
+                count, pixels);
+    std::copy_n(pixels + skipped, width, indices->begin() + start);
+
+    window_line_++;
+}
+
+void PPU::render_sprites(uint8_t line,
+                         const LineIndices &indices,
+                         uint8_t *shades) const {
+    const int height = (lcdc_ & LCDC_OBJ_SIZE) ? 16 : 8;
+
+    // Only the first sprites of OAM on the line are drawn.
+    std::array<Sprite, MAX_SPRITES_PER_LINE> sprites;
+    size_t count = 0;
+    for (size_t i = 0; i < SPRITE_COUNT && count < sprites.size(); ++i) {
+        const Sprite sprite = {oam_[i * 4], oam_[i * 4 + 1], oam_[i * 4 + 2],
+                               oam_[i * 4 + 3]};
+        const int top = sprite.y - SPRITE_Y_OFFSET;
+        if (top <= line && line < top + height) {
+            sprites[count++] = sprite;
+        }
+    }
+
+    // The sprite with the smallest X is on top, then the first one in OAM.
+    std::stable_sort(
+        sprites.begin(), sprites.begin() + count,
+        [](const Sprite &lhs, const Sprite &rhs) { return lhs.x < rhs.x; });
+
+    // Pixels covered by a sprite of higher priority, even when it is itself
+    // hidden by the background.
+    std::array<bool, SCREEN_WIDTH> covered = {};
+
+    for (size_t i = 0; i < count; ++i) {
+        const Sprite &sprite = sprites[i];
+
+        int row = line - (sprite.y - SPRITE_Y_OFFSET);
+        if (sprite.attributes & SPRITE_Y_FLIP) {
+            row = height - 1 - row;
+        }
+        // 8x16 sprites are made of an even tile and the next one.
+        const uint8_t tile = height == 16 ? sprite.tile & 0xfe : sprite.tile;
+
+        const uint8_t *pixels = tile_cache_.tile(tile) + row * TILE_WIDTH;
+
+        const uint8_t palette =
+            (sprite.attributes & SPRITE_PALETTE) ? obp1_ : obp0_;
+        for (size_t px = 0; px < TILE_WIDTH; ++px) {
+            const int x = sprite.x - SPRITE_X_OFFSET + static_cast<int>(px);
+            if (x < 0 || x >= static_cast<int>(SCREEN_WIDTH) || covered[x]) {
+                continue;
+            }
+
+            const uint8_t index = (sprite.attributes & SPRITE_X_FLIP)
+                                      ? pixels[TILE_WIDTH - 1 - px]
+                                      : pixels[px];
+            if (index == 0) {
+                continue;  // Transparent.
+            }
+
+            covered[x] = true;
+            if ((sprite.attributes & SPRITE_BEHIND_BG) && indices[x] != 0) {
+                continue;
+            }
+            shades[x] = apply_palette(palette, index);
+        }
+    }
+}
+
+size_t PPU::background_tile(uint8_t index) const {
+    // Tiles are either indexed from $8000, or signed from $9000.
+    if (lcdc_ & LCDC_TILE_DATA) {
+        return index;
+    }
+    return 256 + static_cast<int8_t>(index);
+}
+
+}  // namespace ppu
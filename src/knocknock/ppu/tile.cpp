@@ -0,0 +1,110 @@
+#include "knocknock/ppu/tile.h"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define KNOCKNOCK_TILE_SSE2 1
+#endif
+
+namespace ppu {
+
+namespace {
+
+// Repeat |byte| in every byte of a 64-bit lane.
+inline int64_t broadcast(uint8_t byte) {
+    return static_cast<int64_t>(byte * 0x0101010101010101ull);
+}
+
+}  // namespace
+
+void decode_tile_rows_scalar(const uint8_t *rows, size_t count,
+                             uint8_t *pixels) {
+    for (size_t row = 0; row < count; ++row) {
+        const uint8_t low = rows[row * 2];
+        const uint8_t high = rows[row * 2 + 1];
+        for (size_t x = 0; x < TILE_WIDTH; ++x) {
+            const unsigned bit = TILE_WIDTH - 1 - x;
+            pixels[row * TILE_WIDTH + x] =
+                ((low >> bit) & 1u) | (((high >> bit) & 1u) << 1u);
+        }
+    }
+}
+
+#if defined(__AVX2__)
+
+void decode_tile_rows(const uint8_t *rows, size_t count, uint8_t *pixels) {
+    // Each byte of a row is broadcast to the 8 bytes of a lane, and tested
+    // against the bit of its pixel: the leftmost pixel is the highest bit.
+    const __m256i bits = _mm256_set1_epi64x(0x0102040810204080ll);
+    const __m256i one = _mm256_set1_epi8(1);
+    const __m256i two = _mm256_set1_epi8(2);
+
+    size_t row = 0;
+    for (; row + 4 <= count; row += 4) {
+        const uint8_t *r = rows + row * 2;
+        const __m256i low = _mm256_set_epi64x(broadcast(r[6]), broadcast(r[4]),
+                                              broadcast(r[2]), broadcast(r[0]));
+        const __m256i high = _mm256_set_epi64x(
+            broadcast(r[7]), broadcast(r[5]), broadcast(r[3]), broadcast(r[1]));
+
+        const __m256i low_set =
+            _mm256_cmpeq_epi8(_mm256_and_si256(low, bits), bits);
+        const __m256i high_set =
+            _mm256_cmpeq_epi8(_mm256_and_si256(high, bits), bits);
+        const __m256i indices = _mm256_or_si256(_mm256_and_si256(low_set, one),
+                                                _mm256_and_si256(high_set, two));
+
+        _mm256_storeu_si256(
+            reinterpret_cast<__m256i *>(pixels + row * TILE_WIDTH), indices);
+    }
+
+    decode_tile_rows_scalar(rows + row * 2, count - row,
+                            pixels + row * TILE_WIDTH);
+}
+
+#elif defined(KNOCKNOCK_TILE_SSE2)
+
+void decode_tile_rows(const uint8_t *rows, size_t count, uint8_t *pixels) {
+    // Each byte of a row is broadcast to the 8 bytes of a lane, and tested
+    // against the bit of its pixel: the leftmost pixel is the highest bit.
+    const __m128i bits = _mm_set1_epi64x(0x0102040810204080ll);
+    const __m128i one = _mm_set1_epi8(1);
+    const __m128i two = _mm_set1_epi8(2);
+
+    auto decode = [&](__m128i low, __m128i high) {
+        const __m128i low_set = _mm_cmpeq_epi8(_mm_and_si128(low, bits), bits);
+        const __m128i high_set =
+            _mm_cmpeq_epi8(_mm_and_si128(high, bits), bits);
+        return _mm_or_si128(_mm_and_si128(low_set, one),
+                            _mm_and_si128(high_set, two));
+    };
+
+    size_t row = 0;
+    for (; row + 2 <= count; row += 2) {
+        const uint8_t *r = rows + row * 2;
+        const __m128i indices =
+            decode(_mm_set_epi64x(broadcast(r[2]), broadcast(r[0])),
+                   _mm_set_epi64x(broadcast(r[3]), broadcast(r[1])));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(pixels + row * TILE_WIDTH),
+                         indices);
+    }
+
+    if (row < count) {
+        const uint8_t *r = rows + row * 2;
+        const __m128i indices = decode(_mm_set1_epi64x(broadcast(r[0])),
+                                       _mm_set1_epi64x(broadcast(r[1])));
+        _mm_storel_epi64(reinterpret_cast<__m128i *>(pixels + row * TILE_WIDTH),
+                         indices);
+    }
+}
+
+#else
+
+void decode_tile_rows(const uint8_t *rows, size_t count, uint8_t *pixels) {
+    decode_tile_rows_scalar(rows, count, pixels);
+}
+
+#endif
+
+}  // namespace ppu
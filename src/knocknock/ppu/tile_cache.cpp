@@ -0,0 +1,26 @@
+#include "knocknock/ppu/tile_cache.h"
+
+namespace ppu {
+
+TileCache::TileCache(const memory::MemoryValue *tile_data)
+    : tile_data_(tile_data), dirty_(), pixels_(), decoded_tiles_(0) {
+    dirty_.set();
+}
+
+void TileCache::update() {
+    if (dirty_.none()) {
+        return;
+    }
+
+    for (size_t index = 0; index < TILE_COUNT; ++index) {
+        if (dirty_[index]) {
+            decode_tile_rows(tile_data_ + index * TILE_SIZE, TILE_WIDTH,
+                             &pixels_[index * TILE_PIXELS]);
+            decoded_tiles_++;
+        }
+    }
+
+    dirty_.reset();
+}
+
+}  // namespace ppu
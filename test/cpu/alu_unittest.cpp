@@ -0,0 +1,197 @@
+#include <catch2/catch.hpp>
+
+#include <cstdint>
+#include <random>
+
+#include <knocknock/cpu/alu.h>
+
+namespace alu = cpu::alu;
+using Operand = cpu::Instruction::Operand;
+
+namespace {
+
+// Run |op| on an eager and a lazy flag register, both starting with |flags|.
+// Returns true if both produce the same result and the same flags.
+template <typename Op>
+bool agree(uint8_t flags, Op op) {
+    cpu::FlagRegister eager{};
+    cpu::LazyFlagRegister lazy{};
+    eager.write(flags);
+    lazy.write(flags);
+
+    auto eager_result = op(eager);
+    auto lazy_result = op(lazy);
+
+    return eager_result == lazy_result && eager.read() == lazy.read();
+}
+
+// Every possible value of the flags.
+constexpr uint8_t FLAGS_STEP = 0x10;
+constexpr unsigned FLAGS_END = 0x100;
+
+template <typename Op>
+int binary_mismatches(Op op) {
+    int mismatches = 0;
+    for (unsigned flags = 0; flags < FLAGS_END; flags += FLAGS_STEP) {
+        for (unsigned x = 0; x <= 0xff; ++x) {
+            for (unsigned y = 0; y <= 0xff; ++y) {
+                if (!agree(flags, [&](auto &f) { return op(f, x, y); })) {
+                    mismatches++;
+                }
+            }
+        }
+    }
+    return mismatches;
+}
+
+template <typename Op>
+int unary_mismatches(Op op) {
+    int mismatches = 0;
+    for (unsigned flags = 0; flags < FLAGS_END; flags += FLAGS_STEP) {
+        for (unsigned x = 0; x <= 0xff; ++x) {
+            if (!agree(flags, [&](auto &f) { return op(f, x); })) {
+                mismatches++;
+            }
+        }
+    }
+    return mismatches;
+}
+
+}  // namespace
+
+TEST_CASE("Lazy flags agree with eager flags", "[cpu][alu]") {
+    SECTION("8-bit arithmetic and logic") {
+        REQUIRE(binary_mismatches([](auto &f, uint8_t x, uint8_t y) {
+                    return alu::add(f, x, y);
+                }) == 0);
+        REQUIRE(binary_mismatches([](auto &f, uint8_t x, uint8_t y) {
+                    return alu::adc(f, x, y);
+                }) == 0);
+        REQUIRE(binary_mismatches([](auto &f, uint8_t x, uint8_t y) {
+                    return alu::sub(f, x, y);
+                }) == 0);
+        REQUIRE(binary_mismatches([](auto &f, uint8_t x, uint8_t y) {
+                    return alu::sbc(f, x, y);
+                }) == 0);
+        REQUIRE(binary_mismatches([](auto &f, uint8_t x, uint8_t y) {
+                    return alu::and_(f, x, y);
+                }) == 0);
+        REQUIRE(binary_mismatches([](auto &f, uint8_t x, uint8_t y) {
+                    return alu::or_(f, x, y);
+                }) == 0);
+        REQUIRE(binary_mismatches([](auto &f, uint8_t x, uint8_t y) {
+                    return alu::xor_(f, x, y);
+                }) == 0);
+        REQUIRE(binary_mismatches([](auto &f, uint8_t x, uint8_t y) {
+                    alu::cp(f, x, y);
+                    return 0;
+                }) == 0);
+    }
+
+    SECTION("INC, DEC, rotates and shifts") {
+        REQUIRE(unary_mismatches(
+                    [](auto &f, uint8_t x) { return alu::inc(f, x); }) == 0);
+        REQUIRE(unary_mismatches(
+                    [](auto &f, uint8_t x) { return alu::dec(f, x); }) == 0);
+        REQUIRE(unary_mismatches(
+                    [](auto &f, uint8_t x) { return alu::rlc(f, x); }) == 0);
+        REQUIRE(unary_mismatches(
+                    [](auto &f, uint8_t x) { return alu::rrc(f, x); }) == 0);
+        REQUIRE(unary_mismatches(
+                    [](auto &f, uint8_t x) { return alu::rl(f, x); }) == 0);
+        REQUIRE(unary_mismatches(
+                    [](auto &f, uint8_t x) { return alu::rr(f, x); }) == 0);
+        REQUIRE(unary_mismatches(
+                    [](auto &f, uint8_t x) { return alu::sla(f, x); }) == 0);
+        REQUIRE(unary_mismatches(
+                    [](auto &f, uint8_t x) { return alu::sra(f, x); }) == 0);
+        REQUIRE(unary_mismatches(
+                    [](auto &f, uint8_t x) { return alu::swap(f, x); }) == 0);
+        REQUIRE(unary_mismatches(
+                    [](auto &f, uint8_t x) { return alu::srl(f, x); }) == 0);
+        REQUIRE(unary_mismatches(
+                    [](auto &f, uint8_t x) { return alu::daa(f, x); }) == 0);
+    }
+
+    SECTION("BIT") {
+        for (uint8_t bit = 0; bit < 8; ++bit) {
+            REQUIRE(unary_mismatches([bit](auto &f, uint8_t x) {
+                        alu::bit(f, bit, x);
+                        return 0;
+                    }) == 0);
+        }
+    }
+
+    SECTION("16-bit arithmetic") {
+        // The flags of ADD HL, rr depend on all 16 bits of both operands, so
+        // the second one is sampled. ADD SP, Imm8Sign only depends on the low
+        // byte of SP, but the whole result is compared.
+        int mismatches = 0;
+        for (unsigned flags = 0; flags < FLAGS_END; flags += FLAGS_STEP) {
+            for (unsigned x = 0; x <= 0xffff; ++x) {
+                for (unsigned y = 0; y <= 0xffff; y += 0x0fff) {
+                    if (!agree(flags, [&](auto &f) {
+                            return alu::add16(f, x, y);
+                        })) {
+                        mismatches++;
+                    }
+                }
+
+                if ((x & 0xff00) != 0x0000 && (x & 0xff00) != 0xff00) {
+                    continue;
+                }
+                for (int y = INT8_MIN; y <= INT8_MAX; ++y) {
+                    if (!agree(flags, [&](auto &f) {
+                            return alu::add_sp(f, x, y);
+                        })) {
+                        mismatches++;
+                    }
+                }
+            }
+        }
+        REQUIRE(mismatches == 0);
+    }
+}
+
+TEST_CASE("Lazy flags agree with eager flags in sequence", "[cpu][alu]") {
+    // Chain random operations, so that every operation starts from the flags
+    // of a pending one instead of stored ones.
+    std::mt19937 rng(0x6b6e);
+    std::uniform_int_distribution<int> byte(0x00, 0xff);
+
+    cpu::FlagRegister eager{};
+    cpu::LazyFlagRegister lazy{};
+
+    auto step = [](auto &f, int op, uint8_t x, uint8_t y) -> int {
+        switch (op) {
+            case 0: return alu::add(f, x, y);
+            case 1: return alu::adc(f, x, y);
+            case 2: return alu::sub(f, x, y);
+            case 3: return alu::sbc(f, x, y);
+            case 4: return alu::and_(f, x, y);
+            case 5: return alu::xor_(f, x, y);
+            case 6: alu::cp(f, x, y); return 0;
+            case 7: return alu::inc(f, x);
+            case 8: return alu::dec(f, x);
+            case 9: return alu::add16(f, (x << 8) | y, (y << 8) | x);
+            case 10: return alu::add_sp(f, (y << 8) | x, (int8_t)(y));
+            case 11: return alu::rl(f, x);
+            case 12: return alu::rr(f, x);
+            case 13: return alu::srl(f, x);
+            case 14: alu::bit(f, y & 0x7, x); return 0;
+            case 15: return alu::daa(f, x);
+            case 16: f.set_carry(!f.carry()); return 0;
+            default: return alu::condition(f, Operand::FlagNZ);
+        }
+    };
+
+    for (int i = 0; i < 100000; ++i) {
+        int op = std::uniform_int_distribution<int>(0, 17)(rng);
+        uint8_t x = byte(rng);
+        uint8_t y = byte(rng);
+
+        INFO("Step " << i << ", operation " << op);
+        REQUIRE(step(eager, op, x, y) == step(lazy, op, x, y));
+        REQUIRE((int)eager.read() == (int)lazy.read());
+    }
+}
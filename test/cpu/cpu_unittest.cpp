@@ -0,0 +1,615 @@
+#include <catch2/catch.hpp>
+
+#include <algorithm>
+#include <vector>
+
+#include <knocknock/cpu/cpu.h>
+#include <knocknock/interrupt.h>
+#include <knocknock/memory/flat_rom.h>
+#include <knocknock/memory/internal_ram.h>
+#include <knocknock/memory/mmu.h>
+#include <knocknock/memory/regions.h>
+#include <knocknock/memory/test_memory.h>
+#include <knocknock/peripherals/scheduler.h>
+#include <knocknock/peripherals/timer.h>
+#include <knocknock/ppu/ppu.h>
+
+#include "peripherals/stubs.h"
+
+namespace {
+
+void load_program(memory::TestMemory *mem,
+                  memory::MemoryAddr addr,
+                  const std::vector<memory::MemoryValue> &program) {
+    for (memory::MemoryValue value : program) {
+        mem->write(addr++, value);
+    }
+}
+
+// Tick the CPU until it halts, and return the number of ticks taken.
+size_t run_until_halted(cpu::CPU *cpu) {
+    size_t ticks = 0;
+    while (!cpu->halted()) {
+        cpu->tick();
+        ticks++;
+    }
+
+    return ticks;
+}
+
+}  // namespace
+
+TEST_CASE("Interpreters agree", "[cpu]") {
+    // Checksum and rewrite $c000 - $c0ff through ALU, CB-prefixed and stack
+    // instructions, then store SP and the registers after it.
+    const std::vector<memory::MemoryValue> program = {
+        0x21, 0x00, 0xc0,  // LD HL, $c000
+        0x06, 0x00,        // LD B, 0
+        0xaf,              // XOR A
+        0x86,              // ADD A, (HL)
+        0xce, 0x35,        // ADC A, $35
+        0xcb, 0x3f,        // SRL A
+        0x27,              // DAA
+        0x22,              // LDI (HL), A
+        0xcd, 0x20, 0x01,  // CALL $0120
+        0x05,              // DEC B
+        0x20, 0xf3,        // JR NZ, -13
+        0x08, 0x00, 0xc1,  // LD ($c100), SP
+        0xf5,              // PUSH AF
+        0xc5,              // PUSH BC
+        0xd5,              // PUSH DE
+        0xe5,              // PUSH HL
+        0x76,              // HALT
+    };
+    const std::vector<memory::MemoryValue> subroutine = {
+        0xcb, 0x30,  // SWAP B
+        0x98,        // SBC A, B
+        0xcb, 0x30,  // SWAP B
+        0x1f,        // RRA
+        0xcb, 0xd1,  // SET 2, C
+        0xd8,        // RET C
+        0x3f,        // CCF
+        0xc9,        // RET
+    };
+
+    memory::TestMemory decoder_mem, threaded_mem, micro_op_mem;
+    for (memory::TestMemory *mem :
+         {&decoder_mem, &threaded_mem, &micro_op_mem}) {
+        for (memory::MemoryAddr addr = 0xc000; addr < 0xc100; ++addr) {
+            mem->write(addr, addr * 37);
+        }
+        load_program(mem, 0x0100, program);
+        load_program(mem, 0x0120, subroutine);
+    }
+
+    cpu::CPU decoder(&decoder_mem, cpu::CPU::Interpreter::DECODER);
+    cpu::CPU threaded(&threaded_mem, cpu::CPU::Interpreter::THREADED);
+    cpu::CPU micro_op(&micro_op_mem, cpu::CPU::Interpreter::MICRO_OP);
+    run_until_halted(&decoder);
+    run_until_halted(&threaded);
+    run_until_halted(&micro_op);
+
+    std::vector<memory::MemoryValue> decoder_dump, threaded_dump, micro_op_dump;
+    for (uint32_t addr = 0; addr <= 0xffff; ++addr) {
+        decoder_dump.push_back(decoder_mem.read(addr));
+        threaded_dump.push_back(threaded_mem.read(addr));
+        micro_op_dump.push_back(micro_op_mem.read(addr));
+    }
+    REQUIRE(decoder_dump == threaded_dump);
+    REQUIRE(decoder_dump == micro_op_dump);
+}
+
+TEST_CASE("Threaded interpreter timing", "[cpu]") {
+    // F is initialized to $b0, so the zero flag is set.
+    const std::vector<memory::MemoryValue> program = {
+        0x00,              // NOP: 1 M-cycle
+        0x01, 0x34, 0x12,  // LD BC, $1234: 3 M-cycles
+        0x20, 0x00,        // JR NZ, 0: not taken, 2 M-cycles
+        0x28, 0x00,        // JR Z, 0: taken, 3 M-cycles
+        0xcb, 0x46,        // BIT 0, (HL): 3 M-cycles
+        0x76,              // HALT: 1 M-cycle
+    };
+
+    memory::TestMemory mem;
+    load_program(&mem, 0x0100, program);
+
+    SECTION("Decoder takes one tick per byte") {
+        cpu::CPU cpu(&mem, cpu::CPU::Interpreter::DECODER);
+        REQUIRE(run_until_halted(&cpu) == program.size());
+    }
+
+    SECTION("Threaded interpreter takes one tick per M-cycle") {
+        cpu::CPU cpu(&mem, cpu::CPU::Interpreter::THREADED);
+        REQUIRE(run_until_halted(&cpu) == 13);
+    }
+
+    SECTION("Micro-op interpreter takes one tick per M-cycle") {
+        // Plus the first tick, which only fetches the NOP.
+        cpu::CPU cpu(&mem, cpu::CPU::Interpreter::MICRO_OP);
+        REQUIRE(run_until_halted(&cpu) == 14);
+    }
+}
+
+TEST_CASE("Batch execution", "[cpu]") {
+    const std::vector<memory::MemoryValue> program = {
+        0x00,              // NOP: 1 M-cycle
+        0x01, 0x34, 0x12,  // LD BC, $1234: 3 M-cycles
+        0x3c,              // INC A: 1 M-cycle
+        0x76,              // HALT: 1 M-cycle
+    };
+
+    memory::TestMemory mem;
+    load_program(&mem, 0x0100, program);
+
+    SECTION("Tick-based interpreters stop at the budget") {
+        for (auto interpreter : {cpu::CPU::Interpreter::DECODER,
+                                 cpu::CPU::Interpreter::MICRO_OP}) {
+            cpu::CPU cpu(&mem, interpreter);
+            REQUIRE(cpu.run(3) == 3);
+            REQUIRE_FALSE(cpu.halted());
+            REQUIRE(cpu.run(100) == 100);
+            REQUIRE(cpu.halted());
+        }
+    }
+
+    SECTION("Threaded interpreter stops between instructions") {
+        cpu::CPU cpu(&mem, cpu::CPU::Interpreter::THREADED);
+        REQUIRE(cpu.run(1) == 1);
+        REQUIRE(cpu.run(1) == 3);
+        REQUIRE_FALSE(cpu.halted());
+        REQUIRE(cpu.run(100) == 100);
+        REQUIRE(cpu.halted());
+    }
+
+    SECTION("Threaded interpreter finishes a ticked instruction first") {
+        cpu::CPU cpu(&mem, cpu::CPU::Interpreter::THREADED);
+        cpu.tick();
+        cpu.tick();
+        REQUIRE(cpu.run(2) == 2);
+        REQUIRE(cpu.run(1) == 1);
+        REQUIRE_FALSE(cpu.halted());
+        REQUIRE(cpu.run(1) == 1);
+        REQUIRE(cpu.halted());
+    }
+}
+
+TEST_CASE("Halted CPU is skipped by the scheduler", "[cpu]") {
+    // Counts the slices the CPU is run for.
+    class CountingCPU : public peripherals::Tickable {
+    public:
+        explicit CountingCPU(cpu::CPU *cpu) : cpu_(cpu) {}
+
+        // Tickable::
+        void tick() override { cpu_->tick(); }
+        uint32_t run(uint32_t ticks) override {
+            runs++;
+            return cpu_->run(ticks);
+        }
+        bool idle() const override { return cpu_->idle(); }
+
+        size_t runs = 0;
+
+    private:
+        cpu::CPU *cpu_;
+    };
+
+    // Raises VBLANK when ticked.
+    class VBlank : public peripherals::Tickable {
+    public:
+        explicit VBlank(interrupt::Interruptible *controller)
+            : controller_(controller) {}
+
+        // Tickable::
+        void tick() override {
+            controller_->interrupt(interrupt::InterruptType::VBLANK);
+        }
+
+    private:
+        interrupt::Interruptible *controller_;
+    };
+
+    memory::TestMemory mem;
+    load_program(&mem, 0x0100, {0xfb, 0x76, 0x76});  // EI, HALT, HALT
+    load_program(&mem, 0x0040, {0x3c, 0xd9});        // INC A, RETI
+
+    cpu::CPU cpu(&mem, cpu::CPU::Interpreter::THREADED);
+    CountingCPU counting(&cpu);
+    peripherals::Scheduler scheduler(&counting);
+    interrupt::InterruptController controller(&cpu, &scheduler);
+    controller.write(0xffff, 0x01);
+    VBlank vblank(&controller);
+    scheduler.schedule(&vblank, 100000);
+
+    scheduler.run(100010);
+    REQUIRE(cpu.halted());
+    REQUIRE(counting.runs < 10);
+
+    // The handler ran, and pushed the address of the second HALT.
+    REQUIRE(mem.read(0xfffd) == 0x01);
+    REQUIRE(mem.read(0xfffc) == 0x02);
+}
+
+TEST_CASE("Interrupts refused by the CPU are serviced after EI", "[cpu]") {
+    const std::vector<memory::MemoryValue> program = {
+        0xf3,        // DI
+        0x06, 0x64,  // LD B, 100
+        0x05,        // DEC B
+        0x20, 0xfd,  // JR NZ, -3
+        0xfb,        // EI
+        0x00,        // NOP
+        0x76,        // HALT
+    };
+
+    for (auto interpreter :
+         {cpu::CPU::Interpreter::DECODER, cpu::CPU::Interpreter::THREADED,
+          cpu::CPU::Interpreter::MICRO_OP}) {
+        memory::TestMemory mem;
+        load_program(&mem, 0x0100, program);
+        load_program(&mem, 0x0040, {0x3c, 0xd9});  // INC A, RETI
+
+        cpu::CPU cpu(&mem, interpreter);
+        peripherals::Scheduler scheduler(&cpu);
+        interrupt::InterruptController controller(&cpu, &scheduler);
+        cpu.set_scheduler(&scheduler);
+        cpu.set_interrupt_controller(&controller);
+        controller.write(0xffff, 0x01);
+        controller.interrupt(interrupt::InterruptType::VBLANK);
+
+        // Refused once, then left pending without any event while the loop
+        // runs with interrupts disabled.
+        scheduler.run(200);
+        REQUIRE_FALSE(scheduler.scheduled(&controller));
+        REQUIRE(controller.pending() == 0x01);
+        REQUIRE_FALSE(cpu.halted());
+
+        // The handler ran right after EI, and pushed the address of the NOP.
+        scheduler.run(400);
+        REQUIRE(cpu.halted());
+        REQUIRE(controller.pending() == 0x00);
+        REQUIRE(mem.read(0xfffd) == 0x01);
+        REQUIRE(mem.read(0xfffc) == 0x07);
+    }
+}
+
+TEST_CASE("Peripherals see the current cycle within a slice", "[cpu]") {
+    // Start the timer, then record DIV and TIMA in WRAM forever.
+    const std::vector<memory::MemoryValue> program = {
+        0x3e, 0x05,        // LD A, $05
+        0xe0, 0x07,        // LDH ($07), A
+        0x21, 0x00, 0xc0,  // LD HL, $c000
+        0xf0, 0x04,        // LDH A, ($04)
+        0x22,              // LDI (HL), A
+        0xf0, 0x05,        // LDH A, ($05)
+        0x22,              // LDI (HL), A
+        0x18, 0xf8,        // JR -8
+    };
+    constexpr uint32_t CYCLES = 3000;
+
+    auto run = [&](cpu::CPU::Interpreter interpreter, bool scheduled) {
+        std::vector<memory::MemoryValue> rom(
+            memory::ROM_0_SIZE + memory::ROM_SWITCHABLE_SIZE, 0x00);
+        std::copy(program.begin(), program.end(), rom.begin() + 0x0100);
+        memory::FlatROM flat_rom(rom, 0);
+        memory::InternalRAM ram;
+        memory::MMU mmu;
+        mmu.register_region(&flat_rom, memory::ROM_0_BEGIN,
+                            memory::ROM_SWITCHABLE_END);
+        mmu.register_region(&ram, memory::RAM_INTERNAL_BEGIN,
+                            memory::RAM_INTERNAL_END);
+
+        cpu::CPU cpu(&mmu, interpreter);
+        peripherals::Scheduler scheduler(&cpu);
+        peripherals::testing::IgnoreInterrupts interrupts;
+        peripherals::Timer timer(&interrupts, scheduled ? &scheduler : nullptr);
+        timer.register_to_mmu(&mmu);
+
+        if (scheduled) {
+            cpu.set_scheduler(&scheduler);
+            scheduler.run(CYCLES);
+        } else {
+            for (uint32_t i = 0; i < CYCLES; ++i) {
+                cpu.tick();
+                timer.tick();
+            }
+        }
+
+        std::vector<memory::MemoryValue> recorded(0x200);
+        mmu.peek_block(0xc000, recorded.data(), recorded.size());
+        return recorded;
+    };
+
+    for (auto interpreter :
+         {cpu::CPU::Interpreter::DECODER, cpu::CPU::Interpreter::THREADED,
+          cpu::CPU::Interpreter::MICRO_OP}) {
+        const auto recorded = run(interpreter, true);
+        REQUIRE(recorded == run(interpreter, false));
+        // DIV went through a few of its periods of 64 cycles.
+        REQUIRE(recorded[0] != recorded[0x100]);
+    }
+}
+
+TEST_CASE("Idle loops are skipped", "[cpu]") {
+    // Records how long each slice of the CPU lasts.
+    class RecordingCPU : public peripherals::Tickable {
+    public:
+        explicit RecordingCPU(cpu::CPU *cpu) : cpu_(cpu) {}
+
+        // Tickable::
+        void tick() override { cpu_->tick(); }
+        uint32_t run(uint32_t ticks) override {
+            runs.push_back(cpu_->run(ticks));
+            return runs.back();
+        }
+        bool idle() const override { return cpu_->idle(); }
+
+        std::vector<uint32_t> runs;
+
+    private:
+        cpu::CPU *cpu_;
+    };
+
+    // Sets the flag polled by the program when ticked.
+    class Flag : public peripherals::Tickable {
+    public:
+        explicit Flag(memory::Memory *mem) : mem_(mem) {}
+
+        // Tickable::
+        void tick() override { mem_->write(0xc000, 0x2a); }
+
+    private:
+        memory::Memory *mem_;
+    };
+
+    SECTION("Polling a flag set by an event") {
+        const std::vector<memory::MemoryValue> program = {
+            0xfa, 0x00, 0xc0,  // LD A, ($c000)
+            0xa7,              // AND A
+            0x28, 0xfa,        // JR Z, -6
+            0x3c,              // INC A
+            0xea, 0x01, 0xc0,  // LD ($c001), A
+            0xf5,              // PUSH AF
+            0x76,              // HALT
+        };
+
+        std::vector<std::vector<uint32_t>> runs;
+        for (bool skip : {false, true}) {
+            memory::TestMemory mem;
+            load_program(&mem, 0x0100, program);
+            mem.write(0xc000, 0x00);
+
+            cpu::CPU cpu(&mem, cpu::CPU::Interpreter::THREADED);
+            cpu.set_skip_idle_loops(skip);
+            RecordingCPU recording(&cpu);
+            peripherals::Scheduler scheduler(&recording);
+            Flag flag(&mem);
+            scheduler.schedule(&flag, 5000);
+
+            scheduler.run(6000);
+            REQUIRE(cpu.halted());
+            REQUIRE(mem.read(0xc001) == 0x2b);
+            REQUIRE(mem.read(0xfffd) == 0x2b);
+            REQUIRE(mem.read(0xfffc) == 0x00);
+            REQUIRE((cpu.idle_cycles_skipped() > 4000) == skip);
+            runs.push_back(recording.runs);
+        }
+
+        // Same slices, so the flag was seen at the same cycle.
+        REQUIRE(runs[0] == runs[1]);
+    }
+
+    SECTION("Polling DIV") {
+        // DIV changes without any event, so the loop must see every value.
+        const std::vector<memory::MemoryValue> program = {
+            0xf0, 0x04,        // LDH A, ($04)
+            0xfe, 0x20,        // CP $20
+            0x20, 0xfa,        // JR NZ, -6
+            0xea, 0x00, 0xc0,  // LD ($c000), A
+            0x76,              // HALT
+        };
+
+        std::vector<std::vector<uint32_t>> runs;
+        for (bool skip : {false, true}) {
+            std::vector<memory::MemoryValue> rom(
+                memory::ROM_0_SIZE + memory::ROM_SWITCHABLE_SIZE, 0x00);
+            std::copy(program.begin(), program.end(), rom.begin() + 0x0100);
+            memory::FlatROM flat_rom(rom, 0);
+            memory::InternalRAM ram;
+            memory::MMU mmu;
+            mmu.register_region(&flat_rom, memory::ROM_0_BEGIN,
+                                memory::ROM_SWITCHABLE_END);
+            mmu.register_region(&ram, memory::RAM_INTERNAL_BEGIN,
+                                memory::RAM_INTERNAL_END);
+
+            cpu::CPU cpu(&mmu, cpu::CPU::Interpreter::THREADED);
+            cpu.set_skip_idle_loops(skip);
+            RecordingCPU recording(&cpu);
+            peripherals::Scheduler scheduler(&recording);
+            cpu.set_scheduler(&scheduler);
+            peripherals::testing::IgnoreInterrupts interrupts;
+            peripherals::Timer timer(&interrupts, &scheduler);
+            timer.register_to_mmu(&mmu);
+
+            scheduler.run(3000);
+            REQUIRE(cpu.halted());
+            REQUIRE(mmu.read(0xc000) == 0x20);
+            REQUIRE(cpu.idle_cycles_skipped() == 0);
+            runs.push_back(recording.runs);
+        }
+
+        REQUIRE(runs[0] == runs[1]);
+    }
+
+    SECTION("Polling LY") {
+        // LY only changes on the events of the PPU, so the loop is skipped
+        // up to each of them.
+        const std::vector<memory::MemoryValue> program = {
+            0xf0, 0x44,        // LDH A, ($44)
+            0xfe, 0x90,        // CP $90
+            0x20, 0xfa,        // JR NZ, -6
+            0xea, 0x00, 0xc0,  // LD ($c000), A
+            0x76,              // HALT
+        };
+
+        std::vector<std::vector<uint32_t>> runs;
+        for (bool skip : {false, true}) {
+            std::vector<memory::MemoryValue> rom(
+                memory::ROM_0_SIZE + memory::ROM_SWITCHABLE_SIZE, 0x00);
+            std::copy(program.begin(), program.end(), rom.begin() + 0x0100);
+            memory::FlatROM flat_rom(rom, 0);
+            memory::InternalRAM ram;
+            memory::MMU mmu;
+            mmu.register_region(&flat_rom, memory::ROM_0_BEGIN,
+                                memory::ROM_SWITCHABLE_END);
+            mmu.register_region(&ram, memory::RAM_INTERNAL_BEGIN,
+                                memory::RAM_INTERNAL_END);
+
+            cpu::CPU cpu(&mmu, cpu::CPU::Interpreter::THREADED);
+            cpu.set_skip_idle_loops(skip);
+            RecordingCPU recording(&cpu);
+            peripherals::Scheduler scheduler(&recording);
+            cpu.set_scheduler(&scheduler);
+            peripherals::testing::IgnoreInterrupts interrupts;
+            ppu::PPU ppu(&interrupts, &scheduler);
+            ppu.register_to_mmu(&mmu);
+
+            // LY reaches 0x90 as VBlank starts, after 144 lines of 114
+            // cycles.
+            scheduler.run(144 * 114 + 1000);
+            REQUIRE(cpu.halted());
+            REQUIRE(mmu.read(0xc000) == 0x90);
+            REQUIRE((cpu.idle_cycles_skipped() > 144 * 114 / 2) == skip);
+            runs.push_back(recording.runs);
+        }
+
+        REQUIRE(runs[0] == runs[1]);
+    }
+
+    SECTION("Tight loop") {
+        memory::TestMemory mem;
+        load_program(&mem, 0x0100, {0x18, 0xfe});  // JR -2
+
+        cpu::CPU cpu(&mem, cpu::CPU::Interpreter::THREADED);
+        cpu.set_skip_idle_loops(true);
+        REQUIRE(cpu.run(1000) == 1002);
+        REQUIRE(cpu.idle_cycles_skipped() == 996);
+    }
+
+    SECTION("Loops with side effects are run") {
+        const std::vector<std::vector<memory::MemoryValue>> programs = {
+            {0x04, 0x18, 0xfd},        // INC B; JR -3
+            {0x77, 0x18, 0xfd},        // LD (HL), A; JR -3
+            {0xf5, 0xf1, 0x18, 0xfc},  // PUSH AF; POP AF; JR -4
+        };
+
+        for (const auto &program : programs) {
+            memory::TestMemory mem;
+            load_program(&mem, 0x0100, program);
+
+            cpu::CPU cpu(&mem, cpu::CPU::Interpreter::THREADED);
+            cpu.set_skip_idle_loops(true);
+            cpu.run(1000);
+            REQUIRE(cpu.idle_cycles_skipped() == 0);
+        }
+    }
+}
+
+TEST_CASE("Micro-op memory access timing", "[cpu]") {
+    memory::TestMemory mem;
+    cpu::CPU cpu(&mem, cpu::CPU::Interpreter::MICRO_OP);
+
+    auto tick = [&](size_t ticks) {
+        for (size_t i = 0; i < ticks; ++i) {
+            cpu.tick();
+        }
+    };
+
+    SECTION("LD (nn), A writes in its third M-cycle") {
+        load_program(&mem, 0x0100, {0xea, 0x00, 0xc0});  // LD ($c000), A
+
+        // Fetch, then read both bytes of the address.
+        tick(3);
+        REQUIRE(mem.read(0xc000) == 0x00);
+        tick(1);
+        REQUIRE(mem.read(0xc000) == 0x01);
+    }
+
+    SECTION("CALL pushes PC after an internal M-cycle") {
+        load_program(&mem, 0x0100, {0xcd, 0x00, 0x02});  // CALL $0200
+
+        // Fetch, read the address, then the internal M-cycle.
+        tick(4);
+        REQUIRE(mem.read(0xfffd) == 0x00);
+        tick(1);
+        REQUIRE(mem.read(0xfffd) == 0x01);
+        REQUIRE(mem.read(0xfffc) == 0x00);
+        tick(1);
+        REQUIRE(mem.read(0xfffc) == 0x03);
+    }
+
+    SECTION("Interrupt dispatch takes 5 M-cycles") {
+        load_program(&mem, 0x0100, {0xfb, 0x00});  // EI, NOP
+        load_program(&mem, 0x0040, {0x76});        // HALT
+
+        // Fetch EI, then run it, which fetches the NOP.
+        tick(2);
+        REQUIRE(cpu.interrupt(interrupt::InterruptType::VBLANK));
+
+        // The NOP is fetched again after the handler returns.
+        tick(4);
+        REQUIRE(mem.read(0xfffd) == 0x01);
+        REQUIRE(mem.read(0xfffc) == 0x01);
+        REQUIRE_FALSE(cpu.halted());
+
+        // The last M-cycle jumps and fetches the HALT, which then runs.
+        tick(2);
+        REQUIRE(cpu.halted());
+    }
+}
+
+TEST_CASE("Cached decoder runs code rewritten in RAM", "[cpu]") {
+    const std::vector<memory::MemoryValue> program = {
+        0x21, 0x00, 0xc1,  // LD HL, $c100
+        0xcd, 0x00, 0xc0,  // CALL $c000
+        0x3e, 0x22,        // LD A, $22
+        0xea, 0x01, 0xc0,  // LD ($c001), A
+        0xcd, 0x00, 0xc0,  // CALL $c000
+        0x76,              // HALT
+    };
+    const std::vector<memory::MemoryValue> routine = {
+        0x3e, 0x11,  // LD A, $11
+        0x22,        // LDI (HL), A
+        0xc9,        // RET
+    };
+
+    auto run = [&](cpu::CPU::Interpreter interpreter) {
+        std::vector<memory::MemoryValue> rom(
+            memory::ROM_0_SIZE + memory::ROM_SWITCHABLE_SIZE, 0x00);
+        std::copy(program.begin(), program.end(), rom.begin() + 0x0100);
+        memory::FlatROM flat_rom(rom, 0);
+        memory::InternalRAM ram;
+        memory::MMU mmu;
+        mmu.register_region(&flat_rom, memory::ROM_0_BEGIN,
+                            memory::ROM_SWITCHABLE_END);
+        mmu.register_region(&ram, memory::RAM_INTERNAL_BEGIN,
+                            memory::RAM_INTERNAL_END);
+        mmu.register_region(&ram, memory::HRAM_BEGIN, memory::HRAM_END);
+        for (size_t i = 0; i < routine.size(); ++i) {
+            mmu.write(0xc000 + i, routine[i]);
+        }
+
+        cpu::CPU cpu(&mmu, interpreter);
+        size_t ticks = run_until_halted(&cpu);
+
+        REQUIRE(mmu.read(0xc100) == 0x11);
+        REQUIRE(mmu.read(0xc101) == 0x22);
+        if (interpreter == cpu::CPU::Interpreter::CACHED_DECODER) {
+            // RET is cached in the first call, and survives the rewrite.
+            REQUIRE(cpu.decoded_cache().hits() >= 1);
+        }
+
+        return ticks;
+    };
+
+    REQUIRE(run(cpu::CPU::Interpreter::CACHED_DECODER) ==
+            run(cpu::CPU::Interpreter::DECODER));
+}
@@ -0,0 +1,146 @@
+#include <catch2/catch.hpp>
+
+#include <knocknock/cpu/decoded_cache.h>
+#include <knocknock/cpu/decoder.h>
+#include <knocknock/memory/direct_memory.h>
+#include <knocknock/memory/internal_ram.h>
+#include <knocknock/memory/mbc1.h>
+#include <knocknock/memory/mmu.h>
+#include <knocknock/memory/regions.h>
+
+#include <vector>
+
+#include "memory/unittest_utils.h"
+
+using Opcode = cpu::Instruction::Opcode;
+using Operand = cpu::Instruction::Operand;
+
+TEST_CASE("Decoded cache", "[cpu][decoder]") {
+    // Bank 1 is filled with INC A, bank 2 with DEC B.
+    memory::MBC1 mbc(
+        memory::testing::generate_test_rom(4, {{0x01, 0x3c}, {0x02, 0x05}}),
+        0);
+    memory::InternalRAM ram;
+    memory::MMU mmu;
+    mmu.register_region(&mbc, memory::ROM_0_BEGIN, memory::ROM_SWITCHABLE_END);
+    mmu.register_region(&ram, memory::RAM_INTERNAL_BEGIN,
+                        memory::RAM_INTERNAL_END);
+    mmu.register_region(&ram, memory::HRAM_BEGIN, memory::HRAM_END);
+
+    memory::DirectMemory direct(&mmu);
+    cpu::DecodedCache cache(direct.host_page_table());
+    memory::MemoryAddr pc = 0;
+    cpu::Decoder decoder(&direct, &pc, &cache);
+
+    // Decode the instruction at |addr|, and return the number of steps taken.
+    auto decode_at = [&](memory::MemoryAddr addr) {
+        size_t steps = 0;
+        pc = addr;
+        do {
+            decoder.step();
+            steps++;
+        } while (!decoder.has_decoded_instruction());
+        return steps;
+    };
+
+    SECTION("Instructions are cached on first execution") {
+        decode_at(0x4000);
+        REQUIRE(decoder.decoded_instruction().opcode() == Opcode::INC);
+        REQUIRE(cache.hits() == 0);
+        REQUIRE(cache.misses() == 1);
+
+        decode_at(0x4000);
+        REQUIRE(decoder.decoded_instruction().opcode() == Opcode::INC);
+        REQUIRE(decoder.decoded_instruction().lhs() == Operand::A);
+        REQUIRE(cache.hits() == 1);
+        REQUIRE(cache.misses() == 1);
+    }
+
+    SECTION("Cached instructions take as many steps") {
+        // LD A, ($c123)
+        mmu.write(0xc000, 0xfa);
+        mmu.write(0xc001, 0x23);
+        mmu.write(0xc002, 0xc1);
+
+        REQUIRE(decode_at(0xc000) == 3);
+        REQUIRE(decode_at(0xc000) == 3);
+        REQUIRE(cache.hits() == 1);
+        REQUIRE(pc == 0xc003);
+        REQUIRE(decoder.decoded_instruction().imm16() == 0xc123);
+        REQUIRE(decoder.decoded_info().length == 3);
+    }
+
+    SECTION("Entries are keyed by ROM bank") {
+        decode_at(0x4000);
+
+        mmu.write(0x2000, 0x02);
+        decode_at(0x4000);
+        REQUIRE(decoder.decoded_instruction().opcode() == Opcode::DEC);
+        REQUIRE(cache.hits() == 0);
+
+        mmu.write(0x2000, 0x01);
+        decode_at(0x4000);
+        REQUIRE(decoder.decoded_instruction().opcode() == Opcode::INC);
+        REQUIRE(cache.hits() == 1);
+    }
+
+    SECTION("Writes invalidate code in RAM") {
+        // LD A, $12
+        mmu.write(0xc000, 0x3e);
+        mmu.write(0xc001, 0x12);
+        decode_at(0xc000);
+        decode_at(0xc000);
+        REQUIRE(cache.hits() == 1);
+
+        // Rewrite the immediate.
+        mmu.write(0xc001, 0x34);
+        cache.invalidate(0xc001);
+        decode_at(0xc000);
+        REQUIRE(decoder.decoded_instruction().imm8() == 0x34);
+        REQUIRE(cache.hits() == 1);
+        REQUIRE(cache.misses() == 2);
+    }
+
+    SECTION("Writes which bypass the CPU invalidate code in RAM") {
+        mmu.set_host_page_observer(&cache);
+
+        // LD A, $12; LD B, $56
+        const std::vector<memory::MemoryValue> code = {0x3e, 0x12, 0x06, 0x56};
+        mmu.write_block(0xc000, code.data(), code.size());
+        decode_at(0xc000);
+        decode_at(0xc002);
+        decode_at(0xc000);
+        decode_at(0xc002);
+        REQUIRE(cache.hits() == 2);
+
+        // Rewrite the first immediate as a block, without calling
+        // invalidate().
+        const memory::MemoryValue imm8 = 0x34;
+        mmu.write_block(0xc001, &imm8, 1);
+        decode_at(0xc000);
+        REQUIRE(decoder.decoded_instruction().imm8() == 0x34);
+        REQUIRE(cache.hits() == 2);
+
+        // Single writes are the CPU's, which invalidates the cache itself, so
+        // they are not reported.
+        mmu.write(0xc003, 0x78);
+        decode_at(0xc002);
+        REQUIRE(decoder.decoded_instruction().imm8() == 0x56);
+        REQUIRE(cache.hits() == 3);
+    }
+
+    SECTION("Instructions not entirely in host memory are not cached") {
+        // LD A, $12 at the end of HRAM, with its immediate in IE.
+        mmu.write(memory::HRAM_END, 0x3e);
+        decode_at(memory::HRAM_END);
+        decode_at(memory::HRAM_END);
+        REQUIRE(cache.hits() == 0);
+
+        // An instruction crossing a page.
+        mmu.write(0xc0ff, 0x3e);
+        mmu.write(0xc100, 0x12);
+        decode_at(0xc0ff);
+        decode_at(0xc0ff);
+        REQUIRE(cache.hits() == 0);
+    }
+}
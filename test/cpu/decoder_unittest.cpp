@@ -0,0 +1,183 @@
+#include <catch2/catch.hpp>
+
+#include <knocknock/cpu/decoder.h>
+#include <knocknock/cpu/opcode_table.h>
+#include <knocknock/memory/direct_memory.h>
+#include <knocknock/memory/test_memory.h>
+
+using cpu::ImmediateKind;
+using Opcode = cpu::Instruction::Opcode;
+using Operand = cpu::Instruction::Operand;
+
+TEST_CASE("Opcode table", "[cpu][decoder]") {
+    SECTION("Invalid opcodes") {
+        size_t invalid = 0;
+        for (const auto &info : cpu::BASE_OPCODES) {
+            invalid += !info.valid;
+        }
+
+        // 11 undefined opcodes, plus the CB prefix.
+        REQUIRE(invalid == 12);
+        REQUIRE(!cpu::BASE_OPCODES[cpu::CB_PREFIX].valid);
+        REQUIRE(!cpu::BASE_OPCODES[0xd3].valid);
+        REQUIRE(!cpu::BASE_OPCODES[0xfd].valid);
+
+        for (const auto &info : cpu::CB_OPCODES) {
+            REQUIRE(info.valid);
+        }
+    }
+
+    SECTION("Lengths follow the immediates") {
+        for (const auto &info : cpu::BASE_OPCODES) {
+            if (!info.valid) {
+                continue;
+            }
+
+            switch (info.immediate) {
+                case ImmediateKind::None: REQUIRE(info.length == 1); break;
+                case ImmediateKind::Imm8:
+                case ImmediateKind::Imm8Sign: REQUIRE(info.length == 2); break;
+                case ImmediateKind::Imm16: REQUIRE(info.length == 3); break;
+            }
+        }
+
+        for (const auto &info : cpu::CB_OPCODES) {
+            REQUIRE(info.immediate == ImmediateKind::None);
+            REQUIRE(info.length == 2);
+        }
+    }
+
+    SECTION("Regular encodings") {
+        // LD D, (HL)
+        REQUIRE(cpu::BASE_OPCODES[0x56].opcode == Opcode::LD);
+        REQUIRE(cpu::BASE_OPCODES[0x56].lhs == Operand::D);
+        REQUIRE(cpu::BASE_OPCODES[0x56].rhs == Operand::PtrHL);
+        REQUIRE(cpu::BASE_OPCODES[0x56].cycles == 2);
+
+        REQUIRE(cpu::BASE_OPCODES[0x76].opcode == Opcode::HALT);
+
+        // SBC A, E
+        REQUIRE(cpu::BASE_OPCODES[0x9b].opcode == Opcode::SBC);
+        REQUIRE(cpu::BASE_OPCODES[0x9b].lhs == Operand::A);
+        REQUIRE(cpu::BASE_OPCODES[0x9b].rhs == Operand::E);
+        REQUIRE(cpu::BASE_OPCODES[0x9b].cycles == 1);
+
+        // RST 28h
+        REQUIRE(cpu::BASE_OPCODES[0xef].opcode == Opcode::RST);
+        REQUIRE(cpu::BASE_OPCODES[0xef].implicit_imm8 == 0x28);
+        REQUIRE(cpu::BASE_OPCODES[0xef].cycles == 4);
+
+        // BIT 5, (HL) and SET 5, (HL)
+        REQUIRE(cpu::CB_OPCODES[0x6e].opcode == Opcode::BIT);
+        REQUIRE(cpu::CB_OPCODES[0x6e].implicit_imm8 == 5);
+        REQUIRE(cpu::CB_OPCODES[0x6e].rhs == Operand::PtrHL);
+        REQUIRE(cpu::CB_OPCODES[0x6e].cycles == 3);
+        REQUIRE(cpu::CB_OPCODES[0xee].opcode == Opcode::SET);
+        REQUIRE(cpu::CB_OPCODES[0xee].cycles == 4);
+    }
+
+    SECTION("Operand pairs") {
+        for (const auto *table : {&cpu::BASE_OPCODES, &cpu::CB_OPCODES}) {
+            for (const auto &info : *table) {
+                if (!info.valid) {
+                    continue;
+                }
+
+                const auto &pair =
+                    cpu::Instruction::OPERAND_PAIRS[info.operands];
+                REQUIRE(pair.lhs == info.lhs);
+                REQUIRE(pair.rhs == info.rhs);
+            }
+        }
+
+        REQUIRE(cpu::Instruction().opcode() == Opcode::NOP);
+        REQUIRE(cpu::Instruction().lhs() == Operand::None);
+        REQUIRE(cpu::Instruction().rhs() == Operand::None);
+    }
+
+    SECTION("Conditional cycles") {
+        // JR NZ, r8
+        REQUIRE(cpu::BASE_OPCODES[0x20].cycles == 2);
+        REQUIRE(cpu::BASE_OPCODES[0x20].cycles_taken == 3);
+        // RET C
+        REQUIRE(cpu::BASE_OPCODES[0xd8].cycles == 2);
+        REQUIRE(cpu::BASE_OPCODES[0xd8].cycles_taken == 5);
+        // CALL Z, a16
+        REQUIRE(cpu::BASE_OPCODES[0xcc].cycles == 3);
+        REQUIRE(cpu::BASE_OPCODES[0xcc].cycles_taken == 6);
+        // Unconditional: CALL a16
+        REQUIRE(cpu::BASE_OPCODES[0xcd].cycles == 6);
+        REQUIRE(cpu::BASE_OPCODES[0xcd].cycles_taken == 6);
+    }
+}
+
+TEST_CASE("Decoder", "[cpu][decoder]") {
+    memory::TestMemory mem;
+    memory::DirectMemory direct(&mem);
+    memory::MemoryAddr pc = 0;
+    cpu::Decoder decoder(&direct, &pc);
+
+    // Step the decoder until an instruction is decoded.
+    auto decode = [&]() {
+        do {
+            decoder.step();
+        } while (!decoder.has_decoded_instruction());
+        return decoder.decoded_instruction();
+    };
+
+    SECTION("Immediates") {
+        // LD BC, $1234; JR -2; LDH ($42), A
+        mem.write(0, 0x01);
+        mem.write(1, 0x34);
+        mem.write(2, 0x12);
+        mem.write(3, 0x18);
+        mem.write(4, 0xfe);
+        mem.write(5, 0xe0);
+        mem.write(6, 0x42);
+
+        auto ld = decode();
+        REQUIRE(ld.opcode() == Opcode::LD);
+        REQUIRE(ld.lhs() == Operand::BC);
+        REQUIRE(ld.imm16() == 0x1234);
+        REQUIRE(pc == 3);
+
+        auto jr = decode();
+        REQUIRE(jr.opcode() == Opcode::JR);
+        REQUIRE(jr.imm8sign() == -2);
+        REQUIRE(pc == 5);
+
+        auto ldh = decode();
+        REQUIRE(ldh.lhs() == Operand::PtrImm8);
+        REQUIRE(ldh.imm8() == 0x42);
+        REQUIRE(pc == 7);
+    }
+
+    SECTION("Immediates encoded in the opcode") {
+        // RST 18h; RES 3, B
+        mem.write(0, 0xdf);
+        mem.write(1, 0xcb);
+        mem.write(2, 0x98);
+
+        auto rst = decode();
+        REQUIRE(rst.opcode() == Opcode::RST);
+        REQUIRE(rst.imm8() == 0x18);
+
+        auto res = decode();
+        REQUIRE(res.opcode() == Opcode::RES);
+        REQUIRE(res.imm8() == 3);
+        REQUIRE(res.rhs() == Operand::B);
+        REQUIRE(decoder.decoded_info().length == 2);
+        REQUIRE(pc == 3);
+    }
+
+    SECTION("Invalid opcodes are skipped") {
+        // Invalid opcode, then NOP
+        mem.write(0, 0xdd);
+        mem.write(1, 0x00);
+
+        decoder.step();
+        REQUIRE(!decoder.has_decoded_instruction());
+        REQUIRE(decode().opcode() == Opcode::NOP);
+        REQUIRE(pc == 2);
+    }
+}
@@ -0,0 +1,94 @@
+#include <catch2/catch.hpp>
+
+#include <cstring>
+
+#include <knocknock/cpu/registers.h>
+
+using Operand = cpu::Instruction::Operand;
+
+TEST_CASE("FlagRegister", "[cpu][registers]") {
+    cpu::FlagRegister f{};
+
+    SECTION("Raw set, porcelain get") {
+        f.write(0b01010000);
+        REQUIRE(!f.zero());
+        REQUIRE(f.subtract());
+        REQUIRE(!f.half_carry());
+        REQUIRE(f.carry());
+
+        f.write(0b10100000);
+        REQUIRE(f.zero());
+        REQUIRE(!f.subtract());
+        REQUIRE(f.half_carry());
+        REQUIRE(!f.carry());
+    }
+
+    SECTION("Porcelain set, raw get") {
+        f.set_zero(true);
+        f.set_subtract(true);
+        f.set_half_carry(true);
+        f.set_carry(true);
+        REQUIRE(f.read() == 0b11110000);
+
+        f.set_zero(false);
+        f.set_subtract(false);
+        f.set_half_carry(false);
+        f.set_carry(false);
+        REQUIRE(f.read() == 0b00000000);
+    }
+
+    SECTION("Lower nibble always reads as 0") {
+        f.write(0xff);
+        REQUIRE(f.read() == 0xf0);
+    }
+}
+
+TEST_CASE("RegisterFile", "[cpu][registers]") {
+    cpu::RegisterFile regs{};
+
+    SECTION("Pairs are made of their 8-bit halves") {
+        regs.set_bc(0x1234);
+        REQUIRE(regs.b == 0x12);
+        REQUIRE(regs.c == 0x34);
+
+        regs.d = 0x56;
+        regs.e = 0x78;
+        REQUIRE(regs.de() == 0x5678);
+
+        regs.set_hl(0x9abc);
+        REQUIRE(regs.h == 0x9a);
+        REQUIRE(regs.l == 0xbc);
+
+        regs.set_af(0xdeff);
+        REQUIRE(regs.a == 0xde);
+        REQUIRE(regs.af() == 0xdef0);
+    }
+
+    SECTION("Pairs are stored little-endian") {
+        regs.set_bc(0x1234);
+
+        uint8_t bytes[sizeof(regs)];
+        std::memcpy(bytes, &regs, sizeof(regs));
+        REQUIRE(bytes[offsetof(cpu::RegisterFile, c)] == 0x34);
+        REQUIRE(bytes[offsetof(cpu::RegisterFile, c) + 1] == 0x12);
+    }
+
+    SECTION("Compile-time access") {
+        regs.set<Operand::A>(0x12);
+        regs.set<Operand::L>(0x34);
+        regs.set<Operand::DE>(0x5678);
+        regs.set<Operand::SP>(0xfffe);
+
+        REQUIRE(regs.get<Operand::A>() == 0x12);
+        REQUIRE(regs.get<Operand::L>() == 0x34);
+        REQUIRE(regs.get<Operand::D>() == 0x56);
+        REQUIRE(regs.get<Operand::E>() == 0x78);
+        REQUIRE(regs.get<Operand::DE>() == 0x5678);
+        REQUIRE(regs.get<Operand::SP>() == 0xfffe);
+
+        STATIC_REQUIRE(std::is_same_v<decltype(regs.get<Operand::A>()),
+                                      uint8_t>);
+        STATIC_REQUIRE(std::is_same_v<decltype(regs.get<Operand::HL>()),
+                                      uint16_t>);
+    }
+}
@@ -1,5 +1,6 @@
 #include <catch2/catch.hpp>
 #include <map>
+#include <vector>
 
 #include <knocknock/interrupt.h>
 
@@ -113,4 +114,52 @@ TEST_CASE("Interrupt via modifying IF", "[interrupt]") {
     }
 }
 
-}  // namespace interrupt
\ No newline at end of file
+TEST_CASE("Interrupts are serviced by priority", "[interrupt]") {
+    // Records the order of interrupts, and refuses them while |accept| is
+    // false.
+    class Recorder : public Interruptible {
+    public:
+        bool interrupt(InterruptType reason) override {
+            if (!accept) {
+                return false;
+            }
+            order.push_back(reason);
+            return true;
+        }
+
+        bool accept = false;
+        std::vector<InterruptType> order;
+    };
+
+    Recorder sink;
+    InterruptController controller(&sink);
+
+    controller[IE] = 0x1f;
+    controller.interrupt(InterruptType::JOYPAD);
+    controller.interrupt(InterruptType::TIMER);
+    controller.interrupt(InterruptType::VBLANK);
+    REQUIRE(controller.pending() == 0b1'0101);
+
+    // A refused interrupt stays requested.
+    controller.tick();
+    REQUIRE(sink.order.empty());
+    REQUIRE(controller.pending() == 0b1'0101);
+
+    // One interrupt per tick, from bit 0 up.
+    sink.accept = true;
+    for (int i = 0; i < 4; ++i) {
+        controller.tick();
+    }
+    REQUIRE(sink.order == std::vector<InterruptType>{InterruptType::VBLANK,
+                                                     InterruptType::TIMER,
+                                                     InterruptType::JOYPAD});
+    REQUIRE(controller.pending() == 0);
+    REQUIRE(controller[IF] == UNUSED_BIT_MASK);
+
+    // Disabled interrupts are not pending.
+    controller[IE] = 0x01;
+    controller[IF] = 0x1e;
+    REQUIRE(controller.pending() == 0);
+}
+
+}  // namespace interrupt
@@ -0,0 +1,113 @@
+#include <catch2/catch.hpp>
+
+#include <knocknock/cartridge.h>
+#include <knocknock/memory/controller.h>
+#include <knocknock/memory/flat_rom.h>
+#include <knocknock/memory/mbc1.h>
+#include <knocknock/memory/mbc2.h>
+#include <knocknock/memory/mbc3.h>
+#include <knocknock/memory/mbc5.h>
+#include <knocknock/memory/regions.h>
+
+#include <vector>
+
+#include "memory/unittest_utils.h"
+
+namespace memory {
+
+namespace {
+
+using CartridgeType = Cartridge::CartridgeType;
+
+constexpr size_t KBYTE = 1024;
+
+Cartridge make_cartridge(CartridgeType type,
+                         size_t rom_banks,
+                         size_t ram_size,
+                         std::vector<MemoryValue> content = {}) {
+    if (content.empty()) {
+        content = testing::generate_test_rom(rom_banks,
+                                             {{0x00, 0x01}, {0x01, 0x02}});
+    }
+
+    return Cartridge("TEST", Cartridge::GameBoyType::GameBoy, type,
+                     rom_banks * ROM_SWITCHABLE_SIZE, ram_size,
+                     std::move(content));
+}
+
+}  // namespace
+
+TEST_CASE("Controller types", "[memory][controller]") {
+    auto flat = make_controller(make_cartridge(CartridgeType::ROM, 2, 0));
+    REQUIRE(dynamic_cast<FlatROM *>(flat.get()) != nullptr);
+
+    auto mbc1 = make_controller(
+        make_cartridge(CartridgeType::ROM_MBC1_RAM_BATT, 4, 8 * KBYTE));
+    REQUIRE(dynamic_cast<MBC1 *>(mbc1.get()) != nullptr);
+
+    auto mbc2 = make_controller(make_cartridge(CartridgeType::ROM_MBC2, 4, 0));
+    REQUIRE(dynamic_cast<MBC2 *>(mbc2.get()) != nullptr);
+
+    auto mbc3 = make_controller(
+        make_cartridge(CartridgeType::ROM_MBC3_RTC_RAM_BATT, 4, 32 * KBYTE));
+    REQUIRE(dynamic_cast<MBC3 *>(mbc3.get()) != nullptr);
+
+    auto mbc5 = make_controller(
+        make_cartridge(CartridgeType::ROM_MBC5_RUMBLE_SRAM, 4, 128 * KBYTE));
+    REQUIRE(dynamic_cast<MBC5 *>(mbc5.get()) != nullptr);
+
+    for (const auto *controller : {flat.get(), mbc1.get(), mbc2.get(),
+                                   mbc3.get(), mbc5.get()}) {
+        REQUIRE(testing::verify_rom_0_value(*controller, 0x01));
+        REQUIRE(testing::verify_rom_switchable_value(*controller, 0x02));
+    }
+}
+
+TEST_CASE("Controller RAM size", "[memory][controller]") {
+    auto mbc5 = make_controller(
+        make_cartridge(CartridgeType::ROM_MBC5_RAM_BATT, 2, 128 * KBYTE));
+    REQUIRE(mbc5 != nullptr);
+
+    // All 16 banks are there.
+    mbc5->write(0x0000, 0x0a);
+    mbc5->write(0x4000, 0x0f);
+    testing::fill_external_ram(mbc5.get(), 0x0f);
+    mbc5->write(0x4000, 0x00);
+    REQUIRE_FALSE(testing::verify_external_ram_value(*mbc5, 0x0f));
+    mbc5->write(0x4000, 0x0f);
+    REQUIRE(testing::verify_external_ram_value(*mbc5, 0x0f));
+
+    // Types without RAM have none, whatever the header says.
+    auto mbc1 =
+        make_controller(make_cartridge(CartridgeType::ROM_MBC1, 2, 8 * KBYTE));
+    mbc1->write(0x0000, 0x0a);
+    mbc1->write(RAM_EXTERNAL_BEGIN, 0x12);
+    REQUIRE(mbc1->read(RAM_EXTERNAL_BEGIN) == 0xff);
+
+    // RAM too large for the controller.
+    REQUIRE(make_controller(make_cartridge(CartridgeType::ROM_MBC1_RAM, 2,
+                                           128 * KBYTE)) == nullptr);
+}
+
+TEST_CASE("Controller ROM size", "[memory][controller]") {
+    // The header says 4 banks, but the content only has 2.
+    auto content = testing::generate_test_rom(2, {{0x00, 0x01}, {0x01, 0x02}});
+    auto mbc1 = make_controller(
+        make_cartridge(CartridgeType::ROM_MBC1, 4, 0, content));
+    REQUIRE(mbc1 != nullptr);
+
+    // The missing banks are padded rather than mirrored.
+    mbc1->write(0x2000, 0x03);
+    REQUIRE(testing::verify_rom_switchable_value(*mbc1, 0xff));
+}
+
+TEST_CASE("Unsupported controllers", "[memory][controller]") {
+    for (CartridgeType type :
+         {CartridgeType::ROM_MMM01, CartridgeType::POCKET_CAMERA,
+          CartridgeType::BANDAI_TAMA5, CartridgeType::HUDSON_HUC3,
+          CartridgeType::HUDSON_HUC1}) {
+        REQUIRE(make_controller(make_cartridge(type, 2, 0)) == nullptr);
+    }
+}
+
+}  // namespace memory
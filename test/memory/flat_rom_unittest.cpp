@@ -1,6 +1,10 @@
 #include <catch2/catch.hpp>
 
 #include <knocknock/memory/flat_rom.h>
+#include <knocknock/memory/mmu.h>
+
+#include <algorithm>
+#include <vector>
 
 #include "memory/unittest_utils.h"
 
@@ -24,4 +28,39 @@ TEST_CASE("RAM read + write", "[memory][FlatROM]") {
     REQUIRE(testing::verify_external_ram_value(flat_rom, 0x8a));
 }
 
+TEST_CASE("FlatROM blocks", "[memory][FlatROM]") {
+    auto rom = testing::generate_test_rom(2, {{0x00, 0x01}, {0x01, 0x02}});
+    FlatROM flat_rom(rom, 0x1000);
+
+    std::vector<MemoryValue> read(0x20);
+    flat_rom.read_block(ROM_SWITCHABLE_BEGIN - 0x10, read.data(), read.size());
+    REQUIRE(read[0x0f] == 0x01);
+    REQUIRE(read[0x10] == 0x02);
+
+    // ROM is not writable.
+    const std::vector<MemoryValue> data(0x20, 0x42);
+    flat_rom.write_block(ROM_0_BEGIN, data.data(), data.size());
+    REQUIRE(flat_rom.read(ROM_0_BEGIN) == 0x01);
+
+    flat_rom.write_block(RAM_EXTERNAL_BEGIN, data.data(), data.size());
+    flat_rom.read_block(RAM_EXTERNAL_BEGIN, read.data(), read.size());
+    REQUIRE(read == data);
+}
+
+TEST_CASE("FlatROM without RAM", "[memory][FlatROM]") {
+    auto rom = testing::generate_test_rom(2, {{0x00, 0x01}, {0x01, 0x02}});
+    FlatROM flat_rom(rom, 0);
+    MMU mmu;
+    mmu.register_region(&flat_rom, RAM_EXTERNAL_BEGIN, RAM_EXTERNAL_END);
+
+    // Missing RAM reads as 0xff instead of failing.
+    std::vector<MemoryValue> read(0x20, 0x00);
+    mmu.peek_block(RAM_EXTERNAL_BEGIN, read.data(), read.size());
+    REQUIRE(read == std::vector<MemoryValue>(0x20, 0xff));
+
+    std::fill(read.begin(), read.end(), 0x00);
+    mmu.read_block(RAM_EXTERNAL_END - 0x1f, read.data(), read.size());
+    REQUIRE(read == std::vector<MemoryValue>(0x20, 0xff));
+}
+
 }  // namespace memory
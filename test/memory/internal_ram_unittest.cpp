@@ -2,6 +2,8 @@
 
 #include <knocknock/memory/internal_ram.h>
 
+#include <vector>
+
 namespace memory {
 
 TEST_CASE("Internal RAM", "[memory]") {
@@ -59,4 +61,24 @@ TEST_CASE("HRAM", "[memory]") {
     }
 }
 
+TEST_CASE("Internal RAM blocks", "[memory]") {
+    InternalRAM ram;
+
+    // Crosses from the end of WRAM to the start of echo RAM, which mirrors
+    // the start of WRAM.
+    const std::vector<MemoryValue> data = {0x01, 0x02, 0x03, 0x04};
+    ram.write_block(RAM_INTERNAL_END - 1, data.data(), data.size());
+    REQUIRE(ram.read(RAM_INTERNAL_END) == 0x02);
+    REQUIRE(ram.read(RAM_INTERNAL_BEGIN) == 0x03);
+    REQUIRE(ram.read(RAM_INTERNAL_BEGIN + 1) == 0x04);
+
+    std::vector<MemoryValue> read(data.size());
+    ram.read_block(RAM_INTERNAL_END - 1, read.data(), read.size());
+    REQUIRE(read == data);
+
+    ram.write_block(HRAM_BEGIN, data.data(), data.size());
+    ram.read_block(HRAM_BEGIN, read.data(), read.size());
+    REQUIRE(read == data);
+}
+
 }  // namespace memory
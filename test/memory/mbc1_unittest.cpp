@@ -2,6 +2,8 @@
 
 #include <knocknock/memory/mbc1.h>
 
+#include <vector>
+
 #include "memory/unittest_utils.h"
 
 namespace memory {
@@ -188,4 +190,65 @@ TEST_CASE("Out-of-bound RAM read", "[memory][mbc1]") {
     REQUIRE(testing::verify_external_ram_value(mem, 0x02));
 }
 
+TEST_CASE("MBC1 blocks", "[memory][mbc1]") {
+    auto rom = testing::generate_test_rom(4, {{0x00, 0x01}, {0x03, 0x04}});
+    MBC1 mem(rom, 2 * RAM_BANK_SIZE);
+    switch_rom_bank(&mem, 0x03);
+
+    std::vector<MemoryValue> read(0x20);
+    mem.read_block(ROM_SWITCHABLE_BEGIN - 0x10, read.data(), read.size());
+    REQUIRE(read[0x0f] == 0x01);
+    REQUIRE(read[0x10] == 0x04);
+
+    // Disabled RAM reads as 0xff.
+    mem.peek_block(RAM_EXTERNAL_BEGIN, read.data(), read.size());
+    REQUIRE(read == std::vector<MemoryValue>(read.size(), 0xff));
+
+    // The block goes through the registers in order: this enables RAM, then
+    // selects the second RAM bank in mode 1.
+    const std::vector<MemoryValue> registers = {0x0a};
+    mem.write_block(0x1fff, registers.data(), registers.size());
+    mem.write(0x6000, 1);
+    switch_ram_bank(&mem, 0x01);
+
+    const std::vector<MemoryValue> data(0x20, 0x5a);
+    mem.write_block(RAM_EXTERNAL_END - 0x1f, data.data(), data.size());
+    mem.read_block(RAM_EXTERNAL_END - 0x1f, read.data(), read.size());
+    REQUIRE(read == data);
+    REQUIRE(mem.read(RAM_EXTERNAL_END) == 0x5a);
+
+    switch_ram_bank(&mem, 0x00);
+    REQUIRE(mem.read(RAM_EXTERNAL_END) == 0x00);
+}
+
+TEST_CASE("ROM not made of whole banks", "[memory][mbc1]") {
+    auto rom = testing::generate_test_rom(1, {{0x00, 0x01}});
+    rom.resize(rom.size() + 0x100, 0x02);
+
+    MBC1 mem(rom, 0);
+
+    // The last bank is padded with 0xff.
+    switch_rom_bank(&mem, 0x01);
+    REQUIRE(mem.read(ROM_SWITCHABLE_BEGIN) == 0x02);
+    REQUIRE(mem.read(ROM_SWITCHABLE_BEGIN + 0xff) == 0x02);
+    REQUIRE(mem.read(ROM_SWITCHABLE_BEGIN + 0x100) == 0xff);
+    REQUIRE(mem.read(ROM_SWITCHABLE_END) == 0xff);
+
+    // Banks wrap around the padded ROM.
+    switch_rom_bank(&mem, 0x02);
+    REQUIRE(testing::verify_rom_switchable_value(mem, 0x01));
+}
+
+TEST_CASE("RAM smaller than a bank", "[memory][mbc1]") {
+    MBC1 mem({}, 0x800);
+
+    // Enable RAM.
+    mem.write(0x1010, 0xfa);
+
+    // The 2 KByte of RAM are mirrored over the whole region.
+    mem.write(RAM_EXTERNAL_BEGIN + 0x10, 0x42);
+    REQUIRE(mem.read(RAM_EXTERNAL_BEGIN + 0x810) == 0x42);
+    REQUIRE(mem.read(RAM_EXTERNAL_BEGIN + 0x1810) == 0x42);
+}
+
 }  // namespace memory
@@ -3,6 +3,8 @@
 #include <knocknock/memory/mbc2.h>
 #include <knocknock/memory/regions.h>
 
+#include <vector>
+
 #include "memory/unittest_utils.h"
 
 namespace memory {
@@ -88,4 +90,62 @@ TEST_CASE("ROM: Out-of-bound read", "[memory][mbc2]") {
     REQUIRE(testing::verify_rom_switchable_value(mem, 0x02));
 }
 
+TEST_CASE("MBC2 blocks", "[memory][mbc2]") {
+    auto rom = testing::generate_test_rom(4, {{0x00, 0x01}, {0x02, 0x03}});
+    MBC2 mem(rom);
+    switch_rom_bank(&mem, 0x02);
+
+    std::vector<MemoryValue> read(0x20);
+    mem.read_block(ROM_SWITCHABLE_BEGIN - 0x10, read.data(), read.size());
+    REQUIRE(read[0x0f] == 0x01);
+    REQUIRE(read[0x10] == 0x03);
+
+    mem.peek_block(RAM_EXTERNAL_BEGIN, read.data(), read.size());
+    REQUIRE(read == std::vector<MemoryValue>(read.size(), 0xff));
+
+    // Enable RAM, through the registers.
+    const MemoryValue enable = 0x0a;
+    mem.write_block(0x0038, &enable, 1);
+
+    // Only the lower nibble is stored, and the RAM is mirrored.
+    const std::vector<MemoryValue> data(0x20, 0x5a);
+    mem.write_block(RAM_EXTERNAL_BEGIN + RAM_SIZE - 0x10, data.data(),
+                    data.size());
+    mem.read_block(RAM_EXTERNAL_BEGIN + RAM_SIZE - 0x10, read.data(),
+                   read.size());
+    REQUIRE(read == std::vector<MemoryValue>(read.size(), 0xfa));
+    REQUIRE(mem.read(RAM_EXTERNAL_BEGIN) == 0xfa);
+
+    // Up to the end of the external RAM area.
+    mem.write_block(RAM_EXTERNAL_END - 0x1f, data.data(), data.size());
+    REQUIRE(mem.read(RAM_EXTERNAL_END) == 0xfa);
+
+    // Across the end of the external RAM area, only the bytes up to $BFFF
+    // are stored, and the others do not wrap around to the start of the RAM.
+    std::vector<MemoryValue> pattern(0x20);
+    for (size_t i = 0; i < pattern.size(); ++i) {
+        pattern[i] = i;
+    }
+    mem.write_block(RAM_EXTERNAL_END - 0x0f, pattern.data(), pattern.size());
+    std::vector<MemoryValue> stored(0x10);
+    mem.read_block(RAM_EXTERNAL_END - 0x0f, stored.data(), stored.size());
+    for (size_t i = 0; i < stored.size(); ++i) {
+        REQUIRE(stored[i] == (0xf0 | i));
+    }
+    mem.read_block(RAM_EXTERNAL_BEGIN, stored.data(), stored.size());
+    REQUIRE(stored == std::vector<MemoryValue>(stored.size(), 0xfa));
+
+    // Over disabled RAM, the bytes of the RAM are dropped, and the others
+    // still go to write().
+    mem.write(0x0038, 0x00);
+    mem.write_block(RAM_EXTERNAL_END - 0x0f, data.data(), data.size());
+    mem.write(0x0038, 0x0a);
+    mem.read_block(RAM_EXTERNAL_END - 0x0f, stored.data(), stored.size());
+    for (size_t i = 0; i < stored.size(); ++i) {
+        REQUIRE(stored[i] == (0xf0 | i));
+    }
+    mem.read_block(RAM_EXTERNAL_BEGIN, stored.data(), stored.size());
+    REQUIRE(stored == std::vector<MemoryValue>(stored.size(), 0xfa));
+}
+
 }  // namespace memory
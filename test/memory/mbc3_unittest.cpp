@@ -0,0 +1,251 @@
+#include <catch2/catch.hpp>
+
+#include <knocknock/memory/mbc3.h>
+#include <knocknock/memory/regions.h>
+#include <knocknock/peripherals/scheduler.h>
+
+#include <chrono>
+#include <vector>
+
+#include "memory/unittest_utils.h"
+#include "peripherals/stubs.h"
+
+namespace memory {
+
+namespace {
+
+using peripherals::testing::NoCPU;
+
+constexpr MemorySize RAM_SIZE = 0x8000;  // 32KByte.
+
+// M-cycles in an emulated second.
+constexpr uint32_t SECOND = 1u << 20u;
+
+// Size of the clock at the end of a save.
+constexpr size_t RTC_SAVE_SIZE = 48;
+
+void enable_ram(MBC3 *mem) {
+    mem->write(0x0000, 0x0a);
+}
+
+void select(MBC3 *mem, uint8_t bank) {
+    mem->write(0x4000, bank);
+}
+
+void latch(MBC3 *mem) {
+    mem->write(0x6000, 0x00);
+    mem->write(0x6000, 0x01);
+}
+
+// Select and write the clock register |reg|.
+void set_register(MBC3 *mem, uint8_t reg, MemoryValue value) {
+    select(mem, reg);
+    mem->write(RAM_EXTERNAL_BEGIN, value);
+}
+
+// Latch the clock and read the register |reg|.
+MemoryValue get_register(MBC3 *mem, uint8_t reg) {
+    latch(mem);
+    select(mem, reg);
+    return mem->read(RAM_EXTERNAL_BEGIN);
+}
+
+}  // namespace
+
+TEST_CASE("MBC3 ROM banks", "[memory][mbc3]") {
+    auto rom = testing::generate_test_rom(
+        128, {{0x00, 0x01}, {0x01, 0x02}, {0x40, 0x40}, {0x7f, 0x7f}});
+
+    MBC3 mem(rom, 0, false);
+
+    REQUIRE(testing::verify_rom_0_value(mem, 0x01));
+    REQUIRE(testing::verify_rom_switchable_value(mem, 0x02));
+
+    // All 7 bits select the bank, up to 2MByte.
+    mem.write(0x2000, 0x40);
+    REQUIRE(testing::verify_rom_switchable_value(mem, 0x40));
+
+    mem.write(0x3fff, 0xff);
+    REQUIRE(testing::verify_rom_switchable_value(mem, 0x7f));
+
+    // Bank 0 selects bank 1 instead.
+    mem.write(0x2000, 0x00);
+    REQUIRE(testing::verify_rom_switchable_value(mem, 0x02));
+}
+
+TEST_CASE("MBC3 RAM banks", "[memory][mbc3]") {
+    MBC3 mem({}, RAM_SIZE, false);
+
+    // Disabled RAM is not written.
+    testing::fill_external_ram(&mem, 0x12);
+    enable_ram(&mem);
+    REQUIRE_FALSE(testing::verify_external_ram_value(mem, 0x12));
+
+    for (uint8_t bank = 0; bank < 4; ++bank) {
+        select(&mem, bank);
+        testing::fill_external_ram(&mem, 0x10 + bank);
+    }
+
+    for (uint8_t bank = 0; bank < 4; ++bank) {
+        select(&mem, bank);
+        REQUIRE(testing::verify_external_ram_value(mem, 0x10 + bank));
+        REQUIRE(mem.host_write_ptr(RAM_EXTERNAL_BEGIN) != nullptr);
+    }
+
+    mem.write(0x0000, 0x00);
+    REQUIRE(mem.read(RAM_EXTERNAL_BEGIN) == 0xff);
+    REQUIRE(mem.host_write_ptr(RAM_EXTERNAL_BEGIN) == nullptr);
+}
+
+TEST_CASE("MBC3 clock", "[memory][mbc3]") {
+    NoCPU cpu;
+    peripherals::Scheduler scheduler(&cpu);
+    MBC3 mem({}, RAM_SIZE, true, &scheduler);
+    REQUIRE(mem.clock_source() == MBC3::ClockSource::EMULATED);
+    enable_ram(&mem);
+
+    // The clock registers are not memory.
+    select(&mem, 0x08);
+    REQUIRE(mem.host_write_ptr(RAM_EXTERNAL_BEGIN) == nullptr);
+    REQUIRE(get_register(&mem, 0x08) == 0);
+
+    scheduler.run(SECOND - 1);
+    REQUIRE(get_register(&mem, 0x08) == 0);
+    scheduler.run(1);
+    REQUIRE(get_register(&mem, 0x08) == 1);
+
+    // The latched registers only change when latched again.
+    scheduler.run(2 * SECOND);
+    select(&mem, 0x08);
+    REQUIRE(mem.read(RAM_EXTERNAL_BEGIN) == 1);
+    REQUIRE(get_register(&mem, 0x08) == 3);
+
+    // Roll over to the next day.
+    set_register(&mem, 0x08, 59);
+    set_register(&mem, 0x09, 59);
+    set_register(&mem, 0x0a, 23);
+    scheduler.run(SECOND);
+    REQUIRE(get_register(&mem, 0x08) == 0);
+    REQUIRE(get_register(&mem, 0x09) == 0);
+    REQUIRE(get_register(&mem, 0x0a) == 0);
+    REQUIRE(get_register(&mem, 0x0b) == 1);
+    REQUIRE(get_register(&mem, 0x0c) == 0);
+
+    // The day counter overflows past 511, and sets the carry.
+    set_register(&mem, 0x0a, 23);
+    set_register(&mem, 0x09, 59);
+    set_register(&mem, 0x0b, 0xff);
+    set_register(&mem, 0x0c, 0x01);
+    set_register(&mem, 0x08, 59);
+    scheduler.run(SECOND);
+    REQUIRE(get_register(&mem, 0x0b) == 0);
+    REQUIRE(get_register(&mem, 0x0c) == 0x80);
+
+    // A halted clock does not count.
+    set_register(&mem, 0x0c, 0x40);
+    scheduler.run(5 * SECOND);
+    REQUIRE(get_register(&mem, 0x08) == 0);
+    REQUIRE(get_register(&mem, 0x0c) == 0x40);
+
+    // And resumes from where it was.
+    set_register(&mem, 0x0c, 0x00);
+    scheduler.run(SECOND);
+    REQUIRE(get_register(&mem, 0x08) == 1);
+}
+
+TEST_CASE("MBC3 without a clock", "[memory][mbc3]") {
+    MBC3 mem({}, RAM_SIZE, false);
+    enable_ram(&mem);
+
+    set_register(&mem, 0x08, 0x12);
+    REQUIRE(get_register(&mem, 0x08) == 0xff);
+    REQUIRE(mem.save().size() == RAM_SIZE);
+}
+
+TEST_CASE("MBC3 blocks", "[memory][mbc3]") {
+    auto rom = testing::generate_test_rom(4, {{0x00, 0x01}, {0x03, 0x03}});
+    MBC3 mem(rom, RAM_SIZE, true);
+    enable_ram(&mem);
+    mem.write(0x2000, 0x03);
+
+    std::vector<MemoryValue> data(0x10);
+    mem.read_block(ROM_SWITCHABLE_BEGIN - 8, data.data(), data.size());
+    REQUIRE(data == std::vector<MemoryValue>{0x01, 0x01, 0x01, 0x01, 0x01,
+                                             0x01, 0x01, 0x01, 0x03, 0x03,
+                                             0x03, 0x03, 0x03, 0x03, 0x03,
+                                             0x03});
+
+    select(&mem, 0x01);
+    const std::vector<MemoryValue> written(RAM_EXTERNAL_SIZE, 0x5a);
+    mem.write_block(RAM_EXTERNAL_BEGIN, written.data(), written.size());
+    REQUIRE(testing::verify_external_ram_value(mem, 0x5a));
+
+    // A clock register is mapped to the whole region.
+    set_register(&mem, 0x09, 42);
+    latch(&mem);
+    mem.peek_block(RAM_EXTERNAL_END - 3, data.data(), 4);
+    REQUIRE(data[0] == 42);
+    REQUIRE(data[3] == 42);
+}
+
+TEST_CASE("MBC3 saves", "[memory][mbc3]") {
+    NoCPU cpu;
+    peripherals::Scheduler scheduler(&cpu);
+    MBC3 mem({}, RAM_SIZE, true, &scheduler);
+    enable_ram(&mem);
+    select(&mem, 0x02);
+    testing::fill_external_ram(&mem, 0x33);
+    set_register(&mem, 0x09, 12);
+    scheduler.run(5 * SECOND);
+    latch(&mem);
+
+    const std::vector<MemoryValue> save = mem.save();
+    REQUIRE(save.size() == RAM_SIZE + RTC_SAVE_SIZE);
+
+    MBC3 loaded({}, RAM_SIZE, true, &scheduler);
+    REQUIRE(loaded.load_save(save));
+    enable_ram(&loaded);
+    select(&loaded, 0x02);
+    REQUIRE(testing::verify_external_ram_value(loaded, 0x33));
+
+    // The latched registers are restored as they were.
+    select(&loaded, 0x08);
+    REQUIRE(loaded.read(RAM_EXTERNAL_BEGIN) == 5);
+    REQUIRE(get_register(&loaded, 0x09) == 12);
+
+    // The emulated clock does not count the time between the save and the
+    // load.
+    REQUIRE(get_register(&loaded, 0x08) == 5);
+    scheduler.run(SECOND);
+    REQUIRE(get_register(&loaded, 0x08) == 6);
+
+    // Saves of the wrong size are refused.
+    REQUIRE_FALSE(loaded.load_save(std::vector<MemoryValue>(RAM_SIZE + 1)));
+    REQUIRE(loaded.load_save(std::vector<MemoryValue>(RAM_SIZE)));
+}
+
+TEST_CASE("MBC3 host clock", "[memory][mbc3]") {
+    MBC3 mem({}, 0, true);
+    REQUIRE(mem.clock_source() == MBC3::ClockSource::HOST);
+    enable_ram(&mem);
+
+    // A save from 2 hours ago: the clock counted the hours since.
+    std::vector<MemoryValue> save = mem.save();
+    REQUIRE(save.size() == RTC_SAVE_SIZE);
+    const uint64_t now =
+        std::chrono::duration_cast<std::chrono::seconds>(
+            std::chrono::system_clock::now().time_since_epoch())
+            .count();
+    const uint64_t saved_at = now - 2 * 60 * 60 - 30;
+    for (size_t i = 0; i < 8; ++i) {
+        save[RTC_SAVE_SIZE - 8 + i] =
+            static_cast<MemoryValue>(saved_at >> (8 * i));
+    }
+
+    REQUIRE(mem.load_save(save));
+    REQUIRE(get_register(&mem, 0x0a) == 2);
+    REQUIRE(get_register(&mem, 0x09) == 0);
+    REQUIRE(get_register(&mem, 0x08) >= 30);
+}
+
+}  // namespace memory
@@ -0,0 +1,128 @@
+#include <catch2/catch.hpp>
+
+#include <knocknock/memory/mbc5.h>
+#include <knocknock/memory/regions.h>
+
+#include <vector>
+
+#include "memory/unittest_utils.h"
+
+namespace memory {
+
+namespace {
+
+constexpr MemorySize RAM_SIZE = 0x20000;  // 128KByte.
+
+void switch_rom_bank(MBC5 *mem, uint16_t bank) {
+    mem->write(0x2000, bank & 0xff);
+    mem->write(0x3000, bank >> 8);
+}
+
+void switch_ram_bank(MBC5 *mem, uint8_t bank) {
+    mem->write(0x4000, bank);
+}
+
+}  // namespace
+
+TEST_CASE("MBC5 ROM banks", "[memory][mbc5]") {
+    // Banks 0x000 - 0x1ff: the generated ROM only holds the lower 8 bits of
+    // the bank number, so the upper banks are told apart by their value.
+    auto rom = testing::generate_test_rom(
+        512, {{0x00, 0x01}, {0x01, 0x02}, {0xff, 0xff}});
+    for (size_t i = 0x100 * ROM_SWITCHABLE_SIZE; i < rom.size(); ++i) {
+        rom[i] = 0x80;
+    }
+
+    MBC5 mem(rom, 0, false);
+
+    REQUIRE(testing::verify_rom_0_value(mem, 0x01));
+    REQUIRE(testing::verify_rom_switchable_value(mem, 0x02));
+
+    switch_rom_bank(&mem, 0xff);
+    REQUIRE(testing::verify_rom_switchable_value(mem, 0xff));
+
+    // The 9th bit reaches the upper 4MByte.
+    switch_rom_bank(&mem, 0x1ff);
+    REQUIRE(testing::verify_rom_switchable_value(mem, 0x80));
+    REQUIRE(testing::verify_rom_0_value(mem, 0x01));
+
+    // Bank 0 is not remapped to bank 1.
+    switch_rom_bank(&mem, 0x000);
+    REQUIRE(testing::verify_rom_switchable_value(mem, 0x01));
+}
+
+TEST_CASE("MBC5 ROM banks wrap around", "[memory][mbc5]") {
+    auto rom = testing::generate_test_rom(4, {{0x00, 0x01}, {0x02, 0x03}});
+
+    MBC5 mem(rom, 0, false);
+
+    switch_rom_bank(&mem, 0x106);
+    REQUIRE(testing::verify_rom_switchable_value(mem, 0x03));
+    REQUIRE(mem.host_read_ptr(ROM_SWITCHABLE_BEGIN) != nullptr);
+    REQUIRE(*mem.host_read_ptr(ROM_SWITCHABLE_BEGIN) == 0x03);
+}
+
+TEST_CASE("MBC5 RAM banks", "[memory][mbc5]") {
+    MBC5 mem({}, RAM_SIZE, false);
+
+    mem.write(0x0000, 0x0a);
+
+    for (uint8_t bank = 0; bank < 16; ++bank) {
+        switch_ram_bank(&mem, bank);
+        testing::fill_external_ram(&mem, 0x20 + bank);
+    }
+
+    for (uint8_t bank = 0; bank < 16; ++bank) {
+        switch_ram_bank(&mem, bank);
+        REQUIRE(testing::verify_external_ram_value(mem, 0x20 + bank));
+    }
+
+    // Only the lower 4 bits select the bank.
+    switch_ram_bank(&mem, 0x13);
+    REQUIRE(testing::verify_external_ram_value(mem, 0x23));
+    REQUIRE_FALSE(mem.rumble());
+
+    mem.write(0x0000, 0x00);
+    REQUIRE(mem.read(RAM_EXTERNAL_BEGIN) == 0xff);
+    REQUIRE(mem.host_write_ptr(RAM_EXTERNAL_BEGIN) == nullptr);
+}
+
+TEST_CASE("MBC5 rumble", "[memory][mbc5]") {
+    MBC5 mem({}, 0x10000, true);
+
+    mem.write(0x0000, 0x0a);
+    switch_ram_bank(&mem, 0x02);
+    testing::fill_external_ram(&mem, 0x42);
+    REQUIRE_FALSE(mem.rumble());
+
+    // Bit 3 drives the motor instead of selecting the bank.
+    switch_ram_bank(&mem, 0x0a);
+    REQUIRE(mem.rumble());
+    REQUIRE(testing::verify_external_ram_value(mem, 0x42));
+
+    switch_ram_bank(&mem, 0x02);
+    REQUIRE_FALSE(mem.rumble());
+}
+
+TEST_CASE("MBC5 blocks", "[memory][mbc5]") {
+    auto rom = testing::generate_test_rom(4, {{0x00, 0x01}, {0x02, 0x03}});
+    MBC5 mem(rom, RAM_SIZE, false);
+    switch_rom_bank(&mem, 0x02);
+
+    std::vector<MemoryValue> read(0x10);
+    mem.read_block(ROM_SWITCHABLE_BEGIN - 8, read.data(), read.size());
+    REQUIRE(read[0x07] == 0x01);
+    REQUIRE(read[0x08] == 0x03);
+
+    mem.write(0x0000, 0x0a);
+    switch_ram_bank(&mem, 0x0f);
+    const std::vector<MemoryValue> data(0x20, 0x5a);
+    mem.write_block(RAM_EXTERNAL_END - 0x1f, data.data(), data.size());
+    mem.peek_block(RAM_EXTERNAL_END - 0x1f, read.data(), read.size());
+    REQUIRE(read == std::vector<MemoryValue>(read.size(), 0x5a));
+
+    switch_ram_bank(&mem, 0x00);
+    REQUIRE(mem.read(RAM_EXTERNAL_END) == 0x00);
+}
+
+}  // namespace memory
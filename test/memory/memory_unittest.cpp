@@ -1,5 +1,6 @@
 /**
- * Test the functionality of read16(), write16() and the Proxy.
+ * Test the functionality of read16(), write16(), the block accesses and the
+ * Proxy.
  * @file memory_unittest.cpp
  */
 #include <catch2/catch.hpp>
@@ -7,8 +8,34 @@
 #include <knocknock/memory/memory.h>
 #include <knocknock/memory/test_memory.h>
 
+#include <vector>
+
 namespace memory {
 
+namespace {
+
+/**
+ * Only implements the byte accesses, and counts them.
+ */
+class ByteMemory : public Memory {
+public:
+    MemoryValue read(MemoryAddr addr) const override {
+        reads++;
+        return bytes[addr];
+    }
+
+    void write(MemoryAddr addr, MemoryValue value) override {
+        writes++;
+        bytes[addr] = value;
+    }
+
+    MemoryValue bytes[0x10000] = {};
+    mutable int reads = 0;
+    int writes = 0;
+};
+
+}  // namespace
+
 TEST_CASE("read16 + write16", "[memory]") {
     TestMemory mem;
 
@@ -59,4 +86,33 @@ TEST_CASE("Proxy", "[memory]") {
     }
 }
 
+TEST_CASE("Block accesses", "[memory]") {
+    const std::vector<MemoryValue> data = {0x12, 0x34, 0x56, 0x78, 0x9a};
+    std::vector<MemoryValue> read(data.size());
+
+    SECTION("Byte accesses by default") {
+        ByteMemory mem;
+        mem.write_block(0xfffb, data.data(), data.size());
+        REQUIRE(mem.writes == 5);
+        REQUIRE(mem.bytes[0xffff] == 0x9a);
+
+        mem.read_block(0xfffb, read.data(), read.size());
+        REQUIRE(mem.reads == 5);
+        REQUIRE(read == data);
+
+        mem.peek_block(0xfffc, read.data(), 1);
+        REQUIRE(read[0] == 0x34);
+    }
+
+    SECTION("Block accesses of the test memory") {
+        TestMemory mem;
+        mem.write_block(0x1234, data.data(), data.size());
+        REQUIRE(mem.read(0x1234) == 0x12);
+        REQUIRE(mem.read(0x1238) == 0x9a);
+
+        mem.read_block(0x1234, read.data(), read.size());
+        REQUIRE(read == data);
+    }
+}
+
 }  // namespace memory
@@ -0,0 +1,197 @@
+#include <catch2/catch.hpp>
+
+#include <knocknock/memory/internal_ram.h>
+#include <knocknock/memory/mbc1.h>
+#include <knocknock/memory/mmu.h>
+#include <knocknock/memory/test_memory.h>
+
+#include <vector>
+
+#include "memory/unittest_utils.h"
+
+namespace memory {
+
+TEST_CASE("Page-aligned regions", "[memory][mmu]") {
+    TestMemory low, high;
+    MMU mmu;
+
+    REQUIRE(mmu.register_region(&low, 0x0000, 0x7fff));
+    REQUIRE(mmu.register_region(&high, 0x8000, 0xfeff));
+
+    mmu.write(0x1234, 0x12);
+    mmu.write(0x9abc, 0x9a);
+
+    REQUIRE(low.read(0x1234) == 0x12);
+    REQUIRE(high.read(0x9abc) == 0x9a);
+    REQUIRE(mmu.read(0x1234) == 0x12);
+    REQUIRE(mmu.read(0x9abc) == 0x9a);
+}
+
+TEST_CASE("Regions sharing a page", "[memory][mmu]") {
+    TestMemory first, second, third;
+    MMU mmu;
+
+    REQUIRE(mmu.register_region(&first, 0xff01, 0xff02));
+    REQUIRE(mmu.register_region(&second, 0xff80, 0xfffe));
+    REQUIRE(mmu.register_region(&third, 0xffff, 0xffff));
+
+    mmu.write(0xff01, 0x01);
+    mmu.write(0xff80, 0x80);
+    mmu.write(0xffff, 0xff);
+
+    REQUIRE(first.read(0xff01) == 0x01);
+    REQUIRE(second.read(0xff80) == 0x80);
+    REQUIRE(third.read(0xffff) == 0xff);
+
+    // Unmapped addresses in a partially mapped page are not dispatched to any
+    // of the regions sharing the page.
+    mmu.write(0xff00, 0x42);
+    REQUIRE(mmu.read(0xff00) == 0xff);
+    REQUIRE(first.read(0xff00) == 0x00);
+}
+
+TEST_CASE("Region not aligned to pages", "[memory][mmu]") {
+    TestMemory partial, whole;
+    MMU mmu;
+
+    // Spans the end of one page, two whole pages and the start of another.
+    REQUIRE(mmu.register_region(&partial, 0x10f0, 0x1310));
+    // Claims the rest of the last partially mapped page.
+    REQUIRE(mmu.register_region(&whole, 0x1311, 0x13ff));
+
+    for (uint32_t addr = 0x10f0; addr <= 0x1310; ++addr) {
+        mmu.write(addr, 0x69);
+    }
+    mmu.write(0x1311, 0x96);
+
+    REQUIRE(partial.read(0x10f0) == 0x69);
+    REQUIRE(partial.read(0x1200) == 0x69);
+    REQUIRE(partial.read(0x1310) == 0x69);
+    REQUIRE(partial.read(0x1311) == 0x00);
+    REQUIRE(whole.read(0x1311) == 0x96);
+}
+
+TEST_CASE("Overlapping regions", "[memory][mmu]") {
+    TestMemory first, second;
+    MMU mmu;
+
+    REQUIRE(mmu.register_region(&first, 0x2000, 0x3fff));
+
+    // Start or end inside an existing region.
+    REQUIRE_FALSE(mmu.register_region(&second, 0x1000, 0x2000));
+    REQUIRE_FALSE(mmu.register_region(&second, 0x3fff, 0x5000));
+    // Completely containing an existing region.
+    REQUIRE_FALSE(mmu.register_region(&second, 0x0000, 0x7fff));
+
+    // The failed registrations do not change the mapping.
+    mmu.write(0x1000, 0x10);
+    REQUIRE(second.read(0x1000) == 0x00);
+    mmu.write(0x2000, 0x20);
+    REQUIRE(first.read(0x2000) == 0x20);
+}
+
+TEST_CASE("Host pointers of the internal RAM", "[memory][mmu]") {
+    InternalRAM ram;
+    TestMemory io;
+    MMU mmu;
+
+    REQUIRE(mmu.register_region(&ram, RAM_INTERNAL_BEGIN, RAM_INTERNAL_END));
+    REQUIRE(mmu.register_region(&ram, RAM_ECHO_BEGIN, RAM_ECHO_END));
+    REQUIRE(mmu.register_region(&io, IO_BEGIN, IO_END));
+    REQUIRE(mmu.register_region(&ram, HRAM_BEGIN, HRAM_END));
+    REQUIRE(mmu.register_region(&io, IE_REG, IE_REG));
+
+    const HostPageTable *table = mmu.host_page_table();
+    REQUIRE(table != nullptr);
+
+    // Echo RAM aliases the same host bytes as the WRAM it mirrors.
+    REQUIRE(table->read_ptr(RAM_INTERNAL_BEGIN) != nullptr);
+    REQUIRE(table->read_ptr(RAM_ECHO_BEGIN + 0x123) ==
+            table->read_ptr(RAM_INTERNAL_BEGIN + 0x123));
+    REQUIRE(table->write_ptr(RAM_ECHO_END) ==
+            table->write_ptr(RAM_INTERNAL_BEGIN + RAM_ECHO_SIZE - 1));
+
+    // HRAM is published per byte, while the IO registers and IE sharing its
+    // page are not.
+    REQUIRE(table->read_ptr(HRAM_BEGIN) != nullptr);
+    REQUIRE(table->write_ptr(HRAM_END) != nullptr);
+    REQUIRE(table->read_ptr(IO_BEGIN) == nullptr);
+    REQUIRE(table->read_ptr(IE_REG) == nullptr);
+
+    // Writes through the MMU land in the published bytes.
+    mmu.write(RAM_ECHO_BEGIN + 0x42, 0x69);
+    REQUIRE(*table->read_ptr(RAM_INTERNAL_BEGIN + 0x42) == 0x69);
+    mmu.write(HRAM_BEGIN + 1, 0x96);
+    REQUIRE(ram.read(HRAM_BEGIN + 1) == 0x96);
+}
+
+TEST_CASE("Host pointers follow bank switches", "[memory][mmu]") {
+    auto rom = testing::generate_test_rom(
+        0x40,
+        {{0x00, 0x00}, {0x01, 0x01}, {0x07, 0x07}, {0x20, 0x20}, {0x21, 0x21}});
+    MBC1 mbc1(rom, RAM_EXTERNAL_SIZE);
+    MMU mmu;
+
+    REQUIRE(mmu.register_region(&mbc1, ROM_0_BEGIN, ROM_SWITCHABLE_END));
+    REQUIRE(mmu.register_region(&mbc1, RAM_EXTERNAL_BEGIN, RAM_EXTERNAL_END));
+
+    const HostPageTable *table = mmu.host_page_table();
+
+    REQUIRE(*table->read_ptr(ROM_0_BEGIN) == 0x00);
+    REQUIRE(*table->read_ptr(ROM_SWITCHABLE_BEGIN) == 0x01);
+
+    // Switching the bank republishes the switchable region.
+    mmu.write(0x2000, 0x07);
+    REQUIRE(*table->read_ptr(ROM_SWITCHABLE_END) == 0x07);
+
+    // In mode 1, BANK2 also moves the ROM_0 region.
+    mmu.write(0x2000, 0x01);
+    mmu.write(0x6000, 0x01);
+    mmu.write(0x4000, 0x01);
+    REQUIRE(*table->read_ptr(ROM_0_BEGIN) == 0x20);
+    REQUIRE(*table->read_ptr(ROM_SWITCHABLE_BEGIN) == 0x21);
+
+    // ROM writes are bank register writes and are never published.
+    REQUIRE(table->write_ptr(ROM_0_BEGIN) == nullptr);
+
+    // The external RAM is only published while it is enabled.
+    REQUIRE(table->read_ptr(RAM_EXTERNAL_BEGIN) == nullptr);
+    mmu.write(0x0000, 0x0a);
+    REQUIRE(table->write_ptr(RAM_EXTERNAL_BEGIN) != nullptr);
+    mmu.write(0x0000, 0x00);
+    REQUIRE(table->write_ptr(RAM_EXTERNAL_BEGIN) == nullptr);
+}
+
+TEST_CASE("Blocks across regions", "[memory][mmu]") {
+    TestMemory low, high, io;
+    MMU mmu;
+
+    REQUIRE(mmu.register_region(&low, 0x0000, 0x10ff));
+    REQUIRE(mmu.register_region(&high, 0x1100, 0x1180));
+    // 0x1181 - 0x11ff is unmapped.
+    REQUIRE(mmu.register_region(&io, 0x1200, 0x12ff));
+
+    std::vector<MemoryValue> data(0x300);
+    for (size_t i = 0; i < data.size(); ++i) {
+        data[i] = static_cast<MemoryValue>(i * 3);
+    }
+
+    mmu.write_block(0x1000, data.data(), data.size());
+    REQUIRE(low.read(0x10ff) == data[0xff]);
+    REQUIRE(high.read(0x1100) == data[0x100]);
+    REQUIRE(high.read(0x1180) == data[0x180]);
+    REQUIRE(io.read(0x12ff) == data[0x2ff]);
+
+    std::vector<MemoryValue> read(data.size());
+    mmu.read_block(0x1000, read.data(), read.size());
+    for (size_t i = 0; i < read.size(); ++i) {
+        REQUIRE(read[i] == mmu.read(0x1000 + i));
+    }
+    REQUIRE(read[0x181] == 0xff);
+
+    std::vector<MemoryValue> peeked(data.size());
+    mmu.peek_block(0x1000, peeked.data(), peeked.size());
+    REQUIRE(peeked == read);
+}
+
+}  // namespace memory
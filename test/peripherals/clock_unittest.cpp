@@ -19,6 +19,19 @@ private:
     uint64_t count_;
 };
 
+// Runs in chunks of 4 ticks, past the budget if needed.
+class ChunkedCounter : public ClockCounter {
+public:
+    // Tickable::
+    uint32_t run(uint32_t ticks) override {
+        const uint32_t chunked = (ticks + 3) / 4 * 4;
+        for (uint32_t i = 0; i < chunked; ++i) {
+            tick();
+        }
+        return chunked;
+    }
+};
+
 }  // namespace
 
 TEST_CASE("Divisible frequency", "[peripherals][clock]") {
@@ -47,4 +60,26 @@ TEST_CASE("Non divisible frequency", "[peripherals][clock]") {
     REQUIRE(counter.count() >= (17263 * 0.99));
 }
 
+TEST_CASE("Run in batches", "[peripherals][clock]") {
+    ClockCounter counter;
+    ChunkedCounter chunked;
+
+    Clock clock(1, 10);
+    clock.add_output(&counter);
+    clock.add_output(&chunked);
+
+    REQUIRE(clock.run(3) == 3);
+    REQUIRE(counter.count() == 30);
+    REQUIRE(chunked.count() == 32);
+
+    // The ticks run past the budget are deducted from the next period.
+    clock.run(1);
+    REQUIRE(counter.count() == 40);
+    REQUIRE(chunked.count() == 40);
+
+    clock.tick();
+    REQUIRE(counter.count() == 50);
+    REQUIRE(chunked.count() == 50);
+}
+
 }  // namespace peripherals
@@ -0,0 +1,212 @@
+#include <catch2/catch.hpp>
+
+#include <vector>
+
+#include <knocknock/interrupt.h>
+#include <knocknock/memory/test_memory.h>
+#include <knocknock/peripherals/scheduler.h>
+#include <knocknock/peripherals/serial.h>
+#include <knocknock/ppu/dma.h>
+
+namespace peripherals {
+
+namespace {
+
+// Stands for the CPU: records how long it is run for.
+class FakeCPU : public Tickable {
+public:
+    // Tickable::
+    void tick() override { runs.push_back(1); }
+    uint32_t run(uint32_t ticks) override {
+        runs.push_back(ticks);
+        return ticks;
+    }
+    bool idle() const override { return halted; }
+
+    std::vector<uint32_t> runs;
+    bool halted = false;
+};
+
+// Wakes the CPU up when ticked.
+class Waker : public Tickable {
+public:
+    explicit Waker(FakeCPU *cpu) : cpu_(cpu) {}
+
+    // Tickable::
+    void tick() override { cpu_->halted = false; }
+
+private:
+    FakeCPU *cpu_;
+};
+
+// Records the cycles it is ticked at.
+class Recorder : public Tickable {
+public:
+    Recorder(const Scheduler *scheduler, std::vector<int> *log, int id)
+        : scheduler_(scheduler), log_(log), id_(id) {}
+
+    // Tickable::
+    void tick() override {
+        log_->push_back(id_);
+        times.push_back(scheduler_->now());
+    }
+
+    std::vector<Scheduler::Timestamp> times;
+
+private:
+    const Scheduler *scheduler_;
+    std::vector<int> *log_;
+    int id_;
+};
+
+// Counts the interrupts offered to it, and takes them if |accept| is set.
+class CountingSink : public interrupt::Interruptible {
+public:
+    bool interrupt(interrupt::InterruptType) override {
+        count++;
+        return accept;
+    }
+
+    bool accept = true;
+    int count = 0;
+};
+
+}  // namespace
+
+TEST_CASE("Scheduler", "[peripherals][scheduler]") {
+    FakeCPU cpu;
+    Scheduler scheduler(&cpu);
+    std::vector<int> log;
+    Recorder first(&scheduler, &log, 1), second(&scheduler, &log, 2);
+
+    SECTION("The CPU runs until the next event") {
+        scheduler.schedule(&first, 10);
+        scheduler.schedule(&second, 4);
+
+        REQUIRE(scheduler.run(20) == 20);
+        REQUIRE(cpu.runs == std::vector<uint32_t>{5, 6, 9});
+        REQUIRE(log == std::vector<int>{2, 1});
+        REQUIRE(first.times == std::vector<Scheduler::Timestamp>{10});
+        REQUIRE(second.times == std::vector<Scheduler::Timestamp>{4});
+        REQUIRE(scheduler.now() == 20);
+    }
+
+    SECTION("Events due at the same cycle run in order") {
+        scheduler.schedule(&second, 3);
+        scheduler.schedule(&first, 3);
+
+        scheduler.run(3);
+        REQUIRE(log.empty());
+        scheduler.run(1);
+        REQUIRE(log == std::vector<int>{2, 1});
+    }
+
+    SECTION("Scheduling again moves the event") {
+        scheduler.schedule(&first, 3);
+        scheduler.schedule(&first, 5);
+        REQUIRE(scheduler.scheduled(&first));
+
+        scheduler.run(10);
+        REQUIRE(first.times == std::vector<Scheduler::Timestamp>{5});
+        REQUIRE_FALSE(scheduler.scheduled(&first));
+    }
+
+    SECTION("Cancelled events don't run") {
+        scheduler.schedule(&first, 3);
+        scheduler.cancel(&first);
+
+        scheduler.run(10);
+        REQUIRE(log.empty());
+        REQUIRE(cpu.runs == std::vector<uint32_t>{10});
+    }
+
+    SECTION("Time skips to the next event while the CPU is idle") {
+        Waker waker(&cpu);
+        cpu.halted = true;
+        scheduler.schedule(&first, 10000);
+        scheduler.schedule(&waker, 20000);
+
+        REQUIRE(scheduler.run(20100) == 20100);
+        REQUIRE(first.times == std::vector<Scheduler::Timestamp>{10000});
+        REQUIRE(cpu.runs == std::vector<uint32_t>{99});
+    }
+
+    SECTION("The CPU runs for at most a slice") {
+        scheduler.run(Scheduler::MAX_SLICE * 2 + 1);
+        REQUIRE(cpu.runs == std::vector<uint32_t>{Scheduler::MAX_SLICE,
+                                                  Scheduler::MAX_SLICE, 1});
+    }
+}
+
+TEST_CASE("Scheduled peripherals", "[peripherals][scheduler]") {
+    FakeCPU cpu;
+    Scheduler scheduler(&cpu);
+
+    SECTION("Serial only runs during a session") {
+        Serial serial(&scheduler);
+        serial.send(0x69);
+        REQUIRE_FALSE(scheduler.scheduled(&serial));
+
+        serial.write(0xff02, 0x81);
+        scheduler.run(7);
+        REQUIRE(serial.read(0xff02) == 0x81);
+
+        scheduler.run(1);
+        REQUIRE(serial.read(0xff02) == 0x01);
+        REQUIRE(serial.read(0xff01) == 0x69);
+        REQUIRE_FALSE(scheduler.scheduled(&serial));
+    }
+
+    SECTION("DMA only runs during a transfer") {
+        memory::TestMemory memory;
+        for (uint8_t i = 0; i < 160; ++i) {
+            memory[0x4500 + i] = i;
+        }
+
+        ppu::DMA dma(&memory, &scheduler);
+        REQUIRE_FALSE(scheduler.scheduled(&dma));
+
+        dma[0xff46] = 0x45;
+        scheduler.run(160);
+        for (uint8_t i = 0; i < 160; ++i) {
+            REQUIRE(memory[0xfe00 + i] == i);
+        }
+        REQUIRE_FALSE(scheduler.scheduled(&dma));
+    }
+
+    SECTION("Interrupt controller only runs when an interrupt is pending") {
+        CountingSink sink;
+        interrupt::InterruptController controller(&sink, &scheduler);
+        controller.write(0xffff, 0x01);
+        REQUIRE_FALSE(scheduler.scheduled(&controller));
+
+        controller.interrupt(interrupt::InterruptType::TIMER);
+        REQUIRE_FALSE(scheduler.scheduled(&controller));
+
+        controller.interrupt(interrupt::InterruptType::VBLANK);
+        scheduler.run(1);
+        REQUIRE(sink.count == 1);
+        REQUIRE_FALSE(scheduler.scheduled(&controller));
+    }
+
+    SECTION("Interrupt controller does not poll a sink which refused") {
+        CountingSink sink;
+        sink.accept = false;
+        interrupt::InterruptController controller(&sink, &scheduler);
+        controller.write(0xffff, 0x01);
+
+        controller.interrupt(interrupt::InterruptType::VBLANK);
+        scheduler.run(1000);
+        REQUIRE(sink.count == 1);
+        REQUIRE_FALSE(scheduler.scheduled(&controller));
+        REQUIRE(controller.pending() == 0x01);
+
+        // The sink asks for it once it can take it.
+        sink.accept = true;
+        REQUIRE(controller.service());
+        REQUIRE(sink.count == 2);
+        REQUIRE(controller.pending() == 0x00);
+    }
+}
+
+}  // namespace peripherals
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <cstdint>
+
+#include <knocknock/interrupt.h>
+#include <knocknock/peripherals/tickable.h>
+
+namespace peripherals::testing {
+
+/**
+ * Stands for a CPU which costs nothing, to run the peripherals alone.
+ */
+class NoCPU : public Tickable {
+public:
+    // Tickable::
+    void tick() override {}
+    uint32_t run(uint32_t ticks) override { return ticks; }
+};
+
+/**
+ * Accepts and drops every interrupt.
+ */
+class IgnoreInterrupts : public interrupt::Interruptible {
+public:
+    // Interruptible::
+    bool interrupt(interrupt::InterruptType) override { return true; }
+};
+
+}  // namespace peripherals::testing
@@ -0,0 +1,194 @@
+#include <catch2/catch.hpp>
+
+#include <knocknock/interrupt.h>
+#include <knocknock/peripherals/scheduler.h>
+#include <knocknock/peripherals/timer.h>
+
+#include "peripherals/stubs.h"
+
+namespace peripherals {
+
+namespace {
+
+using peripherals::testing::NoCPU;
+
+class CountInterrupts : public interrupt::Interruptible {
+public:
+    bool interrupt(interrupt::InterruptType reason) override {
+        REQUIRE(reason == interrupt::InterruptType::TIMER);
+        count++;
+        return true;
+    }
+
+    int count = 0;
+};
+
+void tick(Timer *timer, int ticks) {
+    for (int i = 0; i < ticks; ++i) {
+        timer->tick();
+    }
+}
+
+}  // namespace
+
+TEST_CASE("Timer", "[peripherals][timer]") {
+    CountInterrupts interrupts;
+    Timer timer(&interrupts);
+
+    SECTION("DIV counts every 64 cycles until written") {
+        tick(&timer, 63);
+        REQUIRE(timer.read(0xff04) == 0x00);
+        tick(&timer, 1);
+        REQUIRE(timer.read(0xff04) == 0x01);
+        tick(&timer, 64 * 0x100);
+        REQUIRE(timer.read(0xff04) == 0x01);
+
+        timer.write(0xff04, 0x42);
+        REQUIRE(timer.read(0xff04) == 0x00);
+        tick(&timer, 64);
+        REQUIRE(timer.read(0xff04) == 0x01);
+    }
+
+    SECTION("TIMA counts at the selected frequency") {
+        timer.write(0xff07, 0x05);  // 262144 Hz: every 4 cycles.
+        tick(&timer, 4 * 12);
+        REQUIRE(timer.read(0xff05) == 12);
+
+        timer.write(0xff07, 0x06);  // 65536 Hz: every 16 cycles.
+        tick(&timer, 16 * 10);
+        REQUIRE(timer.read(0xff05) == 22);
+
+        timer.write(0xff07, 0x02);  // Disabled.
+        tick(&timer, 1000);
+        REQUIRE(timer.read(0xff05) == 22);
+        REQUIRE(timer.read(0xff07) == 0xfa);
+    }
+
+    SECTION("TIMA is reloaded from TMA the cycle after it overflows") {
+        timer.write(0xff05, 0xfe);
+        timer.write(0xff06, 0x10);
+        timer.write(0xff07, 0x05);
+
+        tick(&timer, 8);
+        REQUIRE(timer.read(0xff05) == 0x00);
+        REQUIRE(interrupts.count == 0);
+
+        tick(&timer, 1);
+        REQUIRE(timer.read(0xff05) == 0x10);
+        REQUIRE(interrupts.count == 1);
+
+        tick(&timer, 4 * 0xf0);
+        REQUIRE(interrupts.count == 2);
+    }
+
+    SECTION("Writing TIMA after an overflow cancels the reload") {
+        timer.write(0xff05, 0xff);
+        timer.write(0xff07, 0x05);
+
+        tick(&timer, 4);
+        REQUIRE(timer.read(0xff05) == 0x00);
+        timer.write(0xff05, 0x80);
+
+        tick(&timer, 1);
+        REQUIRE(timer.read(0xff05) == 0x80);
+        REQUIRE(interrupts.count == 0);
+    }
+
+    SECTION("Writing DIV or TAC after an overflow keeps the reload") {
+        const memory::MemoryAddr addr = GENERATE(0xff04, 0xff07);
+        timer.write(0xff05, 0xfe);
+        timer.write(0xff06, 0xab);
+        timer.write(0xff07, 0x05);
+
+        tick(&timer, 8);
+        REQUIRE(timer.read(0xff05) == 0x00);
+        timer.write(addr, 0x05);
+        REQUIRE(timer.read(0xff05) == 0x00);
+        REQUIRE(interrupts.count == 0);
+
+        tick(&timer, 1);
+        REQUIRE(timer.read(0xff05) == 0xab);
+        REQUIRE(interrupts.count == 1);
+    }
+
+    SECTION("Resetting DIV is a falling edge") {
+        timer.write(0xff07, 0x05);
+
+        // Bit 3 of the divider is low.
+        tick(&timer, 1);
+        timer.write(0xff04, 0x00);
+        REQUIRE(timer.read(0xff05) == 0x00);
+
+        // Bit 3 of the divider is high.
+        tick(&timer, 2);
+        timer.write(0xff04, 0x00);
+        REQUIRE(timer.read(0xff05) == 0x01);
+    }
+
+    SECTION("Disabling the timer is a falling edge") {
+        timer.write(0xff07, 0x05);
+        tick(&timer, 2);
+        timer.write(0xff07, 0x01);
+        REQUIRE(timer.read(0xff05) == 0x01);
+    }
+}
+
+TEST_CASE("Scheduled timer", "[peripherals][timer][scheduler]") {
+    CountInterrupts interrupts;
+    NoCPU cpu;
+    Scheduler scheduler(&cpu);
+    Timer timer(&interrupts, &scheduler);
+
+    SECTION("Only overflows are scheduled") {
+        REQUIRE_FALSE(scheduler.scheduled(&timer));
+
+        timer.write(0xff07, 0x04);  // 4096 Hz: every 256 cycles.
+        REQUIRE(scheduler.scheduled(&timer));
+
+        scheduler.run(256 * 0x100);
+        REQUIRE(interrupts.count == 0);
+        REQUIRE(timer.read(0xff05) == 0x00);
+        REQUIRE(timer.read(0xff04) == 0x00);
+
+        scheduler.run(1);
+        REQUIRE(interrupts.count == 1);
+
+        scheduler.run(2 * 256 * 0x100);
+        REQUIRE(interrupts.count == 3);
+        REQUIRE(timer.read(0xff04) == 0x00);
+
+        timer.write(0xff07, 0x00);
+        REQUIRE_FALSE(scheduler.scheduled(&timer));
+    }
+
+    SECTION("Writing DIV or TAC after an overflow keeps the reload") {
+        const memory::MemoryAddr addr = GENERATE(0xff04, 0xff07);
+        timer.write(0xff05, 0xfe);
+        timer.write(0xff06, 0xab);
+        timer.write(0xff07, 0x05);
+
+        scheduler.run(8);
+        REQUIRE(timer.read(0xff05) == 0x00);
+        timer.write(addr, 0x05);
+        REQUIRE(interrupts.count == 0);
+
+        scheduler.run(1);
+        REQUIRE(timer.read(0xff05) == 0xab);
+        REQUIRE(interrupts.count == 1);
+    }
+
+    SECTION("Reads are derived from the current cycle") {
+        timer.write(0xff07, 0x05);
+        scheduler.run(1000);
+        REQUIRE(timer.read(0xff04) == 1000 / 64);
+        REQUIRE(timer.read(0xff05) == 1000 / 4 % 0x100);
+        REQUIRE(interrupts.count == 0);
+
+        scheduler.run(24);
+        REQUIRE(timer.read(0xff05) == 0x00);
+        scheduler.run(1);
+        REQUIRE(interrupts.count == 1);
+    }
+}
+
+}  // namespace peripherals
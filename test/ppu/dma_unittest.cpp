@@ -2,16 +2,32 @@
 
 #include <knocknock/ppu/dma.h>
 
+#include <knocknock/interrupt.h>
+#include <knocknock/memory/internal_ram.h>
+#include <knocknock/memory/mmu.h>
 #include <knocknock/memory/test_memory.h>
+#include <knocknock/peripherals/scheduler.h>
+#include <knocknock/ppu/ppu.h>
+
+#include "peripherals/stubs.h"
 
 namespace ppu {
 
 namespace {
 
+using peripherals::testing::IgnoreInterrupts;
+using peripherals::testing::NoCPU;
+
 constexpr memory::MemoryAddr SOURCE_ADDR = 0x4500;
 constexpr uint8_t SIZE = 160;
 constexpr memory::MemoryAddr DMA_ADDR = 0xff46;
 constexpr memory::MemoryAddr OAM_ADDR = 0xfe00;
+constexpr memory::MemoryAddr RAM_SOURCE_ADDR = 0xc300;
+constexpr memory::MemoryAddr LCDC = 0xff40;
+
+// Cycles from the start of a frame to VBlank, and to the next frame.
+constexpr uint32_t VBLANK_CYCLE = 144 * 114;
+constexpr uint32_t FRAME_CYCLES = 154 * 114;
 
 }  // namespace
 
@@ -39,4 +55,124 @@ TEST_CASE("DMA", "[ppu]") {
     }
 }
 
+TEST_CASE("Bulk DMA", "[ppu]") {
+    IgnoreInterrupts interrupts;
+    memory::InternalRAM ram;
+    PPU ppu(&interrupts);
+    memory::MMU mmu;
+    mmu.register_region(&ram, memory::RAM_INTERNAL_BEGIN,
+                        memory::RAM_INTERNAL_END);
+    ppu.register_to_mmu(&mmu);
+
+    for (uint8_t i = 0; i < SIZE; ++i) {
+        mmu.write(RAM_SOURCE_ADDR + i, 0xff - i);
+    }
+
+    DMA dma(&mmu);
+    dma.register_to_mmu(&mmu);
+
+    SECTION("The whole transfer is copied on its first cycle") {
+        mmu.write(LCDC, 0x00);
+        dma.set_bulk_transfers(true, &ppu);
+        mmu.write(DMA_ADDR, RAM_SOURCE_ADDR / 0x100);
+
+        dma.tick();
+        for (uint8_t i = 0; i < SIZE; ++i) {
+            REQUIRE(mmu.read(OAM_ADDR + i) == 0xff - i);
+        }
+
+        // The transfer still lasts 160 cycles.
+        for (uint8_t i = 1; i < SIZE - 1; ++i) {
+            dma.tick();
+            REQUIRE(mmu.read(DMA_ADDR) == 0xff);
+        }
+        dma.tick();
+        REQUIRE(mmu.read(DMA_ADDR) == RAM_SOURCE_ADDR / 0x100);
+    }
+
+    SECTION("Transfers are copied one byte per cycle while OAM is read") {
+        dma.set_bulk_transfers(true, &ppu);
+
+        // The frame starts with the OAM scan of line 0, then goes through
+        // VBlank up to the next one.
+        const auto [cycle, bulk] = GENERATE(table<uint32_t, bool>({
+            {0, false},
+            {VBLANK_CYCLE, true},
+            {FRAME_CYCLES - SIZE, true},
+            {FRAME_CYCLES - SIZE + 1, false},
+        }));
+        for (uint32_t i = 0; i < cycle; ++i) {
+            ppu.tick();
+        }
+
+        mmu.write(DMA_ADDR, RAM_SOURCE_ADDR / 0x100);
+        dma.tick();
+        REQUIRE(mmu.read(OAM_ADDR) == 0xff);
+        REQUIRE((mmu.read(OAM_ADDR + 1) == 0xfe) == bulk);
+        for (uint8_t i = 1; i < SIZE; ++i) {
+            dma.tick();
+        }
+        for (uint8_t i = 0; i < SIZE; ++i) {
+            REQUIRE(mmu.read(OAM_ADDR + i) == 0xff - i);
+        }
+    }
+
+    SECTION("Sources without host pointers are copied one byte per cycle") {
+        mmu.write(LCDC, 0x00);
+        memory::TestMemory memory;
+        for (uint8_t i = 0; i < SIZE; ++i) {
+            memory[SOURCE_ADDR + i] = i;
+        }
+        DMA slow_dma(&memory);
+        slow_dma.set_bulk_transfers(true, &ppu);
+        slow_dma[DMA_ADDR] = SOURCE_ADDR / 0x100;
+
+        slow_dma.tick();
+        REQUIRE(memory[OAM_ADDR] == 0);
+        REQUIRE(memory[OAM_ADDR + 1] != 1);
+        for (uint8_t i = 1; i < SIZE; ++i) {
+            slow_dma.tick();
+        }
+        for (uint8_t i = 0; i < SIZE; ++i) {
+            REQUIRE(memory[OAM_ADDR + i] == i);
+        }
+    }
+}
+
+TEST_CASE("Scheduled bulk DMA", "[ppu][scheduler]") {
+    NoCPU cpu;
+    peripherals::Scheduler scheduler(&cpu);
+    IgnoreInterrupts interrupts;
+    memory::InternalRAM ram;
+    PPU ppu(&interrupts);
+    memory::MMU mmu;
+    mmu.register_region(&ram, memory::RAM_INTERNAL_BEGIN,
+                        memory::RAM_INTERNAL_END);
+    ppu.register_to_mmu(&mmu);
+
+    for (uint8_t i = 0; i < SIZE; ++i) {
+        mmu.write(RAM_SOURCE_ADDR + i, i * 7);
+    }
+
+    DMA dma(&mmu, &scheduler);
+    dma.register_to_mmu(&mmu);
+
+    // Both ways of copying leave the same contents in OAM, at the same time.
+    const bool bulk = GENERATE(false, true);
+    mmu.write(LCDC, 0x00);
+    dma.set_bulk_transfers(bulk, &ppu);
+
+    mmu.write(DMA_ADDR, RAM_SOURCE_ADDR / 0x100);
+    scheduler.run(SIZE - 1);
+    REQUIRE(scheduler.scheduled(&dma));
+    REQUIRE(mmu.read(DMA_ADDR) == 0xff);
+
+    scheduler.run(1);
+    REQUIRE_FALSE(scheduler.scheduled(&dma));
+    REQUIRE(mmu.read(DMA_ADDR) == RAM_SOURCE_ADDR / 0x100);
+    for (uint8_t i = 0; i < SIZE; ++i) {
+        REQUIRE(mmu.read(OAM_ADDR + i) == static_cast<uint8_t>(i * 7));
+    }
+}
+
 }  // namespace ppu
@@ -0,0 +1,359 @@
+#include <catch2/catch.hpp>
+
+#include <algorithm>
+#include <vector>
+
+#include <knocknock/interrupt.h>
+#include <knocknock/peripherals/scheduler.h>
+#include <knocknock/ppu/ppu.h>
+
+#include "peripherals/stubs.h"
+
+namespace ppu {
+
+namespace {
+
+using peripherals::testing::NoCPU;
+
+constexpr memory::MemoryAddr LCDC = 0xff40;
+constexpr memory::MemoryAddr STAT = 0xff41;
+constexpr memory::MemoryAddr SCX = 0xff43;
+constexpr memory::MemoryAddr LY = 0xff44;
+constexpr memory::MemoryAddr LYC = 0xff45;
+constexpr memory::MemoryAddr BGP = 0xff47;
+constexpr memory::MemoryAddr OBP0 = 0xff48;
+constexpr memory::MemoryAddr WY = 0xff4a;
+constexpr memory::MemoryAddr WX = 0xff4b;
+
+constexpr int LINE_CYCLES = 114;
+constexpr int FRAME_CYCLES = LINE_CYCLES * 154;
+
+class RecordInterrupts : public interrupt::Interruptible {
+public:
+    bool interrupt(interrupt::InterruptType reason) override {
+        requests.push_back(reason);
+        return true;
+    }
+
+    [[nodiscard]] size_t count(interrupt::InterruptType reason) const {
+        return std::count(requests.begin(), requests.end(), reason);
+    }
+
+    std::vector<interrupt::InterruptType> requests;
+};
+
+void tick(PPU *ppu, int ticks) {
+    for (int i = 0; i < ticks; ++i) {
+        ppu->tick();
+    }
+}
+
+// Fill every row of the tile at |addr| with the bit planes |low| and |high|.
+void fill_tile(PPU *ppu, memory::MemoryAddr addr, uint8_t low, uint8_t high) {
+    for (int row = 0; row < 8; ++row) {
+        ppu->write(addr + row * 2, low);
+        ppu->write(addr + row * 2 + 1, high);
+    }
+}
+
+void add_sprite(PPU *ppu, int index, uint8_t y, uint8_t x, uint8_t tile,
+                uint8_t attributes) {
+    const memory::MemoryAddr addr = 0xfe00 + index * 4;
+    ppu->write(addr, y);
+    ppu->write(addr + 1, x);
+    ppu->write(addr + 2, tile);
+    ppu->write(addr + 3, attributes);
+}
+
+std::vector<uint8_t> line_of(const PPU &ppu, size_t line) {
+    auto begin = ppu.framebuffer().begin() + line * SCREEN_WIDTH;
+    return {begin, begin + SCREEN_WIDTH};
+}
+
+// A line with |count| pixels of |shade| from |start|, and white elsewhere.
+std::vector<uint8_t> span(size_t start, size_t count, uint8_t shade) {
+    std::vector<uint8_t> line(SCREEN_WIDTH, 0);
+    std::fill_n(line.begin() + start, count, shade);
+    return line;
+}
+
+}  // namespace
+
+TEST_CASE("Scanline renderer", "[ppu]") {
+    RecordInterrupts interrupts;
+    PPU ppu(&interrupts);
+    ppu.write(BGP, 0xe4);
+    ppu.write(OBP0, 0xe4);
+
+    // Tiles 1, 2 and 3 have color indices 1, 2 and 3 respectively.
+    fill_tile(&ppu, 0x8010, 0xff, 0x00);
+    fill_tile(&ppu, 0x8020, 0x00, 0xff);
+    fill_tile(&ppu, 0x8030, 0xff, 0xff);
+
+    // The first tile of the background map is tile 1.
+    ppu.write(0x9800, 0x01);
+
+    SECTION("Background") {
+        ppu.render_line(0);
+        REQUIRE(line_of(ppu, 0) == span(0, 8, 1));
+
+        ppu.write(SCX, 3);
+        ppu.render_line(1);
+        REQUIRE(line_of(ppu, 1) == span(0, 5, 1));
+
+        // Through the palette.
+        ppu.write(BGP, 0x1b);
+        ppu.render_line(2);
+        std::vector<uint8_t> expected(SCREEN_WIDTH, 3);
+        std::fill_n(expected.begin(), 5, 2);
+        REQUIRE(line_of(ppu, 2) == expected);
+    }
+
+    SECTION("Signed tile data") {
+        // Tile -1 is right before $9000.
+        ppu.write(LCDC, 0x81);
+        ppu.write(0x9800, 0xff);
+        fill_tile(&ppu, 0x8ff0, 0x00, 0xff);
+
+        ppu.render_line(0);
+        REQUIRE(line_of(ppu, 0) == span(0, 8, 2));
+    }
+
+    SECTION("Window") {
+        // The window uses the second map, and starts at (80, 2).
+        ppu.write(LCDC, 0xf1);
+        ppu.write(0x9c00, 0x03);
+        ppu.write(WX, 80 + 7);
+        ppu.write(WY, 2);
+
+        ppu.render_line(0);
+        REQUIRE(line_of(ppu, 0) == span(0, 8, 1));
+
+        ppu.render_line(2);
+        REQUIRE(line_of(ppu, 2) == [] {
+            std::vector<uint8_t> line = span(0, 8, 1);
+            std::fill_n(line.begin() + 80, 8, 3);
+            return line;
+        }());
+
+        // Partly off screen.
+        ppu.write(WX, 3);
+        ppu.render_line(3);
+        REQUIRE(line_of(ppu, 3) == span(0, 4, 3));
+    }
+
+    SECTION("Sprites") {
+        ppu.write(LCDC, 0x93);
+
+        // Tile 4 has color indices 1 on the left half, 0 on the right one.
+        fill_tile(&ppu, 0x8040, 0xf0, 0x00);
+
+        add_sprite(&ppu, 0, 16, 20, 0x04, 0x00);
+        add_sprite(&ppu, 1, 16, 40, 0x04, 0x20);  // X flip.
+        add_sprite(&ppu, 2, 16, 12, 0x02, 0x00);
+        add_sprite(&ppu, 3, 16, 8, 0x03, 0x80);  // Behind the background.
+
+        // Sprite 3 is hidden by the background, but still hides the left half
+        // of sprite 2.
+        ppu.render_line(0);
+        std::vector<uint8_t> expected = span(0, 8, 1);
+        std::fill_n(expected.begin() + 8, 4, 2);
+        std::fill_n(expected.begin() + 12, 4, 1);
+        std::fill_n(expected.begin() + 36, 4, 1);
+        REQUIRE(line_of(ppu, 0) == expected);
+
+        // Not on line 8.
+        ppu.render_line(8);
+        REQUIRE(line_of(ppu, 8) == span(0, 0, 0));
+    }
+
+    SECTION("At most 10 sprites per line") {
+        ppu.write(LCDC, 0x93);
+        ppu.write(0x9800, 0x00);
+        for (int i = 0; i < 12; ++i) {
+            add_sprite(&ppu, i, 16, 8 + i * 8, 0x03, 0x00);
+        }
+
+        ppu.render_line(0);
+        REQUIRE(line_of(ppu, 0) == span(0, 80, 3));
+    }
+
+    SECTION("Disabled LCD is blank") {
+        ppu.write(LCDC, 0x11);
+        ppu.render_line(0);
+        REQUIRE(line_of(ppu, 0) == span(0, 0, 0));
+    }
+}
+
+TEST_CASE("PPU modes", "[ppu]") {
+    using interrupt::InterruptType;
+
+    RecordInterrupts interrupts;
+    PPU ppu(&interrupts);
+
+    SECTION("LY and the mode follow the cycle") {
+        REQUIRE(ppu.read(LY) == 0);
+        REQUIRE((ppu.read(STAT) & 0x03) == 2);
+
+        tick(&ppu, 20);
+        REQUIRE((ppu.read(STAT) & 0x03) == 3);
+        tick(&ppu, 43);
+        REQUIRE((ppu.read(STAT) & 0x03) == 0);
+        tick(&ppu, 51);
+        REQUIRE(ppu.read(LY) == 1);
+        REQUIRE((ppu.read(STAT) & 0x03) == 2);
+
+        tick(&ppu, 143 * LINE_CYCLES);
+        REQUIRE(ppu.read(LY) == 144);
+        REQUIRE((ppu.read(STAT) & 0x03) == 1);
+
+        tick(&ppu, 10 * LINE_CYCLES);
+        REQUIRE(ppu.read(LY) == 0);
+        REQUIRE((ppu.read(STAT) & 0x03) == 2);
+    }
+
+    SECTION("VBlank interrupt") {
+        tick(&ppu, 144 * LINE_CYCLES);
+        REQUIRE(interrupts.count(InterruptType::VBLANK) == 0);
+        tick(&ppu, 1);
+        REQUIRE(interrupts.count(InterruptType::VBLANK) == 1);
+
+        tick(&ppu, FRAME_CYCLES);
+        REQUIRE(interrupts.count(InterruptType::VBLANK) == 2);
+        REQUIRE(interrupts.count(InterruptType::LCD_STATUS) == 0);
+    }
+
+    SECTION("LY = LYC") {
+        ppu.write(LYC, 5);
+        ppu.write(STAT, 0x40);
+        REQUIRE((ppu.read(STAT) & 0x04) == 0);
+
+        tick(&ppu, 5 * LINE_CYCLES + 1);
+        REQUIRE(interrupts.count(InterruptType::LCD_STATUS) == 1);
+        REQUIRE((ppu.read(STAT) & 0x04) == 0x04);
+
+        // Writing LYC = LY is a rising edge too.
+        ppu.write(LYC, 6);
+        ppu.write(LYC, 5);
+        REQUIRE(interrupts.count(InterruptType::LCD_STATUS) == 2);
+    }
+
+    SECTION("HBlank interrupt on every visible line") {
+        ppu.write(STAT, 0x08);
+        tick(&ppu, FRAME_CYCLES);
+        REQUIRE(interrupts.count(InterruptType::LCD_STATUS) == 144);
+    }
+
+    SECTION("Lines are drawn as their HBlank starts") {
+        ppu.write(0xff47, 0xff);  // BGP
+        tick(&ppu, 63);
+        REQUIRE(ppu.framebuffer()[0] == 0);
+        tick(&ppu, 1);
+        REQUIRE(ppu.framebuffer()[0] == 3);
+        REQUIRE(ppu.framebuffer()[SCREEN_WIDTH] == 0);
+    }
+
+    SECTION("Disabled LCD") {
+        tick(&ppu, 1000);
+        ppu.write(LCDC, 0x11);
+        REQUIRE(ppu.read(LY) == 0);
+        REQUIRE((ppu.read(STAT) & 0x03) == 0);
+
+        tick(&ppu, FRAME_CYCLES);
+        REQUIRE(interrupts.requests.empty());
+
+        // A new frame starts when enabled again.
+        ppu.write(LCDC, 0x91);
+        tick(&ppu, LINE_CYCLES);
+        REQUIRE(ppu.read(LY) == 1);
+    }
+}
+
+TEST_CASE("Scheduled PPU", "[ppu][scheduler]") {
+    using interrupt::InterruptType;
+
+    // Both run two frames with every source of LCD_STATUS enabled.
+    RecordInterrupts ticked_interrupts;
+    PPU ticked(&ticked_interrupts);
+    ticked.write(STAT, 0x78);
+    ticked.write(LYC, 10);
+    tick(&ticked, 2 * FRAME_CYCLES);
+
+    RecordInterrupts scheduled_interrupts;
+    NoCPU cpu;
+    peripherals::Scheduler scheduler(&cpu);
+    PPU scheduled(&scheduled_interrupts, &scheduler);
+    scheduled.write(STAT, 0x78);
+    scheduled.write(LYC, 10);
+    scheduler.run(2 * FRAME_CYCLES);
+
+    REQUIRE(scheduled_interrupts.count(InterruptType::VBLANK) == 2);
+    REQUIRE(scheduled_interrupts.requests == ticked_interrupts.requests);
+    REQUIRE(scheduled.framebuffer() == ticked.framebuffer());
+
+    scheduler.run(144 * LINE_CYCLES + 30);
+    REQUIRE(scheduled.read(LY) == 144);
+    REQUIRE((scheduled.read(STAT) & 0x03) == 1);
+}
+
+TEST_CASE("Frame skip", "[ppu]") {
+    constexpr memory::MemoryAddr BGP = 0xff47;
+
+    RecordInterrupts interrupts;
+    PPU ppu(&interrupts);
+    ppu.write(STAT, 0x78);
+    ppu.write(BGP, 0xff);
+
+    SECTION("Every Nth frame") {
+        RecordInterrupts reference_interrupts;
+        PPU reference(&reference_interrupts);
+        reference.write(STAT, 0x78);
+        reference.write(BGP, 0xff);
+
+        auto run_frames = [&](int frames) {
+            for (int i = 0; i < frames * FRAME_CYCLES; ++i) {
+                ppu.tick();
+                reference.tick();
+                REQUIRE(ppu.read(LY) == reference.read(LY));
+                REQUIRE(ppu.read(STAT) == reference.read(STAT));
+            }
+        };
+
+        ppu.set_frame_skip(3);
+        run_frames(1);
+        REQUIRE(ppu.framebuffer()[0] == 3);
+
+        // The next two frames are skipped.
+        ppu.write(BGP, 0x00);
+        reference.write(BGP, 0x00);
+        run_frames(2);
+        REQUIRE(ppu.framebuffer()[0] == 3);
+        REQUIRE(reference.framebuffer()[0] == 0);
+
+        run_frames(1);
+        REQUIRE(ppu.framebuffer() == reference.framebuffer());
+
+        REQUIRE(ppu.frames() == 4);
+        REQUIRE(ppu.rendered_frames() == 2);
+        REQUIRE(reference.rendered_frames() == 4);
+        REQUIRE(interrupts.requests == reference_interrupts.requests);
+    }
+
+    SECTION("On demand") {
+        ppu.set_render_on_demand(true);
+        tick(&ppu, FRAME_CYCLES);
+        REQUIRE(ppu.framebuffer()[0] == 0);
+
+        ppu.request_frame();
+        tick(&ppu, FRAME_CYCLES);
+        REQUIRE(ppu.framebuffer()[0] == 3);
+
+        ppu.write(BGP, 0x00);
+        tick(&ppu, FRAME_CYCLES);
+        REQUIRE(ppu.framebuffer()[0] == 3);
+        REQUIRE(ppu.frames() == 3);
+        REQUIRE(ppu.rendered_frames() == 1);
+    }
+}
+
+}  // namespace ppu
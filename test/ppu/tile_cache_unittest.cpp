@@ -0,0 +1,81 @@
+#include <catch2/catch.hpp>
+
+#include <array>
+#include <vector>
+
+#include <knocknock/interrupt.h>
+#include <knocknock/ppu/ppu.h>
+#include <knocknock/ppu/tile_cache.h>
+
+#include "peripherals/stubs.h"
+
+namespace ppu {
+
+namespace {
+
+using peripherals::testing::IgnoreInterrupts;
+
+}  // namespace
+
+TEST_CASE("Tile cache", "[ppu][tile]") {
+    std::array<uint8_t, TILE_COUNT * TILE_SIZE> tile_data = {};
+    TileCache cache(tile_data.data());
+
+    SECTION("Tiles are decoded once until written") {
+        cache.update();
+        REQUIRE(cache.decoded_tiles() == TILE_COUNT);
+
+        cache.update();
+        REQUIRE(cache.decoded_tiles() == TILE_COUNT);
+    }
+
+    SECTION("Only the tiles written are decoded again") {
+        cache.update();
+
+        // The last row of tile 3, and the first of tile 4.
+        tile_data[3 * TILE_SIZE + 14] = 0x80;
+        cache.invalidate(3 * TILE_SIZE + 14);
+        tile_data[4 * TILE_SIZE + 1] = 0x01;
+        cache.invalidate(4 * TILE_SIZE + 1);
+
+        // Past the tile data.
+        cache.invalidate(TILE_COUNT * TILE_SIZE);
+
+        cache.update();
+        REQUIRE(cache.decoded_tiles() == TILE_COUNT + 2);
+        REQUIRE(cache.tile(3)[7 * TILE_WIDTH] == 1);
+        REQUIRE(cache.tile(4)[TILE_WIDTH - 1] == 2);
+    }
+}
+
+TEST_CASE("Renderer only decodes the tiles written", "[ppu][tile]") {
+    IgnoreInterrupts interrupts;
+    PPU ppu(&interrupts);
+    ppu.write(0xff47, 0xe4);  // BGP
+
+    // Tile 0, all over the background, has color index 1.
+    for (int row = 0; row < 8; ++row) {
+        ppu.write(0x8000 + row * 2, 0xff);
+    }
+
+    for (size_t line = 0; line < SCREEN_HEIGHT; ++line) {
+        ppu.render_line(line);
+    }
+    const uint64_t decoded = ppu.tile_cache().decoded_tiles();
+    REQUIRE(ppu.framebuffer()[0] == 1);
+
+    // A static frame decodes nothing.
+    for (size_t line = 0; line < SCREEN_HEIGHT; ++line) {
+        ppu.render_line(line);
+    }
+    REQUIRE(ppu.tile_cache().decoded_tiles() == decoded);
+
+    // Writes to the tile data are drawn.
+    ppu.write(0x8001, 0xff);
+    ppu.render_line(0);
+    REQUIRE(ppu.tile_cache().decoded_tiles() == decoded + 1);
+    REQUIRE(ppu.framebuffer()[0] == 3);
+    REQUIRE(ppu.framebuffer()[SCREEN_WIDTH] == 1);
+}
+
+}  // namespace ppu
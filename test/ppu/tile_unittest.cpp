@@ -0,0 +1,39 @@
+#include <catch2/catch.hpp>
+
+#include <random>
+#include <vector>
+
+#include <knocknock/ppu/tile.h>
+
+namespace ppu {
+
+TEST_CASE("Tile rows are decoded", "[ppu][tile]") {
+    // Rows of the low and high bit planes.
+    const uint8_t row[] = {0x3c, 0x7e};
+    uint8_t pixels[TILE_WIDTH];
+
+    decode_tile_rows(row, 1, pixels);
+    REQUIRE(std::vector<uint8_t>(pixels, pixels + TILE_WIDTH) ==
+            std::vector<uint8_t>{0, 2, 3, 3, 3, 3, 2, 0});
+}
+
+TEST_CASE("Tile decoders agree", "[ppu][tile]") {
+    std::mt19937 rng(42);
+    std::uniform_int_distribution<int> byte(0x00, 0xff);
+
+    // Every count, to go through the vector loops and their tails.
+    for (size_t count = 0; count <= 21; ++count) {
+        std::vector<uint8_t> rows(count * 2);
+        for (uint8_t &value : rows) {
+            value = byte(rng);
+        }
+
+        std::vector<uint8_t> expected(count * TILE_WIDTH);
+        std::vector<uint8_t> actual(count * TILE_WIDTH);
+        decode_tile_rows_scalar(rows.data(), count, expected.data());
+        decode_tile_rows(rows.data(), count, actual.data());
+        REQUIRE(actual == expected);
+    }
+}
+
+}  // namespace ppu